@@ -0,0 +1,286 @@
+/*
+edxbench.cpp - Benchmark the EDX spelling checker, and catch it getting slower
+Uses edxspell.dll (link with edxspell.lib)
+
+   edxbench [-n runs] [-r percent] [-w baseline | -b baseline] [-o option=value] [-a Aux1file] [-s] dictionary ...
+
+Runs edx$lookup_benchmark on each dictionary named: lookups per second and
+the 50th, 90th and 99th percentile time of one lookup for words found in
+the main lexical database, words not found, common words and Aux1 words,
+and the same for guessing the spelling of misspelled words of 2-4, 5-7,
+8-11 and 12 or more letters. Name an ASCII dictionary and one with
+extended ANSI characters to time both kinds of spell guessing.
+
+Each benchmark is run -n times (default 3), and the best of the runs kept
+for each figure, the fastest rate and the shortest times, as the slower
+runs are slower because of whatever else the computer was doing.
+
+   -w baseline   write the results to file 'baseline'
+   -b baseline   compare the results with those in file 'baseline', and
+                 report a figure as REGRESSED if it's more than -r percent
+                 (default 15) worse: fewer per second, or a longer 50th
+                 percentile time. The 90th and 99th percentiles are shown
+                 but aren't held to the threshold, as a lookup takes about
+                 100 ns and its slowest times are at the mercy of whatever
+                 else the computer is doing. Exits with status 1 if
+                 anything regressed.
+   -o n=v        edx$set_option(n, v) for the dictionaries named after it,
+                 to time a configuration (e.g. -o 0=0 for no hash index)
+   -a Aux1file   user's Aux1 dictionary for the next dictionary named
+   -s            time starting up instead, with edx$startup_benchmark:
+                 the first 10,000 lookups after opening each dictionary
+                 with each EDX_OPT_RESIDENCY setting, and the time to
+                 open it and do the first lookup. The open and first
+                 lookup times shown are the first run's; -n 1 shows
+                 just the first, coldest, run.
+
+The baseline file is the report itself, with a "Dictionary" line before
+each dictionary's results, so it can be read and kept with the sources.
+*/
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "edxspell.h"
+
+#define MAX_METRICS   256
+#define REPORT_LEN    2000
+#define ERRBUFLEN     400
+
+/* One line of an edx$lookup_benchmark report:
+      name: rate per second, 50% time, 90% time, 99% time[rest] */
+struct metric {
+   char   dic[80];              /* dictionary it's for */
+   char   name[64];
+   double rate;                 /* per second */
+   double pct[3];               /* 50th, 90th and 99th percentile time */
+   char   unit[4];              /*   in ns or us */
+   char   rest[64];             /* the rest of the line, e.g. ", 31.2 guesses." */
+};
+
+static struct metric results[MAX_METRICS];   /* this run */
+static int nresults;
+static struct metric baseline[MAX_METRICS];  /* from -b file */
+static int nbaseline;
+
+/* Parse a report line into m. Returns FALSE if it isn't a metric line. */
+static BOOL parse_metric(char *line, char *dic, struct metric *m)
+{
+   memset(m, 0, sizeof(struct metric));
+   if (sscanf(line, "%63[^:]: %lf per second, 50%% %lf %3[a-z], 90%% %lf %*[a-z], 99%% %lf %*[a-z]%63[^\n]",
+              m->name, &m->rate, &m->pct[0], m->unit, &m->pct[1], &m->pct[2], m->rest) < 6)
+      return(FALSE);
+   strncpy(m->dic, dic, sizeof(m->dic) - 1);
+   return(TRUE);
+}
+
+static void format_metric(struct metric *m, char *buf, int buflen)
+{
+   _snprintf(buf, buflen, "%s: %.0f per second, 50%% %.1f %s, 90%% %.1f %s, 99%% %.1f %s%s\n",
+             m->name, m->rate, m->pct[0], m->unit, m->pct[1], m->unit, m->pct[2], m->unit, m->rest);
+   buf[buflen-1] = '\0';
+}
+
+static struct metric *find_metric(struct metric *ms, int n, char *dic, char *name)
+{
+   int i;
+   for (i = 0; i < n; ++i)
+      if (strcmp(ms[i].dic, dic) == 0 && strcmp(ms[i].name, name) == 0) return(&ms[i]);
+   return(NULL);
+}
+
+/* Read the -b baseline file */
+static BOOL read_baseline(char *File_Name)
+{
+   char line[256];
+   char dic[80];
+   FILE *fp = fopen(File_Name, "r");
+
+   if (fp == NULL) return(FALSE);
+   dic[0] = '\0';
+   while (fgets(line, sizeof(line), fp) != NULL && nbaseline < MAX_METRICS)
+   {
+      if (strncmp(line, "Dictionary ", 11) == 0)
+      {
+         strncpy(dic, line + 11, sizeof(dic) - 1);
+         dic[sizeof(dic) - 1] = '\0';
+         dic[strcspn(dic, "\r\n")] = '\0';
+      }
+      else if (parse_metric(line, dic, &baseline[nbaseline]))
+         ++nbaseline;
+   }
+   fclose(fp);
+   return(TRUE);
+}
+
+/* Compare m with the baseline. Returns TRUE if it regressed. */
+static BOOL compare_metric(struct metric *m, double threshold)
+{
+   struct metric *b = find_metric(baseline, nbaseline, m->dic, m->name);
+   BOOL regressed = FALSE;
+   double d[4];
+   int i;
+
+   if (b == NULL)
+   {
+      printf("   %s: not in baseline\n", m->name);
+      return(FALSE);
+   }
+   d[0] = (b->rate > 0) ? (m->rate - b->rate) * 100.0 / b->rate : 0.0;
+   for (i = 0; i < 3; ++i)
+      d[i+1] = (b->pct[i] > 0) ? (m->pct[i] - b->pct[i]) * 100.0 / b->pct[i] : 0.0;
+   if (d[0] < -threshold || d[1] > threshold) regressed = TRUE;
+   printf("   %s: per second %+.1f%%, 50%% %+.1f%%, 90%% %+.1f%%, 99%% %+.1f%%%s\n",
+          m->name, d[0], d[1], d[2], d[3], regressed ? "  REGRESSED" : "");
+   return(regressed);
+}
+
+/* The file name part of path */
+static const char *file_part(const char *path)
+{
+   const char *name = path + strlen(path);
+   while (name > path && name[-1] != '\\' && name[-1] != '/' && name[-1] != ':') --name;
+   return(name);
+}
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "usage: edxbench [-n runs] [-r percent] [-w baseline | -b baseline] [-o option=value] [-a Aux1file] [-s] dictionary ...\n"
+      "  -n  runs of each benchmark, best kept (default 3)\n"
+      "  -r  percent worse than the baseline which is a regression (default 15)\n"
+      "  -w  write the results to a baseline file\n"
+      "  -b  compare the results with a baseline file\n"
+      "  -o  edx$set_option(option, value) for the dictionaries after it\n"
+      "  -a  user's Aux1 dictionary for the next dictionary\n"
+      "  -s  time starting up: the first lookups after opening the dictionary\n");
+   exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+   char errbuf[ERRBUFLEN];
+   char report[REPORT_LEN];
+   char text[REPORT_LEN];       /* the report with the best of the runs */
+   char line[256];
+   char dic_name[80];
+   const char *Aux1_File_Name = "";
+   char *Write_File_Name = NULL;
+   char *Base_File_Name = NULL;
+   char *p, *eol;
+   struct edx_dictionary *dic;
+   struct metric m, *best;
+   FILE *wfp = NULL;
+   double threshold = 15.0;
+   int runs = 3;
+   int run, first, i, argi, option;
+   unsigned long value;
+   int regressions = 0;
+   int ndics = 0;
+   BOOL startup = FALSE;
+
+   for (argi = 1; argi < argc; ++argi)
+   {
+      if (argv[argi][0] != '-')         /* a dictionary */
+      {
+         /* Name it by its file name (and its Aux1's), so a baseline is good in any folder */
+         _snprintf(dic_name, sizeof(dic_name), "%s%s%s", file_part(argv[argi]),
+                   (Aux1_File_Name[0] != '\0') ? " + " : "", file_part(Aux1_File_Name));
+         dic_name[sizeof(dic_name)-1] = '\0';
+
+         dic = startup ? NULL : edx$dic_open(argv[argi], (char *)Aux1_File_Name, errbuf, ERRBUFLEN);
+         if (dic == NULL && !startup)
+         {
+            fprintf(stderr, "edxbench: %s: %s\n", argv[argi], errbuf);
+            return(2);
+         }
+         first = nresults;
+         text[0] = '\0';
+         for (run = 0; run < runs; ++run)
+         {
+            if (startup) edx$startup_benchmark(argv[argi], report, REPORT_LEN);
+            else edx$lookup_benchmark(dic, report, REPORT_LEN);
+            for (p = report; *p != '\0'; p = eol)
+            {
+               eol = p + strcspn(p, "\n");
+               if (*eol == '\n') ++eol;
+               _snprintf(line, sizeof(line), "%.*s", (int)(eol - p), p);
+               line[sizeof(line)-1] = '\0';
+               if (!parse_metric(line, dic_name, &m))
+               {
+                  if (run == 0 && strlen(text) + strlen(line) < sizeof(text)) strcat(text, line);
+                  continue;
+               }
+               best = find_metric(results + first, nresults - first, dic_name, m.name);
+               if (best == NULL)
+               {
+                  if (nresults < MAX_METRICS) results[nresults++] = m;
+                  continue;
+               }
+               if (m.rate > best->rate) best->rate = m.rate;
+               for (i = 0; i < 3; ++i)
+                  if (m.pct[i] < best->pct[i]) best->pct[i] = m.pct[i];
+            }
+         }
+         if (dic != NULL) edx$dic_close(dic);
+         ++ndics;
+         for (i = first; i < nresults; ++i)
+         {
+            format_metric(&results[i], line, sizeof(line));
+            if (strlen(text) + strlen(line) < sizeof(text)) strcat(text, line);
+         }
+
+         printf("Dictionary %s\n%s", dic_name, text);
+         if (Write_File_Name != NULL)
+         {
+            if (wfp == NULL) wfp = fopen(Write_File_Name, "w");
+            if (wfp == NULL)
+            {
+               fprintf(stderr, "edxbench: can't write %s\n", Write_File_Name);
+               return(2);
+            }
+            fprintf(wfp, "Dictionary %s\n%s", dic_name, text);
+         }
+         if (Base_File_Name != NULL)
+         {
+            printf("Compared with %s:\n", Base_File_Name);
+            for (i = first; i < nresults; ++i)
+               if (compare_metric(&results[i], threshold)) ++regressions;
+         }
+         Aux1_File_Name = "";
+         continue;
+      }
+
+      if (strcmp(argv[argi], "-s") == 0) { startup = TRUE; continue; }
+      if (argv[argi][1] == '\0' || argv[argi][2] != '\0' || argi + 1 >= argc) usage();
+      switch (argv[argi][1])
+      {
+      case 'n': runs = atoi(argv[++argi]); if (runs < 1) runs = 1; break;
+      case 'r': threshold = atof(argv[++argi]); break;
+      case 'w': Write_File_Name = argv[++argi]; break;
+      case 'b':
+         Base_File_Name = argv[++argi];
+         if (!read_baseline(Base_File_Name))
+         {
+            fprintf(stderr, "edxbench: can't read %s\n", Base_File_Name);
+            return(2);
+         }
+         break;
+      case 'o':
+         if (sscanf(argv[++argi], "%d=%lu", &option, &value) != 2) usage();
+         if (edx$set_option(option, value) == EDX__ERROR) { fprintf(stderr, "edxbench: no option %d\n", option); return(2); }
+         break;
+      case 'a': Aux1_File_Name = argv[++argi]; break;
+      default: usage();
+      }
+   }
+   if (ndics == 0) usage();
+   if (wfp != NULL) fclose(wfp);
+
+   if (Base_File_Name != NULL)
+   {
+      if (regressions > 0) printf("%d figures regressed more than %.0f%%.\n", regressions, threshold);
+      else printf("Nothing regressed more than %.0f%%.\n", threshold);
+   }
+   return((regressions > 0) ? 1 : 0);
+}
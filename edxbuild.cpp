@@ -0,0 +1,673 @@
+/*
+edxbuild.cpp - Build an EDX dictionary from a word list
+Uses edxspell.dll to check the dictionary it built (link with edxspell.lib)
+
+   edxbuild [-t threads] [-V version] [-i indexes] [-z] [-p dicpln] [-g indswd] [-f] [-c ncommon] [-C commonfile] [-n] wordlist dictionary
+
+Reads the word list (words separated by spaces or line breaks, in the
+ANSI character set), lowercases the words, sorts them and drops the
+duplicates, and writes an EDX lexical database that edxspell.dll can load:
+
+   header        version byte, "EDXdict", then the dichead_layout offsets
+   guide words   one per dictionary page, indswd characters, blank padded
+   main lexical database
+                 each word as a length byte and its characters, in order,
+                 a NULL after the last, padded to a whole number of pages
+   common words  the same way, most common first, and a NULL
+
+The guide word of a page is the first word which begins on that page, so
+binsrch_maindic's page range always holds the word. Words may run over
+from one page to the next.
+
+   -t threads   threads to sort with (default one per processor)
+   -V 4, 5 or 6 lexical database version (default 5). Version 4 has no
+                flags field and can't hold characters above 127. Version 5
+                sets the Extended_ANSI_Guessing flag if any word has one.
+                Version 6 has 64 bit offsets, a section table with
+                checksums, sections on page boundaries, and the indexes
+                named by -i saved in it (see VERSION 6 DICTIONARIES in
+                edxspell.cpp). It needs edxspell.dll version 6 or later.
+   -i indexes   indexes to save in a version 6 dictionary (default hb):
+                h hash index, b Bloom filter, s suggestion index,
+                d word graph
+   -z           front code a version 6 dictionary's pages: each word
+                stored as how many characters it shares with the word
+                before it and the rest, which makes the main lexical
+                database about half the size. The hash index, suggestion
+                index and word graph point at whole words, so only the
+                Bloom filter is saved with it (-i b, the default with -z).
+   -p dicpln    dictionary page length (default 512, 64 to 65536). Longer
+                pages mean fewer guide words, and more to scan per lookup.
+   -g indswd    guide word length (default 10, 2 to 32)
+   -f           each word in the word list is followed by how often it's
+                used. The -c most used words are the common words.
+   -c ncommon   number of common words (default 100 with -f, otherwise 0)
+   -C file      the common words are the words in this file
+   -n           don't check the dictionary after building it
+
+The words are sorted in parallel: the list is cut into one run per thread,
+each thread sorts its run, and then pairs of runs are merged by pairs of
+threads until there's one. Then every word of the word list is looked up
+in the new dictionary with edx$session_lookup_words, by binary search of
+the guide words and by the guide word index acceleration (the hash index
+and Bloom filter off, so the pages themselves are searched), and edxbuild
+says how many weren't found, which should be none.
+
+A version 6 dictionary is made by writing a version 5 one (dictionary.tmp),
+opening it with edx$dic_open with the options for the -i indexes set, so
+edxspell.dll builds them, and writing it out with edx$dic_save. Its check
+also verifies every section's checksum with edx$dic_verify, and looks the
+words up a third time with the saved hash index and Bloom filter (just
+the Bloom filter if it's front coded).
+*/
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "edxspell.h"
+
+#define MAX_THREADS     64
+#define CHECK_BATCH     4096
+#define ERRBUFLEN       400
+#define INFOLEN         2000
+#define SPACE           0x20
+
+/* A word of the word list, lowercased in place */
+struct word_ref {
+   unsigned __int64 key;         /* first 8 characters, most significant first, 0 padded */
+   unsigned char *p;
+   DWORD len;
+   DWORD count;                  /* how often it's used (-f), summed over duplicates */
+   DWORD common;                 /* listed in the -C file */
+};
+
+/* A run of words for a thread to sort or merge */
+struct sort_job {
+   struct word_ref *a;           /* a[0..na) */
+   DWORD na;
+   struct word_ref *b;           /* merge with b[0..nb) */
+   DWORD nb;
+   struct word_ref *out;         /*   into out */
+};
+
+static struct word_ref *words;
+static DWORD nwords, wordssize;
+static int nthreads;
+
+// See file "EDX_lowercasing_extended_letters.htm" (as ANSItolower in edxspell.cpp)
+static unsigned char ANSItolower(unsigned char c)
+{
+    if ( ((c >= 65) && (c <= 90)) || ( (c >= 192) && (c <= 222) && (c != 215) ) )
+      return( (unsigned char)(c+0x20) );
+    else if (c == 159)                 //LATIN CAPITAL LETTER Y WITH DIAERESIS
+      return( (unsigned char)(255) );  //LATIN SMALL LETTER Y WITH DIAERESIS
+    else
+      return( (unsigned char)(c) );
+}
+
+static double elapsed_s(LARGE_INTEGER start)
+{
+   LARGE_INTEGER now, freq;
+   QueryPerformanceCounter(&now);
+   QueryPerformanceFrequency(&freq);
+   return( (double)(now.QuadPart - start.QuadPart) / (double)freq.QuadPart );
+}
+
+static void out_of_memory(void)
+{
+   fprintf(stderr, "edxbuild: out of memory\n");
+   exit(2);
+}
+
+/* Read a whole file into memory, with a NULL after it */
+static unsigned char *read_file(char *File_Name, DWORD *len)
+{
+   unsigned char *buf;
+   long size;
+   FILE *fp = fopen(File_Name, "rb");
+
+   if (fp == NULL) { fprintf(stderr, "edxbuild: can't open %s\n", File_Name); exit(2); }
+   fseek(fp, 0, SEEK_END);
+   size = ftell(fp);
+   fseek(fp, 0, SEEK_SET);
+   buf = new unsigned char[size + 1];
+   if (buf == NULL) out_of_memory();
+   *len = (DWORD)fread(buf, 1, size, fp);
+   buf[*len] = '\0';
+   fclose(fp);
+   return(buf);
+}
+
+/*----- .SUBTITLE READ THE WORD LIST
+ Functional Description:
+    Split buf[len) into words (anything 32 or below separates words, as in
+    edxspell.cpp), lowercase them in place, and add them to words[].
+    Words longer than MAXWORDLEN are skipped and counted in *toolong.
+    If 'counts', every other token is the count of the word before it.
+---------------------------------------------------------------------------*/
+static void add_words(unsigned char *buf, DWORD len, BOOL counts, BOOL common, DWORD *toolong)
+{
+   unsigned char *p = buf, *end = buf + len, *wdbeg;
+   struct word_ref *w;
+   DWORD wdlen, i;
+
+   for (;;)
+   {
+      while (p < end && *p <= 32) ++p;
+      if (p == end) break;
+      for (wdbeg = p; p < end && *p > 32; ++p);
+      wdlen = (DWORD)(p - wdbeg);
+      if (counts && nwords > 0 && words[nwords-1].count == (DWORD)-1)
+      {
+         words[nwords-1].count = (DWORD)strtoul((char *)wdbeg, NULL, 10);
+         continue;
+      }
+      if (wdlen > MAXWORDLEN)
+      {
+         ++*toolong;
+         if (counts) { while (p < end && *p <= 32) ++p; while (p < end && *p > 32) ++p; }  /* and its count */
+         continue;
+      }
+      if (nwords == wordssize)
+      {
+         wordssize = (wordssize == 0) ? 0x10000 : wordssize * 2;
+         w = new struct word_ref[wordssize];
+         if (w == NULL) out_of_memory();
+         if (nwords > 0) memcpy(w, words, nwords * sizeof(struct word_ref));
+         delete[] words;
+         words = w;
+      }
+      w = &words[nwords++];
+      w->key = 0;
+      for (i = 0; i < wdlen; ++i)
+      {
+         wdbeg[i] = ANSItolower(wdbeg[i]);
+         if (i < 8) w->key |= (unsigned __int64)wdbeg[i] << (56 - 8*i);
+      }
+      w->p = wdbeg;
+      w->len = wdlen;
+      w->count = counts ? (DWORD)-1 : 0;     /* -1 until its count is read */
+      w->common = common;
+   }
+   if (counts && nwords > 0 && words[nwords-1].count == (DWORD)-1) words[nwords-1].count = 0;
+}
+
+/*----- .SUBTITLE SORT THE WORDS
+ Functional Description:
+    Sort words[] in parallel, in the order of the main lexical database
+    (memcmp order, and a word before any longer word it begins), and drop
+    the duplicates. Most words differ in their first 8 characters, which
+    are compared as one number (word_ref.key) without going to the words.
+---------------------------------------------------------------------------*/
+static int compare_words(const void *x, const void *y)
+{
+   const struct word_ref *a = (const struct word_ref *)x;
+   const struct word_ref *b = (const struct word_ref *)y;
+   int cmp;
+
+   if (a->key != b->key) return( (a->key < b->key) ? -1 : 1 );
+   if (a->len > 8 && b->len > 8)
+   {
+      cmp = memcmp(a->p + 8, b->p + 8, ((a->len < b->len) ? a->len : b->len) - 8);
+      if (cmp != 0) return(cmp);
+   }
+   return( (a->len < b->len) ? -1 : (a->len > b->len) );
+}
+
+static DWORD WINAPI sort_thread(LPVOID param)
+{
+   struct sort_job *job = (struct sort_job *)param;
+   qsort(job->a, job->na, sizeof(struct word_ref), compare_words);
+   return(0);
+}
+
+static DWORD WINAPI merge_thread(LPVOID param)
+{
+   struct sort_job *job = (struct sort_job *)param;
+   struct word_ref *a = job->a, *aend = job->a + job->na;
+   struct word_ref *b = job->b, *bend = job->b + job->nb;
+   struct word_ref *out = job->out;
+
+   while (a < aend && b < bend)
+      *out++ = (compare_words(b, a) < 0) ? *b++ : *a++;
+   while (a < aend) *out++ = *a++;
+   while (b < bend) *out++ = *b++;
+   return(0);
+}
+
+static void run_jobs(LPTHREAD_START_ROUTINE routine, struct sort_job *jobs, int njobs)
+{
+   HANDLE threads[MAX_THREADS];
+   int j;
+
+   for (j = 0; j < njobs; ++j)
+   {
+      threads[j] = CreateThread(NULL, 0, routine, &jobs[j], 0, NULL);
+      if (threads[j] == NULL) routine(&jobs[j]);       /* do it here then */
+   }
+   for (j = 0; j < njobs; ++j)
+   {
+      if (threads[j] == NULL) continue;
+      WaitForSingleObject(threads[j], INFINITE);
+      CloseHandle(threads[j]);
+   }
+}
+
+static void sort_words(void)
+{
+   struct sort_job jobs[MAX_THREADS];
+   DWORD start[MAX_THREADS + 1];
+   struct word_ref *tmp, *t;
+   DWORD i, n;
+   int nruns, j;
+
+   nruns = (nwords < (DWORD)nthreads * 1024) ? 1 : nthreads;
+   for (j = 0; j <= nruns; ++j)
+      start[j] = (DWORD)((unsigned __int64)nwords * j / nruns);
+   for (j = 0; j < nruns; ++j)
+   {
+      jobs[j].a = words + start[j];
+      jobs[j].na = start[j+1] - start[j];
+   }
+   run_jobs(sort_thread, jobs, nruns);
+
+   /* Merge pairs of runs until there's one */
+   tmp = new struct word_ref[nwords + 1];
+   if (tmp == NULL) out_of_memory();
+   while (nruns > 1)
+   {
+      for (j = 0; j < nruns / 2; ++j)
+      {
+         jobs[j].a = words + start[2*j];
+         jobs[j].na = start[2*j+1] - start[2*j];
+         jobs[j].b = words + start[2*j+1];
+         jobs[j].nb = start[2*j+2] - start[2*j+1];
+         jobs[j].out = tmp + start[2*j];
+      }
+      run_jobs(merge_thread, jobs, nruns / 2);
+      if (nruns & 1)                                    /* the odd run out */
+         memcpy(tmp + start[nruns-1], words + start[nruns-1], (start[nruns] - start[nruns-1]) * sizeof(struct word_ref));
+      for (j = 0; j <= nruns / 2; ++j) start[j] = start[2*j];
+      start[(nruns + 1) / 2] = nwords;
+      nruns = (nruns + 1) / 2;
+      t = words; words = tmp; tmp = t;
+   }
+   delete[] tmp;
+
+   /* Drop the duplicates */
+   for (i = 0, n = 0; i < nwords; ++i)
+   {
+      if (n > 0 && compare_words(&words[i], &words[n-1]) == 0)
+      {
+         words[n-1].count += words[i].count;
+         words[n-1].common |= words[i].common;
+         continue;
+      }
+      words[n++] = words[i];
+   }
+   nwords = n;
+}
+
+/*----- .SUBTITLE PICK THE COMMON WORDS
+ Functional Description:
+    The common words are searched before the main lexical database, so
+    they're the words used most: the ncommon with the highest counts
+    (-f), and any listed in the -C file. Most used first.
+    Returns how many, in common[].
+---------------------------------------------------------------------------*/
+static DWORD pick_common(DWORD *common, DWORD ncommon)
+{
+   DWORD i, n = 0, k;
+
+   for (i = 0; i < nwords; ++i)
+   {
+      if (words[i].common) continue;               /* added below */
+      if (n == ncommon && (n == 0 || words[i].count <= words[common[n-1]].count)) continue;
+      if (n < ncommon) ++n;
+      for (k = n - 1; k > 0 && words[common[k-1]].count < words[i].count; --k)
+         common[k] = common[k-1];
+      common[k] = i;
+   }
+   while (n > 0 && words[common[n-1]].count == 0) --n;   /* never used, so not common */
+   for (i = 0; i < nwords; ++i)
+      if (words[i].common) common[n++] = i;
+   return(n);
+}
+
+/*----- .SUBTITLE WRITE THE DICTIONARY
+---------------------------------------------------------------------------*/
+static BOOL write_dictionary(char *Dic_File_Name, int version, DWORD dicpln, DWORD indswd,
+                             DWORD *common, DWORD ncommon, BOOL extended, DWORD *lexlen, DWORD *npages)
+{
+   DWORD header[10];           /* lexofst .. flags, as struct dichead_layout */
+   unsigned char id[8];
+   unsigned char *lex, *idx, *cwd, *lbptr;
+   DWORD headerlen, idxlen, cwdlen, cwdmln, page, i, len;
+   FILE *fp;
+   BOOL ok;
+
+   /* Main lexical database, and a guide word for each page */
+   len = 1;
+   for (i = 0; i < nwords; ++i) len += words[i].len + 1;
+   *npages = (len + dicpln - 1) / dicpln;
+   *lexlen = *npages * dicpln;
+   idxlen = *npages * indswd;
+   lex = new unsigned char[*lexlen];
+   idx = new unsigned char[idxlen];
+   if (lex == NULL || idx == NULL) out_of_memory();
+   memset(lex, 0, *lexlen);
+   memset(idx, SPACE, idxlen);
+   for (i = 0, lbptr = lex, page = 0; i < nwords; ++i)
+   {
+      while (page < *npages && (DWORD)(lbptr - lex) >= page * dicpln)   /* first word beginning on the page */
+      {
+         memcpy(idx + page * indswd, words[i].p, (words[i].len < indswd) ? words[i].len : indswd);
+         ++page;
+      }
+      *lbptr++ = (unsigned char)words[i].len;
+      memcpy(lbptr, words[i].p, words[i].len);
+      lbptr += words[i].len;
+   }
+   for ( ; page < *npages && nwords > 0; ++page)                   /* pages after the last word */
+      memcpy(idx + page * indswd, words[nwords-1].p, (words[nwords-1].len < indswd) ? words[nwords-1].len : indswd);
+
+   /* Common words */
+   cwdlen = 1;
+   cwdmln = 0;
+   for (i = 0; i < ncommon; ++i)
+   {
+      cwdlen += words[common[i]].len + 1;
+      if (words[common[i]].len > cwdmln) cwdmln = words[common[i]].len;
+   }
+   cwd = new unsigned char[cwdlen];
+   if (cwd == NULL) out_of_memory();
+   for (i = 0, lbptr = cwd; i < ncommon; ++i)
+   {
+      *lbptr++ = (unsigned char)words[common[i]].len;
+      memcpy(lbptr, words[common[i]].p, words[common[i]].len);
+      lbptr += words[common[i]].len;
+   }
+   *lbptr = '\0';
+
+   /* Header. Version 4 has no flags. */
+   headerlen = sizeof(id) + ((version == 4) ? 9 : 10) * sizeof(DWORD);
+   id[0] = (unsigned char)version;
+   memcpy(id + 1, "EDXdict", 7);
+   header[0] = headerlen + idxlen;                /* lexofst */
+   header[1] = *lexlen;                           /* lexlen */
+   header[2] = headerlen;                         /* indofst */
+   header[3] = *npages;                           /* nidxwds */
+   header[4] = indswd;                            /* indswd */
+   header[5] = dicpln;                            /* dicpln */
+   header[6] = header[0] + *lexlen;               /* cwdofst */
+   header[7] = cwdlen;                            /* cwdlen */
+   header[8] = cwdmln;                            /* cwdmln */
+   header[9] = extended ? 0x00000001 : 0;         /* flags */
+
+   fp = fopen(Dic_File_Name, "wb");
+   if (fp == NULL) { fprintf(stderr, "edxbuild: can't write %s\n", Dic_File_Name); exit(2); }
+   ok =    fwrite(id, sizeof(id), 1, fp) == 1
+        && fwrite(header, headerlen - sizeof(id), 1, fp) == 1
+        && fwrite(idx, idxlen, 1, fp) == 1
+        && fwrite(lex, *lexlen, 1, fp) == 1
+        && fwrite(cwd, cwdlen, 1, fp) == 1;
+   if (fclose(fp) != 0) ok = FALSE;
+   delete[] lex;
+   delete[] idx;
+   delete[] cwd;
+   return(ok);
+}
+
+/*----- .SUBTITLE WRITE A VERSION 6 DICTIONARY
+ Functional Description:
+    Open version 5 dictionary Tmp_File_Name with the options for the
+    indexes wanted set, so edxspell.dll builds them, and save it as
+    version 6 dictionary Dic_File_Name. The version 5 dictionary and the
+    index files edxspell.dll saved next to it are deleted. The pages are
+    front coded if frontcode. edx$dic_info of the new dictionary is
+    returned in info[INFOLEN].
+---------------------------------------------------------------------------*/
+static void write_v6_dictionary(char *Tmp_File_Name, char *Dic_File_Name, const char *indexes, BOOL frontcode, char *info)
+{
+   char errbuf[ERRBUFLEN];
+   char Index_File_Name[MAX_PATH];
+   struct edx_dictionary *dic;
+   int status;
+
+   edx$set_option(EDX_OPT_HASH_INDEX, strchr(indexes, 'h') != NULL);
+   edx$set_option(EDX_OPT_BLOOM_BITS, (strchr(indexes, 'b') != NULL) ? 10 : 0);
+   edx$set_option(EDX_OPT_SYMSPELL, (strchr(indexes, 's') != NULL) ? 2 : 0);
+   edx$set_option(EDX_OPT_DAWG, strchr(indexes, 'd') != NULL);
+   edx$set_option(EDX_OPT_LOOKUP_CACHE, 0);
+   edx$set_option(EDX_OPT_GUESS_CACHE, 0);
+   edx$set_option(EDX_OPT_FRONT_CODE, frontcode);
+   dic = edx$dic_open(Tmp_File_Name, (char *)"", errbuf, ERRBUFLEN);
+   if (dic == NULL) { fprintf(stderr, "edxbuild: %s\n", errbuf); exit(2); }
+   status = edx$dic_save(dic, Dic_File_Name, errbuf, ERRBUFLEN);
+   edx$dic_close(dic);
+   DeleteFile(Tmp_File_Name);
+   _snprintf(Index_File_Name, MAX_PATH, "%s.sym", Dic_File_Name);   /* EDX.dic.tmp -> EDX.dic.sym */
+   Index_File_Name[MAX_PATH-1] = '\0';
+   DeleteFile(Index_File_Name);
+   _snprintf(Index_File_Name, MAX_PATH, "%s.dwg", Dic_File_Name);
+   Index_File_Name[MAX_PATH-1] = '\0';
+   DeleteFile(Index_File_Name);
+   if (status != EDX__WORDFOUND) { fprintf(stderr, "edxbuild: %s\n", errbuf); exit(2); }
+
+   dic = edx$dic_open(Dic_File_Name, (char *)"", errbuf, ERRBUFLEN);   /* with the same options, it maps the indexes */
+   if (dic == NULL) { fprintf(stderr, "edxbuild: %s\n", errbuf); exit(2); }
+   edx$dic_info(dic, info, INFOLEN);
+   edx$dic_close(dic);
+}
+
+/*----- .SUBTITLE CHECK THE DICTIONARY
+ Functional Description:
+    Look every word up in the dictionary just built, with the hash index
+    and Bloom filter off so the guide words and pages are searched: once
+    with the guide word index acceleration, once with the original binary
+    search. A version 6 dictionary's sections are checked against their
+    checksums, and its words looked up a third time with the hash index
+    and Bloom filter saved in it (the Bloom filter alone if frontcode, as
+    the hash index would have the pages decoded). Returns how many
+    lookups didn't find their word (should be 0).
+---------------------------------------------------------------------------*/
+static DWORD check_dictionary(char *Dic_File_Name, int version, BOOL frontcode)
+{
+   struct edx_wordref batch[CHECK_BATCH];
+   int status[CHECK_BATCH];
+   char errbuf[ERRBUFLEN];
+   struct edx_dictionary *dic;
+   struct edx_session *ses;
+   DWORD notfound = 0, i, n, pass;
+   int k;
+
+   edx$set_option(EDX_OPT_HASH_INDEX, 0);
+   edx$set_option(EDX_OPT_BLOOM_BITS, 0);
+   edx$set_option(EDX_OPT_LOOKUP_CACHE, 0);
+   edx$set_option(EDX_OPT_GUESS_CACHE, 0);
+   edx$set_option(EDX_OPT_SYMSPELL, 0);
+   edx$set_option(EDX_OPT_DAWG, 0);
+   for (pass = 0; pass < ((version == 6) ? 3u : 2u); ++pass)
+   {
+      edx$set_option(EDX_OPT_GUIDE_INDEX, pass > 0);
+      if (pass == 2)                    /* the version 6 dictionary's saved indexes */
+      {
+         edx$set_option(EDX_OPT_HASH_INDEX, !frontcode);
+         edx$set_option(EDX_OPT_BLOOM_BITS, 10);
+      }
+      dic = edx$dic_open(Dic_File_Name, (char *)"", errbuf, ERRBUFLEN);
+      if (dic == NULL) { fprintf(stderr, "edxbuild: %s\n", errbuf); exit(2); }
+      if (pass == 0 && edx$dic_verify(dic, errbuf, ERRBUFLEN) != EDX__WORDFOUND)
+      {
+         fprintf(stderr, "edxbuild: %s\n", errbuf);
+         exit(1);
+      }
+      ses = edx$session_create(dic);
+      if (ses == NULL) out_of_memory();
+      for (i = 0; i < nwords; i += n)
+      {
+         n = (nwords - i < CHECK_BATCH) ? nwords - i : CHECK_BATCH;
+         for (k = 0; k < (int)n; ++k)
+         {
+            batch[k].wdbeg = (char *)words[i+k].p;
+            batch[k].wdlen = (int)words[i+k].len;
+         }
+         if (edx$session_lookup_words(ses, batch, (int)n, status, errbuf, ERRBUFLEN) == EDX__ERROR)
+         {
+            fprintf(stderr, "edxbuild: %s\n", errbuf);
+            exit(2);
+         }
+         for (k = 0; k < (int)n; ++k)
+            if (status[k] != EDX__WORDFOUND)
+            {
+               if (notfound < 10) fprintf(stderr, "edxbuild: %.*s not found\n", (int)words[i+k].len, words[i+k].p);
+               ++notfound;
+            }
+      }
+      edx$session_delete(ses);
+      edx$dic_close(dic);
+   }
+   return(notfound);
+}
+
+/*----- .SUBTITLE MAIN
+---------------------------------------------------------------------------*/
+static void usage(void)
+{
+   fprintf(stderr,
+      "usage: edxbuild [-t threads] [-V version] [-i indexes] [-z] [-p dicpln] [-g indswd] [-f] [-c ncommon] [-C commonfile] [-n] wordlist dictionary\n"
+      "  -t  threads to sort with (default one per processor)\n"
+      "  -V  lexical database version, 4, 5 or 6 (default 5)\n"
+      "  -i  indexes to save in a version 6 dictionary: h hash, b Bloom filter,\n"
+      "      s suggestion index, d word graph (default hb)\n"
+      "  -z  front code a version 6 dictionary's pages (Bloom filter only)\n"
+      "  -p  dictionary page length (default 512)\n"
+      "  -g  guide word length (default 10)\n"
+      "  -f  each word is followed by how often it's used\n"
+      "  -c  number of common words, the most used (default 100 with -f)\n"
+      "  -C  file of common words\n"
+      "  -n  don't check the dictionary after building it\n");
+   exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+   SYSTEM_INFO si;
+   LARGE_INTEGER start, phase;
+   unsigned char *list, *clist;
+   DWORD listlen, clistlen, toolong = 0, extended = 0, inwords;
+   DWORD dicpln = 512, indswd = 10, ncommon = (DWORD)-1, lexlen, npages, notfound;
+   DWORD *common;
+   char *Common_File_Name = NULL;
+   const char *indexes = NULL;
+   char Tmp_File_Name[MAX_PATH];
+   char info[INFOLEN];
+   BOOL counts = FALSE, check = TRUE, frontcode = FALSE;
+   int version = 5;
+   int argi;
+   DWORD i, k;
+   double readsecs, sortsecs, writesecs;
+
+   GetSystemInfo(&si);
+   nthreads = (int)si.dwNumberOfProcessors;
+   for (argi = 1; argi < argc && argv[argi][0] == '-'; ++argi)
+   {
+      if (argv[argi][1] == '\0' || argv[argi][2] != '\0') usage();
+      switch (argv[argi][1])
+      {
+      case 'f': counts = TRUE; continue;
+      case 'n': check = FALSE; continue;
+      case 'z': frontcode = TRUE; continue;
+      }
+      if (argi + 1 >= argc) usage();
+      switch (argv[argi][1])
+      {
+      case 't': nthreads = atoi(argv[++argi]); break;
+      case 'V': version = atoi(argv[++argi]); break;
+      case 'i': indexes = argv[++argi]; break;
+      case 'p': dicpln = (DWORD)atoi(argv[++argi]); break;
+      case 'g': indswd = (DWORD)atoi(argv[++argi]); break;
+      case 'c': ncommon = (DWORD)atoi(argv[++argi]); break;
+      case 'C': Common_File_Name = argv[++argi]; break;
+      default: usage();
+      }
+   }
+   if (argc - argi != 2) usage();
+   if (version < 4 || version > 6) { fprintf(stderr, "edxbuild: version must be 4, 5 or 6\n"); return(2); }
+   if (frontcode && version != 6) { fprintf(stderr, "edxbuild: only a version 6 dictionary can be front coded\n"); return(2); }
+   if (indexes == NULL) indexes = frontcode ? "b" : "hb";
+   if (strspn(indexes, "hbsd") != strlen(indexes)) { fprintf(stderr, "edxbuild: indexes are h, b, s and d\n"); return(2); }
+   if (frontcode && strspn(indexes, "b") != strlen(indexes))
+   {
+      fprintf(stderr, "edxbuild: a front coded dictionary can only have the Bloom filter saved in it\n");
+      return(2);
+   }
+   if (dicpln < 64 || dicpln > 65536) { fprintf(stderr, "edxbuild: page length must be 64 to 65536\n"); return(2); }
+   if (indswd < 2 || indswd > MAXWORDLEN+1) { fprintf(stderr, "edxbuild: guide word length must be 2 to %d\n", MAXWORDLEN+1); return(2); }
+   if (nthreads < 1) nthreads = 1;
+   if (nthreads > MAX_THREADS) nthreads = MAX_THREADS;
+   if (ncommon == (DWORD)-1) ncommon = counts ? 100 : 0;
+
+   /* Read */
+   QueryPerformanceCounter(&start);
+   list = read_file(argv[argi], &listlen);
+   add_words(list, listlen, counts, FALSE, &toolong);
+   if (Common_File_Name != NULL)
+   {
+      clist = read_file(Common_File_Name, &clistlen);
+      add_words(clist, clistlen, FALSE, TRUE, &toolong);
+   }
+   inwords = nwords;
+   for (i = 0; i < nwords; ++i)
+      for (k = 0; k < words[i].len; ++k)
+         if (words[i].p[k] > 127) { ++extended; break; }
+   if (extended > 0 && version == 4)
+   {
+      fprintf(stderr, "edxbuild: %lu words have characters above 127, which a version 4 dictionary can't hold. Use -V 5.\n",
+              (unsigned long)extended);
+      return(2);
+   }
+   readsecs = elapsed_s(start);
+
+   /* Sort */
+   QueryPerformanceCounter(&phase);
+   sort_words();
+   sortsecs = elapsed_s(phase);
+
+   /* Write */
+   QueryPerformanceCounter(&phase);
+   common = new DWORD[ncommon + nwords + 1];
+   if (common == NULL) out_of_memory();
+   ncommon = pick_common(common, ncommon);
+   _snprintf(Tmp_File_Name, MAX_PATH, "%s%s", argv[argi+1], (version == 6) ? ".tmp" : "");
+   Tmp_File_Name[MAX_PATH-1] = '\0';
+   if (!write_dictionary(Tmp_File_Name, (version == 6) ? 5 : version, dicpln, indswd, common, ncommon, (extended > 0), &lexlen, &npages))
+   {
+      fprintf(stderr, "edxbuild: error writing %s\n", Tmp_File_Name);
+      return(2);
+   }
+   if (version == 6) write_v6_dictionary(Tmp_File_Name, argv[argi+1], indexes, frontcode, info);
+   writesecs = elapsed_s(phase);
+
+   printf("%lu words read", (unsigned long)inwords);
+   if (toolong > 0) printf(" (%lu more longer than %d characters skipped)", (unsigned long)toolong, MAXWORDLEN);
+   printf(", %lu different.\n", (unsigned long)nwords);
+   printf("Version %d dictionary %s: %lu pages of %lu bytes%s, %lu character guide words, %lu common words%s.\n",
+          version, argv[argi+1], (unsigned long)npages, (unsigned long)dicpln, frontcode ? " before front coding" : "",
+          (unsigned long)indswd, (unsigned long)ncommon, (extended > 0) ? ", extended ANSI guessing" : "");
+   if (version == 6) printf("%s", info);
+   printf("Read %.2f s, sorted with %d threads %.2f s, written %.2f s.\n", readsecs, nthreads, sortsecs, writesecs);
+
+   /* Check */
+   if (check)
+   {
+      QueryPerformanceCounter(&phase);
+      notfound = check_dictionary(argv[argi+1], version, frontcode);
+      printf("Checked in %.2f s: ", elapsed_s(phase));
+      if (notfound == 0) printf("every word found, by both guide word searches%s.\n",
+                                (version == 6) ? " and the saved indexes, and every section's checksum good" : "");
+      else printf("%lu lookups didn't find their word.\n", (unsigned long)notfound);
+      if (notfound > 0) return(1);
+   }
+   return(0);
+}
@@ -0,0 +1,591 @@
+/*
+edxcheck.cpp - Check the spelling of a whole collection of documents
+Uses edxspell.dll (link with edxspell.lib)
+
+   edxcheck [-t threads] [-s suggestions] [-c chunkKB] [-a Aux1file] [-l layer ...] [-S text|json] [-L text|json] [-T tracefile] dictionary file-or-folder ...
+
+Every file named, and every file in every folder named (and in its
+subfolders), is checked against the EDX dictionary. Prints for each file the
+number of words and misspelled words, then the totals and how fast they were
+checked in MB/s and words/s. With -s, each misspelled word is also listed
+with up to that many guessed spellings:
+
+   file(offset): word -> guess guess guess
+
+Each -l stacks another EDX dictionary or word list (one word per line) on
+the dictionary, in the order given, with edx$dic_open_stack: a word in any
+of them is spelled right.
+
+-S prints edx$stats at the end, what the lookups and guesses of all the
+threads cost (common word hits, guide words compared, bytes scanned, ...),
+as text or JSON.
+
+-L prints edx$latency at the end: how long the guesses (-s) and loading
+the dictionary took, as percentiles (50%, 90%, 99%, 99.9%, slowest), as
+text or JSON. (The words of a chunk are looked up together, so lookups
+aren't timed one by one.) -T writes the guesses which took longer than a
+millisecond to a trace file, which chrome://tracing or Perfetto shows on
+a timeline by thread.
+
+The dictionary is opened once with edx$dic_open_stack and shared by a pool of
+threads (one per processor, or -t), each checking on its own session. Each
+file is memory mapped and cut into chunks of about 1MB (or -c KB). A chunk
+checks the words which begin in it, so a word straddling two chunks is
+checked once, by the chunk it begins in. The chunks are dealt out to the
+threads in runs of consecutive chunks, so a thread mostly works through the
+same files in order. A thread which runs out of chunks takes one from the
+front of another thread's run (the end that thread will get to last), so
+the threads all keep busy until the last chunk, even when one file is much
+bigger than the rest.
+
+A file too big to map at once (more than the free address space of a 32 bit
+process) is checked from start to end by one thread with edx$check_file,
+which maps only a few megabytes of it at a time.
+*/
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "edxspell.h"
+
+#define CHUNK_SIZE      0x00100000    /* default chunk size (1MB) */
+#define MAX_THREADS     64
+#define CHECK_BATCH     256           /* misspelled words fetched per edx$check_next */
+#define ERRBUFLEN       400
+
+/* A file being checked */
+struct doc_file {
+   char  *name;
+   unsigned __int64 size;
+   HANDLE hFile;
+   HANDLE hFileMap;
+   unsigned char *base;          /* whole file mapped, or NULL */
+   BOOL   tried;                 /* tried mapping it (under filelock) */
+   BOOL   whole;                 /* too big to map. Check it with edx$check_file */
+   LONG   chunksleft;            /* chunks not checked yet. The last one unmaps the file */
+   unsigned __int64 words;       /* words checked (under filelock) */
+   unsigned __int64 misspelled;  /* misspelled words (under filelock) */
+   const char *error;            /* why it couldn't be checked, or NULL */
+};
+
+/* One chunk of a file */
+struct doc_chunk {
+   struct doc_file *file;
+   unsigned __int64 start;       /* nominal start and end. The words which begin */
+   unsigned __int64 end;         /*   in [start,end) are checked */
+};
+
+/* A thread's run of chunks. The thread takes chunks from the bottom,
+   and other threads steal them from the top. */
+struct worker {
+   HANDLE thread;
+   struct edx_session *ses;
+   CRITICAL_SECTION lock;
+   DWORD top;                    /* chunks[top..bottom-1] left to check */
+   DWORD bottom;
+   unsigned __int64 words;       /* checked by this thread */
+   DWORD  chunksdone;
+   DWORD  stolen;                /* chunks taken from other threads */
+   char  *suggestions;           /* nsuggest guesses of EDX_SUGGESTION_LEN */
+   char  *out;                   /* -s listing of the current chunk */
+   DWORD  outlen;
+   DWORD  outsize;
+};
+
+static struct edx_dictionary *dic;
+static struct doc_file  *files;
+static DWORD nfiles, filessize;
+static struct doc_chunk *chunks;
+static DWORD nchunks, chunkssize;
+static struct worker workers[MAX_THREADS];
+static int nthreads;
+static int nsuggest;
+static unsigned __int64 chunk_size = CHUNK_SIZE;
+static CRITICAL_SECTION filelock;     /* doc_file mapping and counts */
+static CRITICAL_SECTION printlock;    /* stdout */
+
+/* An unsigned __int64 in decimal, into buf[24] */
+static char *u64str(unsigned __int64 n, char *buf)
+{
+   char *p = buf + 23;
+   *p = '\0';
+   do { *--p = (char)('0' + (int)(n % 10)); n /= 10; } while (n != 0);
+   return(p);
+}
+
+/*----- .SUBTITLE COLLECT THE FILES
+---------------------------------------------------------------------------*/
+static void add_file(char *name)
+{
+   struct doc_file *f;
+   if (nfiles == filessize)
+   {
+      filessize = (filessize == 0) ? 64 : filessize * 2;
+      f = new struct doc_file[filessize];
+      if (f == NULL) { fprintf(stderr, "edxcheck: out of memory\n"); exit(2); }
+      if (nfiles > 0) memcpy(f, files, nfiles * sizeof(struct doc_file));
+      delete[] files;
+      files = f;
+   }
+   f = &files[nfiles++];
+   memset(f, 0, sizeof(struct doc_file));
+   f->name = new char[strlen(name) + 1];
+   if (f->name == NULL) { fprintf(stderr, "edxcheck: out of memory\n"); exit(2); }
+   strcpy(f->name, name);
+   f->hFile = INVALID_HANDLE_VALUE;
+}
+
+/* Add the file 'name', or if it's a folder every file in it and its subfolders */
+static void add_path(char *name)
+{
+   WIN32_FIND_DATA fd;
+   HANDLE hFind;
+   DWORD attr = GetFileAttributes(name);
+   char *path;
+   size_t len;
+
+   if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY))
+   {
+      add_file(name);           /* a file, or reported as not found when opened */
+      return;
+   }
+   len = strlen(name);
+   path = new char[len + MAX_PATH + 2];
+   if (path == NULL) { fprintf(stderr, "edxcheck: out of memory\n"); exit(2); }
+   sprintf(path, "%s\\*", name);
+   hFind = FindFirstFile(path, &fd);
+   if (hFind != INVALID_HANDLE_VALUE)
+   {
+      do
+      {
+         if (strcmp(fd.cFileName, ".") == 0 || strcmp(fd.cFileName, "..") == 0) continue;
+         sprintf(path, "%s\\%s", name, fd.cFileName);
+         if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            add_path(path);
+         else
+            add_file(path);
+      } while (FindNextFile(hFind, &fd));
+      FindClose(hFind);
+   }
+   delete[] path;
+}
+
+/* Cut each file into chunks. Called once the file sizes are known. */
+static void add_chunks(struct doc_file *f)
+{
+   unsigned __int64 start;
+   struct doc_chunk *c;
+
+   for (start = 0; start < f->size; start += chunk_size)
+   {
+      if (nchunks == chunkssize)
+      {
+         chunkssize = (chunkssize == 0) ? 256 : chunkssize * 2;
+         c = new struct doc_chunk[chunkssize];
+         if (c == NULL) { fprintf(stderr, "edxcheck: out of memory\n"); exit(2); }
+         if (nchunks > 0) memcpy(c, chunks, nchunks * sizeof(struct doc_chunk));
+         delete[] chunks;
+         chunks = c;
+      }
+      c = &chunks[nchunks++];
+      c->file = f;
+      c->start = start;
+      c->end = (f->size - start < chunk_size) ? f->size : start + chunk_size;
+      ++f->chunksleft;
+   }
+}
+
+/*----- .SUBTITLE MAP A FILE
+ Functional Description:
+    Map the whole of a chunk's file the first time one of its chunks is
+    checked. Called with filelock held. If the file can't be mapped all at
+    once it's marked to be checked whole with edx$check_file, by the chunk
+    at its start.
+---------------------------------------------------------------------------*/
+static void map_file(struct doc_file *f)
+{
+   f->tried = TRUE;
+   f->hFileMap = CreateFileMapping(f->hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+   if (f->hFileMap != NULL)
+   {
+      f->base = (unsigned char *)MapViewOfFile(f->hFileMap, FILE_MAP_READ, 0, 0, 0);
+      if (f->base != NULL) return;
+      CloseHandle(f->hFileMap);
+      f->hFileMap = NULL;
+   }
+   f->whole = TRUE;
+}
+
+static void unmap_file(struct doc_file *f)
+{
+   if (f->base != NULL) UnmapViewOfFile(f->base);
+   if (f->hFileMap != NULL) CloseHandle(f->hFileMap);
+   if (f->hFile != INVALID_HANDLE_VALUE) CloseHandle(f->hFile);
+   f->base = NULL;
+   f->hFileMap = NULL;
+   f->hFile = INVALID_HANDLE_VALUE;
+}
+
+/*----- .SUBTITLE LIST A MISSPELLED WORD
+ Functional Description:
+    Append "file(offset): word -> guesses" to the thread's listing of the
+    chunk it's checking. The listing is printed all at once when the chunk
+    is done, so the lines of one chunk stay together. A file checked with
+    edx$check_file isn't mapped, so wdbeg is NULL and just the length of
+    the word is listed.
+---------------------------------------------------------------------------*/
+static void list_word(struct worker *w, struct doc_file *f, unsigned __int64 offset, unsigned char *wdbeg, DWORD wdlen)
+{
+   char word[MAXWORDLEN+1];
+   char errbuf[ERRBUFLEN];
+   char numbuf[24];
+   int nsug = 0;
+   int i;
+   DWORD need;
+   char *p;
+
+   if (wdbeg == NULL)
+      sprintf(word, "(%lu characters)", (unsigned long)wdlen);
+   else if (wdlen <= MAXWORDLEN)
+   {
+      memcpy(word, wdbeg, wdlen);
+      word[wdlen] = '\0';
+      if (edx$session_suggest(w->ses, word, nsuggest, w->suggestions, &nsug, errbuf, ERRBUFLEN) == EDX__ERROR) nsug = 0;
+   }
+   else
+   {
+      memcpy(word, wdbeg, MAXWORDLEN - 3);     /* too long to be a word */
+      strcpy(word + MAXWORDLEN - 3, "...");
+   }
+
+   need = (DWORD)strlen(f->name) + 24 + MAXWORDLEN + 8 + nsug * EDX_SUGGESTION_LEN + 2;
+   if (w->outlen + need > w->outsize)
+   {
+      DWORD newsize = (w->outsize == 0) ? 0x10000 : w->outsize * 2;
+      while (newsize < w->outlen + need) newsize *= 2;
+      p = new char[newsize];
+      if (p == NULL) return;
+      if (w->outlen > 0) memcpy(p, w->out, w->outlen);
+      delete[] w->out;
+      w->out = p;
+      w->outsize = newsize;
+   }
+   p = w->out + w->outlen;
+   p += sprintf(p, "%s(%s): %s", f->name, u64str(offset, numbuf), word);
+   if (nsug > 0)
+   {
+      p += sprintf(p, " ->");
+      for (i = 0; i < nsug; ++i) p += sprintf(p, " %s", w->suggestions + i * EDX_SUGGESTION_LEN);
+   }
+   *p++ = '\n';
+   w->outlen = (DWORD)(p - w->out);
+}
+
+/*----- .SUBTITLE CHECK A CHUNK
+ Functional Description:
+    Check the words which begin in chunk c. If the chunk starts in the
+    middle of a word, that word belongs to the chunk before. If it ends in
+    the middle of a word, the rest of the word is checked here.
+    Whitespace separates words, as with edx$check_text.
+---------------------------------------------------------------------------*/
+static void check_chunk(struct worker *w, struct doc_chunk *c)
+{
+   struct doc_file *f = c->file;
+   struct edx_misspelling mis[CHECK_BATCH];
+   struct edx_check *chk = NULL;
+   char errbuf[ERRBUFLEN];
+   unsigned char *p, *q, *end;
+   unsigned __int64 base = 0;
+   unsigned __int64 misspelled = 0;
+   unsigned __int64 words = 0;
+   int nwords;
+   int status;
+   int i;
+
+   EnterCriticalSection(&filelock);
+   if (!f->tried) map_file(f);
+   LeaveCriticalSection(&filelock);
+
+   errbuf[0] = '\0';
+   if (f->base != NULL)
+   {
+      end = f->base + f->size;
+      p = f->base + c->start;
+      if (c->start > 0 && p[-1] > 32)             /* a word begun in the chunk before */
+         while (p < end && *p > 32) ++p;
+      q = f->base + c->end;
+      if (q[-1] > 32)                              /* a word running into the next chunk */
+         while (q < end && *q > 32) ++q;
+      if (p < q)
+      {
+         base = p - f->base;
+         chk = edx$check_text(w->ses, (char *)p, (unsigned __int64)(q - p), errbuf, ERRBUFLEN);
+      }
+   }
+   else if (c->start == 0)
+      chk = edx$check_file(w->ses, f->name, errbuf, ERRBUFLEN);
+
+   if (chk != NULL)
+   {
+      do
+      {
+         status = edx$check_next(chk, mis, CHECK_BATCH, &nwords, errbuf, ERRBUFLEN);
+         misspelled += nwords;
+         if (nsuggest > 0 && f->base != NULL)
+            for (i = 0; i < nwords; ++i)
+               list_word(w, f, base + mis[i].offset, f->base + base + mis[i].offset, mis[i].length);
+         else if (nsuggest > 0)
+            for (i = 0; i < nwords; ++i)
+               list_word(w, f, mis[i].offset, NULL, mis[i].length);
+      } while (status == EDX__WORDFOUND);
+      words = edx$check_words(chk);
+      edx$check_close(chk);
+      if (status == EDX__ERROR) errbuf[ERRBUFLEN-1] = '\0';
+      else errbuf[0] = '\0';
+   }
+
+   if (w->outlen > 0)
+   {
+      EnterCriticalSection(&printlock);
+      fwrite(w->out, 1, w->outlen, stdout);
+      LeaveCriticalSection(&printlock);
+      w->outlen = 0;
+   }
+
+   EnterCriticalSection(&filelock);
+   f->words += words;
+   f->misspelled += misspelled;
+   if (errbuf[0] != '\0' && f->error == NULL)
+   {
+      char *error = new char[strlen(errbuf) + 1];
+      if (error != NULL) strcpy(error, errbuf);
+      f->error = error;
+   }
+   if (--f->chunksleft == 0) unmap_file(f);
+   LeaveCriticalSection(&filelock);
+
+   w->words += words;
+   ++w->chunksdone;
+}
+
+/*----- .SUBTITLE WORKER THREAD
+ Functional Description:
+    Check chunks from the bottom of this thread's run until it's empty,
+    then steal from the top of the other threads' runs until they're all
+    empty. No chunks are added once the threads start, so when every run
+    is empty the work is done.
+---------------------------------------------------------------------------*/
+static BOOL take_chunk(struct worker *w, DWORD *ichunk)
+{
+   BOOL got = FALSE;
+   EnterCriticalSection(&w->lock);
+   if (w->top < w->bottom) { *ichunk = --w->bottom; got = TRUE; }
+   LeaveCriticalSection(&w->lock);
+   return(got);
+}
+
+static BOOL steal_chunk(struct worker *w, DWORD *ichunk)
+{
+   BOOL got = FALSE;
+   EnterCriticalSection(&w->lock);
+   if (w->top < w->bottom) { *ichunk = w->top++; got = TRUE; }
+   LeaveCriticalSection(&w->lock);
+   return(got);
+}
+
+static DWORD WINAPI worker_thread(LPVOID param)
+{
+   struct worker *w = (struct worker *)param;
+   int self = (int)(w - workers);
+   DWORD ichunk;
+   int i;
+
+   for (;;)
+   {
+      if (take_chunk(w, &ichunk)) { check_chunk(w, &chunks[ichunk]); continue; }
+      for (i = 1; i < nthreads; ++i)
+         if (steal_chunk(&workers[(self + i) % nthreads], &ichunk)) break;
+      if (i == nthreads) break;
+      ++w->stolen;
+      check_chunk(w, &chunks[ichunk]);
+   }
+   return(0);
+}
+
+/*----- .SUBTITLE MAIN
+---------------------------------------------------------------------------*/
+static void usage(void)
+{
+   fprintf(stderr,
+      "usage: edxcheck [-t threads] [-s suggestions] [-c chunkKB] [-a Aux1file] [-l layer ...] [-S text|json] [-L text|json] [-T tracefile] dictionary file-or-folder ...\n"
+      "  -t  number of threads (default one per processor)\n"
+      "  -s  list each misspelled word with up to this many guesses (default 0, just count them)\n"
+      "  -c  chunk size in KB the files are cut into (default 1024)\n"
+      "  -a  user's Aux1 dictionary\n"
+      "  -l  EDX dictionary or word list to stack on the dictionary (up to %d)\n"
+      "  -S  print the hot path counters (edx$stats) at the end, as text or json\n"
+      "  -L  print the latency percentiles (edx$latency) at the end, as text or json\n"
+      "  -T  write the calls slower than 1 ms to this trace file (Chrome trace event JSON)\n", EDX_MAX_LAYERS);
+   exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+   char errbuf[ERRBUFLEN];
+   char numbuf[24], numbuf2[24];
+   static char report[65536];
+   char *Dic_File_Name = NULL;
+   const char *Aux1_File_Name = "";
+   char *Dic_File_Names[EDX_MAX_LAYERS+1];   /* the dictionary, then the -l layers */
+   int nlayers = 0;
+   int stats = -1;                      /* -S format, or -1 */
+   int latency = -1;                    /* -L format, or -1 */
+   char *Trace_File_Name = NULL;        /* -T */
+   SYSTEM_INFO si;
+   LARGE_INTEGER freq, t0, t1;
+   HANDLE threads[MAX_THREADS];
+   unsigned __int64 totalbytes = 0, totalwords = 0, totalmisspelled = 0;
+   DWORD sizehigh, steals = 0, failed = 0;
+   DWORD i, per, first;
+   double secs;
+   int argi;
+
+   GetSystemInfo(&si);
+   nthreads = (int)si.dwNumberOfProcessors;
+
+   for (argi = 1; argi < argc && argv[argi][0] == '-'; ++argi)
+   {
+      if (argv[argi][1] == '\0' || argv[argi][2] != '\0' || argi + 1 >= argc) usage();
+      switch (argv[argi][1])
+      {
+      case 't': nthreads = atoi(argv[++argi]); break;
+      case 's': nsuggest = atoi(argv[++argi]); break;
+      case 'c': chunk_size = (unsigned __int64)atoi(argv[++argi]) * 1024; break;
+      case 'a': Aux1_File_Name = argv[++argi]; break;
+      case 'l':
+         if (nlayers == EDX_MAX_LAYERS) usage();
+         Dic_File_Names[++nlayers] = argv[++argi];
+         break;
+      case 'S': stats = (strcmp(argv[++argi], "json") == 0) ? EDX_STATS_JSON : EDX_STATS_TEXT; break;
+      case 'L': latency = (strcmp(argv[++argi], "json") == 0) ? EDX_STATS_JSON : EDX_STATS_TEXT; break;
+      case 'T': Trace_File_Name = argv[++argi]; break;
+      default: usage();
+      }
+   }
+   if (argc - argi < 2) usage();
+   if (nthreads < 1) nthreads = 1;
+   if (nthreads > MAX_THREADS) nthreads = MAX_THREADS;
+   if (nsuggest < 0) nsuggest = 0;
+   if (chunk_size < 4096) chunk_size = 4096;
+
+   if (latency >= 0) edx$set_option(EDX_OPT_LATENCY, 1);
+   if (Trace_File_Name != NULL) edx$set_option(EDX_OPT_TRACE_US, 1000);
+
+   Dic_File_Name = argv[argi++];
+   Dic_File_Names[0] = Dic_File_Name;
+   dic = edx$dic_open_stack(Dic_File_Names, nlayers + 1, (char *)Aux1_File_Name, errbuf, ERRBUFLEN);
+   if (dic == NULL)
+   {
+      fprintf(stderr, "edxcheck: %s\n", errbuf);
+      return(2);
+   }
+
+   for (; argi < argc; ++argi) add_path(argv[argi]);
+
+   /* Open each file and cut it into chunks */
+   for (i = 0; i < nfiles; ++i)
+   {
+      struct doc_file *f = &files[i];
+      f->hFile = CreateFile(f->name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+      if (f->hFile == INVALID_HANDLE_VALUE)
+      {
+         f->error = "can't open file";
+         continue;
+      }
+      f->size = GetFileSize(f->hFile, &sizehigh);
+      f->size |= (unsigned __int64)sizehigh << 32;
+      if (f->size == 0) { unmap_file(f); continue; }
+      add_chunks(f);
+      totalbytes += f->size;
+   }
+
+   /* Deal out the chunks in runs of consecutive chunks */
+   InitializeCriticalSection(&filelock);
+   InitializeCriticalSection(&printlock);
+   per = nchunks / nthreads;
+   first = 0;
+   for (argi = 0; argi < nthreads; ++argi)
+   {
+      struct worker *w = &workers[argi];
+      InitializeCriticalSection(&w->lock);
+      w->top = first;
+      first += per + (((DWORD)argi < nchunks % nthreads) ? 1 : 0);
+      w->bottom = first;
+      w->ses = edx$session_create(dic);
+      w->suggestions = new char[nsuggest * EDX_SUGGESTION_LEN + 1];
+      if (w->ses == NULL || w->suggestions == NULL) { fprintf(stderr, "edxcheck: out of memory\n"); return(2); }
+   }
+
+   /* Check them. A thread takes chunks from the bottom of its run, so
+      reverse each run to check its files from the start, leaving the
+      chunks at the end of the run to be stolen first. */
+   for (argi = 0; argi < nthreads; ++argi)
+   {
+      DWORD lo = workers[argi].top, hi = workers[argi].bottom;
+      while (lo + 1 < hi)
+      {
+         struct doc_chunk tmp = chunks[lo];
+         chunks[lo++] = chunks[--hi];
+         chunks[hi] = tmp;
+      }
+   }
+   QueryPerformanceFrequency(&freq);
+   QueryPerformanceCounter(&t0);
+   for (argi = 0; argi < nthreads; ++argi)
+      threads[argi] = workers[argi].thread = CreateThread(NULL, 0, worker_thread, &workers[argi], 0, NULL);
+   WaitForMultipleObjects(nthreads, threads, TRUE, INFINITE);
+   QueryPerformanceCounter(&t1);
+   secs = (double)(t1.QuadPart - t0.QuadPart) / (double)freq.QuadPart;
+
+   /* Report */
+   for (i = 0; i < nfiles; ++i)
+   {
+      struct doc_file *f = &files[i];
+      if (f->error != NULL)
+      {
+         printf("%s: %s\n", f->name, f->error);
+         ++failed;
+         continue;
+      }
+      printf("%s: %s words, %s misspelled\n", f->name, u64str(f->words, numbuf), u64str(f->misspelled, numbuf2));
+      totalwords += f->words;
+      totalmisspelled += f->misspelled;
+   }
+   for (argi = 0; argi < nthreads; ++argi)
+   {
+      steals += workers[argi].stolen;
+      CloseHandle(threads[argi]);
+      edx$session_delete(workers[argi].ses);
+   }
+   printf("%lu files, %s words, %s misspelled", (unsigned long)nfiles, u64str(totalwords, numbuf), u64str(totalmisspelled, numbuf2));
+   if (failed > 0) printf(", %lu could not be checked", (unsigned long)failed);
+   printf("\n%lu threads, %lu chunks (%lu stolen), %.3f s", (unsigned long)nthreads, (unsigned long)nchunks, (unsigned long)steals, secs);
+   if (secs > 0)
+      printf(", %.1f MB/s, %.0f words/s", (double)(__int64)totalbytes / 1048576.0 / secs, (double)(__int64)totalwords / secs);
+   printf("\n");
+   if (stats >= 0)
+   {
+      edx$stats(dic, stats, report, sizeof(report));   /* (the sessions are deleted, but still counted) */
+      printf("%s", report);
+   }
+   if (latency >= 0)
+   {
+      edx$latency(dic, latency, report, sizeof(report));
+      printf("%s", report);
+   }
+   if (Trace_File_Name != NULL && edx$trace_save(dic, Trace_File_Name, errbuf, ERRBUFLEN) == EDX__ERROR)
+      fprintf(stderr, "edxcheck: %s\n", errbuf);
+
+   edx$dic_close(dic);
+   return((totalmisspelled > 0 || failed > 0) ? 1 : 0);
+}
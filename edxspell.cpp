@@ -11,6 +11,8 @@ This DLL provides three functions:
 1. edx$dic_lookup_word - lookup a word in the lexical database
 2. edx$spell_guess     - guess what word the user meant to type
 3. edx$dll_version     - just returns the version number of this DLL
+(plus edx$add_persdic, and the dictionary/session interface described
+in edxspell.h for programs which check spelling on several threads.)
 
 HISTORY:
 
@@ -76,6 +78,200 @@ Maybe someday in the future we'll make a version that does UNICODE
  is loaded.
  There is also a function that will append a new word to the user's personal
  Aux1 dictionary.
+
+10/16/2026
+ Moved the loaded dictionary and the spell guessing state out of global
+ variables into an edx_dictionary and an edx_session. A program may now open
+ a dictionary once with edx$dic_open and look up and guess words on many
+ threads at once, one session per thread. The original exports work as
+ before, using a default dictionary and session.
+
+ When a dictionary is loaded we now build a hash index of every word in the
+ main lexical database, so a lookup is a hash and a probe or two instead of a
+ binary search of the guide words and a walk through a dictionary page.
+ It costs about 2 MB for an 80,000 word dictionary and a few milliseconds at
+ load time. edx$set_option(EDX_OPT_HASH_INDEX, 0) turns it off, and
+ edx$dic_info (and edx$dll_version) report its size and build time.
+
+ Added a Bloom filter of all the words in the main, common word and Aux1
+ dictionaries. Nearly every word spell guessing tries isn't a word, and the
+ Bloom filter now turns most of them away before we search anything. Spell
+ guessing is about 5 times faster. EDX_OPT_BLOOM_BITS sets its size (and so
+ its false positive rate), and edx$session_info counts the lookups it saved.
+
+ Every lookup used to walk the whole common word list first. The common words
+ now get their own little hash index when the dictionary is loaded, and the
+ common word check comes before the Bloom filter so a common word is still
+ the quickest thing to find.
+
+ The user's personal Aux1 dictionary gets a hash index too, instead of being
+ searched word by word on every lookup. edx$add_persdic now appends the word
+ to the file and adds it to the words in memory, instead of reading the whole
+ file back in, and refuses a word that the next load would choke on.
+
+ When there's no hash index to look a word up in we still walk dictionary
+ pages, and that walk now uses SSE2 when the processor has it, 32 bytes at a
+ time. (EDX_OPT_SIMD turns it off. edx$scan_benchmark compares the two.)
+
+ Finding which dictionary pages to walk used to be a binary search of the
+ guide words and then a walk up and down from there. A jump table on the
+ first two characters and the guide words packed into 64 bit numbers now
+ find the same pages without the walk (EDX_OPT_GUIDE_INDEX, and
+ edx$index_benchmark to compare).
+
+ Spell guessing no longer looks up one guess per call to edx$spell_guess.
+ The first call makes every guess at once, drops the duplicates (the old
+ code could hand out the same word several times), looks them all up with
+ one batched lookup, and ranks the words it finds, common words first.
+ edx$spell_guess then hands them out one per call as before, and the new
+ edx$spell_suggest (edx$session_suggest) returns the best max_k in one call.
+
+ Optional suggestion index (edx$set_option EDX_OPT_SYMSPELL 1 or 2). Spell
+ guessing only finds words one edit away, and not all of those (a wrong
+ consonant in "wrod" or two letters out are missed). With the option set,
+ the first open of a dictionary records every word under each spelling of
+ its first 7 letters with up to 2 letters deleted, and saves that next to
+ the dictionary as a .sym file (about 11MB for 80,000 words, 0.2 seconds
+ to build, split across processors). Later opens map the .sym file. A
+ misspelled word's own deletes then find every word within that many
+ edits, which are checked with a real edit distance and ranked nearest
+ first. edx$suggest_benchmark compares the two on misspelled dictionary
+ words: at one edit the index was faster (26 us vs 36 us per word) and
+ found all 798 words where spell guessing found 527; at two edits it
+ found all 798 in 88 us per word and spell guessing found none.
+
+ Optional word graph (edx$set_option EDX_OPT_DAWG). Spell guessing makes
+ hundreds of guesses for each word and looks every one up, though most
+ change a letter after the point where no dictionary word starts the same
+ way. With the option set, the first open of a dictionary merges its words
+ into a word graph (DAWG) and saves it as a .dwg file (750KB for 80,000
+ words, 40 ms to build), and the five spell guessing tests walk the graph
+ instead, trying only the letters some word has next. The guesses and
+ their ranking are exactly those of spell guessing, about 4 times faster
+ (10 us vs 39 us per word in edx$suggest_benchmark). The .sym and .dwg
+ files are saved and mapped by the same code (INDEX FILES).
+
+ Optional Levenshtein automaton (edx$set_option EDX_OPT_LEVENSHTEIN 1 to
+ 3). Finds every word up to that many edits away with no index to build or
+ store, by running an automaton over the sorted dictionary pages. When it
+ dies partway into a word, we skip straight to the first string it could
+ still accept, jumping over whole pages by the guide words. At one edit
+ about 130 us per word, two edits about 1.1 ms, finding all 798 words
+ either way. EDX_OPT_LEV_BUDGET_US and EDX_OPT_LEV_MAX_WORDS bound one
+ search by time or by words compared, and guess from what it found so
+ far. edx$suggest_benchmark now also reports 50th, 90th and 99th
+ percentile times per word.
+
+ Optional lookup cache (edx$set_option EDX_OPT_LOOKUP_CACHE, the number of
+ words to keep). Remembers whether the last few thousand words looked up
+ were found, shared by every session on the dictionary, least recently
+ used word out first. It's for dictionaries loaded without the hash index
+ (EDX_OPT_HASH_INDEX 0, to save its memory): there a lookup of hot words
+ went from 365 ns to 306 ns with 4096 words cached, and 245 ns with every
+ word cached. With the hash index a lookup is already a hash and a probe,
+ and the cache's lock makes it slower (211 ns vs 245 ns), so it's off by
+ default. edx$add_persdic has it forget the word added, and edx$dic_info
+ reports its hits, misses and evictions.
+
+ Guess cache (edx$set_option EDX_OPT_GUESS_CACHE, default 256 words).
+ People make the same typing mistakes over and over, and we made the same
+ guess list for them each time. The guess lists of the last 256 misspelled
+ words are now kept, and handed out again from memory: 0.4 us per word
+ instead of 41 us. edx$add_persdic empties it, since the new word may be a
+ guess for anything. With EDX_OPT_GUESS_CACHE_FILE it's also kept in a
+ text file next to the user's Aux1 dictionary (AUX1.gsc) and read back
+ when the dictionary is loaded, so it's warm after a restart.
+
+ edx$check_text and edx$check_file check a whole text buffer or file on a
+ session, and edx$check_next hands back the offset and length of each
+ misspelled word. Words are looked up where they lie, without being copied
+ to DIC_LWA first, and a file is mapped 4MB at a time, so a file of many
+ gigabytes is checked in a few megabytes of memory. On a 30MB document
+ that's 690 MB/s, against 480 MB/s splitting it into words and calling
+ edx$session_lookup_word for each.
+
+ edxcheck.cpp is a console program which checks a whole collection of
+ files and folders with a pool of threads, sharing one opened dictionary.
+ The files are cut into 1MB chunks at word boundaries, and a thread out of
+ chunks steals from the others. edx$check_words says how many words a
+ check has been through, for its words/s. 560-590 MB/s on one processor
+ for 180MB in six files, the same counts as checking each file whole.
+
+ edx$lookup_benchmark times lookups of words found, words not found,
+ common words and Aux1 words, and guessing misspellings of 2-4, 5-7, 8-11
+ and 12 or more letters: how many per second, and the 50th, 90th and 99th
+ percentile time of one. edxbench.cpp runs it on each dictionary named,
+ writes the results to a baseline file, and on later runs says which got
+ more than 15% worse than the baseline. On the 80,000 word test
+ dictionary a hit takes 85-150 ns and a miss 110 ns. Guessing takes
+ 13-48 us a word, and about twice that with extended ANSI guessing.
+
+ edxbuild.cpp builds a version 4 or 5 EDX dictionary from a word list,
+ since EDXBuildDictionary isn't with these sources: page length, guide
+ word length, and common words either the most used (from a word list
+ with counts) or from a file. It sorts with a thread per processor and
+ then looks every word up in what it built, by both guide word searches.
+ 4 million words (2.3 million different) take 3 seconds on one processor.
+
+ Version 6 dictionaries (edxbuild -V 6, or edx$dic_save of any open
+ dictionary): a header with a section table of 64 bit offsets, each
+ section on a page boundary with its own checksum, and optionally the
+ hash index, Bloom filter, suggestion index and word graph saved in it and
+ used where they are in the mapped file. Versions 4 and 5 load as before.
+ Opening the 4 million word dictionary with its hash index and Bloom
+ filter takes 0.4 ms instead of 300 ms, and lookups are as fast.
+ edx$dic_verify checks the sections against their checksums.
+
+ Front coded pages (edxbuild -z, or EDX_OPT_FRONT_CODE with edx$dic_save):
+ a version 6 dictionary's words stored as how many characters each
+ shares with the word before it and the rest, no word running over a
+ page, so a lookup decodes just the page the guide words point at. The
+ 80,000 word dictionary is 30% smaller (946 KB to 659 KB with its Bloom
+ filter) and a hit takes 400 ns instead of 290 ns without the hash index;
+ misses and guessing are as fast. The suggestion index, word graph and
+ Levenshtein guessing decode the pages into memory when asked for, and so
+ does the hash index, but only with EDX_HASH_ALWAYS: by default
+ (EDX_HASH_UNLESS_FRONT_CODED) a front coded dictionary gets none, so
+ opening one keeps the saving. edx$dic_info says when the pages were
+ decoded, and for what.
+
+ EDX_OPT_RESIDENCY reads the mapped dictionary in when it's opened rather
+ than a page fault at a time during the first lookups: random access, the
+ hot sections (will need), the whole file (prefault), the hot sections
+ copied to large pages, or the whole file locked in memory.
+ edx$startup_benchmark (edxbench -s) times the first 10,000 lookups after
+ opening with each. From a cold file cache, a 31 MB dictionary's first
+ lookups' 99th percentile went from 6.6 us to 1.9 us with prefault, and
+ the slowest from 8 ms to 25 us with the file locked.
+
+ edx$dic_reload (and edx$reload_dic for the original interface) loads a
+ dictionary again while lookups go on with the old one, then switches
+ each session to the new one at its next call; a guess iteration stays
+ with the dictionary its word was looked up in. The old one is freed
+ when no session has it pinned. 8 threads looking up words while the
+ dictionary was reloaded 60 times found every word, and a lookup is as
+ fast as before (about 90 ns).
+
+ edx$dic_open_stack opens a main dictionary with up to 8 more EDX
+ dictionaries or word lists stacked on it (edxcheck -l), and
+ edx$session_lookup_layer says which one a word was found in. The
+ layers' words share the Aux1 words' hash index and the Bloom filter, so
+ a lookup costs the same with 8 layers as with none (about 120 ns a miss,
+ where looking in 9 dictionaries one after another took 820 ns).
+
+ edx$stats (edxcheck -S) reports, as text or JSON, what the lookups and
+ guesses on a dictionary cost: common word hits and misses, guide words
+ compared and pages from low to high, bytes of pages and Aux1 words
+ scanned, and guesses made by each spell guessing test. Each session
+ counts its own, and edx$stats adds them up. Build with EDX_NO_STATS to
+ leave them out; with them in, lookups take the same time (within 1%).
+
+ With EDX_OPT_LATENCY set, lookups, spell guesses (by whether they made
+ the guess list, and how, or handed out the next guess), edx$add_persdic
+ and loading are timed into histograms, and edx$latency (edxcheck -L)
+ reports their 50th to 99.9th percentile times. EDX_OPT_TRACE_US keeps
+ the calls slower than that for edx$trace_save (edxcheck -T) to write as
+ a Chrome trace file. Left off, lookups are no slower.
 */
 /******************************************************************************/
 #include "stdafx.h"
@@ -84,6 +280,16 @@ Maybe someday in the future we'll make a version that does UNICODE
 #include <stdio.h>
 #include <ctype.h>
 #include <stdlib.h>
+#include <stdarg.h>
+#if defined(_M_IX86) || defined(_M_X64)
+#define EDX_SSE2                     /* compile SSE2 scan kernel (used only if the processor has SSE2) */
+#include <emmintrin.h>
+#endif
+#ifndef EDX_NO_STATS
+#define EDX_STATS                    /* keep the hot path counters edx$stats reports (define EDX_NO_STATS to leave them out) */
+#endif
+#define EDXSPELL_EXPORTS
+#include "edxspell.h"
 //Note: This EDX Spelling Checker VERSION 7.1 November 19, 2006 supports
 //      EDX lexical database versions 4 & 5. The EDX lexical database
 //      version number is the very first byte of the database, followed
@@ -93,6 +299,9 @@ Maybe someday in the future we'll make a version that does UNICODE
 //      are any words in the database with characters above 127. This will
 //      cause spell guessing here to included extended ANSI characters
 //      when spell guessing.
+//      Version 6 lexical databases have a section table with 64 bit
+//      offsets and checksums, and can hold the indexes otherwise built
+//      when the dictionary is loaded. (See VERSION 6 DICTIONARIES.)
 //Extended ANSI characters
 #define  A_WITH_GRAVE          224
 #define  A_WITH_ACUTE          225
@@ -128,9 +337,6 @@ Maybe someday in the future we'll make a version that does UNICODE
 #define  Y_WITH_DIAERESIS      255
 
 #define SPACE 0x20              /* ASCII space character */
-#define EDX__WORDFOUND 1
-#define EDX__WORDNOTFOUND 2
-#define EDX__ERROR 4
 #define ERRMSGLEN 400
 #define GUSREV  1               /* 1 = GUESS REVERSALS */
 #define GUSVOL  2               /* 2 = GUESS VOWELS */
@@ -138,22 +344,10 @@ Maybe someday in the future we'll make a version that does UNICODE
 #define GUSPLS  4               /* 4 = GUESS PLUS */
 #define GUSCON  5               /* 5 = GUESS CONSONANTS */
 #define GIVEUP  6               /* 6 = GIVE UP */
-static BOOL   dic_loaded = FALSE; /* TRUE when EDX dictionary successfully loaded */
-static BOOL   Extended_ANSI_Guessing; /* TRUE when EDX dictionary contains extended ANSI characters */
-static HANDLE hDicFile = 0;       //Handle to EDX dictionary file
-static DWORD  dwDicFileSize;      //Length of EDX dictionary file. Used for mapping file.
-static HANDLE hDicFileMap = 0;    // handle for the EDX dictionary file's memory map
-static LPVOID lpDicMapBase = 0;   // pointer to the base address of the memory-mapped region
-static DWORD target_word_len;     /* length of target word */
-static DWORD gmode;               /* guess mode */
-static DWORD gof;                 /* guess offset */
-static DWORD gsubmode;            /* guess submode */
-static DWORD dic_lwl;             /* length of spell word in dic_lwa to check */
-#define MAXWORDLEN 31             /* maximum word length dictionary can store is 31 characters */
-static unsigned char dic_lwa[MAXWORDLEN+2];/* word spelling checker is currently checking */
+#define GUSLST  7               /* 7 = HAND OUT GUESSES FROM GUESS LIST */
 
 #define int32 DWORD
-static struct dichead_layout {
+struct dichead_layout {
    unsigned char id[8];              /* header id */
    int32 lexofst;   /* Offset to beginning of Lexical Database (dictionary page 0) */
    int32 lexlen;    /* Lexical Database Length (in bytes) */
@@ -165,16 +359,414 @@ static struct dichead_layout {
    int32 cwdlen;    /* Commonwords Length (in bytes) */
    int32 cwdmln;    /* Commonwords Maximum Length (in bytes) */
    int32 flags;     /* Low bit set if extended ANSI characters are in the dictionary */
-}*dichead;
+};
 #define HEADER_LEN  sizeof(dichead_layout)    /* Length of dictionary header */
-
-//User's personal Aux1 dictionary
-unsigned char* aux1base = NULL;
-unsigned char* aux1ptr = NULL;
 #define FNAMESIZE 260
-static char Aux1File[FNAMESIZE] = "";
+
+//Dictionary version 6: a header and section table, then the sections, each
+//starting on a page boundary. (See VERSION 6 DICTIONARIES.)
+#define DIC6_ALIGN        4096        /* sections are written on page boundaries */
+#define DIC6_MIN_ALIGN    64          /* and must be at least on cache line boundaries */
+#define DIC6_MAX_SECTIONS 16
+#define DIC6_INDEX        1           /* guide words */
+#define DIC6_LEX          2           /* main lexical database */
+#define DIC6_COMMON       3           /* common words */
+#define DIC6_HASH         4           /* hash index of main lexical database: hash_slot[], param[0] = words */
+#define DIC6_BLOOM        5           /* Bloom filter: 512 bit blocks, param[0] = bits set per word, param[1] = words */
+#define DIC6_SYM          6           /* suggestion index, as a .sym file */
+#define DIC6_DWG          7           /* word graph, as a .dwg file */
+#define DIC_FRONT_CODED   0x00000002  /* flags: main lexical database pages are front coded (version 6) */
+#define FC_LONG           0x20        /* front coded word sharing 8 or more letters (see FRONT CODED PAGES) */
+struct dic_section {
+   int32 type;      /* DIC6_INDEX ... */
+   int32 sum;       /* hash_word() of the section's bytes */
+   unsigned __int64 ofst;   /* Offset to beginning of section */
+   unsigned __int64 len;    /* Section Length (in bytes) */
+   int32 param[2];  /* depends on type */
+};
+struct dichead6_layout {
+   unsigned char id[8];              /* header id: 6, "EDXdict" */
+   int32 headsum;   /* hash_word() of this header (with headsum 0) */
+   int32 flags;     /* Low bit set if extended ANSI characters are in the dictionary */
+   unsigned __int64 filelen;         /* Length of the whole file (in bytes) */
+   int32 nidxwds;   /* Number of index guide words */
+   int32 indswd;    /* Size of each guide Word (in bytes) */
+   int32 dicpln;    /* Dictionary Page Length (in bytes) */
+   int32 cwdmln;    /* Commonwords Maximum Length (in bytes) */
+   int32 nsections; /* sections used of sect[] */
+   int32 spare;
+   struct dic_section sect[DIC6_MAX_SECTIONS];
+};
+
+//Options set by edx$set_option. A dictionary takes a copy of these when it is loaded.
+#define EDX_NUM_OPTIONS 16
+static DWORD dic_options[EDX_NUM_OPTIONS] = {
+   EDX_HASH_UNLESS_FRONT_CODED,      /* EDX_OPT_HASH_INDEX: build hash index of main lexical database */
+   10,                               /* EDX_OPT_BLOOM_BITS: Bloom filter bits per word (0 = no Bloom filter) */
+   1,                                /* EDX_OPT_SIMD: use SSE2 scan kernel if processor has SSE2 */
+   1,                                /* EDX_OPT_GUIDE_INDEX: build prefix jump table and packed keys of guide words */
+   0,                                /* EDX_OPT_SYMSPELL: guess from suggestion index, this many edits away (0 = don't) */
+   0,                                /* EDX_OPT_DAWG: guess by walking a word graph of the dictionary */
+   0,                                /* EDX_OPT_LEVENSHTEIN: guess with a Levenshtein automaton, this many edits away (0 = don't) */
+   0,                                /* EDX_OPT_LEV_BUDGET_US: most microseconds for one automaton search (0 = no limit) */
+   0,                                /* EDX_OPT_LEV_MAX_WORDS: most words one automaton search compares (0 = no limit) */
+   0,                                /* EDX_OPT_LOOKUP_CACHE: words kept in the lookup cache (0 = no cache) */
+   256,                              /* EDX_OPT_GUESS_CACHE: misspelled words whose guesses are kept (0 = no cache) */
+   0,                                /* EDX_OPT_GUESS_CACHE_FILE: keep the guess cache in a .gsc file */
+   0,                                /* EDX_OPT_FRONT_CODE: edx$dic_save writes front coded pages */
+   0,                                /* EDX_OPT_RESIDENCY: EDX_RES_... bits, how the dictionary is read in at load */
+   0,                                /* EDX_OPT_LATENCY: time calls into latency histograms */
+   0,                                /* EDX_OPT_TRACE_US: calls slower than this (us) go in the trace, 0 none */
+};
+
+#define GUIDE_PREFIXES 65536         /* number of different 2 character prefixes of guide words */
+
+//Scan kernel: search words from length-byte lbptr up to endrange (or the NULL
+//length-byte ending the words) for target_word. Never reads at or past limit.
+typedef BOOL (*scan_kernel)(unsigned char *lbptr, unsigned char *endrange, unsigned char *limit,
+                            unsigned char *target_word, DWORD target_word_len);
+
+//Bloom filter
+#define BLOOM_BLOCK_DWORDS 16        /* one 64 byte (512 bit) block, the size of a cache line */
+#define BLOOM_MAX_BITS     32        /* most bits per word we'll use */
+#define BLOOM_AUX1_WORDS   2000      /* room left in Bloom filter for user's personal Aux1 dictionary words */
+
+//Symmetric delete suggestion index (.sym file)
+#define SYM_MAX_DIST       2         /* edit distance the index is built for */
+#define SYM_PREFIX_LEN     7         /* only the first 7 characters of a word are used for its deletes */
+#define SYM_MAX_DELETES    29        /* deletes of a 7 character prefix: 1 + 7 + 21 */
+#define SYM_DIR_BITS       16        /* directory on the top 16 bits of a delete's hash */
+#define SYM_DIR_SIZE       65536
+#define SYM_COMMON         0x80000000  /* posting is a common word (offset from cmnwdsptr) */
+#define SYM_MAX_THREADS    16        /* most threads used to build the index */
+
+//Word graph (.dwg file)
+#define DWG_WORD           1         /* node ends a word */
+#define DWG_COMMON         2         /* node ends a common word */
+#define DWG_NONE           0xFFFFFFFF  /* no such node */
+#define DWG_MAX_NODES      0x00FFFFFF  /* node numbers have 24 bits in an edge */
+#define DWG_OK_VOWEL       1         /* okchar[]: spell_gusvol puts this character in */
+#define DWG_OK_PLUS        2         /*           spell_guspls does */
+#define DWG_OK_CONSONANT   4         /*           spell_guscon does */
+
+//Levenshtein automaton
+#define LEV_MAX_DIST       3         /* most edits EDX_OPT_LEVENSHTEIN can ask for */
+#define LEV_CHECK_PAGES    16        /* check the time budget every 16 pages */
+
+//Lookup cache
+#define CACHE_SHARDS       16        /* shards of the lookup cache, each with its own lock (a power of 2) */
+#define CACHE_NONE         0xFFFFFFFF  /* no such entry */
+
+//Guess cache
+#define GUESS_CACHE_ID     "EDXgsc1"   /* first word of a .gsc file */
+#define GUESS_CACHE_MAX    64        /* guess lists longer than this aren't cached */
+#define GUESS_CACHE_LINE   ((MAXWORDLEN+1)*(GUESS_CACHE_MAX+1)+2)  /* longest line of a .gsc file */
+
+//Checking a document
+#define CHECK_VIEW_SIZE    0x00400000  /* check a document 4MB at a time (a multiple of the allocation granularity) */
+#define BENCH_WORDS        4000        /* words of each kind edx$lookup_benchmark looks up */
+#define BENCH_GUESS_WORDS  200         /* misspellings of each length edx$lookup_benchmark guesses */
+#define BENCH_GROUP        16          /* lookups timed together for the percentiles */
+#define BENCH_SAMPLES      65536       /* most times kept for the percentiles */
+
+//An index built from a dictionary and saved next to it (.sym, .dwg), so it's
+//only built once. Later loads memory map the saved file.
+struct index_file {
+   HANDLE hFile;                     /* index file, and its memory map */
+   HANDLE hFileMap;
+   LPVOID lpMapBase;
+   DWORD *membase;                   /* index in memory when it couldn't be saved */
+   double buildms;                   /* milliseconds taken to build the index (0 = mapped, built before) */
+   char   Name[FNAMESIZE];           /* index file name ("" if not saved) */
+};
+
+//One slot of a hash index of a lexical database
+struct hash_slot {
+   DWORD hash;                       /* hash_word() of the word, so most mismatches are skipped without touching the word */
+   DWORD ofst;                       /* offset of the word's length-byte from base, plus 1. (0 = empty slot) */
+};
+
+//Hash index of the words of a lexical database (main lexical database, common words, or Aux1)
+struct word_hash {
+   unsigned char *base;              /* lexical database the slots point into */
+   struct hash_slot *tab;            /* the slots (NULL if not built) */
+   DWORD  mask;                      /* number of slots - 1 (number of slots is a power of 2) */
+   DWORD  words;                     /* number of words in the hash index */
+   DWORD  bytes;                     /* memory used by the hash index */
+   BOOL   mapped;                    /* TRUE if tab is in a version 6 dictionary file, not ours to free */
+};
+
+//The Aux1 words as a session searches them, all from between the same two adds (aux1_view)
+struct aux1_view {
+   unsigned char *base;              /* aux1base */
+   DWORD  len;                       /* aux1len */
+   struct word_hash hash;            /* aux1hash */
+};
+
+//An aux1base buffer or aux1hash table an add to Aux1 replaced (aux1_add_word). Sessions
+//may still be searching it, so it is kept till the dictionary is freed
+struct aux1_old {
+   struct aux1_old *next;
+   unsigned char *base;              /* old aux1base (NULL if the add only replaced the table) */
+   struct hash_slot *tab;            /* old aux1hash table (NULL if the add only replaced aux1base) */
+};
+
+//Latency histograms (see LATENCY HISTOGRAMS AND TRACING). What a timed call was:
+#define LAT_LOOKUP         0         /* edx$dic_lookup_word, edx$session_lookup_word */
+#define LAT_GUESS_TESTS    1         /* edx$spell_guess which made the guess list with the spell guessing tests */
+#define LAT_GUESS_SYM      2         /*   ... from the suggestion index */
+#define LAT_GUESS_LEV      3         /*   ... with the Levenshtein automaton */
+#define LAT_GUESS_DWG      4         /*   ... from the word graph */
+#define LAT_GUESS_CACHED   5         /*   ... from the guess cache */
+#define LAT_GUESS_NEXT     6         /* edx$spell_guess which handed out the next guess on the list */
+#define LAT_GUESS_GIVEUP   7         /* edx$spell_guess which had no more guesses */
+#define LAT_ADD_PERSDIC    8         /* edx$add_persdic */
+#define LAT_LOAD           9         /* load_main_dic */
+#define LAT_KINDS          10
+#define LAT_SUB_BITS       4         /* 16 buckets for each power of 2 ns, so a time is within 6% */
+#define LAT_MAX_BITS       36        /* up to 2^36 ns (69 s). Longer times go in the last bucket */
+#define LAT_BUCKETS        ((LAT_MAX_BITS - LAT_SUB_BITS + 1) << LAT_SUB_BITS)
+#define TRACE_RECORDS      4096      /* slow calls the trace keeps (the latest) */
+
+struct lat_hist {
+   unsigned __int64 count;           /* calls timed */
+   unsigned __int64 sum;             /* ns they took */
+   unsigned __int64 max;             /* ns the slowest took */
+   unsigned __int64 bucket[LAT_BUCKETS];  /* calls by time (lat_bucket) */
+};
+
+//One slow call, for the trace
+struct trace_rec {
+   unsigned __int64 start;           /* QueryPerformanceCounter when it started */
+   unsigned __int64 ticks;           /* how long it took */
+   DWORD kind;                       /* LAT_... */
+   DWORD thread;                     /* thread id */
+   DWORD wordlen;                    /* length of the word */
+   DWORD lookups;                    /* words it looked up */
+   DWORD guesses;                    /* guesses on the guess list after it */
+};
+
+//Hot path counters (see HOT PATH COUNTERS). Kept in each session, so by one thread.
+struct edx_stats {
+   unsigned __int64 lookups;         /* words looked up (dic_lookup_word, dic_lookup_words) */
+   unsigned __int64 common_hits;     /* found on the common word list */
+   unsigned __int64 common_misses;   /* not on it */
+   unsigned __int64 common_bytes;    /* bytes of common words walked (when there's no hash index of them) */
+   unsigned __int64 binsrch_calls;   /* binsrch_maindic searches of the guide words */
+   unsigned __int64 binsrch_steps;   /* guide words they compared */
+   unsigned __int64 binsrch_span;    /* pages from low to high they gave, summed */
+   DWORD            binsrch_maxspan; /* most pages from low to high */
+   unsigned __int64 page_scans;      /* page ranges searched */
+   unsigned __int64 page_bytes;      /* bytes in them */
+   unsigned __int64 aux1_searches;   /* searches of the Aux1 words (and a stack's layers) */
+   unsigned __int64 aux1_bytes;      /* bytes of Aux1 words walked (when there's no hash index of them) */
+   unsigned __int64 guess_lookups[GUSCON+1]; /* guesses spell guessing tests GUSREV ... GUSCON made, to look up */
+};
+
+//One word list of a dictionary stack (see DICTIONARY STACKS). Its words are in aux1base, ahead of the Aux1 words.
+struct dic_layer {
+   char   Name[FNAMESIZE];           /* file it was loaded from */
+   DWORD  end;                       /* offset in aux1base just past its last word */
+   DWORD  words;                     /* number of words */
+};
+
+//One word in the lookup cache
+struct cache_entry {
+   DWORD hash;                       /* hash_word() of the word */
+   DWORD prev;                       /* more recently used entry (CACHE_NONE if this is the most) */
+   DWORD next;                       /* less recently used entry (CACHE_NONE if this is the least) */
+   DWORD chain;                      /* next entry in the same hash bucket */
+   unsigned char len;                /* length of word (0 = entry not in use) */
+   unsigned char found;              /* 0 if dic_lookup_word didn't find the word, else 1 + the stack layer it was in */
+   unsigned char word[MAXWORDLEN];   /* the word, lowercased (the guess cache keeps its capitals) */
+   unsigned char *guesses;           /* guess cache: the word's guesses, best first, in lexical database
+                                        format ending with a NULL length-byte (NULL in the lookup cache) */
+};
+
+//One shard of the lookup cache. Everything in it is changed only with lock held.
+struct cache_shard {
+   CRITICAL_SECTION lock;
+   struct cache_entry *entry;        /* size entries, the first used of them in use */
+   DWORD *bucket;                    /* hash table: first entry in each bucket (CACHE_NONE = empty) */
+   DWORD  mask;                      /* number of buckets - 1 (number of buckets is a power of 2) */
+   DWORD  size;
+   DWORD  used;
+   DWORD  head;                      /* most recently used entry */
+   DWORD  tail;                      /* least recently used entry, the next to be evicted */
+   DWORD  generation;                /* changed each time a word is forgotten (see cache_add) */
+   DWORD  hits;
+   DWORD  misses;
+   DWORD  evictions;
+};
+
+/* An open EDX dictionary. Everything here is set up by load_main_dic and
+   load_aux1_dic and is only read after that, so one edx_dictionary can be
+   shared by sessions running on many threads. (Only edx$dic_add_persdic
+   changes it, and the lookup cache, which has its own locks.) */
+struct edx_dictionary {
+   HANDLE hDicFile;                  //Handle to EDX dictionary file
+   DWORD  dwDicFileSize;             //Length of EDX dictionary file. Used for mapping file.
+   HANDLE hDicFileMap;               // handle for the EDX dictionary file's memory map
+   LPVOID lpDicMapBase;              // pointer to the base address of the memory-mapped region
+   struct dichead_layout *dichead;   /* EDX dictionary header (start of the mapped file, or v6head) */
+   struct dichead6_layout *dichead6; /* version 6 header and section table (start of the mapped file, NULL before version 6) */
+   struct dichead_layout v6head;     /* version 6: its header as version 5 fields */
+   DWORD  dicstamp;                  /* mixed into dic_checksum: file size (version 4, 5) or checksum of
+                                        the main lexical database (version 6, whose size changes with
+                                        the sections in it) */
+   unsigned char *diclexdba;         /* Starting address of main lexical database */
+   unsigned char *dicindptr;         /* Starting address of index */
+   unsigned char *cmnwdsptr;         /* Starting address of common words */
+   BOOL   Extended_ANSI_Guessing;    /* TRUE when EDX dictionary contains extended ANSI characters */
+   DWORD  options[EDX_NUM_OPTIONS];  /* dic_options when this dictionary was loaded */
+   struct word_hash cmnhash;         /* hash index of the common words */
+   struct word_hash mainhash;        /* hash index of the main lexical database (if EDX_OPT_HASH_INDEX) */
+   double hashbuildms;               /* milliseconds taken to build the main hash index */
+   scan_kernel scan;                 /* scan_words_scalar or scan_words_sse2 */
+   //Guide word index acceleration (if EDX_OPT_GUIDE_INDEX, NULL if not built)
+   unsigned __int64 *guidekeys;      /* first 8 characters of each guide word, packed into a number */
+   DWORD *guidejump;                 /* [p] = first guide word whose 2 character prefix is >= p (GUIDE_PREFIXES+1 entries) */
+   unsigned char *maplimit;          /* end of mapped dictionary file (scan_kernel limit) */
+   unsigned char *lexlimit;          /* scan_kernel limit for the main lexical database (maplimit, or end of plainbase) */
+   //Front coded pages (see FRONT CODED PAGES)
+   BOOL   frontcoded;                /* TRUE while diclexdba is front coded pages */
+   unsigned char *plainbase;         /* front coded pages decoded into memory (NULL if not), diclexdba */
+   unsigned char *plainindex;        /*   and their guide words, dicindptr */
+   //Residency (see DICTIONARY RESIDENCY)
+   DWORD  resident;                  /* EDX_RES_... bits which took effect */
+   unsigned char *hotbase;           /* large pages holding copies of the hot sections (NULL if none) */
+   size_t hotlen;
+   double residentms;                /* milliseconds taken to read the dictionary in */
+   //Blocked Bloom filter of main lexical database, common words and Aux1 words (NULL if not built)
+   DWORD *bloombase;                 /* memory allocated for Bloom filter (NULL if it's in a version 6 file) */
+   DWORD *bloom;                     /* Bloom filter, aligned on a 64 byte boundary */
+   DWORD  bloomblocks;               /* number of 512 bit blocks */
+   DWORD  bloomk;                    /* number of bits set per word */
+   DWORD  bloomwords;                /* number of words in the Bloom filter */
+   //User's personal Aux1 dictionary, after the words of the stack's layers
+   unsigned char* aux1base;          /* layers' words then Aux1 words in memory, in lexical database format */
+   DWORD  aux1len;                   /* bytes of aux1base used, not counting the NULL after the last word */
+   DWORD  aux1size;                  /* bytes allocated for aux1base */
+   struct word_hash aux1hash;        /* hash index of the layers' and Aux1 words */
+   volatile LONG aux1seq;            /* odd while an add is replacing aux1base, aux1len and aux1hash */
+   struct aux1_old *aux1old;         /* what adds replaced, freed with the dictionary */
+   char   Aux1File[FNAMESIZE];
+   struct dic_layer layers[EDX_MAX_LAYERS];  /* word lists stacked on the main dictionary (see DICTIONARY STACKS) */
+   DWORD  nlayers;
+   //Symmetric delete suggestion index (if EDX_OPT_SYMSPELL, sym is NULL if not loaded)
+   struct sym_header *sym;           /* the index (in symfile) */
+   DWORD *symdir;                    /* directory on top bits of delete hash */
+   struct sym_key *symkeys;          /* delete hashes */
+   DWORD *sympost;                   /* postings (words) */
+   struct index_file symfile;        /* .sym file */
+   DWORD  symthreads;                /* threads used to build it */
+   //Word graph of main lexical database and common words (if EDX_OPT_DAWG, dwg is NULL if not loaded)
+   struct dwg_header *dwg;           /* the graph (in dwgfile) */
+   DWORD *dwgnode;                   /* [n] = first edge of node n << 2 | DWG_WORD | DWG_COMMON */
+   DWORD *dwgedge;                   /* node edge goes to << 8 | character */
+   struct index_file dwgfile;        /* .dwg file */
+   //Lookup cache of dic_lookup_word results (if EDX_OPT_LOOKUP_CACHE, NULL if not built)
+   struct cache_shard *cache;        /* CACHE_SHARDS shards */
+   //Guess cache of make_guess_list results (if EDX_OPT_GUESS_CACHE, NULL if not built)
+   struct cache_shard *guesscache;   /* one shard */
+   char   GuessCacheFile[FNAMESIZE]; /* .gsc file it's kept in ("" if not kept in a file) */
+   //Handle (see DICTIONARY HANDLES). The dictionary edx$dic_open returns holds only these,
+   //and Aux1File; the loaded dictionary is 'live'.
+   struct edx_dictionary *volatile live; /* dictionary lookups start with now */
+   struct edx_dictionary *retired;   /* dictionaries edx$dic_reload replaced, until no session has them pinned */
+   struct edx_dictionary *nextretired; /* (in a loaded dictionary: next on its handle's retired list) */
+   struct edx_session *sessions;     /* the handle's sessions */
+   CRITICAL_SECTION reloadlock;      /* held by reloads, session create/delete, and calls which aren't lookups */
+   CRITICAL_SECTION addlock;         /* held by a reload from reading the Aux1 file to the switch, and by adds to it */
+   char   DicFile[FNAMESIZE];        /* main dictionary file, to reload */
+   DWORD  generation;                /* (in a loaded dictionary: 0 when opened, 1 after the first reload, ...) */
+#ifdef EDX_STATS
+   struct edx_stats stats;           /* counters of the handle's deleted sessions */
+   struct lat_hist *latency;         /* LAT_KINDS histograms: the deleted sessions', add_persdic and loads (NULL until needed) */
+   struct trace_rec *trace;          /* ring of the last TRACE_RECORDS slow calls (NULL until the first) */
+   DWORD  ntrace;                    /* slow calls put in it */
+   CRITICAL_SECTION latencylock;     /* held to change latency and trace */
+   unsigned __int64 loadstart;       /* (in a loaded dictionary: when load_main_dic started, */
+   unsigned __int64 loadticks;       /*  and how long it took) */
+#endif
+};
+
+/* One guess at the spelling of a misspelled word (see make_guess_list) */
+struct guess_cand {
+   unsigned char word[MAXWORDLEN+1]; /* ASCIZ guess word */
+   unsigned char lower[MAXWORDLEN];  /* guess word lowercased */
+   DWORD len;                        /* length of guess word */
+   DWORD dist;                       /* edits from the misspelled word */
+   DWORD gmode;                      /* test that made it (GUSREV ... GUSCON, 0 = suggestion index) */
+   DWORD order;                      /* order it was made in */
+   BOOL  common;                     /* it's on the common word list */
+};
+
+struct guess_list {
+   struct guess_cand *cand;          /* guesses */
+   DWORD ncand;                      /* number of guesses */
+   DWORD maxcand;                    /* room for this many */
+   DWORD *seen;                      /* hash table of guesses made (guess # + 1, 0 = empty) */
+   DWORD seenmask;                   /* hash table size - 1 */
+};
+
+/* One caller's state. Holds the word last looked up, and our place in
+   guessing the spelling of that word between calls to spell guess. */
+struct edx_session {
+   struct edx_dictionary *dic;       /* dictionary this session looks words up in */
+   DWORD gmode;                      /* guess mode */
+   DWORD gof;                        /* next guess to hand out */
+   DWORD dic_lwl;                    /* length of spell word in dic_lwa to check */
+   unsigned char dic_lwa[MAXWORDLEN+2];/* word spelling checker is currently checking */
+   struct guess_list guesses;        /* ranked guesses for dic_lwa */
+   //Counters
+   DWORD bloom_lookups;              /* lookups checked against the Bloom filter */
+   DWORD bloom_rejects;              /* lookups the Bloom filter said could not be a word */
+   DWORD lev_searches;               /* Levenshtein automaton searches (lev_guess_list) */
+   DWORD lev_pages;                  /* dictionary pages they searched */
+   DWORD lev_skipped;                /* pages they skipped, because no word on the page could be close enough */
+   DWORD lev_budget_stops;           /* searches stopped by EDX_OPT_LEV_BUDGET_US or EDX_OPT_LEV_MAX_WORDS */
+   DWORD layer;                      /* stack layer the last word dic_lookup_word found was in */
+#ifdef EDX_STATS
+   struct edx_stats stats;           /* hot path counters (see HOT PATH COUNTERS) */
+   struct lat_hist *latency;         /* LAT_KINDS latency histograms (NULL until the first call timed) */
+   unsigned __int64 latstart;        /* when the call being timed started (0 = not timing it) */
+   unsigned __int64 latlookups;      /* stats.lookups then */
+   DWORD  latkind;                   /* how make_guess_list made the guess list (LAT_GUESS_...) */
+#endif
+   //Pinning (see DICTIONARY HANDLES)
+   struct edx_dictionary *handle;    /* handle this session was created on. 'dic' is what it has pinned */
+   struct edx_dictionary *volatile pin; /* loaded dictionary pinned (the one it last used, until it moves on) */
+   BOOL   guessing;                  /* a guess iteration is going on, so stay with 'pin' */
+   struct edx_session *nextses;      /* next session on the handle */
+};
+
+//The original edx$dic_lookup_word/edx$spell_guess/edx$add_persdic interface
+//uses this dictionary and session.
+static BOOL   dic_loaded = FALSE; /* TRUE when default EDX dictionary successfully loaded */
+static struct edx_dictionary default_dic;
+static struct edx_session default_session = { NULL, GIVEUP };
 
 // MACROS
+//STAT_ADD. Add n to a session's hot path counter. Nothing, if they're compiled out.
+#ifdef EDX_STATS
+#define STAT_ADD(ses,counter,n)  ((ses)->stats.counter += (n))
+#define STAT_MAX(ses,counter,n)  ((ses)->stats.counter = ((DWORD)(n) > (ses)->stats.counter) ? (DWORD)(n) : (ses)->stats.counter)
+#else
+#define STAT_ADD(ses,counter,n)  ((void)0)
+#define STAT_MAX(ses,counter,n)  ((void)0)
+#endif
+//LAT_START, LAT_END. Time a session call of kind LAT_..., if the dictionary was loaded with
+//EDX_OPT_LATENCY or EDX_OPT_TRACE_US set. LAT_KIND sets how the guess list was made.
+#ifdef EDX_STATS
+#define LAT_START(ses)           (((ses)->dic->options[EDX_OPT_LATENCY] | (ses)->dic->options[EDX_OPT_TRACE_US]) ? lat_start(ses) : (void)0)
+#define LAT_END(ses,kind,wordlen) (((ses)->latstart != 0) ? lat_end((ses), (kind), (wordlen)) : (void)0)
+#define LAT_KIND(ses,kind)       ((ses)->latkind = (kind))
+#else
+#define LAT_START(ses)           ((void)0)
+#define LAT_END(ses,kind,wordlen) ((void)0)
+#define LAT_KIND(ses,kind)       ((void)0)
+#endif
 #define LOAD_EIPE_ERROR_MESSAGE \
 _snprintf(errbuf, errbuflen, "EDXspell.dll encountered error EXCEPTION_IN_PAGE_ERROR. \
 This error can occur if the EDX dictionary file is on a remote computer \
@@ -186,14 +778,14 @@ errbuf[errbuflen-1] = '\0';
 // (This macro does not get used here in edxspell.cpp . It does get used in EDXBuildDictionary.cpp)
 #define EDXisspace(c)  ( ((c) <= 32 ) ? TRUE : FALSE )
 
-//ISVOWEL. If char (c) is a vowel
-#define ISVOWEL(c) \
+//ISVOWEL. If char (c) is a vowel. (ext) is the dictionary's Extended_ANSI_Guessing
+#define ISVOWEL(c,ext) \
          (   ((c) == (unsigned char)'a') \
           || ((c) == (unsigned char)'e') \
           || ((c) == (unsigned char)'i') \
           || ((c) == (unsigned char)'o') \
           || ((c) == (unsigned char)'u') \
-          || ((Extended_ANSI_Guessing) && \
+          || ((ext) && \
               ((c) >= 224 && (c) <= 252 \
                 && (c) != 231 \
                 && (c) != 240 \
@@ -217,6 +809,631 @@ unsigned char ANSItolower(unsigned char c)
       return( (unsigned char)(c) );    //LATIN SMALL LETTER Y WITH DIAERESIS
 }
 
+// The reverse of ANSItolower
+unsigned char ANSItoupper(unsigned char c)
+{
+    if ( ((c >= 97) && (c <= 122)) || ( (c >= 224) && (c <= 254) && (c != 247) ) )
+      return( (unsigned char)(c-0x20) );
+    else if ((c == 154) || (c == 156) || (c == 158))  //s with caron; ligature oe; z with caron
+      return( (unsigned char)(c-0x10) );
+    else if (c == 255)                 //LATIN SMALL LETTER Y WITH DIAERESIS
+      return( (unsigned char)(159) );  //LATIN CAPITAL LETTER Y WITH DIAERESIS
+    else
+      return( (unsigned char)(c) );
+}
+
+/******************************************************************************/
+// Release everything load_main_dic and load_aux1_dic set up for this dictionary.
+// Unmap or free an index saved next to the dictionary (see load_index_file)
+void close_index_file(struct index_file *f)
+{
+    if (f->membase)   { delete[] f->membase; }
+    if (f->lpMapBase) { UnmapViewOfFile(f->lpMapBase); }
+    if (f->hFileMap && f->hFileMap != INVALID_HANDLE_VALUE) { CloseHandle(f->hFileMap); }
+    if (f->hFile)     { CloseHandle(f->hFile); }
+    memset(f, 0, sizeof(struct index_file));
+}
+
+// Free a lookup cache or guess cache of nshards shards (see LOOKUP CACHE, GUESS CACHE)
+void free_cache(struct cache_shard *cache, DWORD nshards)
+{
+    DWORD i, e;
+
+    for (i = 0; i < nshards; ++i)
+    {
+        for (e = 0; cache[i].entry && e < cache[i].used; ++e)
+            if (cache[i].entry[e].guesses) { delete[] cache[i].entry[e].guesses; }
+        if (cache[i].entry)  { delete[] cache[i].entry; }
+        if (cache[i].bucket) { delete[] cache[i].bucket; }
+        DeleteCriticalSection(&cache[i].lock);
+    }
+    delete[] cache;
+}
+
+void unload_dic(struct edx_dictionary *dic)
+{
+    /* Although an application may close the file handle used to create a file
+    mapping object, the system holds the corresponding file open until the last
+    view of the file is unmapped. Files for which the last view has not yet been
+    unmapped are held open with no sharing restrictions. To fully close a file
+    mapping object, an application must unmap all mapped views of the file
+    mapping object by calling UnmapViewOfFile, and then close the file mapping
+    object handle by calling CloseHandle. */
+
+    if (dic->aux1base)     { delete[] dic->aux1base; }  // User's personal Aux1 dictionary in memory
+    if (dic->aux1hash.tab) { delete[] dic->aux1hash.tab; } // Hash index of Aux1 dictionary
+    while (dic->aux1old != NULL)   // What adds to the Aux1 dictionary replaced
+    {
+        struct aux1_old *old = dic->aux1old;
+        dic->aux1old = old->next;
+        if (old->base) { delete[] old->base; }
+        if (old->tab)  { delete[] old->tab; }
+        delete old;
+    }
+    if (dic->cmnhash.tab)  { delete[] dic->cmnhash.tab; }  // Hash index of common words
+    if (dic->mainhash.tab && !dic->mainhash.mapped) { delete[] dic->mainhash.tab; } // Hash index of main lexical database
+    if (dic->bloombase)    { delete[] dic->bloombase; } // Bloom filter
+    if (dic->guidekeys)    { delete[] dic->guidekeys; } // Guide word index acceleration
+    if (dic->guidejump)    { delete[] dic->guidejump; }
+    if (dic->plainbase)    { delete[] dic->plainbase; }  // Front coded pages decoded
+    if (dic->plainindex)   { delete[] dic->plainindex; }
+    close_index_file(&dic->symfile);                    // Suggestion index
+    close_index_file(&dic->dwgfile);                    // Word graph
+    if (dic->cache)        { free_cache(dic->cache, CACHE_SHARDS); } // Lookup cache
+    if (dic->guesscache)   { free_cache(dic->guesscache, 1); }      // Guess cache
+    if (dic->hotbase)      { VirtualFree(dic->hotbase, 0, MEM_RELEASE); } // Hot sections in large pages
+    if (dic->resident & EDX_RES_LOCK)                   // Give back the working set locked for it
+    {
+      SIZE_T min, max;
+      VirtualUnlock(dic->lpDicMapBase, dic->dwDicFileSize);
+      if (GetProcessWorkingSetSize(GetCurrentProcess(), &min, &max) && min > dic->dwDicFileSize)
+        { SetProcessWorkingSetSize(GetCurrentProcess(), min - dic->dwDicFileSize, max - dic->dwDicFileSize); }
+    }
+    if (dic->lpDicMapBase) { UnmapViewOfFile(dic->lpDicMapBase); }
+    if (dic->hDicFileMap)  { CloseHandle(dic->hDicFileMap); }
+    if (dic->hDicFile && dic->hDicFile != INVALID_HANDLE_VALUE) { CloseHandle(dic->hDicFile); }
+    memset(dic, 0, sizeof(struct edx_dictionary));
+}
+
+// Release the session's guess list (see make_guess_list).
+void free_guesses(struct edx_session *ses)
+{
+    if (ses->guesses.cand) { delete[] ses->guesses.cand; }
+    if (ses->guesses.seen) { delete[] ses->guesses.seen; }
+    memset(&ses->guesses, 0, sizeof(struct guess_list));
+}
+
+/*---------------------------------------------------------------------------
+    .SUBTITLE DICTIONARY HANDLES
+
+ Functional Description:
+    The dictionary edx$dic_open returns, and default_dic, is a handle:
+    the dictionary loaded is handle->live, which edx$dic_reload replaces
+    with a newly loaded one while lookups go on. Each session call pins
+    the loaded dictionary it starts with in ses->pin, without a lock,
+
+        ses->pin = handle->live, then make sure handle->live is still it
+
+    and uses that one (ses->dic) to the end of the call. The pin stays
+    set between calls, so the next call only has to see that it's still
+    handle->live, which costs a load and a compare instead of the
+    exchange; we measured the exchange at about 6 ns a lookup, 7%.
+    A lookup which doesn't find its word stays with the pinned
+    dictionary for the guesses which may follow, until edx$spell_guess
+    runs out of them or another word is looked up, so a guess iteration
+    uses one dictionary all through.
+
+    A reload makes the new dictionary live and puts the old one on the
+    handle's retired list, and a retired dictionary is freed once no
+    session has it pinned: by the reload if it can, else by the last
+    session to move off it, or at session delete or close
+    (free_retired). A session which is idle keeps the old dictionary
+    pinned until its next call. Calls which aren't session calls
+    (edx$dic_info, edx$dic_save, edx$dic_add_persdic, the benchmarks)
+    hold the handle's reloadlock while they use its live dictionary
+    (dic_lock).
+
+    A reload reads the user's Aux1 file long before it takes reloadlock,
+    so a word edx$dic_add_persdic added in between would be in the old
+    dictionary and the file but not the new one. So a reload holds the
+    handle's addlock from loading to the switch, and adds take it too
+    (an add waits for a reload to finish). Take addlock before reloadlock,
+    and reloadlock before latencylock.
+---------------------------------------------------------------------------*/
+// Free the handle's retired dictionaries which no session has pinned
+// (all of them if 'all'). Call holding handle->reloadlock.
+void free_retired(struct edx_dictionary *handle, BOOL all)
+{
+   struct edx_dictionary **prev = &handle->retired;
+   struct edx_dictionary *dic;
+   struct edx_session *ses;
+
+   while ((dic = *prev) != NULL)
+   {
+      for (ses = handle->sessions; !all && ses != NULL && ses->pin != dic; ses = ses->nextses) ;
+      if (!all && ses != NULL) { prev = &dic->nextretired; continue; }
+      *prev = dic->nextretired;
+      unload_dic(dic);
+      delete dic;
+   }
+}
+
+// Pin the loaded dictionary for a session call (see above). 'newword' ends
+// the guess iteration which kept the last one pinned.
+struct edx_dictionary *session_enter(struct edx_session *ses, BOOL newword)
+{
+   struct edx_dictionary *handle = ses->handle;
+   struct edx_dictionary *dic = ses->pin;
+
+   if (dic != handle->live && (newword || !ses->guessing))
+   {
+      do
+      {
+         dic = handle->live;
+         InterlockedExchangePointer((void * volatile *)&ses->pin, dic);  /* (a full barrier: pinned before live is read again) */
+      } while (dic != handle->live);
+      if (handle->retired != NULL && TryEnterCriticalSection(&handle->reloadlock))   /* (never wait) */
+      {
+         free_retired(handle, FALSE);
+         LeaveCriticalSection(&handle->reloadlock);
+      }
+   }
+   ses->dic = dic;
+   return(dic);
+}
+
+// End a session call. Stay with the dictionary next call if 'guessing'.
+void session_leave(struct edx_session *ses, BOOL guessing)
+{
+   ses->guessing = guessing;
+}
+
+// The handle's live dictionary, for a call which isn't a session call
+struct edx_dictionary *dic_lock(struct edx_dictionary *handle)
+{
+   EnterCriticalSection(&handle->reloadlock);
+   return(handle->live);
+}
+
+void dic_unlock(struct edx_dictionary *handle)
+{
+   LeaveCriticalSection(&handle->reloadlock);
+}
+
+// Free the dictionaries of a handle whose sessions are all deleted
+void close_handle(struct edx_dictionary *handle)
+{
+   EnterCriticalSection(&handle->reloadlock);
+   free_retired(handle, TRUE);
+   if (handle->live) { unload_dic(handle->live); delete handle->live; }
+   handle->live = NULL;
+#ifdef EDX_STATS
+   if (handle->latency) { delete[] handle->latency; }
+   if (handle->trace) { delete[] handle->trace; }
+   handle->latency = NULL;
+   handle->trace = NULL;
+#endif
+   LeaveCriticalSection(&handle->reloadlock);
+}
+
+/*---------------------------------------------------------------------------
+    .SUBTITLE HOT PATH COUNTERS
+
+ Functional Description:
+    What a lookup costs is decided by a few things: whether the word is
+    a common word, how many guide words binsrch_maindic compares and how
+    many pages apart low and high end up, how many bytes of pages are
+    then scanned, and how many bytes of Aux1 words. Spell guessing's cost
+    is how many guesses each test (GUSREV ... GUSCON) makes to be looked
+    up. Each session counts these (struct edx_stats, with STAT_ADD) as it
+    goes, so no two threads ever write the same counter and there's no
+    locking or interlocked instruction on the hot path. edx$stats adds
+    up the counters of a handle's sessions, and of its deleted sessions
+    (session delete adds them to the handle's).
+
+    Bytes scanned are the bytes in the range handed to the scan kernel
+    (or walked for a batch), whether or not the word is found part way.
+
+    The counters are read while other threads may be adding to them, so
+    a count may be a lookup or two behind (and on a 32 bit processor a
+    64 bit count read as it carries is off for that one read).
+
+    Compile with EDX_NO_STATS to leave the counters out altogether.
+    With them in, the lookup benchmark is no more than 1% slower.
+---------------------------------------------------------------------------*/
+#ifdef EDX_STATS
+void add_stats(struct edx_stats *to, struct edx_stats *from)
+{
+   DWORD i;
+
+   to->lookups       += from->lookups;
+   to->common_hits   += from->common_hits;
+   to->common_misses += from->common_misses;
+   to->common_bytes  += from->common_bytes;
+   to->binsrch_calls += from->binsrch_calls;
+   to->binsrch_steps += from->binsrch_steps;
+   to->binsrch_span  += from->binsrch_span;
+   if (from->binsrch_maxspan > to->binsrch_maxspan) to->binsrch_maxspan = from->binsrch_maxspan;
+   to->page_scans    += from->page_scans;
+   to->page_bytes    += from->page_bytes;
+   to->aux1_searches += from->aux1_searches;
+   to->aux1_bytes    += from->aux1_bytes;
+   for (i = GUSREV; i <= GUSCON; ++i) to->guess_lookups[i] += from->guess_lookups[i];
+}
+
+// Add up the counters of a handle's sessions, and its deleted sessions.
+// Returns the number of sessions. Call holding handle->reloadlock.
+DWORD sum_stats(struct edx_dictionary *handle, struct edx_stats *total)
+{
+   struct edx_session *ses;
+   DWORD nsessions = 0;
+
+   *total = handle->stats;
+   for (ses = handle->sessions; ses != NULL; ses = ses->nextses, ++nsessions)
+      add_stats(total, &ses->stats);
+   return(nsessions);
+}
+
+// Per, avoiding dividing by 0
+#define PER(a,b)  ((b) ? (double)(a) / (double)(b) : 0.0)
+
+// Report the counters as text or JSON. Returns FALSE if they didn't fit in buf.
+BOOL format_stats(struct edx_stats *st, DWORD nsessions, int format, char *buf, int buflen)
+{
+   int len;
+
+   if (format == EDX_STATS_JSON)
+      len = _snprintf(buf, buflen,
+                "{\"enabled\":true,\"sessions\":%lu,\"lookups\":%.0f,"
+                "\"common\":{\"hits\":%.0f,\"misses\":%.0f,\"bytes_scanned\":%.0f},"
+                "\"binsrch\":{\"searches\":%.0f,\"steps\":%.0f,\"page_span\":%.0f,\"max_page_span\":%lu},"
+                "\"pages\":{\"scans\":%.0f,\"bytes_scanned\":%.0f},"
+                "\"aux1\":{\"searches\":%.0f,\"bytes_scanned\":%.0f},"
+                "\"guess_lookups\":{\"reversals\":%.0f,\"vowels\":%.0f,\"minus\":%.0f,\"plus\":%.0f,\"consonants\":%.0f}}\n",
+                nsessions, (double)st->lookups,
+                (double)st->common_hits, (double)st->common_misses, (double)st->common_bytes,
+                (double)st->binsrch_calls, (double)st->binsrch_steps, (double)st->binsrch_span, st->binsrch_maxspan,
+                (double)st->page_scans, (double)st->page_bytes,
+                (double)st->aux1_searches, (double)st->aux1_bytes,
+                (double)st->guess_lookups[GUSREV], (double)st->guess_lookups[GUSVOL], (double)st->guess_lookups[GUSMIN],
+                (double)st->guess_lookups[GUSPLS], (double)st->guess_lookups[GUSCON]);
+   else
+      len = _snprintf(buf, buflen,
+                "Lookups: %.0f, %lu sessions open.\n"
+                "Common words: %.0f hits, %.0f misses, %.0f bytes scanned.\n"
+                "Guide word search: %.0f searches, %.1f guide words compared and %.1f pages from low to high a search, %lu pages at most.\n"
+                "Page scans: %.0f, %.0f bytes scanned, %.0f bytes a scan.\n"
+                "Aux1 words: %.0f searches, %.0f bytes scanned.\n"
+                "Guess lookups: %.0f reversals, %.0f vowels, %.0f minus, %.0f plus, %.0f consonants.\n",
+                (double)st->lookups, nsessions,
+                (double)st->common_hits, (double)st->common_misses, (double)st->common_bytes,
+                (double)st->binsrch_calls, PER(st->binsrch_steps, st->binsrch_calls), PER(st->binsrch_span, st->binsrch_calls),
+                st->binsrch_maxspan,
+                (double)st->page_scans, (double)st->page_bytes, PER(st->page_bytes, st->page_scans),
+                (double)st->aux1_searches, (double)st->aux1_bytes,
+                (double)st->guess_lookups[GUSREV], (double)st->guess_lookups[GUSVOL], (double)st->guess_lookups[GUSMIN],
+                (double)st->guess_lookups[GUSPLS], (double)st->guess_lookups[GUSCON]);
+   buf[buflen-1] = '\0';
+   return(len >= 0 && len < buflen);
+}
+#endif
+
+/*---------------------------------------------------------------------------
+    .SUBTITLE LATENCY HISTOGRAMS AND TRACING
+
+ Functional Description:
+    An average hides the call that freezes the editor: the edx$spell_guess
+    on a long word with Extended_ANSI_Guessing that makes thousands of
+    guesses to look up. So with option EDX_OPT_LATENCY set, each call is
+    timed (QueryPerformanceCounter) into a histogram for its kind (LAT_...):
+    lookups, edx$spell_guess by what it did (made the guess list, and how,
+    handed out the next guess, or gave up), edx$add_persdic, and
+    load_main_dic. (edx$spell_suggest's time making the guess list is
+    counted with edx$spell_guess's.)
+
+    The histograms are HDR style: 16 buckets for each power of 2 ns
+    (lat_bucket), so every time is counted to within 6% from 1 ns to
+    69 s in a fixed 4 KB a kind, and the 99th or 99.9th percentile is as good
+    as the median. Lookups and guesses go in the session's histograms,
+    with no locking, like the hot path counters; add_persdic and loads,
+    and a deleted session's histograms, go in the handle's.
+
+    With option EDX_OPT_TRACE_US set, a call which takes longer than that
+    many microseconds is also put in the handle's trace (under its
+    latencylock; slow calls are few): when it started and how long it
+    took, the thread, the length of the word, how many words it looked
+    up, and the guesses it made. The trace keeps the last TRACE_RECORDS.
+    edx$trace_save writes it as a Chrome trace event file, which
+    chrome://tracing, Perfetto and speedscope load.
+
+    Only calls one word at a time are timed; edx$dic_lookup_words and
+    the document checker look up a batch of words together.
+
+    Timing a call reads the clock twice, which nearly doubles the time
+    of a lookup (112 ns to 218 ns, best of 30 runs), so it's off unless
+    an option is set, and then costs one compare a call. Compiled out
+    with the hot path counters (EDX_NO_STATS).
+---------------------------------------------------------------------------*/
+/* Append to report buf,buflen (ASCIZ) */
+void report_printf(char *buf, int buflen, const char *fmt, ...)
+{
+   va_list args;
+   int len = strlen(buf);
+
+   if (len >= buflen - 1) return;
+   va_start(args, fmt);
+   _vsnprintf(buf + len, buflen - len, fmt, args);
+   va_end(args);
+   buf[buflen-1] = '\0';
+}
+
+#ifdef EDX_STATS
+static double ns_per_tick = 0.0;     /* QueryPerformanceCounter tick */
+
+static const char *lat_names[LAT_KINDS][2] = {   /* call, mode */
+   { "lookup", NULL }, { "spell_guess", "tests" }, { "spell_guess", "suggestion_index" },
+   { "spell_guess", "levenshtein" }, { "spell_guess", "word_graph" }, { "spell_guess", "guess_cache" },
+   { "spell_guess", "next_guess" }, { "spell_guess", "give_up" }, { "add_persdic", NULL }, { "load_main_dic", NULL }
+};
+
+// QueryPerformanceCounter ticks in ns
+double tick_ns(unsigned __int64 ticks)
+{
+   LARGE_INTEGER freq;
+
+   if (ns_per_tick == 0.0)
+   {
+      QueryPerformanceFrequency(&freq);
+      ns_per_tick = 1e9 / (double)freq.QuadPart;
+   }
+   return( (double)ticks * ns_per_tick );
+}
+
+unsigned __int64 ticks_now(void)
+{
+   LARGE_INTEGER now;
+
+   QueryPerformanceCounter(&now);
+   return( now.QuadPart );
+}
+
+unsigned __int64 ticks_since(unsigned __int64 start)
+{
+   return( ticks_now() - start );
+}
+
+// Histogram bucket of a time of ns: ns itself below 16, then 16 buckets
+// from each power of 2 to the next
+DWORD lat_bucket(unsigned __int64 ns)
+{
+   DWORD e;
+
+   if (ns < (1 << LAT_SUB_BITS)) return((DWORD)ns);
+   if (ns >> LAT_MAX_BITS) return(LAT_BUCKETS - 1);
+   for (e = LAT_SUB_BITS; (ns >> (e + 1)) != 0; ++e);     /* 2^e <= ns < 2^(e+1) */
+   return( ((e - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + (DWORD)((ns >> (e - LAT_SUB_BITS)) & ((1 << LAT_SUB_BITS) - 1)) );
+}
+
+// Longest time counted in bucket b
+unsigned __int64 lat_bucket_high(DWORD b)
+{
+   DWORD e;
+
+   if (b < (1 << LAT_SUB_BITS)) return(b);
+   e = (b >> LAT_SUB_BITS) - 1 + LAT_SUB_BITS;
+   return( ((unsigned __int64)((1 << LAT_SUB_BITS) + (b & ((1 << LAT_SUB_BITS) - 1)) + 1) << (e - LAT_SUB_BITS)) - 1 );
+}
+
+struct lat_hist *new_latency(void)
+{
+   struct lat_hist *h = new struct lat_hist[LAT_KINDS];
+   if (h != NULL) memset(h, 0, LAT_KINDS * sizeof(struct lat_hist));
+   return(h);
+}
+
+void lat_add(struct lat_hist *h, unsigned __int64 ticks)
+{
+   unsigned __int64 ns = (unsigned __int64)tick_ns(ticks);
+
+   ++h->count;
+   h->sum += ns;
+   if (ns > h->max) h->max = ns;
+   ++h->bucket[lat_bucket(ns)];
+}
+
+// Add histograms 'from' to 'to'
+void add_latency(struct lat_hist *to, struct lat_hist *from)
+{
+   DWORD k, b;
+
+   for (k = 0; k < LAT_KINDS; ++k, ++to, ++from)
+   {
+      to->count += from->count;
+      to->sum += from->sum;
+      if (from->max > to->max) to->max = from->max;
+      for (b = 0; b < LAT_BUCKETS; ++b) to->bucket[b] += from->bucket[b];
+   }
+}
+
+// Put a slow call in the handle's trace
+void lat_trace(struct edx_dictionary *handle, DWORD kind, unsigned __int64 start, unsigned __int64 ticks,
+               DWORD wordlen, DWORD lookups, DWORD guesses)
+{
+   struct trace_rec *tr;
+
+   EnterCriticalSection(&handle->latencylock);
+   if (handle->trace == NULL) handle->trace = new struct trace_rec[TRACE_RECORDS];
+   if (handle->trace != NULL)
+   {
+      tr = &handle->trace[handle->ntrace++ % TRACE_RECORDS];
+      tr->start = start;
+      tr->ticks = ticks;
+      tr->kind = kind;
+      tr->thread = GetCurrentThreadId();
+      tr->wordlen = wordlen;
+      tr->lookups = lookups;
+      tr->guesses = guesses;
+   }
+   LeaveCriticalSection(&handle->latencylock);
+}
+
+// Start timing a session call (LAT_START)
+void lat_start(struct edx_session *ses)
+{
+   if (ses->handle == NULL) return;     /* a benchmark's session */
+   ses->latlookups = ses->stats.lookups;
+   ses->latstart = ticks_now();
+}
+
+// Finish timing it (LAT_END)
+void lat_end(struct edx_session *ses, DWORD kind, DWORD wordlen)
+{
+   struct edx_dictionary *dic = ses->dic;
+   unsigned __int64 ticks = ticks_since(ses->latstart);
+
+   if (dic->options[EDX_OPT_LATENCY])
+   {
+      if (ses->latency == NULL) ses->latency = new_latency();
+      if (ses->latency != NULL) lat_add(&ses->latency[kind], ticks);
+   }
+   if (dic->options[EDX_OPT_TRACE_US] && tick_ns(ticks) >= dic->options[EDX_OPT_TRACE_US] * 1000.0)
+      lat_trace(ses->handle, kind, ses->latstart, ticks, wordlen, (DWORD)(ses->stats.lookups - ses->latlookups),
+                (kind == LAT_LOOKUP) ? 0 : ses->guesses.ncand);
+   ses->latstart = 0;
+}
+
+// Time a call which isn't a session call, of the handle's loaded dictionary dic
+void lat_record(struct edx_dictionary *handle, struct edx_dictionary *dic, DWORD kind,
+                unsigned __int64 start, unsigned __int64 ticks, DWORD wordlen)
+{
+   if (dic->options[EDX_OPT_LATENCY])
+   {
+      EnterCriticalSection(&handle->latencylock);
+      if (handle->latency == NULL) handle->latency = new_latency();
+      if (handle->latency != NULL) lat_add(&handle->latency[kind], ticks);
+      LeaveCriticalSection(&handle->latencylock);
+   }
+   if (dic->options[EDX_OPT_TRACE_US] && tick_ns(ticks) >= dic->options[EDX_OPT_TRACE_US] * 1000.0)
+      lat_trace(handle, kind, start, ticks, wordlen, 0, 0);
+}
+
+// Time of ns as text
+char *format_ns(double ns, char *buf, int buflen)
+{
+   if (ns < 1e3)      _snprintf(buf, buflen, "%.0f ns", ns);
+   else if (ns < 1e6) _snprintf(buf, buflen, "%.1f us", ns / 1e3);
+   else if (ns < 1e9) _snprintf(buf, buflen, "%.1f ms", ns / 1e6);
+   else               _snprintf(buf, buflen, "%.2f s", ns / 1e9);
+   buf[buflen-1] = '\0';
+   return(buf);
+}
+
+// Time which fraction p of the calls in h took no longer than
+double lat_percentile(struct lat_hist *h, double p)
+{
+   unsigned __int64 n = 0;
+   DWORD b;
+
+   for (b = 0; b < LAT_BUCKETS; ++b)
+   {
+      n += h->bucket[b];
+      if ((double)n >= p * (double)h->count)
+         return( (double)((lat_bucket_high(b) < h->max) ? lat_bucket_high(b) : h->max) );
+   }
+   return( (double)h->max );
+}
+
+// Report histograms h (LAT_KINDS of them) as text or JSON. Returns FALSE if it didn't fit in buf.
+BOOL format_latency(struct lat_hist *h, int format, char *buf, int buflen)
+{
+   static const double pct[5] = { 0.5, 0.9, 0.99, 0.999, 1.0 };
+   char t[5][24];
+   DWORD k, b, i, n;
+
+   buf[0] = '\0';
+   if (format == EDX_STATS_JSON) report_printf(buf, buflen, "{\"enabled\":true,\"unit\":\"ns\",\"histograms\":{");
+   for (k = 0, n = 0; k < LAT_KINDS; ++k)
+   {
+      if (h[k].count == 0) continue;
+      if (format == EDX_STATS_JSON)
+      {
+         report_printf(buf, buflen, "%s\"%s%s%s\":{\"count\":%.0f,\"mean\":%.0f,\"p50\":%.0f,\"p90\":%.0f,\"p99\":%.0f,\"p999\":%.0f,\"max\":%.0f,\"buckets\":[",
+                       (n > 0) ? "," : "", lat_names[k][0], lat_names[k][1] ? "/" : "", lat_names[k][1] ? lat_names[k][1] : "",
+                       (double)h[k].count, (double)h[k].sum / (double)h[k].count,
+                       lat_percentile(&h[k], 0.5), lat_percentile(&h[k], 0.9), lat_percentile(&h[k], 0.99),
+                       lat_percentile(&h[k], 0.999), (double)h[k].max);
+         for (b = 0, i = 0; b < LAT_BUCKETS; ++b)     /* [longest time in the bucket, calls] */
+            if (h[k].bucket[b] != 0)
+               report_printf(buf, buflen, "%s[%.0f,%.0f]", (i++ > 0) ? "," : "",
+                             (double)lat_bucket_high(b), (double)h[k].bucket[b]);
+         report_printf(buf, buflen, "]}");
+      }
+      else
+      {
+         for (i = 0; i < 5; ++i) format_ns(lat_percentile(&h[k], pct[i]), t[i], sizeof(t[i]));
+         report_printf(buf, buflen, "%s%s%s: %.0f calls, 50%% %s, 90%% %s, 99%% %s, 99.9%% %s, slowest %s.\n",
+                       lat_names[k][0], lat_names[k][1] ? " " : "", lat_names[k][1] ? lat_names[k][1] : "",
+                       (double)h[k].count, t[0], t[1], t[2], t[3], t[4]);
+      }
+      ++n;
+   }
+   if (format == EDX_STATS_JSON) report_printf(buf, buflen, "}}\n");
+   else if (n == 0) report_printf(buf, buflen, "No calls timed (set EDX_OPT_LATENCY).\n");
+   return( (int)strlen(buf) < buflen - 1 );
+}
+
+// Write the handle's trace to File_Name as a Chrome trace event file
+int save_trace(struct edx_dictionary *handle, char *File_Name, char *errbuf, int errbuflen)
+{
+   struct trace_rec *tr;
+   DWORD i, n, first, pid = GetCurrentProcessId();
+   FILE *fp;
+
+   EnterCriticalSection(&handle->latencylock);
+   n = (handle->ntrace < TRACE_RECORDS) ? handle->ntrace : TRACE_RECORDS;
+   first = handle->ntrace - n;
+   tr = (n > 0) ? new struct trace_rec[n] : NULL;
+   for (i = 0; tr != NULL && i < n; ++i) tr[i] = handle->trace[(first + i) % TRACE_RECORDS];   /* oldest first */
+   LeaveCriticalSection(&handle->latencylock);
+   if (n > 0 && tr == NULL)
+   {
+      _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+      errbuf[errbuflen-1] = '\0';
+      return(EDX__ERROR);
+   }
+
+   fp = fopen(File_Name, "w");
+   if (fp == NULL)
+   {
+      _snprintf(errbuf, errbuflen, "Can't write trace file %s.", File_Name);
+      errbuf[errbuflen-1] = '\0';
+      if (tr) { delete[] tr; }
+      return(EDX__ERROR);
+   }
+   fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+               "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%lu,\"args\":{\"name\":\"edxspell\"}}", pid);
+   for (i = 0; i < n; ++i)
+   {
+      fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"edxspell\",\"ph\":\"X\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,"
+                  "\"args\":{\"word_length\":%lu,\"lookups\":%lu",
+              lat_names[tr[i].kind][0], pid, tr[i].thread, tick_ns(tr[i].start) / 1e3, tick_ns(tr[i].ticks) / 1e3,
+              tr[i].wordlen, tr[i].lookups);
+      if (lat_names[tr[i].kind][1] != NULL)
+         fprintf(fp, ",\"mode\":\"%s\",\"guesses\":%lu", lat_names[tr[i].kind][1], tr[i].guesses);
+      fprintf(fp, "}}");
+   }
+   fprintf(fp, "\n]}\n");
+   if (tr) { delete[] tr; }
+   if (fclose(fp) != 0)
+   {
+      _snprintf(errbuf, errbuflen, "Error writing trace file %s.", File_Name);
+      errbuf[errbuflen-1] = '\0';
+      return(EDX__ERROR);
+   }
+   return(EDX__WORDFOUND);
+}
+#endif
+
 /******************************************************************************/
 BOOL WINAPI DllMain(
     HINSTANCE hinstDLL,  // handle to DLL module
@@ -229,6 +1446,11 @@ BOOL WINAPI DllMain(
         case DLL_PROCESS_ATTACH:
          // Initialize once for each new process.
          // Return FALSE to fail DLL load.
+            InitializeCriticalSection(&default_dic.reloadlock);
+            InitializeCriticalSection(&default_dic.addlock);
+#ifdef EDX_STATS
+            InitializeCriticalSection(&default_dic.latencylock);
+#endif
             break;
 
         case DLL_THREAD_ATTACH:
@@ -241,18 +1463,17 @@ BOOL WINAPI DllMain(
 
         case DLL_PROCESS_DETACH:
          // Perform any necessary cleanup.
-            /* Although an application may close the file handle used to create a file
-            mapping object, the system holds the corresponding file open until the last
-            view of the file is unmapped. Files for which the last view has not yet been
-            unmapped are held open with no sharing restrictions. To fully close a file
-            mapping object, an application must unmap all mapped views of the file
-            mapping object by calling UnmapViewOfFile, and then close the file mapping
-            object handle by calling CloseHandle. */
-
-            if (aux1base)     { delete[] aux1base; }  // User's personal Aux1 dictionary in memory
-            if (lpDicMapBase) { UnmapViewOfFile(lpDicMapBase); }
-            if (hDicFileMap)  { CloseHandle(hDicFileMap); }
-            if (hDicFile)     { CloseHandle(hDicFile); }
+         // (Dictionaries opened with edx$dic_open are the caller's to close.)
+            free_guesses(&default_session);
+#ifdef EDX_STATS
+            if (default_session.latency) { delete[] default_session.latency; }
+#endif
+            close_handle(&default_dic);
+            DeleteCriticalSection(&default_dic.reloadlock);
+            DeleteCriticalSection(&default_dic.addlock);
+#ifdef EDX_STATS
+            DeleteCriticalSection(&default_dic.latencylock);
+#endif
             break;
     }
     return TRUE;  // Successful DLL_PROCESS_ATTACH.
@@ -274,957 +1495,7155 @@ void FetchErrorText(DWORD dwErrCode, char *errmsg, char *errbuf, int errbuflen)
     return;
 }
 /******************************************************************************/
-//SPELL_INIT           !Initialize spelling checker
-//LOAD_MAIN_DIC
-//LOAD_AUX1_DIC
-BOOL load_main_dic(char *Dic_File_Name, char *errbuf, int errbuflen)
+// Elapsed milliseconds since 'start' (from QueryPerformanceCounter)
+double elapsed_ms(LARGE_INTEGER start)
 {
-  // MAKE SURE WE WERE PASSED A Dic_File_Name.
-  if ( !strlen(Dic_File_Name) )
-  {
-    char errmsg[ERRMSGLEN];
-    _snprintf(errmsg, ERRMSGLEN, "Error opening EDX dictionary file.\n No Dic_File_Name passsed.\n Did you call edx$spell_guess before calling edx$dic_lookup_word?\n");
-    errmsg[ERRMSGLEN-1] = '\0';
-    return(FALSE);
-  }
+    LARGE_INTEGER now, freq;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&freq);
+    return( (double)(now.QuadPart - start.QuadPart) * 1000.0 / (double)freq.QuadPart );
+}
 
-  //OPEN MAIN EDX DICTIONARY FILE
-  hDicFile = CreateFile (Dic_File_Name,
-                         GENERIC_READ,
-                         FILE_SHARE_READ,
-                         NULL,
-                         OPEN_EXISTING,
-                         0,
-                         NULL);
-  if (hDicFile == INVALID_HANDLE_VALUE)
-  {
-    DWORD dwErrCode = GetLastError();
-    char errmsg[ERRMSGLEN];
-    _snprintf(errmsg, ERRMSGLEN, "Error opening %s", Dic_File_Name );
-    errmsg[ERRMSGLEN-1] = '\0';
-    FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
-    return(FALSE);
-  }
+/******************************************************************************/
+// Number of words in lexical database words starting at lbptr, up to the
+// terminating NULL length-byte or 'end'
+DWORD count_words(unsigned char *lbptr, unsigned char *end)
+{
+    DWORD nwords;
+    for ( nwords = 0;
+          lbptr < end && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+          lbptr += *lbptr + 1, ++nwords );
+    return(nwords);
+}
 
-  //GET SIZE OF DICTIONARY FILE
-  dwDicFileSize = GetFileSize(hDicFile, NULL);
-  if (dwDicFileSize == 0xFFFFFFFF)
-  {
-    DWORD dwErrCode = GetLastError();
-    if (dwErrCode != NO_ERROR)
+/******************************************************************************/
+// FNV-1a hash of a (lowercased) word
+DWORD hash_word(unsigned char *word, DWORD len)
+{
+    DWORD h = 2166136261u;
+    DWORD i;
+    for (i = 0; i < len; ++i)
     {
-       char errmsg[ERRMSGLEN];
-       _snprintf(errmsg, ERRMSGLEN, "Call to 'GetFileSize' failed for file %s", Dic_File_Name );
-       errmsg[ERRMSGLEN-1] = '\0';
-       FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
-       return(FALSE);
+        h ^= word[i];
+        h *= 16777619u;
     }
-  }
+    return(h);
+}
 
-  //MAP THE FILE
-  // Create a file mapping object for the file.
-  hDicFileMap = CreateFileMapping (hDicFile, NULL, PAGE_READONLY, 0, dwDicFileSize, NULL);
-  if (hDicFileMap == INVALID_HANDLE_VALUE)
-  {
-    DWORD dwErrCode = GetLastError();
-    char errmsg[ERRMSGLEN];
-    _snprintf(errmsg, ERRMSGLEN, "Error calling CreateFileMapping for file %s", Dic_File_Name );
-    errmsg[ERRMSGLEN-1] = '\0';
-    FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
-    return(FALSE);
-  }
+/*---------------------------------------------------------------------------
+    .SUBTITLE BUILD_WORD_HASH
 
-  //CREATE
-  // Map the view
-  lpDicMapBase = MapViewOfFile(hDicFileMap,        // handle to mapping object
-                              FILE_MAP_READ,       // read permission
-                              0,                   // high-order 32 bits of file offset
-                              0,                   // low-order 32 bits of file offset
-                              dwDicFileSize);      // number of bytes to map
-  if (lpDicMapBase == NULL)
-  {
-    DWORD dwErrCode = GetLastError();
-    FetchErrorText(dwErrCode, "Call to 'MapViewOfFile' failed. lpDicMapBase returned is NULL.", errbuf, errbuflen );
+ Functional Description:
+    Builds an open addressing (linear probing) hash table over every word
+    of a lexical database, so we can find a word with one hash and a probe
+    or two instead of a walk through the words. aux1_add_word adds words
+    to the Aux1 one later, while sessions may be searching it
+    (hash_slot_publish, copy_word_hash).
+    The table is at most half full. Each slot holds the word's hash and the
+    offset of the word's length-byte in the lexical database.
+    We build one for the main lexical database when the dictionary is loaded
+    if option EDX_OPT_HASH_INDEX is set (so dic_lookup_word needs no binary
+    search of the index and walk through the dictionary pages), and one for
+    the common words and one for the user's Aux1 dictionary always (so a
+    word that isn't a common word or Aux1 word costs a probe, not a walk
+    through all of them).
+    If there isn't memory for one we just do without it.
+---------------------------------------------------------------------------*/
+// Put a word's hash and offset into the first free slot
+void hash_slot_insert(struct hash_slot *tab, DWORD mask, DWORD h, DWORD ofst)
+{
+    DWORD slot;
+    for (slot = h & mask; tab[slot].ofst != 0; slot = (slot + 1) & mask);
+    tab[slot].hash = h;
+    tab[slot].ofst = ofst;
+}
+
+void build_word_hash(struct word_hash *wh, unsigned char *base, unsigned char *end)
+{
+    unsigned char *lbptr;     /* pointer to length-byte of current word */
+    DWORD nwords, nslots;
+
+    nwords = count_words(base, end);
+
+    for (nslots = 16; nslots < 2*nwords; nslots <<= 1);
+    wh->tab = new struct hash_slot[nslots];
+    if (wh->tab == NULL) {return;}
+    memset(wh->tab, 0, nslots * sizeof(struct hash_slot));
+    wh->mask = nslots - 1;
+    wh->base = base;
+
+    for ( lbptr = base;
+          lbptr < end && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+          lbptr += *lbptr + 1 )
+        hash_slot_insert(wh->tab, wh->mask, hash_word(lbptr + 1, *lbptr), (DWORD)(lbptr - base) + 1);
+    wh->words = nwords;
+    wh->bytes = nslots * sizeof(struct hash_slot);
+}
+
+// hash_slot_insert for a table sessions may be searching. The offset,
+// which puts the slot in use, goes in last.
+void hash_slot_publish(struct hash_slot *tab, DWORD mask, DWORD h, DWORD ofst)
+{
+    DWORD slot;
+    for (slot = h & mask; tab[slot].ofst != 0; slot = (slot + 1) & mask);
+    tab[slot].hash = h;
+    InterlockedExchange((LONG volatile *)&tab[slot].ofst, (LONG)ofst);
+}
+
+// Copy hash index wh into a new table of nslots slots (a power of 2, at
+// least as many as wh has) for base, which holds the same words at the same
+// offsets as wh->base. Returns FALSE if there isn't memory for it.
+BOOL copy_word_hash(struct word_hash *copy, struct word_hash *wh, unsigned char *base, DWORD nslots)
+{
+    struct hash_slot *tab;
+    DWORD slot;
+
+    tab = new struct hash_slot[nslots];
+    if (tab == NULL) {return(FALSE);}
+    memset(tab, 0, nslots * sizeof(struct hash_slot));
+    for (slot = 0; slot <= wh->mask; ++slot)
+        if (wh->tab[slot].ofst != 0)
+            hash_slot_insert(tab, nslots - 1, wh->tab[slot].hash, wh->tab[slot].ofst);
+    copy->base = base;
+    copy->tab = tab;
+    copy->mask = nslots - 1;
+    copy->words = wh->words;
+    copy->bytes = nslots * sizeof(struct hash_slot);
+    copy->mapped = FALSE;
+    return(TRUE);
+}
+
+/* SEARCH HASH INDEX OF LEXICAL DATABASE FOR MATCH */
+BOOL search_word_hash(struct word_hash *wh, unsigned char *target_word, DWORD target_word_len)
+{
+    DWORD h = hash_word(target_word, target_word_len);
+    DWORD slot;
+    unsigned char *lbptr;     /* pointer to length-byte of word in slot */
+
+    for (slot = h & wh->mask; wh->tab[slot].ofst != 0; slot = (slot + 1) & wh->mask)
+    {
+        if (wh->tab[slot].hash != h) continue;
+        lbptr = wh->base + wh->tab[slot].ofst - 1;
+        if (*lbptr == target_word_len && memcmp(lbptr + 1, target_word, target_word_len) == 0)
+            return(TRUE);
+    }
     return(FALSE);
-  }
+}
+
+/* Like search_word_hash, but returns the offset plus 1 of the first of the
+   word's length-bytes in the lexical database (0 if it isn't there), for a
+   word which may be in it more than once (the layers of a dictionary stack) */
+DWORD find_word_hash(struct word_hash *wh, unsigned char *target_word, DWORD target_word_len)
+{
+    DWORD h = hash_word(target_word, target_word_len);
+    DWORD slot, ofst = 0;
+    unsigned char *lbptr;     /* pointer to length-byte of word in slot */
+
+    for (slot = h & wh->mask; wh->tab[slot].ofst != 0; slot = (slot + 1) & wh->mask)
+    {
+        if (wh->tab[slot].hash != h || (ofst != 0 && wh->tab[slot].ofst > ofst)) continue;
+        lbptr = wh->base + wh->tab[slot].ofst - 1;
+        if (*lbptr == target_word_len && memcmp(lbptr + 1, target_word, target_word_len) == 0)
+            ofst = wh->tab[slot].ofst;
+    }
+    return(ofst);
+}
+
+/*---------------------------------------------------------------------------
+    .SUBTITLE SCAN KERNELS
+
+ Functional Description:
+    Search a run of words in lexical database format (dictionary pages,
+    common words, or Aux1 words) for target_word, starting at length-byte
+    lbptr and stopping at endrange or at the NULL length-byte after the last
+    word. Used when there's no hash index to look in.
+
+    scan_words_scalar is the original loop. It hops from length-byte to
+    length-byte, and compares words of the right length backwards (we
+    expect the first few characters to match already).
+
+    scan_words_sse2 uses the fact that characters in words are all > 31
+    and length-bytes are 0 to 31, so any byte equal to target_word_len is
+    the length-byte of a word of the right length. It compares 32 bytes at
+    a time with target_word_len (and with 0, the end of the words) to find
+    those. For each one found whose last character matches, it compares
+    the word with the blank padded target_word in two 16 byte compares,
+    masked to the word's length. It finds exactly the words
+    scan_words_scalar finds.
+
+    Neither ever reads at or past 'limit' (end of the mapped dictionary
+    file, or of the Aux1 buffer). The SSE2 kernel does the last few
+    bytes of the range a byte at a time.
+
+    load_main_dic picks the kernel for the dictionary: scan_words_sse2 if
+    it was compiled in, the processor has SSE2, and option EDX_OPT_SIMD is
+    set, else scan_words_scalar.
+---------------------------------------------------------------------------*/
+BOOL scan_words_scalar(unsigned char *lbptr, unsigned char *endrange, unsigned char *limit,
+                       unsigned char *target_word, DWORD target_word_len)
+{
+   unsigned char *dptr;      /* pointer into dictionary into word */
+   unsigned char *tptr;      /* pointer into target_word */
+
+   while (lbptr < endrange && lbptr < limit)
+   {
+      if (*lbptr == 0x00) break;                            /* End of Lexical Database */
+      if ((DWORD)*lbptr == target_word_len)                 /* check if word lengths match first */
+      {
+         for ( tptr = target_word + target_word_len -1,     /* start tptr at last char of target_word */
+               dptr = lbptr + target_word_len;              /* start dptr at last char of word in dictionary */
+               tptr >= target_word && *tptr == *dptr;       /* while chars match up to beginning of word */
+               --tptr, --dptr);                             /* move back a char */
+         if (tptr < target_word) return(TRUE);              /* word found */
+      }
+      lbptr += *lbptr + 1;                  /* move to next word */
+   }
+   return(FALSE);
+}
+
+#ifdef EDX_SSE2
+#if _MSC_VER >= 1400
+#define LOWEST_SET_BIT(i, m)  _BitScanForward(&(i), (m))
+#else
+#define LOWEST_SET_BIT(i, m)  for ((i) = 0; ((m) & (1u << (i))) == 0; ++(i))
+#endif
+BOOL scan_words_sse2(unsigned char *lbptr, unsigned char *endrange, unsigned char *limit,
+                     unsigned char *target_word, DWORD target_word_len)
+{
+   __m128i vlen  = _mm_set1_epi8((char)target_word_len);
+   __m128i vzero = _mm_setzero_si128();
+   __m128i tlo   = _mm_loadu_si128((__m128i *)target_word);        /* target_word is MAXWORDLEN+1 bytes, */
+   __m128i thi   = _mm_loadu_si128((__m128i *)(target_word + 16)); /* blank padded */
+   DWORD wordmask = (1u << target_word_len) - 1;   /* which of the 32 bytes compared are in the word */
+   unsigned long m, z, i;
+   unsigned char *p = lbptr;
+   unsigned char *dptr;
+
+   if (endrange > limit) endrange = limit;
+   while (p + 32 <= endrange)
+   {
+      __m128i v0 = _mm_loadu_si128((__m128i *)p);
+      __m128i v1 = _mm_loadu_si128((__m128i *)(p + 16));
+      m = (DWORD)_mm_movemask_epi8(_mm_cmpeq_epi8(v0, vlen))           /* length-bytes of words of the right length */
+        | ((DWORD)_mm_movemask_epi8(_mm_cmpeq_epi8(v1, vlen)) << 16);
+      z = (DWORD)_mm_movemask_epi8(_mm_cmpeq_epi8(v0, vzero))          /* end of lexical database */
+        | ((DWORD)_mm_movemask_epi8(_mm_cmpeq_epi8(v1, vzero)) << 16);
+      if (z) m &= (z & (0u - z)) - 1;     /* only words before the end */
+      while (m)
+      {
+         LOWEST_SET_BIT(i, m);
+         m &= m - 1;
+         dptr = p + i + 1;
+         if (dptr[target_word_len-1] != target_word[target_word_len-1]) continue;  /* most differ in the last char */
+         if (dptr + 32 <= limit)
+         {
+            if ( ( ( (DWORD)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)dptr), tlo))
+                   | ((DWORD)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)(dptr + 16)), thi)) << 16) )
+                   & wordmask ) == wordmask )
+               return(TRUE);
+         }
+         else if (memcmp(dptr, target_word, target_word_len) == 0) return(TRUE);
+      }
+      if (z) return(FALSE);
+      p += 32;
+   }
+
+   /* Finish up the last few bytes of the range a byte at a time */
+   for ( ; p < endrange; ++p)
+   {
+      if (*p == 0x00) break;
+      if ((DWORD)*p == target_word_len && memcmp(p + 1, target_word, target_word_len) == 0) return(TRUE);
+   }
+   return(FALSE);
+}
+#endif
+
+// Pick scan kernel for a dictionary
+scan_kernel select_scan_kernel(DWORD use_simd)
+{
+#ifdef EDX_SSE2
+   if (use_simd && IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE)) return(scan_words_sse2);
+#endif
+   return(scan_words_scalar);
+}
+
+/*---------------------------------------------------------------------------
+    .SUBTITLE GUIDE WORD INDEX ACCELERATION
+
+ Functional Description:
+    Built when the dictionary is loaded if option EDX_OPT_GUIDE_INDEX is set,
+    for binsrch_maindic (see there).
+    guidekeys[] holds the first 8 characters of each guide word packed into
+    a 64 bit number, so most guide word compares are one number compare
+    instead of a memcmp of indswd characters.
+    guidejump[] is indexed by the first two characters of a word, and gives
+    the first guide word starting with those two characters or later ones.
+---------------------------------------------------------------------------*/
+/* Pack the first 8 characters of word (indswd long) into a number, so that
+   comparing two packed words compares their first 8 characters the way memcmp
+   would. (Characters after indswd are packed as 0.) */
+unsigned __int64 guide_key(unsigned char *word, DWORD indswd)
+{
+   unsigned __int64 key = 0;
+   DWORD i;
+   for (i = 0; i < 8; ++i)
+      key = (key << 8) | (i < indswd ? word[i] : 0);
+   return(key);
+}
+
+/* Compare target_word (key tkey) with guide word number i, like memcmp */
+int cmp_guideword(struct edx_dictionary *dic, unsigned char *target_word, unsigned __int64 tkey, DWORD i)
+{
+   DWORD indswd = dic->dichead->indswd;
+   if (tkey < dic->guidekeys[i]) return(-1);
+   if (tkey > dic->guidekeys[i]) return(1);
+   if (indswd <= 8) return(0);
+   return( memcmp(target_word + 8, dic->dicindptr + i*indswd + 8, indswd - 8) );
+}
+
+/* Build guide word index acceleration. If there isn't memory for it we do without. */
+void build_guide_index(struct edx_dictionary *dic)
+{
+   DWORD nidxwds = dic->dichead->nidxwds;
+   DWORD indswd = dic->dichead->indswd;
+   DWORD i, p;
+
+   dic->guidekeys = new unsigned __int64[nidxwds + 1];
+   dic->guidejump = new DWORD[GUIDE_PREFIXES + 1];
+   if (dic->guidekeys == NULL || dic->guidejump == NULL)
+   {
+      if (dic->guidekeys) { delete[] dic->guidekeys; dic->guidekeys = NULL; }
+      if (dic->guidejump) { delete[] dic->guidejump; dic->guidejump = NULL; }
+      return;
+   }
+   for (i = 0; i < nidxwds; ++i)
+      dic->guidekeys[i] = guide_key(dic->dicindptr + i*indswd, indswd);
+
+   /* guidejump[p] = first guide word with prefix >= p (the guide words are in order) */
+   for (i = 0, p = 0; p <= GUIDE_PREFIXES; ++p)
+   {
+      while (i < nidxwds && (DWORD)(dic->guidekeys[i] >> 48) < p) ++i;
+      dic->guidejump[p] = i;
+   }
+}
+
+/*---------------------------------------------------------------------------
+    .SUBTITLE FRONT CODED PAGES
+
+ Functional Description:
+    Words next to each other in the main lexical database share most of
+    their letters ("inter", "interact", "interaction"), and each is stored
+    whole. A version 6 dictionary with flag DIC_FRONT_CODED stores each
+    word as how many letters it shares with the word before it, and the
+    rest of it:
+
+       sss lllll   suffix      shared letters (0-7) and suffix length (1-31)
+       FC_LONG shared suflen suffix   when 8 or more letters are shared
+       0                       end of the page
+
+    No word runs over onto the next page, and the first word of a page
+    shares nothing, so a page can be searched without the pages before it,
+    and the guide word of a page is its first word as before. The pages
+    are searched where they are in the mapped file (fc_search_pages), so
+    the smaller file takes that much less memory and file cache.
+
+    fc_search_pages doesn't decode the words. It keeps how many letters
+    of the target word the word before matched (m). A word sharing more
+    than m letters with the word before is smaller than the target word
+    just as that one was, and is skipped without reading its suffix. One
+    sharing fewer is bigger than the target word, so the search is over.
+    Only a word sharing exactly m letters has its suffix compared, from
+    the m'th letter on. The words must be in order, which pack_fc_pages
+    checks.
+
+    The hash index, suggestion index, word graph and Levenshtein automaton
+    need the words whole. If any of them is wanted when a front coded
+    dictionary is loaded, the pages are decoded into memory and it's used
+    like any other dictionary (expand_front_coded), which takes more
+    memory than the uncompressed file would have. So the hash index is
+    only wanted for a front coded dictionary if EDX_OPT_HASH_INDEX is
+    EDX_HASH_ALWAYS; by default (EDX_HASH_UNLESS_FRONT_CODED) its pages
+    are searched in place (hash_index_wanted). The Bloom filter is built
+    from the decoded words, which are then freed.
+---------------------------------------------------------------------------*/
+// Decode the header of the front coded word at p: shared letters, suffix
+// length and suffix. Returns the next word.
+#define FC_DECODE(p, shared, suflen, suffix)  \
+   if ((*(p) & 0x1F) != 0) { shared = *(p) >> 5; suflen = *(p) & 0x1F; suffix = (p) + 1; } \
+   else                    { shared = (p)[1]; suflen = (p)[2]; suffix = (p) + 3; }
+
+// Search front coded pages low..high-1 (from binsrch_maindic) for target_word
+BOOL fc_search_pages(struct edx_dictionary *dic, DWORD low, DWORD high,
+                     unsigned char *target_word, DWORD target_word_len)
+{
+   DWORD dicpln = dic->dichead->dicpln;
+   unsigned char *p, *pend, *suffix;
+   DWORD page, shared, suflen, m, i, j;
+
+   for (page = low; page < high; ++page)
+   {
+      p = dic->diclexdba + page * dicpln;
+      pend = p + dicpln;
+      m = 0;                                  /* letters of target_word the word before matched */
+      while (p < pend && *p != 0x00)
+      {
+         FC_DECODE(p, shared, suflen, suffix)
+         p = suffix + suflen;
+         if (p > pend) break;                 /* not a front coded page */
+         if (shared > m) continue;            /* < target_word, like the word before */
+         if (shared < m) return(FALSE);       /* > target_word, and so is every word after it */
+         for ( i = m, j = 0;
+               i < target_word_len && j < suflen && suffix[j] == target_word[i];
+               ++i, ++j );
+         if (j == suflen)
+         {
+            if (i == target_word_len) return(TRUE);
+            m = i;                            /* the word is the start of target_word */
+            continue;
+         }
+         if (i == target_word_len || suffix[j] > target_word[i]) return(FALSE);
+         m = i;
+      }
+   }
+   return(FALSE);
+}
+
+// Decode front coded pages into lexical database format (each word as a
+// length-byte and its characters, then a NULL length-byte). Returns NULL
+// if there isn't memory. *len is the length, not counting the NULL.
+unsigned char *fc_decode(unsigned char *diclexdba, DWORD lexlen, DWORD dicpln, DWORD *len)
+{
+   unsigned char word[MAXWORDLEN];
+   unsigned char *words, *lbptr, *p, *pend, *suffix;
+   DWORD page, shared, suflen, pass;
+
+   *len = 0;
+   words = NULL;
+   for (pass = 0; pass < 2; ++pass)          /* count, then decode */
+   {
+      lbptr = words;
+      for (page = 0; page < lexlen / dicpln; ++page)
+         for ( p = diclexdba + page * dicpln, pend = p + dicpln;
+               p < pend && *p != 0x00; )
+         {
+            FC_DECODE(p, shared, suflen, suffix)
+            p = suffix + suflen;
+            if (p > pend || shared + suflen > MAXWORDLEN) break;
+            memcpy(word + shared, suffix, suflen);
+            if (pass == 0) { *len += shared + suflen + 1; continue; }
+            *lbptr++ = (unsigned char)(shared + suflen);
+            memcpy(lbptr, word, shared + suflen);
+            lbptr += shared + suflen;
+         }
+      if (pass == 0)
+      {
+         words = new unsigned char[*len + 1];
+         if (words == NULL) {return(NULL);}
+      }
+   }
+   words[*len] = 0x00;
+   return(words);
+}
+
+// Guide word of a page: the first word beginning on it, blank padded to indswd
+void set_guide_word(unsigned char *guide, DWORD indswd, unsigned char *word, DWORD len)
+{
+   memset(guide, SPACE, indswd);
+   memcpy(guide, word, (len < indswd) ? len : indswd);
+}
+
+// Lay out words[0..len) (lexical database format) in pages of dicpln bytes:
+// front coded if 'fc', otherwise whole, running over from page to page.
+// Returns the pages (*lexlen bytes) and a guide word for each (*nidxwds of
+// indswd bytes) in memory the caller deletes. Returns FALSE if there isn't
+// memory, or a word is too long for a page, or (front coded) the words
+// aren't in order.
+BOOL pack_pages(unsigned char *words, DWORD len, BOOL fc, DWORD dicpln, DWORD indswd,
+                unsigned char **lex, DWORD *lexlen, unsigned char **index, DWORD *nidxwds)
+{
+   unsigned char *lbptr, *prev, *p;
+   DWORD npages, page, used, shared, need, pass, cmplen;
+
+   *lex = *index = NULL;
+   if (fc && dicpln < MAXWORDLEN + 2) {return(FALSE);}
+   for ( lbptr = words;                        /* up to the NULL length-byte */
+         lbptr < words + len && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+         lbptr += *lbptr + 1 );
+   len = (DWORD)(lbptr - words);
+   if (!fc)
+   {
+      npages = (len + 1 + dicpln - 1) / dicpln;
+      *lex = new unsigned char[npages * dicpln];
+      *index = new unsigned char[npages * indswd];
+      if (*lex == NULL || *index == NULL) goto fail;
+      memset(*lex, 0, npages * dicpln);
+      memset(*index, SPACE, npages * indswd);
+      memcpy(*lex, words, len);
+      for (page = 0, prev = NULL, lbptr = words; lbptr < words + len; prev = lbptr, lbptr += *lbptr + 1)
+         for ( ; page < npages && (DWORD)(lbptr - words) >= page * dicpln; ++page)   /* first word beginning on the page */
+            set_guide_word(*index + page * indswd, indswd, lbptr + 1, *lbptr);
+      for ( ; page < npages && prev != NULL; ++page)                                 /* pages after the last word */
+         set_guide_word(*index + page * indswd, indswd, prev + 1, *prev);
+      *lexlen = npages * dicpln;
+      *nidxwds = npages;
+      return(TRUE);
+   }
+
+   npages = 0;
+   for (pass = 0; pass < 2; ++pass)          /* count the pages, then fill them */
+   {
+      page = 0;
+      used = dicpln;                          /* (no page yet) */
+      prev = NULL;
+      for (lbptr = words; lbptr < words + len; prev = lbptr, lbptr += *lbptr + 1)
+      {
+         shared = 0;
+         if (prev != NULL)
+         {
+            cmplen = (*prev < *lbptr) ? *prev : *lbptr;
+            for ( ; shared < cmplen && prev[1 + shared] == lbptr[1 + shared]; ++shared );
+            if (   shared == *lbptr
+                || (shared < cmplen && prev[1 + shared] > lbptr[1 + shared]) )
+              goto fail;                      /* not in order */
+         }
+         need = ((shared <= 7) ? 1 : 3) + *lbptr - shared;
+         if (used + need > dicpln)            /* start a new page, sharing nothing */
+         {
+            ++page;
+            used = 0;
+            shared = 0;
+            need = 1 + *lbptr;
+            if (pass == 1) set_guide_word(*index + (page - 1) * indswd, indswd, lbptr + 1, *lbptr);
+         }
+         if (pass == 1)
+         {
+            p = *lex + (page - 1) * dicpln + used;
+            if (shared <= 7) { *p++ = (unsigned char)((shared << 5) | (*lbptr - shared)); }
+            else { *p++ = FC_LONG; *p++ = (unsigned char)shared; *p++ = (unsigned char)(*lbptr - shared); }
+            memcpy(p, lbptr + 1 + shared, *lbptr - shared);
+         }
+         used += need;
+      }
+      if (pass == 0)
+      {
+         npages = (page == 0) ? 1 : page;
+         *lex = new unsigned char[npages * dicpln];
+         *index = new unsigned char[npages * indswd];
+         if (*lex == NULL || *index == NULL) goto fail;
+         memset(*lex, 0, npages * dicpln);
+         memset(*index, SPACE, npages * indswd);
+      }
+   }
+   *lexlen = npages * dicpln;
+   *nidxwds = npages;
+   return(TRUE);
+
+fail:
+   if (*lex)   { delete[] *lex; }
+   if (*index) { delete[] *index; }
+   *lex = *index = NULL;
+   return(FALSE);
+}
+
+// The words of the main lexical database in lexical database format: the
+// dictionary's own, or its front coded pages decoded into memory (release
+// with free_main_words). NULL if there isn't memory to decode them.
+unsigned char *main_words(struct edx_dictionary *dic, unsigned char **end)
+{
+   unsigned char *words;
+   DWORD len;
+
+   if (!dic->frontcoded)
+   {
+      *end = dic->diclexdba + dic->dichead->lexlen;
+      return(dic->diclexdba);
+   }
+   words = fc_decode(dic->diclexdba, dic->dichead->lexlen, dic->dichead->dicpln, &len);
+   *end = (words == NULL) ? NULL : words + len + 1;
+   return(words);
+}
+
+void free_main_words(struct edx_dictionary *dic, unsigned char *words)
+{
+   if (words != NULL && words != dic->diclexdba) { delete[] words; }
+}
+
+// Decode a front coded dictionary's pages into memory, laid out as an
+// uncompressed dictionary with its own guide words, and use them instead.
+// Returns FALSE if there isn't memory (the dictionary stays front coded).
+BOOL expand_front_coded(struct edx_dictionary *dic)
+{
+   unsigned char *words, *end, *lex, *index;
+   DWORD lexlen, nidxwds;
+   BOOL ok;
+
+   words = main_words(dic, &end);
+   if (words == NULL) {return(FALSE);}
+   ok = pack_pages(words, (DWORD)(end - words) - 1, FALSE, dic->dichead->dicpln, dic->dichead->indswd,
+                   &lex, &lexlen, &index, &nidxwds);
+   free_main_words(dic, words);
+   if (!ok) {return(FALSE);}
+   dic->plainbase = lex;
+   dic->plainindex = index;
+   dic->v6head.lexlen = lexlen;
+   dic->v6head.nidxwds = nidxwds;
+   dic->diclexdba = lex;
+   dic->dicindptr = index;
+   dic->lexlimit = lex + lexlen;
+   dic->frontcoded = FALSE;
+   return(TRUE);
+}
+
+// Whether EDX_OPT_HASH_INDEX wants a hash index of the main lexical
+// database: EDX_HASH_UNLESS_FRONT_CODED only if the pages weren't front
+// coded, even once they have been decoded for something else
+BOOL hash_index_wanted(struct edx_dictionary *dic)
+{
+   if (dic->options[EDX_OPT_HASH_INDEX] == EDX_HASH_UNLESS_FRONT_CODED)
+     {return( !dic->frontcoded && dic->plainbase == NULL );}
+   return( dic->options[EDX_OPT_HASH_INDEX] != EDX_HASH_NONE );
+}
+
+/*---------------------------------------------------------------------------
+    .SUBTITLE BLOOM FILTER
+
+ Functional Description:
+    A blocked Bloom filter of every word in the main lexical database, the
+    common word list and the user's personal Aux1 dictionary. When spell
+    guessing almost every word we look up is not a word, and the Bloom
+    filter says so after reading one 64 byte block, without searching the
+    common words, index or dictionary pages.
+
+    The word's hash picks a 512 bit block, and bloomk bits in that block
+    are set for the word. A word not in the dictionary has all its bits set
+    by chance (a false positive, so we go on and search for it) about 1% of
+    the time at 10 bits per word (EDX_OPT_BLOOM_BITS), 0.2% at 15 bits,
+    and 5% at 6 bits.
+
+    The filter is sized when the main dictionary is loaded, leaving room for
+    BLOOM_AUX1_WORDS Aux1 words. Words added to the Aux1 dictionary after
+    that only make false positives a little more likely. A dictionary
+    stack's layers may have many more words than that, so load_dic makes a
+    new one sized for them too (see DICTIONARY STACKS).
+---------------------------------------------------------------------------*/
+// Second hash, for picking bits within the block
+DWORD bloom_mix(DWORD h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return(h);
+}
+
+// Add word (lowercased, length wdlen) to Bloom filter
+void bloom_add(struct edx_dictionary *dic, unsigned char *word, DWORD wdlen)
+{
+    DWORD h = hash_word(word, wdlen);
+    DWORD *block = dic->bloom + (DWORD)(((unsigned __int64)h * dic->bloomblocks) >> 32) * BLOOM_BLOCK_DWORDS;
+    DWORD g = bloom_mix(h);
+    DWORD delta = (g >> 23) | 1;     /* odd, so the k bits differ */
+    DWORD i, bit;
+
+    for (i = 0, bit = g; i < dic->bloomk; ++i, bit += delta)
+       block[(bit >> 5) & (BLOOM_BLOCK_DWORDS-1)] |= 1u << (bit & 31);
+    ++dic->bloomwords;
+}
+
+// bloom_add for a Bloom filter sessions may be reading (aux1_add_word).
+// Each bit is set with one locked OR, so no reader sees a DWORD half written.
+void bloom_publish(struct edx_dictionary *dic, unsigned char *word, DWORD wdlen)
+{
+    DWORD h = hash_word(word, wdlen);
+    DWORD *block = dic->bloom + (DWORD)(((unsigned __int64)h * dic->bloomblocks) >> 32) * BLOOM_BLOCK_DWORDS;
+    DWORD g = bloom_mix(h);
+    DWORD delta = (g >> 23) | 1;
+    DWORD i, bit;
+
+    for (i = 0, bit = g; i < dic->bloomk; ++i, bit += delta)
+       InterlockedOr((LONG volatile *)&block[(bit >> 5) & (BLOOM_BLOCK_DWORDS-1)], (LONG)(1u << (bit & 31)));
+    ++dic->bloomwords;
+}
+
+// Returns FALSE if word (lowercased, length wdlen) is definitely not in the dictionary
+BOOL bloom_maybe_hash(struct edx_dictionary *dic, DWORD h)
+{
+    DWORD *block = dic->bloom + (DWORD)(((unsigned __int64)h * dic->bloomblocks) >> 32) * BLOOM_BLOCK_DWORDS;
+    DWORD g = bloom_mix(h);
+    DWORD delta = (g >> 23) | 1;
+    DWORD i, bit;
+
+    for (i = 0, bit = g; i < dic->bloomk; ++i, bit += delta)
+       if ((block[(bit >> 5) & (BLOOM_BLOCK_DWORDS-1)] & (1u << (bit & 31))) == 0) return(FALSE);
+    return(TRUE);
+}
+
+BOOL bloom_maybe(struct edx_dictionary *dic, unsigned char *word, DWORD wdlen)
+{
+    return( bloom_maybe_hash(dic, hash_word(word, wdlen)) );
+}
+
+// Add all the words of a lexical database (main, common words, or Aux1) to the Bloom filter
+void bloom_add_words(struct edx_dictionary *dic, unsigned char *lbptr, unsigned char *end)
+{
+    for ( ;
+          (end == NULL || lbptr < end) && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+          lbptr += *lbptr + 1 )
+       bloom_add(dic, lbptr + 1, *lbptr);
+}
+
+// Returns TRUE if there's a Bloom filter we can add words to. The Bloom
+// filter of a version 6 dictionary is in the read only mapped file, so it's
+// copied into memory before the first Aux1 word is added. Sessions reading
+// the mapped one go on with it (it stays mapped till the dictionary is
+// freed). If there isn't memory for the copy, load_dic does without the
+// Bloom filter (one that didn't have the Aux1 words would say they're not
+// words) and aux1_add_word fails.
+BOOL bloom_writable(struct edx_dictionary *dic)
+{
+    DWORD *base, *bloom;
+
+    if (dic->bloom == NULL) {return(FALSE);}
+    if (dic->bloombase != NULL) {return(TRUE);}
+    base = new DWORD[(dic->bloomblocks + 1) * BLOOM_BLOCK_DWORDS];
+    if (base == NULL) {return(FALSE);}
+    bloom = (DWORD *)(((DWORD_PTR)base + 63) & ~(DWORD_PTR)63);
+    memcpy(bloom, dic->bloom, dic->bloomblocks * BLOOM_BLOCK_DWORDS * sizeof(DWORD));
+    dic->bloombase = base;
+    InterlockedExchangePointer((void * volatile *)&dic->bloom, bloom);   /* (copied before sessions see it) */
+    return(TRUE);
+}
+
+// Build Bloom filter of main lexical database and common words, with room
+// for 'more' words (the layers of a dictionary stack) and the Aux1 words.
+// They're added by load_dic. If there isn't memory for it we do without it.
+void build_bloom_filter(struct edx_dictionary *dic, DWORD bits_per_word, DWORD more)
+{
+    unsigned char *diclexend;
+    unsigned char *cmnwdsend = dic->cmnwdsptr + dic->dichead->cwdlen;
+    unsigned char *words = main_words(dic, &diclexend);   /* (front coded pages decoded) */
+    DWORD nwords;
+
+    if (words == NULL) {return;}
+    if (bits_per_word > BLOOM_MAX_BITS) bits_per_word = BLOOM_MAX_BITS;
+    nwords = count_words(words, diclexend)
+           + count_words(dic->cmnwdsptr, cmnwdsend)
+           + more + BLOOM_AUX1_WORDS;
+    dic->bloomwords = 0;
+    dic->bloomblocks = (DWORD)(((unsigned __int64)nwords * bits_per_word + 511) / 512);
+    dic->bloomk = (bits_per_word * 69 + 50) / 100;    /* bits per word * ln(2) is the best number of bits to set */
+    if (dic->bloomk < 1) dic->bloomk = 1;
+
+    dic->bloombase = new DWORD[(dic->bloomblocks + 1) * BLOOM_BLOCK_DWORDS];  /* +1 block so we can align it */
+    if (dic->bloombase == NULL) { free_main_words(dic, words); return; }
+    dic->bloom = (DWORD *)(((DWORD_PTR)dic->bloombase + 63) & ~(DWORD_PTR)63);
+    memset(dic->bloom, 0, dic->bloomblocks * BLOOM_BLOCK_DWORDS * sizeof(DWORD));
+
+    bloom_add_words(dic, words, diclexend);
+    bloom_add_words(dic, dic->cmnwdsptr, cmnwdsend);
+    free_main_words(dic, words);
+}
+
+/*---------------------------------------------------------------------------
+    .SUBTITLE LOOKUP CACHE
+
+ Functional Description:
+    Remembers whether dic_lookup_word found each of the last few thousand
+    words looked up (EDX_OPT_LOOKUP_CACHE words). Most of the words in a
+    document are the same few hundred, which are then found with one hash
+    and a probe instead of a search of the common words, Bloom filter and
+    dictionary pages.
+
+    The cache belongs to the dictionary, so all sessions on it share it.
+    It's split into CACHE_SHARDS shards by the word's hash, each with its
+    own lock, so threads looking up different words seldom wait on each
+    other. Each shard is a hash table of its entries, and a list of them
+    from most to least recently used. When a shard is full the least
+    recently used word is evicted.
+
+    Only words added to the user's Aux1 dictionary can change from not
+    found to found, so edx$dic_add_persdic has the cache forget just that
+    word (cache_forget). A lookup that searched for the word before it was
+    added may still be about to put "not found" into the cache, so
+    cache_forget also changes the shard's generation, and cache_add puts
+    nothing in if the generation changed since its cache_find.
+---------------------------------------------------------------------------*/
+// Make an empty cache of nwords words split into nshards shards (a lookup
+// cache, or a guess cache). Returns NULL if there isn't memory for it.
+struct cache_shard *new_cache(DWORD nshards, DWORD nwords)
+{
+    struct cache_shard *cache, *cs;
+    DWORD i, size, nbuckets;
+
+    cache = new struct cache_shard[nshards];
+    if (cache == NULL) {return(NULL);}
+    memset(cache, 0, nshards * sizeof(struct cache_shard));
+    size = (nwords + nshards - 1) / nshards;
+    for (nbuckets = 16; nbuckets < 2*size; nbuckets <<= 1);
+    for (i = 0; i < nshards; ++i) InitializeCriticalSection(&cache[i].lock);
+    for (i = 0; i < nshards; ++i)
+    {
+        cs = &cache[i];
+        cs->entry = new struct cache_entry[size];
+        cs->bucket = new DWORD[nbuckets];
+        if (cs->entry == NULL || cs->bucket == NULL) { free_cache(cache, nshards); return(NULL); }
+        memset(cs->bucket, 0xFF, nbuckets * sizeof(DWORD));   /* all CACHE_NONE */
+        cs->mask = nbuckets - 1;
+        cs->size = size;
+        cs->head = cs->tail = CACHE_NONE;
+    }
+    return(cache);
+}
+
+struct cache_shard *cache_shard_of(struct edx_dictionary *dic, DWORD h)
+{
+    return( &dic->cache[(h >> 16) & (CACHE_SHARDS-1)] );   /* (the buckets use the low bits) */
+}
+
+// Entry of word,len with hash h in shard cs, or CACHE_NONE
+DWORD cache_search(struct cache_shard *cs, unsigned char *word, DWORD len, DWORD h)
+{
+    DWORD e;
+    struct cache_entry *ce;
+
+    for (e = cs->bucket[h & cs->mask]; e != CACHE_NONE; e = ce->chain)
+    {
+        ce = &cs->entry[e];
+        if (ce->hash == h && ce->len == len && memcmp(ce->word, word, len) == 0) return(e);
+    }
+    return(CACHE_NONE);
+}
+
+// Take entry e off the most to least recently used list
+void cache_unlink(struct cache_shard *cs, DWORD e)
+{
+    struct cache_entry *ce = &cs->entry[e];
+
+    if (ce->prev != CACHE_NONE) cs->entry[ce->prev].next = ce->next; else cs->head = ce->next;
+    if (ce->next != CACHE_NONE) cs->entry[ce->next].prev = ce->prev; else cs->tail = ce->prev;
+}
+
+// Put entry e at the most recently used end of the list (or the least, if !recent)
+void cache_link(struct cache_shard *cs, DWORD e, BOOL recent)
+{
+    struct cache_entry *ce = &cs->entry[e];
+
+    if (recent)
+    {
+        ce->prev = CACHE_NONE;
+        ce->next = cs->head;
+        if (cs->head != CACHE_NONE) cs->entry[cs->head].prev = e; else cs->tail = e;
+        cs->head = e;
+    }
+    else
+    {
+        ce->next = CACHE_NONE;
+        ce->prev = cs->tail;
+        if (cs->tail != CACHE_NONE) cs->entry[cs->tail].next = e; else cs->head = e;
+        cs->tail = e;
+    }
+}
+
+// Take entry e out of its hash bucket
+void cache_unchain(struct cache_shard *cs, DWORD e)
+{
+    DWORD *link;
+
+    for (link = &cs->bucket[cs->entry[e].hash & cs->mask]; *link != e; link = &cs->entry[*link].chain);
+    *link = cs->entry[e].chain;
+}
+
+// Look word,len (lowercased, hash h) up in the lookup cache. Returns TRUE and
+// its status (and layer, if found) if it's there. Either way sets
+// *generation for cache_add.
+BOOL cache_find(struct edx_dictionary *dic, unsigned char *word, DWORD len, DWORD h, int *status, DWORD *layer, DWORD *generation)
+{
+    struct cache_shard *cs = cache_shard_of(dic, h);
+    DWORD e;
+
+    EnterCriticalSection(&cs->lock);
+    *generation = cs->generation;
+    e = cache_search(cs, word, len, h);
+    if (e == CACHE_NONE)
+    {
+        ++cs->misses;
+        LeaveCriticalSection(&cs->lock);
+        return(FALSE);
+    }
+    ++cs->hits;
+    *status = cs->entry[e].found ? EDX__WORDFOUND : EDX__WORDNOTFOUND;
+    if (cs->entry[e].found) { *layer = cs->entry[e].found - 1; }
+    if (cs->head != e) { cache_unlink(cs, e); cache_link(cs, e, TRUE); }
+    LeaveCriticalSection(&cs->lock);
+    return(TRUE);
+}
+
+// Put word,len (hash h) into shard cs as its most recently used entry,
+// evicting the shard's least recently used word if it's full. Returns the
+// entry, or CACHE_NONE if the word is already there. (cs->lock is held.)
+DWORD cache_insert(struct cache_shard *cs, unsigned char *word, DWORD len, DWORD h)
+{
+    struct cache_entry *ce;
+    DWORD e;
+
+    if (cache_search(cs, word, len, h) != CACHE_NONE) return(CACHE_NONE);
+    if (cs->used < cs->size)
+    {
+        e = cs->used++;
+        cs->entry[e].guesses = NULL;
+    }
+    else
+    {
+        e = cs->tail;
+        cache_unlink(cs, e);
+        if (cs->entry[e].len != 0) { cache_unchain(cs, e); ++cs->evictions; }
+        if (cs->entry[e].guesses) { delete[] cs->entry[e].guesses; cs->entry[e].guesses = NULL; }
+    }
+    ce = &cs->entry[e];
+    ce->hash = h;
+    ce->len = (unsigned char)len;
+    memcpy(ce->word, word, len);
+    ce->chain = cs->bucket[h & cs->mask];
+    cs->bucket[h & cs->mask] = e;
+    cache_link(cs, e, TRUE);
+    return(e);
+}
+
+// Put word,len (lowercased, hash h) and its status (and layer, if found)
+// into the lookup cache. generation is what cache_find set when the word
+// wasn't there.
+void cache_add(struct edx_dictionary *dic, unsigned char *word, DWORD len, DWORD h, int status, DWORD layer, DWORD generation)
+{
+    struct cache_shard *cs = cache_shard_of(dic, h);
+    DWORD e;
+
+    EnterCriticalSection(&cs->lock);
+    if (cs->generation == generation)
+    {
+        e = cache_insert(cs, word, len, h);
+        if (e != CACHE_NONE) cs->entry[e].found = (unsigned char)((status == EDX__WORDFOUND) ? layer + 1 : 0);
+    }
+    LeaveCriticalSection(&cs->lock);
+}
+
+// Forget word,len (lowercased), if it's in the lookup cache. Its entry goes
+// to the least recently used end, to be used next.
+void cache_forget(struct edx_dictionary *dic, unsigned char *word, DWORD len)
+{
+    DWORD h = hash_word(word, len);
+    struct cache_shard *cs = cache_shard_of(dic, h);
+    DWORD e;
+
+    EnterCriticalSection(&cs->lock);
+    ++cs->generation;
+    e = cache_search(cs, word, len, h);
+    if (e != CACHE_NONE)
+    {
+        cache_unchain(cs, e);
+        cache_unlink(cs, e);
+        cs->entry[e].len = 0;
+        cache_link(cs, e, FALSE);
+    }
+    LeaveCriticalSection(&cs->lock);
+}
+
+/*--------------------------------------------------------------------------
+    .SUBTITLE INDEX FILES
+
+ Functional Description:
+    Some indexes take too long to build every time the dictionary is
+    loaded. They're saved next to the dictionary (EDX.dic -> EDX.sym) and
+    memory mapped on later loads, so they're only built once. An index
+    starts with a checksum of the dictionary it was built from
+    (dic_checksum), and is built again if it wasn't built from this
+    dictionary. If it can't be saved (say the dictionary is on a read only
+    share) it's kept in memory instead.
+
+    Each kind of index has a builder, which returns the index as an image
+    of the file, and a user, which checks an image and points the
+    dictionary at it.
+---------------------------------------------------------------------------*/
+typedef DWORD *(*index_builder)(struct edx_dictionary *dic, DWORD *len);
+typedef BOOL (*index_user)(struct edx_dictionary *dic, unsigned char *image, DWORD len);
+
+/* Checksum of the parts of a dictionary that say which dictionary it is */
+DWORD dic_checksum_of(struct dichead_layout *dichead, unsigned char *dicindptr, DWORD dicstamp)
+{
+   return(   hash_word((unsigned char *)dichead, HEADER_LEN)
+          ^ (hash_word(dicindptr, dichead->nidxwds * dichead->indswd) * 31)
+          ^  dicstamp );
+}
+
+DWORD dic_checksum(struct edx_dictionary *dic)
+{
+   return( dic_checksum_of(dic->dichead, dic->dicindptr, dic->dicstamp) );
+}
+
+/* Map index file f->Name. Returns FALSE if there isn't one, or use()
+   says it isn't a good index of this dictionary. */
+BOOL map_index_file(struct edx_dictionary *dic, struct index_file *f, index_user use)
+{
+   DWORD size;
+
+   f->hFile = CreateFile(f->Name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+   if (f->hFile == INVALID_HANDLE_VALUE) { f->hFile = NULL; return(FALSE); }
+   size = GetFileSize(f->hFile, NULL);
+   if (size != 0xFFFFFFFF && size != 0)
+   {
+      f->hFileMap = CreateFileMapping(f->hFile, NULL, PAGE_READONLY, 0, size, NULL);
+      if (f->hFileMap != NULL && f->hFileMap != INVALID_HANDLE_VALUE)
+      {
+         f->lpMapBase = MapViewOfFile(f->hFileMap, FILE_MAP_READ, 0, 0, size);
+         if (f->lpMapBase != NULL && use(dic, (unsigned char *)f->lpMapBase, size)) return(TRUE);
+      }
+   }
+   if (f->lpMapBase) { UnmapViewOfFile(f->lpMapBase); f->lpMapBase = NULL; }
+   if (f->hFileMap && f->hFileMap != INVALID_HANDLE_VALUE) { CloseHandle(f->hFileMap); }
+   f->hFileMap = NULL;
+   CloseHandle(f->hFile);
+   f->hFile = NULL;
+   return(FALSE);
+}
+
+/* Name (FNAMESIZE characters) of the file next to File_Name with extension
+   ext (EDX.dic -> EDX.sym) */
+void index_file_name(char *Name, char *File_Name, char *ext)
+{
+   char *dot, *p;
+
+   strncpy(Name, File_Name, FNAMESIZE - 5);
+   Name[FNAMESIZE-5] = '\0';
+   for (dot = NULL, p = Name; *p; ++p)
+   {
+      if (*p == '.') dot = p;
+      else if (*p == '\\' || *p == '/' || *p == ':') dot = NULL;
+   }
+   strcpy( (dot != NULL) ? dot : p, ext );
+}
+
+/* Load the index of dictionary Dic_File_Name saved in the file with
+   extension ext (".sym"), building and saving it first if need be. If it
+   can't be built, use() is never called. */
+void load_index_file(struct edx_dictionary *dic, struct index_file *f, char *Dic_File_Name,
+                     char *ext, index_builder build, index_user use)
+{
+   LARGE_INTEGER start;
+   DWORD *image;
+   DWORD len;
+   HANDLE hFile;
+   DWORD written;
+   BOOL saved;
+
+   index_file_name(f->Name, Dic_File_Name, ext);
+   if (map_index_file(dic, f, use)) return;      /* built before */
+
+   QueryPerformanceCounter(&start);
+   image = build(dic, &len);
+   if (image == NULL) { f->Name[0] = '\0'; return; }
+   f->buildms = elapsed_ms(start);
+
+   hFile = CreateFile(f->Name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+   saved = FALSE;
+   if (hFile != INVALID_HANDLE_VALUE)
+   {
+      saved = WriteFile(hFile, image, len, &written, NULL) && written == len;
+      CloseHandle(hFile);
+      if (!saved) DeleteFile(f->Name);
+   }
+   if (saved && map_index_file(dic, f, use)) { delete[] image; return; }
+
+   /* Couldn't save it. Use it from memory. */
+   f->Name[0] = '\0';
+   f->membase = image;
+   if (!use(dic, (unsigned char *)image, len))
+   {
+      delete[] f->membase;
+      f->membase = NULL;
+   }
+}
+
+/*--------------------------------------------------------------------------
+    .SUBTITLE GUESS CACHE
+
+ Functional Description:
+    People make the same typing mistakes over and over ("teh", "recieve"),
+    and make_guess_list made the same guess list for them every time. The
+    guess cache keeps the guess lists of the last few misspelled words
+    (EDX_OPT_GUESS_CACHE words), and when one comes round again its guesses
+    are copied from the cache instead. It's the lookup cache's code with
+    one shard, keyed by the misspelled word as it was typed (the guesses'
+    capitals follow it), and is shared by all sessions on the dictionary.
+
+    A word added to the user's Aux1 dictionary may be a guess for any
+    misspelled word, so edx$dic_add_persdic empties the guess cache.
+    Guess lists of more than GUESS_CACHE_MAX words aren't kept, nor are
+    those of Levenshtein automaton searches stopped by their budget.
+
+    With EDX_OPT_GUESS_CACHE_FILE the guess cache is also kept in a plain
+    text file next to the user's Aux1 dictionary (AUX1.txt -> AUX1.gsc),
+    or next to the dictionary if there's no Aux1 dictionary. Each guess
+    list made is added to the end of the file, and the file is read back
+    into the cache when the dictionary is loaded, so guessing is quick
+    from the start after a restart. The file is written over with just the
+    words the cache kept when it has more than that.
+
+ .gsc file layout:
+    EDXgsc1 stamp                 guess_cache_stamp() in hex, of the
+                                  dictionary, Aux1 words and guessing
+                                  engine the guesses were made with. If it
+                                  isn't ours the file is started over.
+    word guess guess ...          one line for each misspelled word, its
+                                  guesses best first, least recent first
+---------------------------------------------------------------------------*/
+/* Which dictionary, Aux1 words and guessing engine (see make_guess_list) made the guesses */
+DWORD guess_cache_stamp(struct edx_dictionary *dic)
+{
+   DWORD stamp = dic_checksum(dic);
+
+   if (dic->aux1base != NULL) stamp ^= hash_word(dic->aux1base, dic->aux1len) * 31;
+   if (dic->sym != NULL) stamp ^= dic->options[EDX_OPT_SYMSPELL] << 24;
+   if (dic->dwg != NULL) stamp ^= 1 << 27;
+   stamp ^= dic->options[EDX_OPT_LEVENSHTEIN] << 28;
+   return(stamp);
+}
+
+/* Write guess cache entry ce to .gsc file fp */
+void guess_cache_write(FILE *fp, struct cache_entry *ce)
+{
+   unsigned char *lbptr;
+
+   fprintf(fp, "%.*s", (int)ce->len, (char *)ce->word);
+   for (lbptr = ce->guesses; *lbptr != 0x00; lbptr += *lbptr + 1)
+      fprintf(fp, " %.*s", (int)*lbptr, (char *)lbptr + 1);
+   fprintf(fp, "\n");
+}
+
+/* Write the .gsc file over with the words in the guess cache, least
+   recently used first. If it can't be written, the cache isn't kept in a
+   file. (dic->guesscache->lock is held, or no sessions yet.) */
+void guess_cache_rewrite(struct edx_dictionary *dic)
+{
+   struct cache_shard *cs = dic->guesscache;
+   FILE *fp;
+   DWORD e;
+
+   fp = fopen(dic->GuessCacheFile, "w");
+   if (fp == NULL) { dic->GuessCacheFile[0] = '\0'; return; }
+   fprintf(fp, "%s %08lx\n", GUESS_CACHE_ID, (unsigned long)guess_cache_stamp(dic));
+   for (e = cs->tail; e != CACHE_NONE; e = cs->entry[e].prev)
+      guess_cache_write(fp, &cs->entry[e]);
+   fclose(fp);
+}
+
+/* Read a line of a .gsc file: the misspelled word (word,*len) and its
+   guesses (*guesses, new[]'d, in lexical database format). Returns FALSE
+   if it isn't a good line. */
+BOOL guess_cache_parse(char *line, unsigned char *word, DWORD *len, unsigned char **guesses)
+{
+   unsigned char list[GUESS_CACHE_LINE];
+   unsigned char *p = (unsigned char *)line;
+   unsigned char *tok;
+   DWORD n, listlen, toklen;
+
+   for (n = 0, listlen = 0; ; ++n)
+   {
+      while (*p != '\0' && EDXisspace(*p)) ++p;
+      if (*p == '\0') break;
+      for (tok = p; *p != '\0' && !EDXisspace(*p); ++p);
+      toklen = (DWORD)(p - tok);
+      if (toklen > MAXWORDLEN || n > GUESS_CACHE_MAX) return(FALSE);
+      if (n == 0) { memcpy(word, tok, toklen); *len = toklen; continue; }
+      list[listlen++] = (unsigned char)toklen;
+      memcpy(list + listlen, tok, toklen);
+      listlen += toklen;
+   }
+   if (n == 0) return(FALSE);
+   list[listlen++] = 0x00;
+   *guesses = new unsigned char[listlen];
+   if (*guesses == NULL) return(FALSE);
+   memcpy(*guesses, list, listlen);
+   return(TRUE);
+}
+
+/* Make the guess cache of a dictionary once its main and Aux1 dictionaries
+   are loaded, and fill it from its .gsc file if EDX_OPT_GUESS_CACHE_FILE.
+   If there isn't memory for it we do without it. */
+void load_guess_cache(struct edx_dictionary *dic, char *Dic_File_Name)
+{
+   struct cache_shard *cs;
+   FILE *fp;
+   char line[GUESS_CACHE_LINE];
+   unsigned char word[MAXWORDLEN];
+   unsigned char *guesses;
+   unsigned long stamp;
+   DWORD len, e, nlines;
+
+   if (dic->options[EDX_OPT_GUESS_CACHE] == 0) {return;}
+   dic->guesscache = cs = new_cache(1, dic->options[EDX_OPT_GUESS_CACHE]);
+   if (cs == NULL || !dic->options[EDX_OPT_GUESS_CACHE_FILE]) {return;}
+
+   index_file_name(dic->GuessCacheFile, (dic->Aux1File[0] != '\0') ? dic->Aux1File : Dic_File_Name, ".gsc");
+   nlines = 0;
+   fp = fopen(dic->GuessCacheFile, "r");
+   if (fp != NULL)
+   {
+      if (   fgets(line, GUESS_CACHE_LINE, fp) != NULL
+          && sscanf(line, GUESS_CACHE_ID " %lx", &stamp) == 1
+          && stamp == guess_cache_stamp(dic) )
+      {
+         while (fgets(line, GUESS_CACHE_LINE, fp) != NULL)
+         {
+            ++nlines;
+            if (!guess_cache_parse(line, word, &len, &guesses)) continue;
+            e = cache_insert(cs, word, len, hash_word(word, len));
+            if (e == CACHE_NONE) delete[] guesses;
+            else cs->entry[e].guesses = guesses;
+         }
+      }
+      fclose(fp);
+   }
+   cs->evictions = 0;
+   if (fp == NULL || nlines != cs->used) guess_cache_rewrite(dic);   /* new, not ours, or more than we kept */
+}
+
+/* If the session's misspelled word is in the guess cache, make the
+   session's guess list from the guesses kept for it and return TRUE.
+   Either way sets *generation for guess_cache_add. */
+BOOL guess_cache_find(struct edx_session *ses, DWORD h, DWORD *generation)
+{
+   struct cache_shard *cs = ses->dic->guesscache;
+   struct guess_list *gl = &ses->guesses;
+   struct guess_cand *gc;
+   unsigned char list[GUESS_CACHE_LINE];
+   unsigned char *lbptr;
+   DWORD e, n, i;
+
+   EnterCriticalSection(&cs->lock);
+   *generation = cs->generation;
+   e = cache_search(cs, ses->dic_lwa, ses->dic_lwl, h);
+   if (e == CACHE_NONE)
+   {
+      ++cs->misses;
+      LeaveCriticalSection(&cs->lock);
+      return(FALSE);
+   }
+   ++cs->hits;
+   for (lbptr = cs->entry[e].guesses, n = 0; *lbptr != 0x00; lbptr += *lbptr + 1, ++n);
+   memcpy(list, cs->entry[e].guesses, lbptr - cs->entry[e].guesses + 1);
+   if (cs->head != e) { cache_unlink(cs, e); cache_link(cs, e, TRUE); }
+   LeaveCriticalSection(&cs->lock);
+
+   free_guesses(ses);
+   gl->cand = new struct guess_cand[n + 1];
+   if (gl->cand == NULL) {return(FALSE);}      /* make them the long way */
+   memset(gl->cand, 0, (n + 1) * sizeof(struct guess_cand));
+   for (lbptr = list, i = 0; i < n; lbptr += *lbptr + 1, ++i)
+   {
+      gc = &gl->cand[i];
+      gc->len = *lbptr;
+      memcpy(gc->word, lbptr + 1, gc->len);
+      for (e = 0; e < gc->len; ++e) gc->lower[e] = ANSItolower(gc->word[e]);
+      gc->order = i;
+   }
+   gl->ncand = gl->maxcand = n;
+   return(TRUE);
+}
+
+/* Put the session's guess list for its misspelled word (hash h) into the
+   guess cache, and on the end of the .gsc file. generation is what
+   guess_cache_find set. */
+void guess_cache_add(struct edx_session *ses, DWORD h, DWORD generation)
+{
+   struct edx_dictionary *dic = ses->dic;
+   struct cache_shard *cs = dic->guesscache;
+   struct guess_list *gl = &ses->guesses;
+   unsigned char *guesses, *p;
+   DWORD n, size, e;
+   FILE *fp;
+
+   if (gl->ncand > GUESS_CACHE_MAX) {return;}
+   for (n = 0, size = 1; n < gl->ncand; ++n) size += gl->cand[n].len + 1;
+   guesses = new unsigned char[size];
+   if (guesses == NULL) {return;}
+   for (n = 0, p = guesses; n < gl->ncand; ++n)
+   {
+      *p++ = (unsigned char)gl->cand[n].len;
+      memcpy(p, gl->cand[n].word, gl->cand[n].len);
+      p += gl->cand[n].len;
+   }
+   *p = 0x00;
+
+   EnterCriticalSection(&cs->lock);
+   e = (cs->generation == generation) ? cache_insert(cs, ses->dic_lwa, ses->dic_lwl, h) : CACHE_NONE;
+   if (e == CACHE_NONE) delete[] guesses;
+   else
+   {
+      cs->entry[e].guesses = guesses;
+      if (dic->GuessCacheFile[0] != '\0' && (fp = fopen(dic->GuessCacheFile, "a")) != NULL)
+      {
+         guess_cache_write(fp, &cs->entry[e]);
+         fclose(fp);
+      }
+   }
+   LeaveCriticalSection(&cs->lock);
+}
+
+/* Empty the guess cache and its .gsc file (a word was added to the user's Aux1 dictionary) */
+void guess_cache_clear(struct edx_dictionary *dic)
+{
+   struct cache_shard *cs = dic->guesscache;
+   DWORD e;
+
+   EnterCriticalSection(&cs->lock);
+   ++cs->generation;
+   for (e = 0; e < cs->used; ++e)
+      if (cs->entry[e].guesses) { delete[] cs->entry[e].guesses; }
+   cs->used = 0;
+   cs->head = cs->tail = CACHE_NONE;
+   memset(cs->bucket, 0xFF, (cs->mask + 1) * sizeof(DWORD));   /* all CACHE_NONE */
+   if (dic->GuessCacheFile[0] != '\0') guess_cache_rewrite(dic);
+   LeaveCriticalSection(&cs->lock);
+}
+
+/*--------------------------------------------------------------------------
+    .SUBTITLE SYMMETRIC DELETE SUGGESTION INDEX
+
+ Functional Description:
+    A precomputed index for guessing spellings up to SYM_MAX_DIST edits
+    away. Two words are within 2 edits of each other only if deleting at
+    most 2 characters from each of them leaves the same string. So for
+    every word of the main lexical database and the common word list we
+    hash each string left after deleting 0, 1 or 2 of its first
+    SYM_PREFIX_LEN characters (its "deletes"), and record the word under
+    each of those hashes. Spell guessing then hashes the deletes of the
+    misspelled word, and only the few words recorded under those hashes
+    need their edit distance checked (see SYM_GUESS_LIST).
+    This is the SymSpell symmetric delete algorithm.
+
+    The index is saved next to the dictionary as EDX.sym (see INDEX FILES).
+
+ .sym file layout:
+    struct sym_header
+    DWORD dir[SYM_DIR_SIZE+1]     dir[b] = first key whose hash's top
+                                  SYM_DIR_BITS bits are >= b
+    struct sym_key keys[nkeys+1]  sorted by hash. The words recorded under
+                                  keys[k].hash are postings[keys[k].first]
+                                  up to postings[keys[k+1].first]
+    DWORD postings[npostings]     offset of word's length-byte from
+                                  diclexdba, or from cmnwdsptr if SYM_COMMON
+
+ Outline (build_sym_index):
+    1.  Each thread takes a share of the words, makes the (hash, word)
+        pairs for them, and counts its pairs by the top bits of the hash.
+    2.  Each thread copies its pairs into one array of all the pairs,
+        grouped by the top bits of the hash.
+    3.  Each thread sorts its share of the groups by hash, and counts the
+        different hashes in each group.
+    4.  The directory, keys and postings are written out.
+---------------------------------------------------------------------------*/
+struct sym_header {
+   unsigned char id[8];              /* "EDXsym1" */
+   DWORD dicsum;                     /* dic_checksum() of the dictionary the index was built from */
+   DWORD maxdist;                    /* SYM_MAX_DIST */
+   DWORD prefixlen;                  /* SYM_PREFIX_LEN */
+   DWORD nkeys;                      /* number of different delete hashes */
+   DWORD npostings;                  /* number of (delete hash, word) pairs */
+   DWORD dirofst;                    /* offset of dir[] */
+   DWORD keyofst;                    /* offset of keys[] */
+   DWORD postofst;                   /* offset of postings[] */
+   DWORD filelen;                    /* length of the whole .sym file */
+   DWORD spare;
+};
+
+struct sym_key {
+   DWORD hash;                       /* hash_word() of a delete */
+   DWORD first;                      /* first of its postings */
+};
+
+struct sym_pair {
+   DWORD hash;                       /* hash_word() of a delete */
+   DWORD ref;                        /* word it's a delete of (a posting) */
+};
+
+/* One build thread's share of the work */
+struct sym_build {
+   struct edx_dictionary *dic;
+   int    phase;                     /* step of the outline the thread is to do */
+   DWORD *refs;                      /* step 1: words to make pairs for */
+   DWORD  nrefs;
+   struct sym_pair *pairs;           /* step 1: pairs made */
+   DWORD  npairs;
+   DWORD *count;                     /* step 1: [g] = pairs made in group g.
+                                        step 2: [g] = where the next one goes in all[] */
+   struct sym_pair *all;             /* step 2: all pairs, grouped */
+   DWORD *groupstart;                /* step 3: [g] = first pair of group g in all[] */
+   DWORD *groupkeys;                 /* step 3: [g] = different hashes in group g */
+   DWORD  firstgroup;                /* step 3: groups to sort */
+   DWORD  endgroup;
+};
+
+/* Word a posting refers to (pointer to its length-byte), or NULL if the
+   posting is bad */
+unsigned char *sym_word(struct edx_dictionary *dic, DWORD ref)
+{
+   if (ref & SYM_COMMON)
+   {
+      ref &= ~SYM_COMMON;
+      if (ref >= dic->dichead->cwdlen) return(NULL);
+      return(dic->cmnwdsptr + ref);
+   }
+   if (ref >= dic->dichead->lexlen) return(NULL);
+   return(dic->diclexdba + ref);
+}
+
+/* Hash each string left after deleting up to maxdist of the first
+   SYM_PREFIX_LEN characters of word (lowercased, length wdlen). Puts the
+   different hashes in hashes[] (room for SYM_MAX_DELETES) and returns how many. */
+DWORD sym_deletes(unsigned char *word, DWORD wdlen, DWORD maxdist, DWORD *hashes)
+{
+   unsigned char del[SYM_PREFIX_LEN];
+   DWORD plen = (wdlen < SYM_PREFIX_LEN) ? wdlen : SYM_PREFIX_LEN;
+   DWORD n = 0;
+   DWORD i, j, k, m, h;
+
+   hashes[n++] = hash_word(word, plen);              /* nothing deleted */
+   if (maxdist < 1) return(n);
+   for (i = 0; i < plen; ++i)
+   {
+      for (m = k = 0; k < plen; ++k)                 /* delete character i */
+         if (k != i) del[m++] = word[k];
+      h = hash_word(del, m);
+      for (k = 0; k < n && hashes[k] != h; ++k);
+      if (k == n) hashes[n++] = h;
+      if (maxdist < 2) continue;
+      for (j = i+1; j < plen; ++j)
+      {
+         for (m = k = 0; k < plen; ++k)              /* delete characters i and j */
+            if (k != i && k != j) del[m++] = word[k];
+         h = hash_word(del, m);
+         for (k = 0; k < n && hashes[k] != h; ++k);
+         if (k == n) hashes[n++] = h;
+      }
+   }
+   return(n);
+}
+
+/* qsort comparison: order (hash, word) pairs by hash, then word */
+int compare_sym_pairs(const void *a, const void *b)
+{
+   const struct sym_pair *pa = (const struct sym_pair *)a;
+   const struct sym_pair *pb = (const struct sym_pair *)b;
+
+   if (pa->hash != pb->hash) return( (pa->hash < pb->hash) ? -1 : 1 );
+   if (pa->ref != pb->ref) return( (pa->ref < pb->ref) ? -1 : 1 );
+   return(0);
+}
+
+DWORD WINAPI sym_build_thread(LPVOID param)
+{
+   struct sym_build *sb = (struct sym_build *)param;
+   DWORD hashes[SYM_MAX_DELETES];
+   unsigned char *lbptr;
+   struct sym_pair *pair;
+   DWORD i, n, d, g, first, end;
+
+   switch (sb->phase)
+   {
+      case 1:                   /* 1. MAKE PAIRS, AND COUNT THEM BY GROUP */
+           for (i = 0; i < sb->nrefs; ++i)
+           {
+              lbptr = sym_word(sb->dic, sb->refs[i]);
+              n = sym_deletes(lbptr + 1, *lbptr, SYM_MAX_DIST, hashes);
+              for (d = 0; d < n; ++d)
+              {
+                 pair = &sb->pairs[sb->npairs++];
+                 pair->hash = hashes[d];
+                 pair->ref = sb->refs[i];
+                 ++sb->count[pair->hash >> (32 - SYM_DIR_BITS)];
+              }
+           }
+           break;
+      case 2:                   /* 2. COPY THEM INTO all[], GROUPED */
+           for (i = 0; i < sb->npairs; ++i)
+              sb->all[ sb->count[sb->pairs[i].hash >> (32 - SYM_DIR_BITS)]++ ] = sb->pairs[i];
+           break;
+      case 3:                   /* 3. SORT EACH GROUP, AND COUNT ITS DIFFERENT HASHES */
+           for (g = sb->firstgroup; g < sb->endgroup; ++g)
+           {
+              first = sb->groupstart[g];
+              end = sb->groupstart[g+1];
+              qsort(sb->all + first, end - first, sizeof(struct sym_pair), compare_sym_pairs);
+              for (n = 0, i = first; i < end; ++i)
+                 if (i == first || sb->all[i].hash != sb->all[i-1].hash) ++n;
+              sb->groupkeys[g] = n;
+           }
+           break;
+   }
+   return(0);
+}
+
+/* Run phase of the build on nthreads threads, and wait for them all to finish */
+void run_sym_build(struct sym_build *sb, DWORD nthreads, int phase)
+{
+   HANDLE threads[SYM_MAX_THREADS];
+   DWORD t, nstarted;
+
+   for (t = 0; t < nthreads; ++t) sb[t].phase = phase;
+   for (t = 1, nstarted = 0; t < nthreads; ++t)   /* this thread does the first share */
+   {
+      threads[nstarted] = CreateThread(NULL, 0, sym_build_thread, &sb[t], 0, NULL);
+      if (threads[nstarted] == NULL) sym_build_thread(&sb[t]);  /* couldn't start thread. Do it here. */
+      else ++nstarted;
+   }
+   sym_build_thread(&sb[0]);
+   if (nstarted > 0) WaitForMultipleObjects(nstarted, threads, TRUE, INFINITE);
+   for (t = 0; t < nstarted; ++t) CloseHandle(threads[t]);
+}
+
+/* Build the suggestion index of a dictionary. Returns the .sym file image
+   (length in *len), or NULL on memory allocation failure. */
+DWORD *build_sym_index(struct edx_dictionary *dic, DWORD *len)
+{
+   struct sym_build sb[SYM_MAX_THREADS];
+   struct sym_header *sym;
+   struct sym_key *keys;
+   SYSTEM_INFO si;
+   unsigned char *lbptr;
+   DWORD *refs = NULL;
+   DWORD *groupstart = NULL;
+   DWORD *groupkeys = NULL;
+   DWORD *image = NULL;
+   DWORD *dir, *postings;
+   struct sym_pair *all = NULL;
+   DWORD nmain, ncommon, nrefs, nthreads, npairs, nkeys, share, t, g, i, k, next;
+   BOOL ok = FALSE;
+
+   memset(sb, 0, sizeof(sb));
+
+   /* Every word of the main lexical database and the common word list */
+   nmain = count_words(dic->diclexdba, dic->diclexdba + dic->dichead->lexlen);
+   ncommon = count_words(dic->cmnwdsptr, dic->cmnwdsptr + dic->dichead->cwdlen);
+   nrefs = nmain + ncommon;
+   refs = new DWORD[nrefs + 1];
+   if (refs == NULL) return(NULL);
+   for (i = 0, lbptr = dic->diclexdba; i < nmain; ++i, lbptr += *lbptr + 1)
+      refs[i] = (DWORD)(lbptr - dic->diclexdba);
+   for (lbptr = dic->cmnwdsptr; i < nrefs; ++i, lbptr += *lbptr + 1)
+      refs[i] = (DWORD)(lbptr - dic->cmnwdsptr) | SYM_COMMON;
+
+   /* One thread per processor, each with a share of the words */
+   GetSystemInfo(&si);
+   nthreads = si.dwNumberOfProcessors;
+   if (nthreads > SYM_MAX_THREADS) nthreads = SYM_MAX_THREADS;
+   if (nthreads > nrefs / 1000 + 1) nthreads = nrefs / 1000 + 1;
+   if (nthreads < 1) nthreads = 1;
+   dic->symthreads = nthreads;
+   share = (nrefs + nthreads - 1) / nthreads;
+   for (t = 0; t < nthreads; ++t)
+   {
+      sb[t].dic = dic;
+      sb[t].refs = refs + t * share;
+      sb[t].nrefs = (t * share >= nrefs) ? 0 : ((nrefs - t * share < share) ? nrefs - t * share : share);
+      sb[t].pairs = new struct sym_pair[sb[t].nrefs * SYM_MAX_DELETES + 1];
+      sb[t].count = new DWORD[SYM_DIR_SIZE];
+      if (sb[t].pairs == NULL || sb[t].count == NULL) goto cleanup;
+      memset(sb[t].count, 0, SYM_DIR_SIZE * sizeof(DWORD));
+   }
+
+   /* 1. Make the pairs */
+   run_sym_build(sb, nthreads, 1);
+
+   /* Where each group, and each thread's share of each group, goes in all[] */
+   groupstart = new DWORD[SYM_DIR_SIZE + 1];
+   groupkeys = new DWORD[SYM_DIR_SIZE];
+   if (groupstart == NULL || groupkeys == NULL) goto cleanup;
+   for (g = 0, npairs = 0; g < SYM_DIR_SIZE; ++g)
+   {
+      groupstart[g] = npairs;
+      for (t = 0; t < nthreads; ++t)
+      {
+         k = sb[t].count[g];
+         sb[t].count[g] = npairs;
+         npairs += k;
+      }
+   }
+   groupstart[SYM_DIR_SIZE] = npairs;
+   all = new struct sym_pair[npairs + 1];
+   if (all == NULL) goto cleanup;
+
+   /* 2. Group them */
+   for (t = 0; t < nthreads; ++t) sb[t].all = all;
+   run_sym_build(sb, nthreads, 2);
+   for (t = 0; t < nthreads; ++t)
+   {
+      delete[] sb[t].pairs; sb[t].pairs = NULL;
+      delete[] sb[t].count; sb[t].count = NULL;
+   }
+
+   /* 3. Sort each group. Each thread gets about the same number of pairs. */
+   for (t = 0, g = 0; t < nthreads; ++t)
+   {
+      sb[t].groupstart = groupstart;
+      sb[t].groupkeys = groupkeys;
+      sb[t].firstgroup = g;
+      next = (t == nthreads - 1) ? npairs : (DWORD)(((unsigned __int64)npairs * (t + 1)) / nthreads);
+      while (g < SYM_DIR_SIZE && groupstart[g] < next) ++g;
+      if (t == nthreads - 1) g = SYM_DIR_SIZE;
+      sb[t].endgroup = g;
+   }
+   run_sym_build(sb, nthreads, 3);
+
+   /* 4. Write out the index */
+   for (g = 0, nkeys = 0; g < SYM_DIR_SIZE; ++g) nkeys += groupkeys[g];
+   *len = sizeof(struct sym_header)
+        + (SYM_DIR_SIZE + 1) * sizeof(DWORD)
+        + (nkeys + 1) * sizeof(struct sym_key)
+        + npairs * sizeof(DWORD);
+   image = new DWORD[*len / sizeof(DWORD)];
+   if (image == NULL) goto cleanup;
+   sym = (struct sym_header *)image;
+   memset(sym, 0, sizeof(struct sym_header));
+   memcpy(sym->id, "EDXsym1", 8);
+   sym->dicsum = dic_checksum(dic);
+   sym->maxdist = SYM_MAX_DIST;
+   sym->prefixlen = SYM_PREFIX_LEN;
+   sym->nkeys = nkeys;
+   sym->npostings = npairs;
+   sym->dirofst = sizeof(struct sym_header);
+   sym->keyofst = sym->dirofst + (SYM_DIR_SIZE + 1) * sizeof(DWORD);
+   sym->postofst = sym->keyofst + (nkeys + 1) * sizeof(struct sym_key);
+   sym->filelen = *len;
+   dir = (DWORD *)((unsigned char *)sym + sym->dirofst);
+   keys = (struct sym_key *)((unsigned char *)sym + sym->keyofst);
+   postings = (DWORD *)((unsigned char *)sym + sym->postofst);
+   for (g = 0, k = 0; g < SYM_DIR_SIZE; ++g)
+   {
+      dir[g] = k;
+      for (i = groupstart[g]; i < groupstart[g+1]; ++i)
+      {
+         if (i == groupstart[g] || all[i].hash != all[i-1].hash)
+         {
+            keys[k].hash = all[i].hash;
+            keys[k].first = i;
+            ++k;
+         }
+         postings[i] = all[i].ref;
+      }
+   }
+   dir[SYM_DIR_SIZE] = k;
+   keys[k].hash = 0;
+   keys[k].first = npairs;
+   ok = TRUE;
+
+cleanup:
+   for (t = 0; t < nthreads; ++t)
+   {
+      if (sb[t].pairs) { delete[] sb[t].pairs; }
+      if (sb[t].count) { delete[] sb[t].count; }
+   }
+   if (refs)       { delete[] refs; }
+   if (groupstart) { delete[] groupstart; }
+   if (groupkeys)  { delete[] groupkeys; }
+   if (all)        { delete[] all; }
+   if (!ok && image) { delete[] image; image = NULL; }
+   return(image);
+}
+
+/* Point the dictionary at the suggestion index in image[0..len) if it's a
+   good index of this dictionary. Returns FALSE if it isn't. */
+BOOL use_sym_index(struct edx_dictionary *dic, unsigned char *image, DWORD len)
+{
+   struct sym_header *sym = (struct sym_header *)image;
+
+   if (   len < sizeof(struct sym_header)
+       || memcmp(sym->id, "EDXsym1", 8) != 0
+       || sym->dicsum != dic_checksum(dic)
+       || sym->maxdist != SYM_MAX_DIST
+       || sym->prefixlen != SYM_PREFIX_LEN
+       || sym->filelen != len
+       || sym->dirofst + (SYM_DIR_SIZE + 1) * sizeof(DWORD) > len
+       || sym->keyofst + ((unsigned __int64)sym->nkeys + 1) * sizeof(struct sym_key) > len
+       || sym->postofst + (unsigned __int64)sym->npostings * sizeof(DWORD) > len )
+     return(FALSE);
+   dic->symdir = (DWORD *)(image + sym->dirofst);
+   dic->symkeys = (struct sym_key *)(image + sym->keyofst);
+   dic->sympost = (DWORD *)(image + sym->postofst);
+   if (   dic->symdir[SYM_DIR_SIZE] != sym->nkeys
+       || dic->symkeys[sym->nkeys].first != sym->npostings )
+     return(FALSE);
+   dic->sym = sym;
+   return(TRUE);
+}
+
+/* Load the suggestion index of dictionary Dic_File_Name, building and
+   saving it first if need be. Not having one isn't an error, so this
+   doesn't fail. It just leaves dic->sym NULL. */
+void load_sym_index(struct edx_dictionary *dic, char *Dic_File_Name)
+{
+   load_index_file(dic, &dic->symfile, Dic_File_Name, ".sym", build_sym_index, use_sym_index);
+}
+
+/*--------------------------------------------------------------------------
+    .SUBTITLE WORD GRAPH
+
+ Functional Description:
+    A word graph (DAWG) of the main lexical database and the common words,
+    for spell guessing without looking up guesses which can't be words.
+    Each node is a string some word starts with, and has an edge for each
+    character that can come next. Nodes with the same words after them
+    (e.g. the ends of "walking" and "talking") are merged into one, which
+    makes the graph several times smaller than a tree of the words.
+
+    spell_gusrev ... spell_guscon make every guess and look it up.
+    dwg_guess_list makes the same guesses by walking the graph instead, so
+    a guess is only made if it's a word. Once no word starts with the first
+    few characters of the misspelled word, no guess changing a character
+    after those can be a word, and all of them are skipped.
+
+    The graph is saved next to the dictionary as EDX.dwg (see INDEX FILES).
+
+ .dwg file layout:
+    struct dwg_header
+    DWORD node[nnodes+1]          node[n] >> 2 = first edge of node n, its
+                                  edges are up to node[n+1] >> 2. Low
+                                  bits DWG_WORD and DWG_COMMON if a word
+                                  (a common word) ends at node n.
+                                  Node 0 is the empty string.
+    DWORD edge[nedges]            node the edge goes to << 8 | character.
+                                  A node's edges are in character order.
+
+ Outline (build_dwg_index):
+    1.  All of the words are put in a tree, one node per character.
+    2.  The nodes are merged, from the last made (which have no children)
+        back to node 0. A node is merged with one already kept if they end
+        words the same way and have the same edges to the same nodes.
+    3.  The nodes kept are numbered in breadth first order and written out.
+---------------------------------------------------------------------------*/
+struct dwg_header {
+   unsigned char id[8];              /* "EDXdwg1" */
+   DWORD dicsum;                     /* dic_checksum() of the dictionary the graph was built from */
+   DWORD nwords;                     /* words in the graph */
+   DWORD treenodes;                  /* nodes before merging */
+   DWORD nnodes;                     /* nodes */
+   DWORD nedges;                     /* edges */
+   DWORD nodeofst;                   /* offset of node[] */
+   DWORD edgeofst;                   /* offset of edge[] */
+   DWORD filelen;                    /* length of the whole .dwg file */
+};
+
+/* One node of the tree build_dwg_index makes */
+struct dwg_build_node {
+   DWORD child;                      /* first child (DWG_NONE if none). Children are in character order */
+   DWORD sibling;                    /* next child of the same parent */
+   DWORD keep;                       /* node it's merged with (itself if kept) */
+   DWORD num;                        /* its number in the .dwg file (DWG_NONE until numbered) */
+   unsigned char c;                  /* character of the edge to it from its parent */
+   unsigned char flags;              /* DWG_WORD, DWG_COMMON */
+};
+
+/* Put word,wdlen in the tree of nnodes nodes (room for it is there). Returns the new number of nodes. */
+DWORD dwg_tree_add(struct dwg_build_node *tree, DWORD nnodes, unsigned char *word, DWORD wdlen, unsigned char flags)
+{
+   DWORD n, k, prev, i;
+
+   for (n = 0, i = 0; i < wdlen; ++i)
+   {
+      for (prev = DWG_NONE, k = tree[n].child; k != DWG_NONE && tree[k].c < word[i]; prev = k, k = tree[k].sibling);
+      if (k == DWG_NONE || tree[k].c != word[i])
+      {
+         tree[nnodes].child = DWG_NONE;
+         tree[nnodes].sibling = k;
+         tree[nnodes].c = word[i];
+         tree[nnodes].flags = 0;
+         if (prev == DWG_NONE) tree[n].child = nnodes;
+         else tree[prev].sibling = nnodes;
+         k = nnodes++;
+      }
+      n = k;
+   }
+   tree[n].flags |= flags;
+   return(nnodes);
+}
+
+/* Hash of what makes node k the same as another: its flags, and its edges */
+DWORD dwg_node_hash(struct dwg_build_node *tree, DWORD k)
+{
+   DWORD h = tree[k].flags;
+   DWORD ch;
+
+   for (ch = tree[k].child; ch != DWG_NONE; ch = tree[ch].sibling)
+      h = (h * 31 + tree[ch].c) * 31 + tree[ch].keep;
+   return(bloom_mix(h));
+}
+
+/* Can nodes a and b be merged? (Their children have been merged already.) */
+BOOL dwg_same_node(struct dwg_build_node *tree, DWORD a, DWORD b)
+{
+   if (tree[a].flags != tree[b].flags) return(FALSE);
+   for (a = tree[a].child, b = tree[b].child; a != DWG_NONE && b != DWG_NONE; a = tree[a].sibling, b = tree[b].sibling)
+      if (tree[a].c != tree[b].c || tree[a].keep != tree[b].keep) return(FALSE);
+   return(a == b);             /* both out of children */
+}
+
+/* Build the word graph of dictionary dic. Returns the .dwg file image
+   (len bytes), or NULL if there isn't memory for it. */
+DWORD *build_dwg_index(struct edx_dictionary *dic, DWORD *len)
+{
+   struct dwg_build_node *tree = NULL;
+   DWORD *table = NULL;           /* hash table of nodes kept (node + 1, 0 = empty) */
+   DWORD *queue = NULL;           /* nodes kept, in breadth first order */
+   DWORD *image = NULL;
+   struct dwg_header *dwg;
+   DWORD *node, *edge;
+   unsigned char *lbptr, *end;
+   DWORD maxnodes, nnodes, ntable, nkept, nedges, nwords, k, h, ch, e, q;
+
+   /* 1. Put the words in a tree. A node for each character is plenty. */
+   maxnodes = dic->dichead->lexlen + dic->dichead->cwdlen + 1;
+   tree = new struct dwg_build_node[maxnodes];
+   if (tree == NULL) goto cleanup;
+   tree[0].child = tree[0].sibling = DWG_NONE;
+   tree[0].c = tree[0].flags = 0;
+   nnodes = 1;
+   nwords = 0;
+   for ( lbptr = dic->diclexdba, end = lbptr + dic->dichead->lexlen;
+         lbptr < end && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+         lbptr += *lbptr + 1, ++nwords )
+      nnodes = dwg_tree_add(tree, nnodes, lbptr + 1, *lbptr, DWG_WORD);
+   for ( lbptr = dic->cmnwdsptr, end = lbptr + dic->dichead->cwdlen;
+         lbptr < end && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+         lbptr += *lbptr + 1, ++nwords )
+      nnodes = dwg_tree_add(tree, nnodes, lbptr + 1, *lbptr, DWG_WORD | DWG_COMMON);
+
+   /* 2. Merge nodes. Children are always made after their parents, so
+         going backwards every node's children are done before it is. */
+   for (ntable = 64; ntable < 2 * nnodes; ntable <<= 1);   /* keep hash table under half full */
+   table = new DWORD[ntable];
+   if (table == NULL) goto cleanup;
+   memset(table, 0, ntable * sizeof(DWORD));
+   for (k = nnodes; k-- > 0; )
+   {
+      tree[k].keep = k;
+      tree[k].num = DWG_NONE;
+      for (h = dwg_node_hash(tree, k) & (ntable - 1); table[h] != 0; h = (h + 1) & (ntable - 1))
+         if (dwg_same_node(tree, table[h] - 1, k)) { tree[k].keep = table[h] - 1; break; }
+      if (table[h] == 0) table[h] = k + 1;
+   }
+
+   /* 3. Number the nodes kept, breadth first from node 0 */
+   queue = new DWORD[nnodes];
+   if (queue == NULL) goto cleanup;
+   queue[0] = 0;
+   tree[0].num = 0;
+   for (q = 0, nkept = 1, nedges = 0; q < nkept; ++q)
+   {
+      for (ch = tree[queue[q]].child; ch != DWG_NONE; ch = tree[ch].sibling, ++nedges)
+      {
+         k = tree[ch].keep;
+         if (tree[k].num == DWG_NONE) { tree[k].num = nkept; queue[nkept++] = k; }
+      }
+   }
+   if (nkept > DWG_MAX_NODES) goto cleanup;
+
+   *len = sizeof(struct dwg_header) + (nkept + 1 + nedges) * sizeof(DWORD);
+   image = new DWORD[*len / sizeof(DWORD)];
+   if (image == NULL) goto cleanup;
+   dwg = (struct dwg_header *)image;
+   memset(dwg, 0, sizeof(struct dwg_header));
+   memcpy(dwg->id, "EDXdwg1", 8);
+   dwg->dicsum = dic_checksum(dic);
+   dwg->nwords = nwords;
+   dwg->treenodes = nnodes;
+   dwg->nnodes = nkept;
+   dwg->nedges = nedges;
+   dwg->nodeofst = sizeof(struct dwg_header);
+   dwg->edgeofst = dwg->nodeofst + (nkept + 1) * sizeof(DWORD);
+   dwg->filelen = *len;
+   node = (DWORD *)((unsigned char *)dwg + dwg->nodeofst);
+   edge = (DWORD *)((unsigned char *)dwg + dwg->edgeofst);
+   for (q = 0, e = 0; q < nkept; ++q)
+   {
+      node[q] = (e << 2) | tree[queue[q]].flags;
+      for (ch = tree[queue[q]].child; ch != DWG_NONE; ch = tree[ch].sibling)
+         edge[e++] = (tree[tree[ch].keep].num << 8) | tree[ch].c;
+   }
+   node[nkept] = e << 2;
+
+cleanup:
+   if (tree)  { delete[] tree; }
+   if (table) { delete[] table; }
+   if (queue) { delete[] queue; }
+   return(image);
+}
+
+/* Point the dictionary at the word graph in image[0..len) if it's a good
+   word graph of this dictionary. Returns FALSE if it isn't. */
+BOOL use_dwg_index(struct edx_dictionary *dic, unsigned char *image, DWORD len)
+{
+   struct dwg_header *dwg = (struct dwg_header *)image;
+   DWORD *node, *edge;
+   DWORD n;
+
+   if (   len < sizeof(struct dwg_header)
+       || memcmp(dwg->id, "EDXdwg1", 8) != 0
+       || dwg->dicsum != dic_checksum(dic)
+       || dwg->filelen != len
+       || dwg->nnodes == 0 || dwg->nnodes > DWG_MAX_NODES
+       || dwg->nodeofst + ((unsigned __int64)dwg->nnodes + 1) * sizeof(DWORD) > len
+       || dwg->edgeofst + (unsigned __int64)dwg->nedges * sizeof(DWORD) > len )
+     return(FALSE);
+   node = (DWORD *)(image + dwg->nodeofst);
+   edge = (DWORD *)(image + dwg->edgeofst);
+   /* Check every node's edges are in the file and go to nodes in the graph, so walking it can't go wrong */
+   for (n = 0; n < dwg->nnodes; ++n)
+     if ((node[n] >> 2) > (node[n+1] >> 2)) return(FALSE);
+   if ((node[dwg->nnodes] >> 2) != dwg->nedges) return(FALSE);
+   for (n = 0; n < dwg->nedges; ++n)
+     if ((edge[n] >> 8) >= dwg->nnodes) return(FALSE);
+   dic->dwgnode = node;
+   dic->dwgedge = edge;
+   dic->dwg = dwg;
+   return(TRUE);
+}
+
+/* Load the word graph of dictionary Dic_File_Name, building and saving it
+   first if need be. Not having one isn't an error, so this doesn't fail.
+   It just leaves dic->dwg NULL. */
+void load_dwg_index(struct edx_dictionary *dic, char *Dic_File_Name)
+{
+   load_index_file(dic, &dic->dwgfile, Dic_File_Name, ".dwg", build_dwg_index, use_dwg_index);
+}
+
+/*--------------------------------------------------------------------------
+    .SUBTITLE VERSION 6 DICTIONARIES
+
+ Functional Description:
+    A version 4 or 5 dictionary is a packed header of 32 bit offsets
+    followed by the guide words, main lexical database and common words,
+    and everything else (hash index, Bloom filter, suggestion index, word
+    graph) is built or read from another file each time it's loaded.
+    A version 6 dictionary starts with a header and a table of sections,
+    with 64 bit offsets and lengths, and each section starts on a page
+    boundary (so the dictionary pages of the main lexical database don't
+    straddle memory pages, and the Bloom filter blocks are on cache lines).
+    Besides the guide words (DIC6_INDEX), main lexical database (DIC6_LEX)
+    and common words (DIC6_COMMON) it can hold the indexes load_main_dic
+    would otherwise build: the hash index (DIC6_HASH), Bloom filter
+    (DIC6_BLOOM), suggestion index (DIC6_SYM) and word graph (DIC6_DWG).
+    These are used where they are in the mapped file, so loading one
+    reads nothing but the header, and only the pages of them a lookup
+    touches are ever read in. An index is only used if its option is set
+    (EDX_OPT_HASH_INDEX etc.), at the size it was saved with.
+
+    Every section has a checksum (hash_word of its bytes), and so has the
+    header. load_main_dic checks the header's; checking the sections would
+    read the whole file, which is what version 6 is for not doing, so
+    edx$dic_verify does that when asked.
+
+    edx$dic_save writes an open dictionary (of any version) as a version 6
+    dictionary, with whichever of the indexes it has loaded. A suggestion
+    index or word graph saved in the dictionary holds the dictionary's
+    dic_checksum like one saved next to it, but with the checksum of the
+    main lexical database in place of the file size, as the file size
+    depends on the sections saved in it.
+---------------------------------------------------------------------------*/
+/* Section 'type' of a version 6 dictionary (NULL if it hasn't got one) */
+struct dic_section *dic6_section(struct dichead6_layout *dichead6, DWORD type)
+{
+   DWORD i;
+   for (i = 0; i < dichead6->nsections; ++i)
+      if (dichead6->sect[i].type == type) return(&dichead6->sect[i]);
+   return(NULL);
+}
+
+/* Checksum of a version 6 header (with headsum 0) */
+DWORD dic6_headsum(struct dichead6_layout *dichead6)
+{
+   struct dichead6_layout head;
+   memcpy(&head, dichead6, sizeof(struct dichead6_layout));
+   head.headsum = 0;
+   return( hash_word((unsigned char *)&head, sizeof(struct dichead6_layout)) );
+}
+
+/* Version 5 header fields of a (checked) version 6 header, so the rest of
+   edxspell.cpp (and dic_checksum) needn't care which version it is. */
+void dic6_head(struct dichead6_layout *dichead6, struct dichead_layout *dichead)
+{
+   struct dic_section *index = dic6_section(dichead6, DIC6_INDEX);
+   struct dic_section *lex = dic6_section(dichead6, DIC6_LEX);
+   struct dic_section *cmn = dic6_section(dichead6, DIC6_COMMON);
+
+   memset(dichead, 0, sizeof(struct dichead_layout));
+   memcpy(dichead->id, dichead6->id, sizeof(dichead->id));
+   dichead->lexofst = (DWORD)lex->ofst;
+   dichead->lexlen  = (DWORD)lex->len;
+   dichead->indofst = (DWORD)index->ofst;
+   dichead->nidxwds = dichead6->nidxwds;
+   dichead->indswd  = dichead6->indswd;
+   dichead->dicpln  = dichead6->dicpln;
+   dichead->cwdofst = (DWORD)cmn->ofst;
+   dichead->cwdlen  = (DWORD)cmn->len;
+   dichead->cwdmln  = dichead6->cwdmln;
+   dichead->flags   = dichead6->flags;
+}
+
+/* Check the header and section table of version 6 dictionary (mapped at
+   dic->lpDicMapBase) and point the dictionary at its sections. */
+BOOL load_dic6(struct edx_dictionary *dic, char *Dic_File_Name, char *errbuf, int errbuflen)
+{
+   struct dichead6_layout *dichead6 = (struct dichead6_layout *)dic->lpDicMapBase;
+   struct dic_section *s;
+   DWORD i;
+
+   if (   dic->dwDicFileSize < sizeof(struct dichead6_layout)
+       || dichead6->headsum != dic6_headsum(dichead6) )
+   {
+     _snprintf(errbuf, errbuflen, "EDX dictionary file %s is corrupt. Its header fails its checksum.", Dic_File_Name );
+     errbuf[errbuflen-1] = '\0';
+     return(FALSE);
+   }
+   if (dichead6->filelen != dic->dwDicFileSize)
+   {
+     _snprintf(errbuf, errbuflen, "EDX dictionary file %s is %lu bytes long. Its header says %.0f.",
+               Dic_File_Name, dic->dwDicFileSize, (double)dichead6->filelen );
+     errbuf[errbuflen-1] = '\0';
+     return(FALSE);
+   }
+   for (i = 0; i < dichead6->nsections && i < DIC6_MAX_SECTIONS; ++i)
+   {
+     s = &dichead6->sect[i];
+     if (   s->ofst % DIC6_MIN_ALIGN != 0
+         || s->ofst < sizeof(struct dichead6_layout)
+         || s->len > dichead6->filelen
+         || s->ofst > dichead6->filelen - s->len )
+       break;
+   }
+   if (   i < dichead6->nsections
+       || dic6_section(dichead6, DIC6_INDEX) == NULL
+       || dic6_section(dichead6, DIC6_LEX) == NULL
+       || dic6_section(dichead6, DIC6_COMMON) == NULL
+       || dic6_section(dichead6, DIC6_INDEX)->len < (unsigned __int64)dichead6->nidxwds * dichead6->indswd
+       || (   (dichead6->flags & DIC_FRONT_CODED)
+           && (   dichead6->dicpln < MAXWORDLEN + 2
+               || dic6_section(dichead6, DIC6_LEX)->len % dichead6->dicpln != 0 ) ) )
+   {
+     _snprintf(errbuf, errbuflen, "EDX dictionary file %s is corrupt. Its section table is wrong.", Dic_File_Name );
+     errbuf[errbuflen-1] = '\0';
+     return(FALSE);
+   }
+   dic->dichead6 = dichead6;
+   dic6_head(dichead6, &dic->v6head);
+   dic->dichead = &dic->v6head;
+   dic->Extended_ANSI_Guessing = (dichead6->flags & 0x00000001);
+   dic->frontcoded = ((dichead6->flags & DIC_FRONT_CODED) != 0);
+   dic->dicstamp = dic6_section(dichead6, DIC6_LEX)->sum;
+   return(TRUE);
+}
+
+/* Use the hash index saved in a version 6 dictionary, if it has one */
+BOOL map_dic6_hash(struct edx_dictionary *dic)
+{
+   struct dic_section *s;
+   DWORD nslots;
+
+   if (dic->dichead6 == NULL || (s = dic6_section(dic->dichead6, DIC6_HASH)) == NULL) {return(FALSE);}
+   nslots = (DWORD)(s->len / sizeof(struct hash_slot));
+   if (   s->len % sizeof(struct hash_slot) != 0
+       || nslots < 16 || (nslots & (nslots - 1)) != 0
+       || s->param[0] > nslots / 2 )
+     return(FALSE);
+   dic->mainhash.base = dic->diclexdba;
+   dic->mainhash.tab = (struct hash_slot *)((unsigned char *)dic->lpDicMapBase + s->ofst);
+   dic->mainhash.mask = nslots - 1;
+   dic->mainhash.words = s->param[0];
+   dic->mainhash.bytes = (DWORD)s->len;
+   dic->mainhash.mapped = TRUE;
+   return(TRUE);
+}
+
+/* Use the Bloom filter saved in a version 6 dictionary, if it has one */
+BOOL map_dic6_bloom(struct edx_dictionary *dic)
+{
+   struct dic_section *s;
+
+   if (dic->dichead6 == NULL || (s = dic6_section(dic->dichead6, DIC6_BLOOM)) == NULL) {return(FALSE);}
+   if (   s->len == 0 || s->len % (BLOOM_BLOCK_DWORDS * sizeof(DWORD)) != 0
+       || s->param[0] < 1 || s->param[0] > BLOOM_MAX_BITS )
+     return(FALSE);
+   dic->bloombase = NULL;
+   dic->bloom = (DWORD *)((unsigned char *)dic->lpDicMapBase + s->ofst);
+   dic->bloomblocks = (DWORD)(s->len / (BLOOM_BLOCK_DWORDS * sizeof(DWORD)));
+   dic->bloomk = s->param[0];
+   dic->bloomwords = s->param[1];
+   return(TRUE);
+}
+
+/* Use the suggestion index or word graph (section 'type') saved in a
+   version 6 dictionary, if it has one and use() says it's good */
+BOOL map_dic6_index(struct edx_dictionary *dic, DWORD type, struct index_file *f, char *Dic_File_Name, index_user use)
+{
+   struct dic_section *s;
+
+   if (dic->dichead6 == NULL || (s = dic6_section(dic->dichead6, type)) == NULL) {return(FALSE);}
+   if (!use(dic, (unsigned char *)dic->lpDicMapBase + s->ofst, (DWORD)s->len)) {return(FALSE);}
+   strncpy(f->Name, Dic_File_Name, FNAMESIZE);
+   f->Name[FNAMESIZE-1] = '\0';
+   return(TRUE);
+}
+
+/* Check every section of a version 6 dictionary against its checksum.
+   (Versions 4 and 5 have no checksums, so there's nothing to check.) */
+int dic_verify(struct edx_dictionary *dic, char *errbuf, int errbuflen)
+{
+   struct dic_section *s;
+   DWORD i;
+
+   if (dic->dichead6 == NULL) {return(EDX__WORDFOUND);}
+   for (i = 0; i < dic->dichead6->nsections; ++i)
+   {
+     s = &dic->dichead6->sect[i];
+     if (hash_word((unsigned char *)dic->lpDicMapBase + s->ofst, (DWORD)s->len) != s->sum)
+     {
+       _snprintf(errbuf, errbuflen, "EDX dictionary file is corrupt. Section %lu (type %lu, %lu bytes at %lu) fails its checksum.",
+                 i, s->type, (DWORD)s->len, (DWORD)s->ofst );
+       errbuf[errbuflen-1] = '\0';
+       return(EDX__ERROR);
+     }
+   }
+   return(EDX__WORDFOUND);
+}
+
+/* Add a section of len bytes at p to a version 6 header being made */
+void dic6_add_section(struct dichead6_layout *dichead6, unsigned char **data, DWORD type,
+                      void *p, DWORD len, DWORD param0, DWORD param1)
+{
+   struct dic_section *s = &dichead6->sect[dichead6->nsections];
+
+   s->type = type;
+   s->len = len;
+   s->param[0] = param0;
+   s->param[1] = param1;
+   data[dichead6->nsections++] = (unsigned char *)p;
+}
+
+/* Write dictionary dic as version 6 dictionary File_Name */
+int dic_save(struct edx_dictionary *dic, char *File_Name, char *errbuf, int errbuflen)
+{
+   static unsigned char zeros[DIC6_ALIGN];
+   struct dichead6_layout dichead6;
+   struct dichead_layout dichead;
+   unsigned char *data[DIC6_MAX_SECTIONS];   /* bytes of each section */
+   unsigned char *copy[DIC6_MAX_SECTIONS];   /* the indexes, with their dic_checksum changed */
+   unsigned __int64 ofst, at;
+   struct dic_section *s;
+   unsigned char *lex, *index, *words, *end;
+   HANDLE hFile;
+   DWORD i, len, written, dicsum, lexlen, nidxwds;
+   BOOL ok, frontcode;
+
+   /* Front coded pages (EDX_OPT_FRONT_CODE) or whole words. Lay the pages out again if need be. */
+   frontcode = (dic->options[EDX_OPT_FRONT_CODE] != 0);
+   lex = dic->diclexdba;
+   lexlen = dic->dichead->lexlen;
+   index = dic->dicindptr;
+   nidxwds = dic->dichead->nidxwds;
+   if (frontcode != dic->frontcoded)
+   {
+     words = main_words(dic, &end);
+     ok = (words != NULL) && pack_pages(words, (DWORD)(end - words), frontcode, dic->dichead->dicpln,
+                                        dic->dichead->indswd, &lex, &lexlen, &index, &nidxwds);
+     free_main_words(dic, words);
+     if (!ok)
+     {
+       _snprintf(errbuf, errbuflen, "Can't lay out the dictionary's pages: out of memory, or (front coded) a page is too short or the words are out of order.");
+       errbuf[errbuflen-1] = '\0';
+       return(EDX__ERROR);
+     }
+   }
+
+   memset(&dichead6, 0, sizeof(struct dichead6_layout));
+   memset(copy, 0, sizeof(copy));
+   dichead6.id[0] = 6;
+   memcpy(dichead6.id + 1, "EDXdict", 7);
+   dichead6.flags = (dic->Extended_ANSI_Guessing ? 0x00000001 : 0) | (frontcode ? DIC_FRONT_CODED : 0);
+   dichead6.nidxwds = nidxwds;
+   dichead6.indswd = dic->dichead->indswd;
+   dichead6.dicpln = dic->dichead->dicpln;
+   dichead6.cwdmln = dic->dichead->cwdmln;
+   dic6_add_section(&dichead6, data, DIC6_INDEX, index, nidxwds * dic->dichead->indswd, 0, 0);
+   dic6_add_section(&dichead6, data, DIC6_LEX, lex, lexlen, 0, 0);
+   dic6_add_section(&dichead6, data, DIC6_COMMON, dic->cmnwdsptr, dic->dichead->cwdlen, 0, 0);
+   if (dic->mainhash.tab != NULL && !frontcode)    /* (these point at words in whole word pages) */
+     dic6_add_section(&dichead6, data, DIC6_HASH, dic->mainhash.tab, dic->mainhash.bytes, dic->mainhash.words, 0);
+   if (dic->bloom != NULL)
+     dic6_add_section(&dichead6, data, DIC6_BLOOM, dic->bloom, dic->bloomblocks * BLOOM_BLOCK_DWORDS * sizeof(DWORD),
+                      dic->bloomk, dic->bloomwords);
+   if (dic->sym != NULL && !frontcode)
+     dic6_add_section(&dichead6, data, DIC6_SYM, dic->sym, dic->sym->filelen, 0, 0);
+   if (dic->dwg != NULL && !frontcode)
+     dic6_add_section(&dichead6, data, DIC6_DWG, dic->dwg, dic->dwg->filelen, 0, 0);
+
+   /* Each section on a page, with at least one NULL after it (the end of the words) */
+   ofst = (sizeof(struct dichead6_layout) + DIC6_ALIGN - 1) & ~(unsigned __int64)(DIC6_ALIGN - 1);
+   for (i = 0; i < dichead6.nsections; ++i)
+   {
+     s = &dichead6.sect[i];
+     s->ofst = ofst;
+     ofst = (ofst + s->len + 1 + DIC6_ALIGN - 1) & ~(unsigned __int64)(DIC6_ALIGN - 1);
+     if (s->type != DIC6_SYM && s->type != DIC6_DWG) s->sum = hash_word(data[i], (DWORD)s->len);
+   }
+   dichead6.filelen = ofst;
+
+   /* The indexes hold the new dictionary's dic_checksum */
+   dic6_head(&dichead6, &dichead);
+   dicsum = dic_checksum_of(&dichead, index, dic6_section(&dichead6, DIC6_LEX)->sum);
+   for (i = 0; i < dichead6.nsections; ++i)
+   {
+     s = &dichead6.sect[i];
+     if (s->type != DIC6_SYM && s->type != DIC6_DWG) continue;
+     copy[i] = new unsigned char[(DWORD)s->len];
+     if (copy[i] == NULL)
+     {
+       for (i = 0; i < dichead6.nsections; ++i) if (copy[i]) { delete[] copy[i]; }
+       if (lex != dic->diclexdba) { delete[] lex; delete[] index; }
+       _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+       errbuf[errbuflen-1] = '\0';
+       return(EDX__ERROR);
+     }
+     memcpy(copy[i], data[i], (DWORD)s->len);
+     if (s->type == DIC6_SYM) ((struct sym_header *)copy[i])->dicsum = dicsum;
+     else ((struct dwg_header *)copy[i])->dicsum = dicsum;
+     data[i] = copy[i];
+     s->sum = hash_word(data[i], (DWORD)s->len);
+   }
+   dichead6.headsum = dic6_headsum(&dichead6);
+
+   hFile = CreateFile(File_Name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+   ok = (hFile != INVALID_HANDLE_VALUE);
+   if (ok) ok = WriteFile(hFile, &dichead6, sizeof(struct dichead6_layout), &written, NULL) && written == sizeof(struct dichead6_layout);
+   at = sizeof(struct dichead6_layout);
+   for (i = 0; ok && i <= dichead6.nsections; ++i)
+   {
+     ofst = (i < dichead6.nsections) ? dichead6.sect[i].ofst : dichead6.filelen;
+     for ( ; ok && at < ofst; at += len)           /* NULLs up to the section */
+     {
+       len = (ofst - at < DIC6_ALIGN) ? (DWORD)(ofst - at) : DIC6_ALIGN;
+       ok = WriteFile(hFile, zeros, len, &written, NULL) && written == len;
+     }
+     if (ok && i < dichead6.nsections)
+     {
+       len = (DWORD)dichead6.sect[i].len;
+       ok = WriteFile(hFile, data[i], len, &written, NULL) && written == len;
+       at += len;
+     }
+   }
+   for (i = 0; i < dichead6.nsections; ++i) if (copy[i]) { delete[] copy[i]; }
+   if (lex != dic->diclexdba) { delete[] lex; delete[] index; }
+   if (!ok)
+   {
+     DWORD dwErrCode = GetLastError();
+     char errmsg[ERRMSGLEN];
+     _snprintf(errmsg, ERRMSGLEN, "Error writing %s", File_Name );
+     errmsg[ERRMSGLEN-1] = '\0';
+     FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
+     if (hFile != INVALID_HANDLE_VALUE) { CloseHandle(hFile); DeleteFile(File_Name); }
+     return(EDX__ERROR);
+   }
+   CloseHandle(hFile);
+   return(EDX__WORDFOUND);
+}
+
+/*---------------------------------------------------------------------------
+    .SUBTITLE DICTIONARY RESIDENCY
+
+ Functional Description:
+    load_main_dic maps the dictionary file, and its pages are read in by
+    page faults the first time lookups touch them, so the first lookups
+    after it's opened can take milliseconds each. Option
+    EDX_OPT_RESIDENCY has them read in when it's opened instead, any of:
+
+       EDX_RES_RANDOM       open the file with FILE_FLAG_RANDOM_ACCESS,
+                            as lookups jump about it, so the system
+                            doesn't read ahead of them
+       EDX_RES_WILLNEED     read in the sections every lookup starts in,
+                            the guide words, common words and a version 6
+                            dictionary's hash index and Bloom filter: in
+                            the background with PrefetchVirtualMemory
+                            (Windows 8 and later), else by touching them
+       EDX_RES_PREFAULT     read the whole file in (PrefetchVirtualMemory
+                            if there is one) and touch every page, so no
+                            lookup waits for a page
+       EDX_RES_LARGE_PAGES  copy the guide words and a version 6
+                            dictionary's hash index and Bloom filter into
+                            large pages (2 MB), for fewer TLB misses.
+                            Needs the "Lock pages in memory" user right.
+       EDX_RES_LOCK         lock the whole file in memory with VirtualLock,
+                            the working set grown to hold it, so its pages
+                            aren't trimmed while the program's idle
+
+    Whatever can't be done is skipped, and the dictionary loads all the
+    same. dic->resident has the bits which took effect, which edx$dic_info
+    shows. edx$startup_benchmark times the first lookups with each.
+---------------------------------------------------------------------------*/
+//The PrefetchVirtualMemory arguments (WIN32_MEMORY_RANGE_ENTRY, which older SDKs don't have)
+struct prefetch_range {
+   void   *VirtualAddress;
+   size_t NumberOfBytes;
+};
+typedef BOOL (WINAPI *prefetch_fn)(HANDLE hProcess, DWORD_PTR NumberOfEntries, struct prefetch_range *VirtualAddresses, DWORD Flags);
+
+// Ask the system to read ranges[n] in, in the background. FALSE if it can't
+// (PrefetchVirtualMemory is Windows 8 and later, so it's looked up).
+BOOL prefetch_ranges(struct prefetch_range *ranges, DWORD n)
+{
+   static prefetch_fn fn = NULL;
+   static BOOL looked = FALSE;
+   HMODULE hKernel;
+
+   if (!looked)
+   {
+      hKernel = GetModuleHandle("kernel32.dll");
+      if (hKernel != NULL) fn = (prefetch_fn)GetProcAddress(hKernel, "PrefetchVirtualMemory");
+      looked = TRUE;
+   }
+   return(fn != NULL && n > 0 && fn(GetCurrentProcess(), n, ranges, 0));
+}
+
+// Read a byte of every page of p[len], so they're all in memory
+void touch_pages(unsigned char *p, size_t len)
+{
+   SYSTEM_INFO si;
+   volatile unsigned char sum = 0;
+   size_t i;
+
+   GetSystemInfo(&si);
+   for (i = 0; i < len; i += si.dwPageSize) sum ^= p[i];
+   if (len > 0) sum ^= p[len - 1];
+}
+
+// The sections every lookup starts in, those still in the mapped file, in r[4]
+DWORD hot_sections(struct edx_dictionary *dic, struct prefetch_range *r, BOOL common)
+{
+   unsigned char *base = (unsigned char *)dic->lpDicMapBase;
+   DWORD n = 0;
+
+#define HOT(p, len) if ((unsigned char *)(p) >= base && (unsigned char *)(p) < dic->maplimit && (len) > 0) \
+                      { r[n].VirtualAddress = (void *)(p); r[n].NumberOfBytes = (len); ++n; }
+   HOT(dic->dicindptr, dic->dichead->nidxwds * dic->dichead->indswd)
+   if (common) HOT(dic->cmnwdsptr, dic->dichead->cwdlen)
+   if (dic->mainhash.mapped) HOT(dic->mainhash.tab, dic->mainhash.bytes)
+   if (dic->bloom != NULL && dic->bloombase == NULL) HOT(dic->bloom, dic->bloomblocks * BLOOM_BLOCK_DWORDS * sizeof(DWORD))
+#undef HOT
+   return(n);
+}
+
+// Large pages need SeLockMemoryPrivilege enabled, and the user must have it
+BOOL enable_lock_memory_privilege(void)
+{
+   HANDLE hToken;
+   TOKEN_PRIVILEGES tp;
+   BOOL ok;
+
+   if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &hToken)) {return(FALSE);}
+   tp.PrivilegeCount = 1;
+   tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+   ok =    LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid)
+        && AdjustTokenPrivileges(hToken, FALSE, &tp, 0, NULL, NULL)
+        && GetLastError() == ERROR_SUCCESS;    /* (ERROR_NOT_ALL_ASSIGNED if the user hasn't the right) */
+   CloseHandle(hToken);
+   return(ok);
+}
+
+// Copy the hot sections (not the common words, which are scanned up to
+// maplimit) into large pages, and use the copies. FALSE if there are none.
+BOOL copy_hot_sections(struct edx_dictionary *dic)
+{
+   struct prefetch_range r[4];
+   size_t large = GetLargePageMinimum();
+   size_t total = 0;
+   unsigned char *p;
+   DWORD n, i;
+
+   n = hot_sections(dic, r, FALSE);
+   for (i = 0; i < n; ++i) total += (r[i].NumberOfBytes + 63) & ~(size_t)63;
+   if (large == 0 || total == 0 || !enable_lock_memory_privilege()) {return(FALSE);}
+   total = (total + large - 1) & ~(large - 1);
+   dic->hotbase = (unsigned char *)VirtualAlloc(NULL, total, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+   if (dic->hotbase == NULL) {return(FALSE);}
+   dic->hotlen = total;
+   for (i = 0, p = dic->hotbase; i < n; ++i)
+   {
+      memcpy(p, r[i].VirtualAddress, r[i].NumberOfBytes);
+      if (r[i].VirtualAddress == dic->dicindptr) dic->dicindptr = p;
+      else if (r[i].VirtualAddress == dic->mainhash.tab) dic->mainhash.tab = (struct hash_slot *)p;   /* (still mapped: not ours to free) */
+      else dic->bloom = (DWORD *)p;
+      p += (r[i].NumberOfBytes + 63) & ~(size_t)63;
+   }
+   return(TRUE);
+}
+
+// Lock the mapped file in memory, growing the working set to hold it
+BOOL lock_pages(struct edx_dictionary *dic)
+{
+   SIZE_T min, max;
+
+   if (   !GetProcessWorkingSetSize(GetCurrentProcess(), &min, &max)
+       || !SetProcessWorkingSetSize(GetCurrentProcess(), min + dic->dwDicFileSize, max + dic->dwDicFileSize) )
+     {return(FALSE);}
+   if (VirtualLock(dic->lpDicMapBase, dic->dwDicFileSize)) {return(TRUE);}
+   SetProcessWorkingSetSize(GetCurrentProcess(), min, max);
+   return(FALSE);
+}
+
+// The names of EDX_RES_... bits, "random access, prefault" ("none" if none)
+void residency_names(DWORD bits, char *buf, int buflen)
+{
+   static const char *name[5] = { "random access", "will need", "prefault", "large pages", "locked" };
+   int i, len;
+
+   if (buflen < 1) {return;}
+   _snprintf(buf, buflen, "none");
+   buf[buflen-1] = '\0';
+   for (i = 0, len = 0; i < 5; ++i)
+   {
+      if (!(bits & (1 << i))) continue;
+      _snprintf(buf + len, buflen - len, "%s%s", (len > 0) ? ", " : "", name[i]);
+      buf[buflen-1] = '\0';
+      len = strlen(buf);
+   }
+}
+
+// Read the dictionary in as option EDX_OPT_RESIDENCY says (see above)
+void make_resident(struct edx_dictionary *dic)
+{
+   struct prefetch_range r[4];
+   DWORD want = dic->options[EDX_OPT_RESIDENCY];
+   DWORD n, i;
+   LARGE_INTEGER start;
+
+   QueryPerformanceCounter(&start);
+   dic->resident = want & EDX_RES_RANDOM;       /* (done by load_main_dic's CreateFile) */
+   if ((want & EDX_RES_LARGE_PAGES) && copy_hot_sections(dic)) { dic->resident |= EDX_RES_LARGE_PAGES; }
+   if (want & EDX_RES_WILLNEED)
+   {
+      n = hot_sections(dic, r, TRUE);
+      if (!prefetch_ranges(r, n))
+        for (i = 0; i < n; ++i) touch_pages((unsigned char *)r[i].VirtualAddress, r[i].NumberOfBytes);
+      dic->resident |= EDX_RES_WILLNEED;
+   }
+   if (want & EDX_RES_PREFAULT)
+   {
+      r[0].VirtualAddress = dic->lpDicMapBase;   /* (one big read, not a page fault at a time) */
+      r[0].NumberOfBytes = dic->dwDicFileSize;
+      prefetch_ranges(r, 1);
+      touch_pages((unsigned char *)dic->lpDicMapBase, dic->dwDicFileSize);
+      dic->resident |= EDX_RES_PREFAULT;
+   }
+   if ((want & EDX_RES_LOCK) && lock_pages(dic)) { dic->resident |= EDX_RES_LOCK; }
+   dic->residentms = elapsed_ms(start);
+}
+
+/******************************************************************************/
+//SPELL_INIT           !Initialize spelling checker
+//LOAD_MAIN_DIC
+//LOAD_AUX1_DIC
+// Map an EDX dictionary file and check its header (load_main_dic, and the
+// layers of a dictionary stack which are EDX dictionaries)
+BOOL map_main_dic(struct edx_dictionary *dic, char *Dic_File_Name, char *errbuf, int errbuflen)
+{
+  // MAKE SURE WE WERE PASSED A Dic_File_Name.
+  if ( !strlen(Dic_File_Name) )
+  {
+    char errmsg[ERRMSGLEN];
+    _snprintf(errmsg, ERRMSGLEN, "Error opening EDX dictionary file.\n No Dic_File_Name passsed.\n Did you call edx$spell_guess before calling edx$dic_lookup_word?\n");
+    errmsg[ERRMSGLEN-1] = '\0';
+    return(FALSE);
+  }
+  memcpy(dic->options, dic_options, sizeof(dic_options));
+
+  //OPEN MAIN EDX DICTIONARY FILE
+  dic->hDicFile = CreateFile (Dic_File_Name,
+                         GENERIC_READ,
+                         FILE_SHARE_READ,
+                         NULL,
+                         OPEN_EXISTING,
+                         (dic->options[EDX_OPT_RESIDENCY] & EDX_RES_RANDOM) ? FILE_FLAG_RANDOM_ACCESS : 0,
+                         NULL);
+  if (dic->hDicFile == INVALID_HANDLE_VALUE)
+  {
+    DWORD dwErrCode = GetLastError();
+    char errmsg[ERRMSGLEN];
+    _snprintf(errmsg, ERRMSGLEN, "Error opening %s", Dic_File_Name );
+    errmsg[ERRMSGLEN-1] = '\0';
+    FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
+    return(FALSE);
+  }
+
+  //GET SIZE OF DICTIONARY FILE
+  dic->dwDicFileSize = GetFileSize(dic->hDicFile, NULL);
+  if (dic->dwDicFileSize == 0xFFFFFFFF)
+  {
+    DWORD dwErrCode = GetLastError();
+    if (dwErrCode != NO_ERROR)
+    {
+       char errmsg[ERRMSGLEN];
+       _snprintf(errmsg, ERRMSGLEN, "Call to 'GetFileSize' failed for file %s", Dic_File_Name );
+       errmsg[ERRMSGLEN-1] = '\0';
+       FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
+       return(FALSE);
+    }
+  }
+
+  //MAP THE FILE
+  // Create a file mapping object for the file.
+  dic->hDicFileMap = CreateFileMapping (dic->hDicFile, NULL, PAGE_READONLY, 0, dic->dwDicFileSize, NULL);
+  if (dic->hDicFileMap == INVALID_HANDLE_VALUE)
+  {
+    DWORD dwErrCode = GetLastError();
+    char errmsg[ERRMSGLEN];
+    _snprintf(errmsg, ERRMSGLEN, "Error calling CreateFileMapping for file %s", Dic_File_Name );
+    errmsg[ERRMSGLEN-1] = '\0';
+    FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
+    return(FALSE);
+  }
+
+  //CREATE
+  // Map the view
+  dic->lpDicMapBase = MapViewOfFile(dic->hDicFileMap,   // handle to mapping object
+                              FILE_MAP_READ,          // read permission
+                              0,                      // high-order 32 bits of file offset
+                              0,                      // low-order 32 bits of file offset
+                              dic->dwDicFileSize);    // number of bytes to map
+  if (dic->lpDicMapBase == NULL)
+  {
+    DWORD dwErrCode = GetLastError();
+    FetchErrorText(dwErrCode, "Call to 'MapViewOfFile' failed. lpDicMapBase returned is NULL.", errbuf, errbuflen );
+    return(FALSE);
+  }
 
   //NOW TRY SOME SANITY CHECKS
-  dichead = (struct dichead_layout *) lpDicMapBase;
-  if ( !(    dichead->id[1] == 'E'
-          && dichead->id[2] == 'D'
-          && dichead->id[3] == 'X'
-          && dichead->id[4] == 'd'
-          && dichead->id[5] == 'i'
-          && dichead->id[6] == 'c'
-          && dichead->id[7] == 't' ) )
+  dic->dichead = (struct dichead_layout *) dic->lpDicMapBase;
+  if ( !(    dic->dichead->id[1] == 'E'
+          && dic->dichead->id[2] == 'D'
+          && dic->dichead->id[3] == 'X'
+          && dic->dichead->id[4] == 'd'
+          && dic->dichead->id[5] == 'i'
+          && dic->dichead->id[6] == 'c'
+          && dic->dichead->id[7] == 't' ) )
+  {
+    //NOT EDX DICTIONARY. ERROR IN HEADER.
+    _snprintf(errbuf, errbuflen, "File %s is not an EDX dictionary file. Header does not begin with 'EDXdict'", Dic_File_Name );
+    errbuf[errbuflen-1] = '\0';
+    return(FALSE);
+  }
+  if (dic->dichead->id[0] == 6)    //Dictionary version 6 has a section table
+  {
+    if (!load_dic6(dic, Dic_File_Name, errbuf, errbuflen)) {return(FALSE);}
+  }
+  else if (dic->dichead->id[0] == 5)    //Dictionary version 5 contains 'flags'
+  {
+    dic->Extended_ANSI_Guessing = (dic->dichead->flags & 0x00000001);
+  }
+  else
+  {
+    if (dic->dichead->id[0] != 4)    //Dictionary version 4
+    {
+      //WRONG DICTIONARY VERSION
+      _snprintf(errbuf, errbuflen, "EDX dictionary file %s is not version 4, 5 or 6. Version is %d", Dic_File_Name, dic->dichead->id[0] );
+      errbuf[errbuflen-1] = '\0';
+      return(FALSE);
+    }
+    dic->Extended_ANSI_Guessing = FALSE;
+  }
+  if (dic->dichead6 == NULL) { dic->dicstamp = dic->dwDicFileSize; }
+  dic->diclexdba = (unsigned char *)dic->lpDicMapBase + dic->dichead->lexofst;  /* Starting address of main lexical database */
+  dic->dicindptr = (unsigned char *)dic->lpDicMapBase + dic->dichead->indofst;  /* Starting address of index */
+  dic->cmnwdsptr = (unsigned char *)dic->lpDicMapBase + dic->dichead->cwdofst;  /* Starting address of common words */
+
+  dic->scan = select_scan_kernel(dic->options[EDX_OPT_SIMD]);
+  dic->maplimit = (unsigned char *)dic->lpDicMapBase + dic->dwDicFileSize;
+  dic->lexlimit = dic->maplimit;
+  return(TRUE);
+}
+
+// Map the main EDX dictionary and build the indexes the options ask for
+BOOL load_main_dic(struct edx_dictionary *dic, char *Dic_File_Name, char *errbuf, int errbuflen)
+{
+  if (!map_main_dic(dic, Dic_File_Name, errbuf, errbuflen)) {return(FALSE);}
+  if (   dic->frontcoded
+      && (   hash_index_wanted(dic) || dic->options[EDX_OPT_SYMSPELL]
+          || dic->options[EDX_OPT_DAWG] || dic->options[EDX_OPT_LEVENSHTEIN] ) )
+    { expand_front_coded(dic); }          /* they need the words whole */
+  build_word_hash(&dic->cmnhash, dic->cmnwdsptr, dic->cmnwdsptr + dic->dichead->cwdlen);
+  if (hash_index_wanted(dic) && !dic->frontcoded && !map_dic6_hash(dic))
+  {
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+    build_word_hash(&dic->mainhash, dic->diclexdba, dic->diclexdba + dic->dichead->lexlen);
+    dic->hashbuildms = elapsed_ms(start);
+  }
+  if (dic->options[EDX_OPT_BLOOM_BITS] && !map_dic6_bloom(dic)) { build_bloom_filter(dic, dic->options[EDX_OPT_BLOOM_BITS], 0); }
+  if (dic->options[EDX_OPT_GUIDE_INDEX]) { build_guide_index(dic); }
+  if (dic->options[EDX_OPT_SYMSPELL] && !dic->frontcoded && !map_dic6_index(dic, DIC6_SYM, &dic->symfile, Dic_File_Name, use_sym_index))
+    { load_sym_index(dic, Dic_File_Name); }
+  if (dic->options[EDX_OPT_DAWG] && !dic->frontcoded && !map_dic6_index(dic, DIC6_DWG, &dic->dwgfile, Dic_File_Name, use_dwg_index))
+    { load_dwg_index(dic, Dic_File_Name); }
+  if (dic->options[EDX_OPT_LOOKUP_CACHE]) { dic->cache = new_cache(CACHE_SHARDS, dic->options[EDX_OPT_LOOKUP_CACHE]); }
+  if (dic->options[EDX_OPT_RESIDENCY]) { make_resident(dic); }
+  return(TRUE);
+}
+
+/*****************************************************************************/
+// Read a word list (one word per line, like the user's Aux1 dictionary) into
+// lexical database format at out, lowercased. Returns the end of the words
+// (where the NULL length-byte after the last word goes), or NULL with error
+// text in errbuf.
+unsigned char *read_words(FILE *fp, unsigned char *out, char *File_Name, char *what, char *errbuf, int errbuflen)
+{
+  /* MAIN LOOP. READ FROM WORD LIST, ADD TO MEMORY DATABASE */
+   int i,j,
+       ln_len,  /* line length */
+       wd_len,  /* word length */
+       wdbeg;
+   int linenum = 0;  /* line number */
+
+   #define WDBUF_SIZE    80    /* Inword buffer */
+   unsigned char  wdbuf[WDBUF_SIZE];
+   char signedwdbuf[WDBUF_SIZE];
+
+   while ( fgets(signedwdbuf,WDBUF_SIZE,fp) != 0)
+   {
+      ++linenum;                /* line # of file we're reading */
+      ln_len = strlen(signedwdbuf);   /* Save length of line */
+      if (ln_len == WDBUF_SIZE)
+      {
+         _snprintf(errbuf, errbuflen, "Input line too long in %s.\nLine %d, file %s.\n", what, linenum, File_Name);
+         errbuf[errbuflen-1] = '\0';
+         return(NULL);
+      }
+
+      /* Lowercase the string */
+      for ( i = 0; i < ln_len; ++i )
+         wdbuf[i] = ANSItolower( (unsigned char)signedwdbuf[i] );
+
+      /* skip over leading spaces and tabs until we find beginning of word or end of line */
+      for ( wdbeg = 0;
+             EDXisspace(wdbuf[wdbeg])
+            &&
+             wdbeg < ln_len;
+           ++wdbeg );
+
+      if (wdbeg < ln_len)   /* Is begining of word (else was a blank line)*/
+      {
+         /* Get length of word */
+         for (  j = wdbeg, wd_len=0 ;
+                j < ln_len
+             && !EDXisspace(wdbuf[j]);
+                ++j, ++wd_len );
+
+         if ( wd_len > 31 )
+         {
+            wdbuf[wdbeg+wd_len] = 0;                    /* make ASCIZ string */
+            _snprintf(errbuf, errbuflen, "Word too long in %s.\nMax length is 31 characters.\nLine %d, file %s, word '%s'\n", what, linenum, File_Name, &wdbuf[wdbeg]);
+            errbuf[errbuflen-1] = '\0';
+            return(NULL);
+         }
+
+/* Move word to output */
+         *out++ = (unsigned char) wd_len;         /* Length-byte preceeding each word */
+         for (  i = 0, j = wdbeg;
+                i < wd_len;
+                ++i, ++j )
+         {
+            *out++ = wdbuf[j];
+         }
+      }/*endif we have a word*/
+   }/* END MAIN LOOP */
+
+/* Assume we exit loop because fgets reached End Of File. (No fancy error checking) */
+   return(out);
+}
+
+// Make room for 'bytes' more bytes of words (and the NULL length-byte after
+// them) at the end of aux1base
+BOOL aux1_room(struct edx_dictionary *dic, DWORD bytes)
+{
+  unsigned char *newbase;
+
+  if (dic->aux1base != NULL && dic->aux1len + bytes + 1 <= dic->aux1size) {return(TRUE);}
+  newbase = new unsigned char[dic->aux1len + bytes + 1];
+  if (newbase == NULL) {return(FALSE);}
+  if (dic->aux1base != NULL)
+  {
+    memcpy(newbase, dic->aux1base, dic->aux1len);
+    delete[] dic->aux1base;
+  }
+  newbase[dic->aux1len] = '\0';
+  dic->aux1base = newbase;
+  dic->aux1size = dic->aux1len + bytes + 1;
+  return(TRUE);
+}
+
+BOOL load_aux1_dic(struct edx_dictionary *dic, char *Aux1_File_Name, char *errbuf, int errbuflen)
+{
+  FILE *fpAux1File = NULL;  //User's Aux1 dictionary
+  HANDLE hAux1File;         //Handle to user's Aux1 dictionary
+  DWORD dwAux1FileSize;     //Length of user's Aux1 dictionary. Used to determine how much memory to allocate.
+  unsigned char* aux1ptr;   /* Current address into user's AUX1 personal lexical database */
+  //User's personal Aux1 dictionary is optional.
+  if (Aux1_File_Name == NULL || Aux1_File_Name[0] == '\0') {return(TRUE);}
+
+  //Save Aux1 filename
+  if (Aux1_File_Name != dic->Aux1File)
+  {
+    strncpy(dic->Aux1File,Aux1_File_Name,FNAMESIZE);
+    dic->Aux1File[FNAMESIZE-1] = '\0';
+  }
+
+  //OPEN USER'S PERSONAL DICTIONARY (AUX1) and get the size
+  hAux1File = CreateFile (Aux1_File_Name,
+                          GENERIC_READ,
+                          FILE_SHARE_READ,
+                          NULL,
+                          OPEN_ALWAYS,
+                          0,
+                          NULL);
+  if (hAux1File == INVALID_HANDLE_VALUE)
+  {
+    DWORD dwErrCode = GetLastError();
+    char errmsg[ERRMSGLEN];
+    _snprintf(errmsg, ERRMSGLEN, "Error opening %s", Aux1_File_Name );
+    errmsg[ERRMSGLEN-1] = '\0';
+    FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
+    return(FALSE);
+  }
+
+  //GET SIZE OF AUX1 FILE
+  dwAux1FileSize = GetFileSize(hAux1File, NULL);
+  if (dwAux1FileSize == 0xFFFFFFFF)
+  {
+    DWORD dwErrCode = GetLastError();
+    if (dwErrCode != NO_ERROR)
+    {
+       char errmsg[ERRMSGLEN];
+       _snprintf(errmsg, ERRMSGLEN, "Call to 'GetFileSize' failed for file %s", Aux1_File_Name );
+       errmsg[ERRMSGLEN-1] = '\0';
+       FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
+       return(FALSE);
+    }
+  }
+  CloseHandle(hAux1File);
+
+  fpAux1File = fopen(Aux1_File_Name,"r");
+  if (fpAux1File == (FILE *) NULL)
+  {
+    char errmsg[ERRMSGLEN];
+    _snprintf(errmsg, ERRMSGLEN, "Error reopening user's personal dictionary file %s.\n", Aux1_File_Name);
+    errmsg[ERRMSGLEN-1] = '\0';
+    return(FALSE);
+  }
+
+  if (!aux1_room(dic, dwAux1FileSize+1))  //+1 for leading length byte of first word (aux1_room adds the trailing NULL byte of last word)
+  {
+    fclose(fpAux1File);
+    _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+    errbuf[errbuflen-1] = '\0';
+    return(FALSE);
+  }
+  aux1ptr = dic->aux1base + dic->aux1len;  /* Current address into user's AUX1 personal lexical database (after the stack's layers) */
+  aux1ptr = read_words(fpAux1File, aux1ptr, Aux1_File_Name, "user's personal dictionary file", errbuf, errbuflen);
+  fclose(fpAux1File);
+  if (aux1ptr == NULL) {return(FALSE);}
+  *aux1ptr = '\0';        /* NULL after last word indicates end of lexical word list*/
+  dic->aux1len = (DWORD)(aux1ptr - dic->aux1base);
+  return(TRUE);
+}
+
+/*---------------------------------------------------------------------------
+    .SUBTITLE DICTIONARY STACKS
+
+ Functional Description:
+    A dictionary stack is a main EDX dictionary with up to EDX_MAX_LAYERS
+    more word lists on top of it (a medical or legal dictionary, a team's
+    list), then the user's Aux1 dictionary. A layer is an EDX dictionary
+    (any version; its common words and main lexical database are read) or
+    a word list like an Aux1 file.
+
+    The layers' words go into aux1base, in order, ahead of the Aux1 words,
+    and layers[n].end marks where each layer's words end. So they're all in
+    the one Aux1 hash index and the Bloom filter, and a lookup costs what
+    it did with just an Aux1 dictionary, however many layers there are:
+    the main dictionary, then one probe of the Aux1 hash index
+    (find_word_hash, which finds the first of a word's layers). Spell
+    guessing looks its guesses up the same way, and the suggestion index,
+    word graph and Levenshtein guessing take the layers' words as
+    candidates along with the Aux1 words. The layer a word was found in
+    is numbered 0 for the main dictionary, 1 to nlayers for the layers
+    and nlayers+1 for the Aux1 words (ses->layer, see aux1_layer).
+    A word in more than one layer is found in the first of them.
+---------------------------------------------------------------------------*/
+// Add the words of EDX dictionary File_Name to the end of aux1base
+BOOL load_layer_dic(struct edx_dictionary *dic, char *File_Name, char *errbuf, int errbuflen)
+{
+  struct edx_dictionary *layer = new struct edx_dictionary;
+  unsigned char *words, *end, *lbptr;
+  unsigned char *ranges[2][2];
+  DWORD r;
+  BOOL ok = FALSE;
+
+  if (layer == NULL)
+  {
+    _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+    errbuf[errbuflen-1] = '\0';
+    return(FALSE);
+  }
+  memset(layer, 0, sizeof(struct edx_dictionary));
+  words = NULL;
+  if (map_main_dic(layer, File_Name, errbuf, errbuflen))
+  {
+    words = main_words(layer, &end);
+    if (words != NULL && aux1_room(dic, layer->dichead->cwdlen + (DWORD)(end - words)))
+    {
+      ranges[0][0] = layer->cmnwdsptr;  ranges[0][1] = layer->cmnwdsptr + layer->dichead->cwdlen;
+      ranges[1][0] = words;             ranges[1][1] = end;
+      for (r = 0; r < 2; ++r)
+      {
+        for ( lbptr = ranges[r][0];
+              lbptr < ranges[r][1] && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+              lbptr += *lbptr + 1 )
+        {
+          memcpy(dic->aux1base + dic->aux1len, lbptr, *lbptr + 1);
+          dic->aux1len += *lbptr + 1;
+        }
+      }
+      dic->aux1base[dic->aux1len] = '\0';
+      ok = TRUE;
+    }
+    else
+    {
+      _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+      errbuf[errbuflen-1] = '\0';
+    }
+  }
+  free_main_words(layer, words);
+  unload_dic(layer);
+  delete layer;
+  return(ok);
+}
+
+// Add the words of word list File_Name to the end of aux1base
+BOOL load_layer_list(struct edx_dictionary *dic, char *File_Name, char *errbuf, int errbuflen)
+{
+  FILE *fp = fopen(File_Name, "r");
+  unsigned char *end;
+  long size;
+
+  if (fp == NULL)
+  {
+    _snprintf(errbuf, errbuflen, "Error opening word list %s.\n", File_Name);
+    errbuf[errbuflen-1] = '\0';
+    return(FALSE);
+  }
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+  rewind(fp);
+  if (!aux1_room(dic, size + 1))
+  {
+    fclose(fp);
+    _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+    errbuf[errbuflen-1] = '\0';
+    return(FALSE);
+  }
+  end = read_words(fp, dic->aux1base + dic->aux1len, File_Name, "word list", errbuf, errbuflen);
+  fclose(fp);
+  if (end == NULL) {return(FALSE);}
+  *end = '\0';
+  dic->aux1len = (DWORD)(end - dic->aux1base);
+  return(TRUE);
+}
+
+// Load the layers of a dictionary stack, in order, ahead of the Aux1 words
+BOOL load_layers(struct edx_dictionary *dic, char **Layer_File_Names, int nlayers, char *errbuf, int errbuflen)
+{
+  struct dic_layer *layer;
+  unsigned char id[8];
+  DWORD start;
+  FILE *fp;
+  BOOL isdic;
+  int n;
+
+  if (nlayers > EDX_MAX_LAYERS)
+  {
+    _snprintf(errbuf, errbuflen, "Too many dictionaries in the stack. The most is %d more than the main dictionary.", EDX_MAX_LAYERS);
+    errbuf[errbuflen-1] = '\0';
+    return(FALSE);
+  }
+  for (n = 0; n < nlayers; ++n)
+  {
+    layer = &dic->layers[n];
+    strncpy(layer->Name, Layer_File_Names[n], FNAMESIZE);
+    layer->Name[FNAMESIZE-1] = '\0';
+    isdic = FALSE;                    /* an EDX dictionary, or a word list? */
+    fp = fopen(layer->Name, "rb");
+    if (fp != NULL)
+    {
+      isdic = (fread(id, 1, sizeof(id), fp) == sizeof(id) && memcmp(id + 1, "EDXdict", 7) == 0);
+      fclose(fp);
+    }
+    start = dic->aux1len;
+    if (isdic ? !load_layer_dic(dic, layer->Name, errbuf, errbuflen)
+              : !load_layer_list(dic, layer->Name, errbuf, errbuflen)) {return(FALSE);}
+    layer->end = dic->aux1len;
+    layer->words = count_words(dic->aux1base + start, dic->aux1base + dic->aux1len);
+    dic->nlayers = n + 1;
+  }
+  return(TRUE);
+}
+
+/******************************************************************************/
+// Dic_File_Name is name of main EDX spelling dictionary (the EDX lexical database file)
+// Aux1_File_Name is the name of the user's personal auxiliary spelling dictionary (Aux1)
+// Loads a dictionary for a handle (see DICTIONARY HANDLES), with the layers of
+// a dictionary stack if there are any. NULL if it can't be loaded.
+struct edx_dictionary *load_dic(char *Dic_File_Name, char **Layer_File_Names, int nlayers, char *Aux1_File_Name, char *errbuf, int errbuflen)
+{
+  BOOL loaded;
+  struct edx_dictionary *dic = new struct edx_dictionary;
+  if (dic == NULL)
+  {
+    _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+    errbuf[errbuflen-1] = '\0';
+    return(NULL);
+  }
+  memset(dic, 0, sizeof(struct edx_dictionary));
+ __try
+ {
+#ifdef EDX_STATS
+   dic->loadstart = ticks_now();      /* (the handle's latency histogram gets it, see init_handle) */
+#endif
+   loaded = load_main_dic(dic, Dic_File_Name, errbuf, errbuflen);
+#ifdef EDX_STATS
+   dic->loadticks = ticks_since(dic->loadstart);
+#endif
+   if (   loaded
+       && load_layers(dic, Layer_File_Names, nlayers, errbuf, errbuflen)
+       && load_aux1_dic(dic, Aux1_File_Name, errbuf, errbuflen) )
+   {
+     if (dic->aux1base != NULL)
+     {
+       build_word_hash(&dic->aux1hash, dic->aux1base, dic->aux1base + dic->aux1len);
+       if (dic->nlayers != 0 && dic->bloom != NULL)   /* sized for the main dictionary alone */
+       {
+         if (dic->bloombase != NULL) { delete[] dic->bloombase; }
+         dic->bloombase = NULL;
+         dic->bloom = NULL;
+         build_bloom_filter(dic, dic->options[EDX_OPT_BLOOM_BITS], dic->aux1hash.words);
+       }
+       if (bloom_writable(dic)) { bloom_add_words(dic, dic->aux1base, NULL); }
+       else { dic->bloom = NULL; }
+     }
+     load_guess_cache(dic, Dic_File_Name);
+     return(dic);
+   }
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+ }
+  unload_dic(dic);
+  delete dic;
+  return(NULL);
+}
+
+// Load the handle's dictionary (Dic_File_Name, or the one it has if NULL or
+// "") again, and make it live. Lookups go on with the old one meanwhile.
+int reload_dic(struct edx_dictionary *handle, char *Dic_File_Name, char *errbuf, int errbuflen)
+{
+  struct edx_dictionary *dic, *old;
+  char *layers[EDX_MAX_LAYERS];
+  DWORD i;
+
+  if (Dic_File_Name == NULL || Dic_File_Name[0] == '\0') { Dic_File_Name = handle->DicFile; }
+  EnterCriticalSection(&handle->addlock);    /* no words added to Aux1 till the new dictionary's live */
+  for (i = 0; i < handle->nlayers; ++i) layers[i] = handle->layers[i].Name;
+  dic = load_dic(Dic_File_Name, layers, handle->nlayers, handle->Aux1File, errbuf, errbuflen);
+  if (dic == NULL) { LeaveCriticalSection(&handle->addlock); return(EDX__ERROR); }
+
+  EnterCriticalSection(&handle->reloadlock);
+  old = handle->live;
+  dic->generation = old->generation + 1;
+  old->nextretired = handle->retired;
+  handle->retired = old;
+  InterlockedExchangePointer((void * volatile *)&handle->live, dic);
+  if (Dic_File_Name != handle->DicFile)
+  {
+    strncpy(handle->DicFile, Dic_File_Name, FNAMESIZE);
+    handle->DicFile[FNAMESIZE-1] = '\0';
+  }
+  free_retired(handle, FALSE);
+#ifdef EDX_STATS
+  lat_record(handle, dic, LAT_LOAD, dic->loadstart, dic->loadticks, 0);   /* (once we let go, another reload can free dic) */
+#endif
+  LeaveCriticalSection(&handle->reloadlock);
+  LeaveCriticalSection(&handle->addlock);
+  return(EDX__WORDFOUND);
+}
+
+// Make a handle of a dictionary just loaded
+void init_handle(struct edx_dictionary *handle, struct edx_dictionary *dic, char *Dic_File_Name, char *Aux1_File_Name)
+{
+  handle->live = dic;
+  memcpy(handle->layers, dic->layers, sizeof(dic->layers));   /* (for reloads) */
+  handle->nlayers = dic->nlayers;
+  strncpy(handle->DicFile, Dic_File_Name, FNAMESIZE);
+  handle->DicFile[FNAMESIZE-1] = '\0';
+  strncpy(handle->Aux1File, (Aux1_File_Name != NULL) ? Aux1_File_Name : "", FNAMESIZE);
+  handle->Aux1File[FNAMESIZE-1] = '\0';
+#ifdef EDX_STATS
+  lat_record(handle, dic, LAT_LOAD, dic->loadstart, dic->loadticks, 0);
+#endif
+}
+
+// Loads the default dictionary used by edx$dic_lookup_word the first time through.
+BOOL spell_init(char *Dic_File_Name, char *Aux1_File_Name, char *errbuf, int errbuflen)
+{
+  struct edx_dictionary *dic;
+
+  if (dic_loaded) { return(TRUE); }
+
+  dic = load_dic(Dic_File_Name, NULL, 0, Aux1_File_Name, errbuf, errbuflen);
+  if (dic == NULL) return(FALSE);
+  init_handle(&default_dic, dic, Dic_File_Name, Aux1_File_Name);
+  default_session.handle = &default_dic;
+  default_dic.sessions = &default_session;
+
+  dic_loaded = TRUE;  //dic_loaded now means both main dictionary and optinal aux1 dictionary
+  return(TRUE);
+}
+
+/*---------------------------------------------------------------------------
+    .SUBTITLE BINSRCH_MAINDIC
+
+ Functional Description:
+    The index to the dictionary main lexical database is searched
+    to determine the page range within which target_word must lie
+    if it exists.
+
+    binsrch_guidewords is the original binary search of the guide words,
+    followed by a walk up and down from where it stopped to find the page
+    boundaries. It gives:
+       low  = last page whose guide word is < target_word (or 0)
+       high = first page whose guide word is > target_word (or nidxwds)
+    On a big dictionary with long guide words the walk can be long.
+
+    If the guide word index acceleration was built (build_guide_index),
+    binsrch_maindic finds the same low and high without the walk:
+    guidejump[] gives the range of guide words starting with target_word's
+    first two characters (every guide word before that range is less than
+    target_word and every one after is greater), and two binary searches
+    of the packed guide word keys in that range find the first guide word
+    >= target_word and the first > target_word.
+
+ Calling Sequence:
+    steps = binsrch_maindic( dic, &low, &high, &target_word );
+
+ Argument inputs:
+    target_word - character array of word to match, blank padded to
+                      dic->dichead->indswd (by reference)
+
+ Outputs:
+    low - dictionary page number below which word would not reside (by reference)
+    high - dictionary page number above which word would not reside (by reference)
+    (NOTE: The first dictionary page number is 0.)
+    steps - guide words compared (for the hot path counters)
+
+---------------------------------------------------------------------------*/
+DWORD binsrch_guidewords( struct edx_dictionary *dic,
+                          DWORD *low,
+                          DWORD *high,
+                          unsigned char *target_word )
+{
+   struct dichead_layout *dichead = dic->dichead;
+   unsigned char *dicindptr = dic->dicindptr;  /* Starting address of index */
+   int cmp;     /* Result of memory compare memcmp */
+   DWORD newdpn;  /* new dictionary page number to try */
+   DWORD steps = 0;  /* guide words compared */
+
+/* PREPARE FOR BINARY SEARCH */
+   *high = dichead->nidxwds - 1;   /* Highest dictionary page number [minus one because we start count at zero](number of index guide words. One guide word for each page.) */
+   *low = 0;  /* Start at low dictionary page number = 0 (first page)*/
+
+/* BINARY SEARCH THE INDEX */
+   for (;;)
+   {
+      newdpn = (*low + *high)/2;
+      if (newdpn == *low) break;           /* exitloop when guess=lowb */
+      ++steps;
+      cmp = memcmp(target_word, dicindptr + newdpn*dichead->indswd, dichead->indswd);
+      if (cmp == 0) break;          /* switch to linear search */
+      if (cmp > 0) *low = newdpn;          /* word is in higher half */
+      else *high = newdpn;             /* else word is in lower half */
+   }/*endloop */
+
+/* NOW DO LINEAR SEARCH UP AND DOWN TO FIND TRUE PAGE BOUNDARIES */
+/* FIRST LOOK TOWARD Z'S FOR newdpn > TARGET_INDEX OR END OF DICTIONARY */
+/* Set upper bound page #.  NOTE: Search is to INCLUDE this page up to
+first length-byte.  Word we are looking for may be at the end of prev
+page spilling over into this page.  ALSO NOTE: if word is in very last
+page of dictionary past last guide word then we must increment high by
+one to include the last page.  */
+   *high = dichead->nidxwds -1;   /* number of last page in dictionary [minus one because we start count at zero](number of index guide words) */
+   while( (++steps, cmp = memcmp(target_word,
+                       dicindptr + newdpn*dichead->indswd,
+                       dichead->indswd))
+          >= 0  &&  newdpn != *high ) ++newdpn;
+   *high = newdpn;             /* Set upper bound page # */
+   if (cmp >= 0) ++*high;       /* include very last page of dictionary if need be */
+
+
+/* SEARCH FOR newdpn < TARGET_INDEX OR BEGINNING OF DICTIONARY */
+   while( (++steps, memcmp(target_word,
+                 dicindptr + newdpn*dichead->indswd,
+                 dichead->indswd))
+          <= 0  &&  newdpn != 0 ) --newdpn;
+   *low = newdpn;  /* set lower bound page # */
+   return(steps);
+}
+
+DWORD binsrch_maindic( struct edx_dictionary *dic,
+                       DWORD *low,
+                       DWORD *high,
+                       unsigned char *target_word )
+{
+   unsigned __int64 tkey;
+   DWORD prefix, lo, hi, mid, first, last;
+   DWORD steps = 0;  /* guide words compared */
+
+   if (dic->guidekeys == NULL) return( binsrch_guidewords(dic, low, high, target_word) );
+
+   tkey = guide_key(target_word, dic->dichead->indswd);
+   prefix = (DWORD)(tkey >> 48);
+   first = dic->guidejump[prefix];      /* guide words first..last-1 have the same prefix as target_word */
+   last = dic->guidejump[prefix + 1];
+
+   /* first guide word >= target_word */
+   for (lo = first, hi = last; lo < hi; ++steps)
+   {
+      mid = (lo + hi)/2;
+      if (cmp_guideword(dic, target_word, tkey, mid) > 0) lo = mid + 1;
+      else hi = mid;
+   }
+   *low = (lo == 0) ? 0 : lo - 1;       /* last guide word < target_word */
+
+   /* first guide word > target_word */
+   for (hi = last; lo < hi; ++steps)
+   {
+      mid = (lo + hi)/2;
+      if (cmp_guideword(dic, target_word, tkey, mid) >= 0) lo = mid + 1;
+      else hi = mid;
+   }
+   *high = lo;
+   return(steps);
+}
+
+/*=============================================================================
+    .SUBTITLE DIC_LOOKUP_WORD
+
+ Functional Description:
+    Searches the EDX dictionary for a given word
+
+ Calling Sequence:
+    status = dic_lookup_word(ses, wdlen, wdbeg)
+
+ Argument inputs:
+    ses - session whose EDX dictionary to search (main lexical database,
+          common words, and user's personal Aux1 dictionary). Counters
+          are kept in the session.
+    wdlen - length of word
+    wdbeg - pointer to start of word
+
+ Outputs:
+    status = EDX__WORDFOUND - word was found
+           = EDX__WORDNOTFOUND - word was not found
+
+ Outline:
+    1.  The input word is copied to target_word buffer and lowercased.
+
+    2.  The dictionary common word list is searched for the word.
+
+    3.  If the word is in the lookup cache, we're done (see LOOKUP CACHE).
+
+    4.  If the Bloom filter says it isn't a word, we're done.
+
+    5.  The main lexical database is searched for the word, then the
+        user's Aux1 dictionary, and the lookup cache is told what we found.
+
+---------------------------------------------------------------------------*/
+
+/* SETUP_DICWORD */
+/* Move word wdbeg,wdlen (1 to MAXWORDLEN characters) to target_word,
+   lowercase, and blank pad to INDSWD in length (so we can compare it
+   with guide words) */
+void setup_dicword(struct edx_dictionary *dic, int wdlen, unsigned char *wdbeg, unsigned char *target_word)
+{
+   DWORD i;
+   unsigned char *wdend;     /* word pointer */
+   unsigned char *wdptr;     /* word pointer */
+
+   wdend = wdbeg + wdlen;               /* wdend -> char after last char of word */
+   for ( wdptr = wdbeg, i = 0;
+         wdptr < wdend;
+         ++wdptr, ++i )
+      target_word[i] = ANSItolower(*wdptr);
+
+   for ( ; i < dic->dichead->indswd; ++i )     /* BLANK PAD TO INDSWD LENGTH */
+      target_word[i] = SPACE;
+}
+
+/* SEARCH COMMON WORD LIST FOR MATCH */
+BOOL search_commonwords(struct edx_dictionary *dic, unsigned char *target_word, DWORD target_word_len)
+{
+   if (target_word_len > dic->dichead->cwdmln) return(FALSE);   /* too long to be in commonword list */
+   if (dic->cmnhash.tab != NULL) return( search_word_hash(&dic->cmnhash, target_word, target_word_len) );
+
+   /* No hash index of common words, so walk through them */
+   return( dic->scan(dic->cmnwdsptr, dic->cmnwdsptr + dic->dichead->cwdlen, dic->maplimit,
+                     target_word, target_word_len) );
+}
+
+/* Bytes search_commonwords walks to look for a word of length len (for the hot path counters) */
+#define COMMON_SCAN_BYTES(dic,len) \
+   (((dic)->cmnhash.tab == NULL && (len) <= (dic)->dichead->cwdmln) ? (dic)->dichead->cwdlen : 0)
+
+/* The Aux1 words (after the stack's layers), their length and hash index,
+   for a session to search. An add may be replacing them (aux1_add_word),
+   so they're read between two reads of aux1seq that agree and are even. */
+void aux1_view(struct edx_dictionary *dic, struct aux1_view *v)
+{
+   LONG seq;
+
+   do
+   {
+      while ((seq = dic->aux1seq) & 1) YieldProcessor();
+      MemoryBarrier();
+      v->base = dic->aux1base;
+      v->len = dic->aux1len;
+      v->hash = dic->aux1hash;
+      MemoryBarrier();
+   } while (dic->aux1seq != seq);
+}
+
+/* Which layer of a dictionary stack the word at offset ofst of aux1base is
+   in: 1 to nlayers for the stacked word lists, nlayers+1 for the Aux1 words */
+DWORD aux1_layer(struct edx_dictionary *dic, DWORD ofst)
+{
+   DWORD i;
+   for (i = 0; i < dic->nlayers && ofst >= dic->layers[i].end; ++i);
+   return(i + 1);
+}
+
+/* Search the main lexical database and the user's Aux1 dictionary (and the
+   layers of a dictionary stack) for target_word (set up by setup_dicword).
+   Sets ses->layer to the layer it was found in. */
+int search_dic(struct edx_session *ses, unsigned char *target_word, DWORD target_word_len)
+{
+   struct edx_dictionary *dic = ses->dic;
+   struct aux1_view aux1;
+   DWORD ofst, start, end, i, steps;
+   DWORD low;       /* lower bound page # */
+   DWORD high;      /* upper bound page # */
+   unsigned char *lbptr;     /* pointer to length-byte of current word */
+   unsigned char *endrange;
+   struct dichead_layout *dichead = dic->dichead;
+   unsigned char *diclexdba = dic->diclexdba;  /* Starting address of main lexical database */
+/* NOTE: pages referred to are edx_dictionary pages of size DICPLN */
+
+/* CHECK BLOOM FILTER */
+   if (dic->bloom != NULL)
+   {
+      ++ses->bloom_lookups;
+      if (!bloom_maybe(dic, target_word, target_word_len)) { ++ses->bloom_rejects; return(EDX__WORDNOTFOUND); }
+   }
+
+/* SEARCH MAIN DICTIONARY FOR MATCH */
+   if (dic->mainhash.tab != NULL)   /* hash index built? Then that's all we need */
+   {
+      if (search_word_hash(&dic->mainhash, target_word, target_word_len)) { ses->layer = 0; return(EDX__WORDFOUND); }
+      goto search_aux1;
+   }
+   steps = binsrch_maindic( dic, &low, &high, target_word );
+   STAT_ADD(ses, binsrch_calls, 1);
+   STAT_ADD(ses, binsrch_steps, steps);
+   STAT_ADD(ses, binsrch_span, high - low);
+   STAT_MAX(ses, binsrch_maxspan, high - low);
+   STAT_ADD(ses, page_scans, 1);
+   if (dic->frontcoded)
+   {
+      STAT_ADD(ses, page_bytes, (high - low) * dichead->dicpln);
+      if (fc_search_pages(dic, low, high, target_word, target_word_len)) { ses->layer = 0; return(EDX__WORDFOUND); }
+      goto search_aux1;
+   }
+
+/* Linear search dictionary pages for match to target word.  Compare
+   found word with target word starting with last character and moving
+   to front of word.  We do this because we already expect the first
+   few characters of the word to match if we're looking in the right
+   area of the dictionary.
+*/
+   endrange = diclexdba + (high * dichead->dicpln);
+
+/*//DEBUG
+   char *lbptra = diclexdba + (low * dichead->dicpln);
+   char *diclexend = diclexdba + dichead->lexlen;
+   sprintf(errbuf,"low=%u high=%u dichead=%x diclexdba=%x diclexend=%x lbptra=%x lbptr=%x endrange=%x *lbptra=%c *lbptr=%c",low,high,dichead,diclexdba,diclexend,lbptra,lbptr,endrange,*lbptra,*lbptr);
+   return(31);
+*/
+
+   for ( lbptr = diclexdba + (low * dichead->dicpln); *lbptr > 31; ++lbptr);  /* find a length-byte */
+   STAT_ADD(ses, page_bytes, (endrange > lbptr) ? endrange - lbptr : 0);
+   if (dic->scan(lbptr, endrange, dic->lexlimit, target_word, target_word_len)) { ses->layer = 0; return(EDX__WORDFOUND); }
+
+/* SEARCH USER'S PERSONAL AUX1 DICTIONARY (AND THE STACK'S LAYERS) FOR MATCH */
+search_aux1:
+   aux1_view(dic, &aux1);
+   if (aux1.base != NULL) STAT_ADD(ses, aux1_searches, 1);
+   if (aux1.hash.tab != NULL)
+   {
+      ofst = find_word_hash(&aux1.hash, target_word, target_word_len);
+      if (ofst != 0) { ses->layer = aux1_layer(dic, ofst - 1); return(EDX__WORDFOUND); }
+   }
+   else if (aux1.base != NULL)  //If there is a user's personal Aux1 dictionary
+   {
+      unsigned char *aux1end = aux1.base + aux1.len + 1;
+      for (i = 0, start = 0; i <= dic->nlayers; ++i, start = end)   /* each layer in turn, then the Aux1 words */
+      {
+         end = (i < dic->nlayers) ? dic->layers[i].end : aux1.len + 1;
+         STAT_ADD(ses, aux1_bytes, end - start);
+         if (dic->scan(aux1.base + start, aux1.base + end, aux1end, target_word, target_word_len))
+            { ses->layer = i + 1; return(EDX__WORDFOUND); }
+      }
+   }
+
+/* DROP OUT BOTTOM IF WORD NOT FOUND IN MAIN DICTIONARY */
+   return(EDX__WORDNOTFOUND);      /* WORD NOT FOUND ANYWHERE.  SORRY */
+}
+
+int dic_lookup_word(struct edx_session *ses, int wdlen, unsigned char *wdbeg)
+{
+   struct edx_dictionary *dic = ses->dic;
+   unsigned char target_word[MAXWORDLEN+1];   /* word spelling checker is currently checking */
+   DWORD h, generation;
+   int status;
+
+   ses->layer = 0;
+   if (wdlen == 0) return(EDX__WORDFOUND);     /* accept zero length word as OK */
+   if (wdlen > MAXWORDLEN) return(EDX__WORDNOTFOUND); /* Word too long.  Can't possibly be a word.  User probably doesn't want us to stop on it anyway. */
+   setup_dicword(dic, wdlen, wdbeg, target_word);
+   STAT_ADD(ses, lookups, 1);
+
+/* SEARCH COMMON WORD LIST FOR MATCH */
+   STAT_ADD(ses, common_bytes, COMMON_SCAN_BYTES(dic, (DWORD)wdlen));
+   if (search_commonwords(dic, target_word, wdlen)) { STAT_ADD(ses, common_hits, 1); return(EDX__WORDFOUND); }
+   STAT_ADD(ses, common_misses, 1);
+   if (dic->cache == NULL) return( search_dic(ses, target_word, wdlen) );
+
+/* LOOK IN LOOKUP CACHE */
+   h = hash_word(target_word, wdlen);
+   if (cache_find(dic, target_word, wdlen, h, &status, &ses->layer, &generation)) return(status);
+   status = search_dic(ses, target_word, wdlen);
+   cache_add(dic, target_word, wdlen, h, status, ses->layer, generation);
+   return(status);
+}
+
+/*=============================================================================
+    .SUBTITLE DIC_LOOKUP_WORDS
+
+ Functional Description:
+    Searches the EDX dictionary for a batch of words at once. Gives exactly
+    the same status for each word as dic_lookup_word would, but words whose
+    search starts on the same dictionary page share one walk of the pages,
+    a word appearing several times in the batch is searched for only once,
+    and the user's personal Aux1 dictionary is walked once for all the words
+    not found elsewhere.
+
+ Calling Sequence:
+    result = dic_lookup_words(ses, words, nwords, status)
+
+ Argument inputs:
+    dic - the loaded EDX dictionary to search
+    words - array of nwords (pointer, length) words. Words need not be
+            lowercased or null terminated.
+    nwords - number of words in the batch
+
+ Outputs:
+    status - array of nwords. status[n] is set to EDX__WORDFOUND or
+             EDX__WORDNOTFOUND for words[n].
+    result = EDX__WORDFOUND - every word was found
+           = EDX__WORDNOTFOUND - at least one word was not found
+           = EDX__ERROR - memory allocation failure
+
+ Outline:
+    1.  Each word is copied to its own target_word, lowercased and blank
+        padded, and the common word list is searched for it.
+
+    2.  The index is searched for the page range of each word not yet found,
+        and the words are sorted by page range, then by word, so the same
+        word appearing twice ends up side by side.
+
+    3.  For each run of words starting on the same page, the pages are
+        walked once. Each length-byte is checked only against the words of
+        that length, and only while still inside that word's page range.
+
+    4.  The user's personal Aux1 dictionary is walked once for the words
+        still not found, and duplicates are given the status of the first.
+---------------------------------------------------------------------------*/
+struct batch_word {
+   unsigned char target_word[MAXWORDLEN+1];   /* lowercased, blank padded word */
+   DWORD target_word_len;            /* length of target word */
+   DWORD low;                        /* lower bound page # */
+   DWORD high;                       /* upper bound page # */
+   unsigned char *endrange;          /* end of this word's page range (NULL = no limit) */
+   int   wordno;                     /* index of this word in words[] and status[] */
+   BOOL  duplicate;                  /* same word as the one before it in the batch */
+   BOOL  found;
+   struct batch_word *next;          /* next word of same length still being looked for */
+};
+
+/* qsort comparison: order by lower bound page, upper bound page, then word */
+int compare_batch_words(const void *a, const void *b)
+{
+   const struct batch_word *wa = (const struct batch_word *)a;
+   const struct batch_word *wb = (const struct batch_word *)b;
+
+   if (wa->low != wb->low) return( (wa->low < wb->low) ? -1 : 1 );
+   if (wa->high != wb->high) return( (wa->high < wb->high) ? -1 : 1 );
+   if (wa->target_word_len != wb->target_word_len) return( (wa->target_word_len < wb->target_word_len) ? -1 : 1 );
+   return( memcmp(wa->target_word, wb->target_word, wa->target_word_len) );
+}
+
+/* Walk length-prefixed words from lbptr up to endrange (NULL = until the
+   NULL length-byte at the end), checking each word against the batch words
+   of the same length in chain[]. Found words, and words whose own endrange
+   we have passed, are dropped from chain[]. Stop when none are left. */
+void walk_for_batch(unsigned char *lbptr, unsigned char *endrange,
+                    struct batch_word **chain, int pending)
+{
+   unsigned char *dptr;      /* pointer into dictionary into word */
+   unsigned char *tptr;      /* pointer into target_word */
+   struct batch_word **pp;
+   struct batch_word *bw;
+
+   while (pending > 0 && (endrange == NULL || lbptr < endrange))
+   {
+      if (*lbptr == 0x00) break;                            /* End of Lexical Database */
+      if (*lbptr <= MAXWORDLEN)
+      {
+         for (pp = &chain[*lbptr]; (bw = *pp) != NULL; )
+         {
+            if (bw->endrange != NULL && lbptr >= bw->endrange)  /* past this word's pages */
+            {
+               *pp = bw->next;
+               --pending;
+               continue;
+            }
+            for ( tptr = bw->target_word + bw->target_word_len -1,  /* start tptr at last char of target_word */
+                  dptr = lbptr + bw->target_word_len;               /* start dptr at last char of word in dictionary */
+                  tptr >= bw->target_word && *tptr == *dptr;        /* while chars match up to beginning of word */
+                  --tptr, --dptr);                                  /* move back a char */
+            if (tptr < bw->target_word)                /* word found */
+            {
+               bw->found = TRUE;
+               *pp = bw->next;
+               --pending;
+            }
+            else pp = &bw->next;
+         }
+      }
+      lbptr += *lbptr + 1;                  /* move to next word */
+   }
+}
+
+int dic_lookup_words(struct edx_session *ses, struct edx_wordref *words, int nwords, int *status)
+{
+   struct edx_dictionary *dic = ses->dic;
+   struct batch_word *batch;
+   struct batch_word *bw;
+   struct batch_word *chain[MAXWORDLEN+1];   /* words being looked for, by length */
+   struct aux1_view aux1;
+   unsigned char *lbptr;     /* pointer to length-byte of current word */
+   unsigned char *endrange;
+   DWORD wdlen, steps;
+   int n, nbatch, first, last, pending;
+   int result = EDX__WORDFOUND;
+   struct dichead_layout *dichead = dic->dichead;
+
+   if (nwords <= 0) return(EDX__WORDFOUND);
+   batch = new struct batch_word[nwords];
+   if (batch == NULL) return(EDX__ERROR);
+
+/* 1. SETUP EACH WORD AND SEARCH COMMON WORD LIST */
+   for (n = 0, nbatch = 0; n < nwords; ++n)
+   {
+      status[n] = EDX__WORDNOTFOUND;
+      wdlen = (DWORD)words[n].wdlen;
+      if (wdlen == 0) { status[n] = EDX__WORDFOUND; continue; }  /* accept zero length word as OK */
+      if (wdlen > MAXWORDLEN) continue;                          /* Word too long.  Can't possibly be a word. */
+      bw = &batch[nbatch];
+      setup_dicword(dic, wdlen, (unsigned char *)words[n].wdbeg, bw->target_word);
+      bw->target_word_len = wdlen;
+      STAT_ADD(ses, lookups, 1);
+      STAT_ADD(ses, common_bytes, COMMON_SCAN_BYTES(dic, wdlen));
+      if (search_commonwords(dic, bw->target_word, wdlen)) { STAT_ADD(ses, common_hits, 1); status[n] = EDX__WORDFOUND; continue; }
+      STAT_ADD(ses, common_misses, 1);
+      if (dic->bloom != NULL)
+      {
+         ++ses->bloom_lookups;
+         if (!bloom_maybe(dic, bw->target_word, wdlen)) { ++ses->bloom_rejects; continue; }
+      }
+      bw->wordno = n;
+      bw->found = FALSE;
+
+/* 2. FIND THE PAGE RANGE OF EACH WORD, AND SORT */
+      if (dic->mainhash.tab != NULL)   /* hash index built? Then no page walks needed */
+      {
+         bw->found = search_word_hash(&dic->mainhash, bw->target_word, wdlen);
+         bw->low = bw->high = 0;
+         bw->endrange = dic->diclexdba;
+      }
+      else
+      {
+         steps = binsrch_maindic( dic, &bw->low, &bw->high, bw->target_word );
+         STAT_ADD(ses, binsrch_calls, 1);
+         STAT_ADD(ses, binsrch_steps, steps);
+         STAT_ADD(ses, binsrch_span, bw->high - bw->low);
+         STAT_MAX(ses, binsrch_maxspan, bw->high - bw->low);
+         bw->endrange = dic->diclexdba + (bw->high * dichead->dicpln);
+         if (dic->frontcoded)             /* front coded pages are searched a word at a time */
+         {
+            STAT_ADD(ses, page_scans, 1);
+            STAT_ADD(ses, page_bytes, (bw->high - bw->low) * dichead->dicpln);
+            bw->found = fc_search_pages(dic, bw->low, bw->high, bw->target_word, wdlen);
+         }
+      }
+      ++nbatch;
+   }
+   qsort(batch, nbatch, sizeof(struct batch_word), compare_batch_words);
+   for (n = 0; n < nbatch; ++n)
+      batch[n].duplicate = (n > 0 && compare_batch_words(&batch[n], &batch[n-1]) == 0);
+
+/* 3. WALK THE PAGES ONCE FOR ALL WORDS STARTING ON THE SAME PAGE */
+   for (first = 0; first < nbatch; first = last)
+   {
+      memset(chain, 0, sizeof(chain));
+      endrange = batch[first].endrange;
+      pending = 0;
+      for (last = first; last < nbatch && batch[last].low == batch[first].low; ++last)
+      {
+         bw = &batch[last];
+         if (bw->duplicate || bw->found) continue;
+         bw->next = chain[bw->target_word_len];
+         chain[bw->target_word_len] = bw;
+         ++pending;
+         if (bw->endrange > endrange) endrange = bw->endrange;
+      }
+      for ( lbptr = dic->diclexdba + (batch[first].low * dichead->dicpln); *lbptr > 31; ++lbptr);  /* find a length-byte */
+      if (pending == 0) continue;
+      if (endrange > lbptr) { STAT_ADD(ses, page_scans, 1); STAT_ADD(ses, page_bytes, endrange - lbptr); }
+      walk_for_batch(lbptr, endrange, chain, pending);
+   }
+
+/* 4. WALK THE USER'S PERSONAL AUX1 DICTIONARY ONCE FOR THE REST (OR LOOK THEM UP IN ITS HASH INDEX) */
+   aux1_view(dic, &aux1);
+   if (aux1.hash.tab != NULL)
+   {
+      for (n = 0; n < nbatch; ++n)
+      {
+         bw = &batch[n];
+         if (bw->duplicate || bw->found) continue;
+         STAT_ADD(ses, aux1_searches, 1);
+         bw->found = search_word_hash(&aux1.hash, bw->target_word, bw->target_word_len);
+      }
+   }
+   else if (aux1.base != NULL)  //If there is a user's personal Aux1 dictionary
+   {
+      memset(chain, 0, sizeof(chain));
+      pending = 0;
+      for (n = 0; n < nbatch; ++n)
+      {
+         bw = &batch[n];
+         if (bw->duplicate || bw->found) continue;
+         bw->endrange = NULL;
+         bw->next = chain[bw->target_word_len];
+         chain[bw->target_word_len] = bw;
+         ++pending;
+      }
+      STAT_ADD(ses, aux1_searches, pending);
+      if (pending > 0) STAT_ADD(ses, aux1_bytes, aux1.len);
+      walk_for_batch(aux1.base, aux1.base + aux1.len, chain, pending);
+   }
+
+   for (n = 0; n < nbatch; ++n)
+   {
+      bw = &batch[n];
+      if (bw->duplicate) bw->found = batch[n-1].found;
+      if (bw->found) status[bw->wordno] = EDX__WORDFOUND;
+   }
+   delete[] batch;
+
+   for (n = 0; n < nwords; ++n)
+      if (status[n] != EDX__WORDFOUND) result = EDX__WORDNOTFOUND;
+   return(result);
+}
+
+/*===============================================================================
+ * Fills in the session's dic_lwa with word, dic_lwl with word length,
+ * Resets GMODE and GOF for possible call to spell guess
+ * and looks the word up in the session's dictionary.
+ *===============================================================================*/
+int session_lookup_word(struct edx_session *ses, char *spellword)
+{
+   int status;
+
+   LAT_START(ses);
+   ses->gof = 0;                       /* reset GMODE and GOF, incase we start spell guessing */
+   ses->gmode = GUSREV;
+   free_guesses(ses);                  /* guesses for the last word are no good now */
+   strncpy( (char *)ses->dic_lwa,spellword,MAXWORDLEN);
+   ses->dic_lwl = strlen(spellword);
+   if (ses->dic_lwl > MAXWORDLEN) { ses->gmode = GIVEUP; }  /* too long to be a word, and too long for dic_lwa. Don't guess. */
+   status = dic_lookup_word(ses, ses->dic_lwl, ses->dic_lwa);
+   LAT_END(ses, LAT_LOOKUP, ses->dic_lwl);
+   return(status);
+}
+
+/*===============================================================================
+ * Main entry point. Fills in default session's dic_lwa with word, dic_lwl with word length,
+ * Resets GMODE and GOF for possible call to edx$spell_guess
+ Functional Description:
+    Searches the EDX dictionary for a given word
+
+ Calling Sequence:
+    status = edx$dic_lookup_word(char *spellword, char *errbuf, int errbuflen, char *Dic_File_Name, char *Aux1_File_Name);
+
+ Argument inputs:
+    spellword - word to check spelling of
+    errbuf - buffer to put any error message in to return to caller (let caller display it)
+    errbuflen - length of errbuf.
+    Dic_File_Name - name of EDX dictionary file to pass to Spell_Init
+    Aux1_File_Name - name of user's personal dictionary file to pass to Spell_Init.
+                     May be NULL "" if user does not have a personal dictionary file.
+                     A user's personal dictionary file is a plain text file with
+                     one word per line. This file is checked when spell checking
+                     and when spell guessing.
+
+ Outputs:
+    status = EDX__WORDFOUND - word was found
+           = EDX__WORDNOTFOUND - word was not found
+           = EDX__ERROR - an error was encountered. Error text returned in 'errbuf'
+ *===============================================================================*/
+extern "C" _declspec (dllexport) int edx$dic_lookup_word(char *spellword, char *errbuf, int errbuflen, char *Dic_File_Name, char *Aux1_File_Name)
+{
+ int status;
+
+ __try
+ {
+   if (!spell_init(Dic_File_Name,Aux1_File_Name,errbuf,errbuflen)) { return(EDX__ERROR); }
+   session_enter(&default_session, TRUE);
+   status = session_lookup_word(&default_session, spellword);
+   session_leave(&default_session, status == EDX__WORDNOTFOUND && default_session.gmode != GIVEUP);
+   return(status);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   session_leave(&default_session, FALSE);
+   return(EDX__ERROR);
+ }
+}
+/*===============================================================================
+ * Batch entry point. Looks up nwords words at once in the default dictionary.
+ * Does not change the word edx$spell_guess will guess.
+
+ Calling Sequence:
+    result = edx$dic_lookup_words(struct edx_wordref *words, int nwords, int *status,
+                                  char *errbuf, int errbuflen, char *Dic_File_Name, char *Aux1_File_Name);
+
+ Argument inputs:
+    words - array of nwords (pointer, length) words to check spelling of
+    nwords - number of words
+    errbuf, errbuflen, Dic_File_Name, Aux1_File_Name - same as edx$dic_lookup_word
+
+ Outputs:
+    status - array of nwords. status[n] = EDX__WORDFOUND or EDX__WORDNOTFOUND
+             for words[n], exactly as edx$dic_lookup_word would return.
+    result = EDX__WORDFOUND - every word was found
+           = EDX__WORDNOTFOUND - at least one word was not found
+           = EDX__ERROR - an error was encountered. Error text returned in 'errbuf'
+ *===============================================================================*/
+int session_lookup_words(struct edx_session *ses, struct edx_wordref *words, int nwords, int *status, char *errbuf, int errbuflen)
+{
+   int result = dic_lookup_words(ses, words, nwords, status);
+   if (result == EDX__ERROR)
+   {
+     _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+     errbuf[errbuflen-1] = '\0';
+   }
+   return(result);
+}
+
+extern "C" _declspec (dllexport) int edx$dic_lookup_words(struct edx_wordref *words, int nwords, int *status, char *errbuf, int errbuflen, char *Dic_File_Name, char *Aux1_File_Name)
+{
+ int result;
+ BOOL guessing = FALSE;
+
+ __try
+ {
+   if (!spell_init(Dic_File_Name,Aux1_File_Name,errbuf,errbuflen)) { return(EDX__ERROR); }
+   guessing = default_session.guessing;
+   session_enter(&default_session, FALSE);
+   result = session_lookup_words(&default_session, words, nwords, status, errbuf, errbuflen);
+   session_leave(&default_session, guessing);
+   return(result);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   session_leave(&default_session, guessing);
+   return(EDX__ERROR);
+ }
+}
+/*--------------------------------------------------------------------------
+    .SUBTITLE SPELL_GUESS
+
+ Functional Description:
+    Guesses the spelling of misspelled word stored in DIC_LWA,DIC_LWL.
+    Algorythm taken from the very popular Vassar Spelling Checker.
+    With credit to Vassar where credit is due.
+
+    Every guess is the misspelled word with one mistake undone. We make all
+    of the guesses at once into a guess list, drop the duplicates, and look
+    the rest up with one call to dic_lookup_words. The guesses which are
+    words are then ranked: words on the common word list first, then in the
+    order the tests below are made in.
+
+ Outline:
+    1.  spell_gusrev   Reversals   (test for transposed characters)
+    2.  spell_gusvol   vowels      (test for wrong vowel used)
+    3.  spell_gusmin   minus chars (test for extra character in word)
+    4.  spell_guspls   plus chars  (test for character missing from word)
+    5.  spell_guscon   consonants  (test for wrong character used)
+    6.  give up     (give up)
+
+Updated 11/03/2006
+ I defined Extended_ANSI_Guessing. If TRUE, spell guessing will use
+ those extended characters with accents in spell guessing.
+ Characters such as                                   
+
+
+---------------------------------------------------------------------------*/
+
+/* Put guess word guess_word,len on guess list gl, unless it's already on
+   it (ignoring case). The word lowercased must be in the lower[] of the
+   next free guess already, and hash is its hash_word(). Returns the guess,
+   or NULL if it was already on the list. */
+struct guess_cand *enter_guess(struct guess_list *gl, unsigned char *guess_word, DWORD len, DWORD hash, DWORD gmode, DWORD order)
+{
+   struct guess_cand *gc = &gl->cand[gl->ncand];
+   struct guess_cand *prev;
+   DWORD h;
+
+   for (h = hash & gl->seenmask; gl->seen[h] != 0; h = (h + 1) & gl->seenmask)
+   {
+      prev = &gl->cand[gl->seen[h] - 1];
+      if (prev->len == len && memcmp(prev->lower, gc->lower, len) == 0) return(NULL);
+   }
+   gl->seen[h] = ++gl->ncand;
+
+   memcpy(gc->word, guess_word, len);
+   gc->word[len] = '\0';
+   gc->len = len;
+   gc->dist = 1;
+   gc->gmode = gmode;
+   gc->order = order;
+   gc->common = FALSE;
+   return(gc);
+}
+
+/* Add guess word guess_word,len made by test gmode (GUSREV...GUSCON) to the
+   session's guess list, unless the Bloom filter says it isn't a word or it's
+   already on the list (ignoring case) */
+void add_guess(struct edx_session *ses, unsigned char *guess_word, DWORD len, DWORD gmode)
+{
+   struct guess_list *gl = &ses->guesses;
+   struct guess_cand *gc;
+   DWORD i;
+   DWORD hash;
+
+   if (len == 0 || len > MAXWORDLEN) return;   /* can't be a word in the dictionary */
+   if (gl->ncand >= gl->maxcand) return;       /* (should never happen) */
+   STAT_ADD(ses, guess_lookups[gmode], 1);
+   gc = &gl->cand[gl->ncand];
+   for (i = 0; i < len; ++i) gc->lower[i] = ANSItolower(guess_word[i]);
+   hash = hash_word(gc->lower, len);
+   if (ses->dic->bloom != NULL)
+   {
+      ++ses->bloom_lookups;
+      if (!bloom_maybe_hash(ses->dic, hash)) { ++ses->bloom_rejects; return; }
+   }
+   enter_guess(gl, guess_word, len, hash, gmode, gl->ncand);
+}
+
+void spell_gusrev(struct edx_session *ses)
+{
+   unsigned char guess_word[MAXWORDLEN+2];
+   unsigned char temp;
+   DWORD gof;
+
+   /* Guess reversals.
+      Copy word and transpose x with x+1 */
+   for (gof = 0; gof+1 < ses->dic_lwl; ++gof)
+   {
+      if (ses->dic_lwa[gof] != ses->dic_lwa[gof+1]) /* don't swap if characters are identical */
+      {
+         memcpy(guess_word,ses->dic_lwa,ses->dic_lwl); /* copy over word */
+         temp = guess_word[gof];          /* swap chars */
+         guess_word[gof] = guess_word[gof+1];
+         guess_word[gof+1] = temp;
+         add_guess(ses, guess_word, ses->dic_lwl, GUSREV);
+      }
+   }
+}
+/*-------------------------------------------------------------------------------*/
+/* Vowels spell_gusvol replaces a vowel with. The first 5 always, the rest only
+   if Extended_ANSI_Guessing. (AE, C_WITH_CEDILLA, ETH, N_WITH_TILDE, the
+   division sign, Y_WITH_ACUTE, THORN and Y_WITH_DIAERESIS are not used.) */
+static const unsigned char guess_vowels[] = {
+   'a', 'e', 'i', 'o', 'u',
+   A_WITH_GRAVE, A_WITH_ACUTE, A_WITH_CIRCUMFLEX, A_WITH_TILDE, A_WITH_DIAERESIS, A_WITH_RING_ABOVE,
+   E_WITH_GRAVE, E_WITH_ACUTE, E_WITH_CIRCUMFLEX, E_WITH_DIAERESIS,
+   I_WITH_GRAVE, I_WITH_ACUTE, I_WITH_CIRCUMFLEX, I_WITH_DIAERESIS,
+   O_WITH_GRAVE, O_WITH_ACUTE, O_WITH_CIRCUMFLEX, O_WITH_TILDE, O_WITH_DIAERESIS, O_WITH_STROKE,
+   U_WITH_GRAVE, U_WITH_ACUTE, U_WITH_CIRCUMFLEX, U_WITH_DIAERESIS
+};
+#define NUM_GUESS_VOWELS (sizeof(guess_vowels)/sizeof(guess_vowels[0]))
+
+void spell_gusvol(struct edx_session *ses)
+{
+   struct edx_dictionary *dic = ses->dic;
+   unsigned char guess_word[MAXWORDLEN+2];
+   DWORD gof;
+   DWORD nvowels;
+   DWORD v;
+
+   /* Guess vowel replacements.
+      For each {a,e,i,o,u} replace with {a,e,i,o,u}
+
+      11/03/2006
+      Added dic->Extended_ANSI_Guessing. If defined, then we include all those other
+      extended vowels with accents, and we do
+      For each {a,e,i,o,u} replace with {a,e,i,o,u}
+      (all 29 of guess_vowels[])
+   */
+   nvowels = dic->Extended_ANSI_Guessing ? NUM_GUESS_VOWELS : 5;
+   for (gof = 0; gof < ses->dic_lwl; ++gof)
+   {
+      if ( !ISVOWEL(ses->dic_lwa[gof],dic->Extended_ANSI_Guessing) ) continue;
+      memcpy(guess_word,ses->dic_lwa,ses->dic_lwl); /* copy over word */
+      for (v = 0; v < nvowels; ++v)
+      {
+         if (guess_vowels[v] == ses->dic_lwa[gof]) continue; /* don't replace vowel with same vowel */
+         guess_word[gof] = guess_vowels[v];
+         add_guess(ses, guess_word, ses->dic_lwl, GUSVOL);
+      }
+   }
+}
+/*-------------------------------------------------------------------------------*/
+void spell_gusmin(struct edx_session *ses)
+{
+   unsigned char guess_word[MAXWORDLEN+2];
+   DWORD gof;
+
+   /* Guess minus.  Test for extra character.
+      Try eliding one character at a time */
+   if (ses->dic_lwl < 2) {return;}    /* skip this test if eliding a character would leave us with an empty string */
+   for (gof = 0; gof < ses->dic_lwl; ++gof)
+   {
+      if (gof == 0 || ses->dic_lwa[gof] != ses->dic_lwa[gof-1]) /* skip if prev char = current char. The result would be the same */
+      {                                                         /*  as last time.  (Also check gof==0 first) */
+         memcpy(&guess_word[0],&ses->dic_lwa[0],gof);  /* copy over word */
+         memcpy(&guess_word[gof],&ses->dic_lwa[gof+1],ses->dic_lwl-(gof+1));/* shift GOF'th+1 to end of word left one */
+         add_guess(ses, guess_word, ses->dic_lwl-1, GUSMIN);
+      }
+   }
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Fill in alphabet[] with the letters spell_guspls (plus=TRUE) inserts or
+   spell_guscon overstrikes with, and return how many there are:
+      a-z
+   then if 'dic->Extended_ANSI_Guessing' is TRUE
+      154, 156, 158 (spell_guspls only)
+      223-255, skipping 247 (division sign)
+   (see file "EDX_lowercasing_entended_letters.htm") */
+DWORD guess_alphabet(struct edx_dictionary *dic, BOOL plus, unsigned char *alphabet)
+{
+   DWORD n = 0;
+   DWORD c;
+
+   for (c = 'a'; c <= 'z'; ++c) alphabet[n++] = (unsigned char)c;
+   if (!dic->Extended_ANSI_Guessing) return(n);
+   if (plus)
+   {
+      alphabet[n++] = 154;
+      alphabet[n++] = 156;
+      alphabet[n++] = 158;
+   }
+   for (c = 223; c <= 255; ++c)
+      if (c != 247) alphabet[n++] = (unsigned char)c;
+   return(n);
+}
+#define GUESS_ALPHABET_MAX (26+3+32)
+
+void spell_guspls(struct edx_session *ses)
+{
+   unsigned char guess_word[MAXWORDLEN+2];
+   unsigned char alphabet[GUESS_ALPHABET_MAX];
+   DWORD nletters;
+   DWORD gof;
+   DWORD c;
+
+   /* Guess plus.  Test if a letter is missing from word.  Add one letter anywhere in word. */
+   if (ses->dic_lwl >= MAXWORDLEN) {return;}   /* adding a letter would make it too long to be a word */
+   nletters = guess_alphabet(ses->dic, TRUE, alphabet);
+   for (gof = 0; gof <= ses->dic_lwl; ++gof)
+   {
+      memcpy(&guess_word[0],&ses->dic_lwa[0],gof);  /* copy over word */
+      memcpy(&guess_word[gof+1],&ses->dic_lwa[gof],ses->dic_lwl-gof); /* shift GOF'th to end of word right one */
+
+      for (c = 0; c < nletters; ++c)
+      {
+         if (gof == 0 || alphabet[c] != ses->dic_lwa[gof-1]) /* if extra char being inserted = char it's infront of */
+         {                                                   /*  then don't do it to avoid duplicates */
+            guess_word[gof] = alphabet[c];                   /* insert missing letter */
+            add_guess(ses, guess_word, ses->dic_lwl+1, GUSPLS);
+         }
+      }
+   }
+}
+
+/*-------------------------------------------------------------------------------*/
+void spell_guscon(struct edx_session *ses)
+{
+   struct edx_dictionary *dic = ses->dic;
+   unsigned char guess_word[MAXWORDLEN+2];
+   unsigned char alphabet[GUESS_ALPHABET_MAX];
+   DWORD nletters;
+   DWORD gof;
+   DWORD c;
+
+   /* Guess consonants.  Test for any one character wrong.
+      Replace each character with every other character of the alphabet
+      We've already tried replacing vowel characters with other vowel characters,
+      so skip if our replacement character is a vowel.
+      Also skip if our guess character is the same as the original character.
+   */
+   nletters = guess_alphabet(dic, FALSE, alphabet);
+   for (gof = 0; gof < ses->dic_lwl; ++gof)
+   {
+      memcpy(guess_word,ses->dic_lwa,ses->dic_lwl); /* copy over word */
+      for (c = 0; c < nletters; ++c)
+      {
+         if (   (alphabet[c] != ses->dic_lwa[gof])       /* if overstrike char != original char */
+             && ( !ISVOWEL(alphabet[c],dic->Extended_ANSI_Guessing) ) /* and overstrike char isn't a vowel */
+            )
+         {
+            guess_word[gof] = alphabet[c];          /* overstrike with another letter */
+            add_guess(ses, guess_word, ses->dic_lwl, GUSCON);
+         }
+      }
+   }
+}
+
+/*-------------------------------------------------------------------------------*/
+/* Make room on the session's guess list for every guess the tests can make
+   for a word of length L, plus extra more */
+BOOL alloc_guesses(struct edx_session *ses, DWORD L, DWORD extra)
+{
+   struct guess_list *gl = &ses->guesses;
+   DWORD nseen;
+
+   gl->maxcand = L                               /* reversals */
+               + NUM_GUESS_VOWELS * L            /* vowels */
+               + L                               /* minus */
+               + GUESS_ALPHABET_MAX * (L+1)      /* plus */
+               + GUESS_ALPHABET_MAX * L          /* consonants */
+               + extra;
+   for (nseen = 64; nseen < 2 * gl->maxcand; nseen <<= 1);   /* keep hash table under half full */
+   gl->cand = new struct guess_cand[gl->maxcand];
+   gl->seen = new DWORD[nseen];
+   if (gl->cand == NULL || gl->seen == NULL) { free_guesses(ses); return(FALSE); }
+   memset(gl->seen, 0, nseen * sizeof(DWORD));
+   gl->seenmask = nseen - 1;
+   return(TRUE);
+}
+
+/* qsort comparison: rank guesses. Fewest edits first, then common words,
+   then by the test that made them (GUSREV first), then in the order made */
+int compare_guess_rank(const void *a, const void *b)
+{
+   const struct guess_cand *ga = (const struct guess_cand *)a;
+   const struct guess_cand *gb = (const struct guess_cand *)b;
+
+   if (ga->dist != gb->dist) return( (ga->dist < gb->dist) ? -1 : 1 );
+   if (ga->common != gb->common) return( ga->common ? -1 : 1 );
+   if (ga->gmode != gb->gmode) return( (ga->gmode < gb->gmode) ? -1 : 1 );
+   return( (ga->order < gb->order) ? -1 : (ga->order > gb->order) );
+}
+
+/*--------------------------------------------------------------------------
+    .SUBTITLE MAKE_GUESS_LIST
+
+ Functional Description:
+    Makes the session's guess list for the misspelled word in DIC_LWA,DIC_LWL.
+    (vassar_guess_list. If the dictionary has a suggestion index,
+    sym_guess_list makes it instead. If EDX_OPT_LEVENSHTEIN is set,
+    lev_guess_list. If it has a word graph, dwg_guess_list. If the word
+    is in the guess cache, the guesses kept there.)
+
+ Outputs:
+    ses->guesses holds the guesses which are words, best guess first.
+    result = EDX__WORDFOUND - at least one guess is a word
+           = EDX__WORDNOTFOUND - no guesses
+           = EDX__ERROR - memory allocation failure
+
+ Outline:
+    1.  Every test (spell_gusrev ... spell_guscon) adds its guesses to the
+        guess list. Most guesses aren't words, and the Bloom filter keeps
+        them off the list. A small hash table of the guesses made so far
+        keeps a guess off the list if it's already on it, ignoring case
+        (e.g. "Teh" -> "teh" by overstriking the "T").
+
+    2.  The rest are looked up with one call to dic_lookup_words, and
+        the guesses which are words are checked against the common word list.
+
+    3.  The guesses which are words are sorted by compare_guess_rank.
+---------------------------------------------------------------------------*/
+int vassar_guess_list(struct edx_session *ses)
+{
+   struct edx_dictionary *dic = ses->dic;
+   struct guess_list *gl = &ses->guesses;
+   struct edx_wordref *words;
+   int *status;
+   unsigned char target_word[MAXWORDLEN+1];
+   unsigned char lwa_lower[MAXWORDLEN+1];
+   DWORD L = ses->dic_lwl;
+   DWORD i, n;
+
+   free_guesses(ses);
+   if (L > MAXWORDLEN) return(EDX__WORDNOTFOUND);    /* too long to be a word. Don't guess. */
+
+   /* 1. Make every guess */
+   if (!alloc_guesses(ses, L, 0)) return(EDX__ERROR);
+   spell_gusrev(ses);
+   spell_gusvol(ses);
+   spell_gusmin(ses);
+   spell_guspls(ses);
+   spell_guscon(ses);
+   delete[] gl->seen;
+   gl->seen = NULL;
+   if (gl->ncand == 0) return(EDX__WORDNOTFOUND);
+
+   /* 2. Look them all up at once */
+   words = new struct edx_wordref[gl->ncand];
+   status = new int[gl->ncand];
+   if (words == NULL || status == NULL)
+   {
+      if (words)  { delete[] words; }
+      if (status) { delete[] status; }
+      free_guesses(ses);
+      return(EDX__ERROR);
+   }
+   for (i = 0; i < gl->ncand; ++i)
+   {
+      words[i].wdbeg = (char *)gl->cand[i].word;
+      words[i].wdlen = gl->cand[i].len;
+   }
+   if (dic_lookup_words(ses, words, gl->ncand, status) == EDX__ERROR)
+   {
+      delete[] words;
+      delete[] status;
+      free_guesses(ses);
+      return(EDX__ERROR);
+   }
+   setup_dicword(dic, L, ses->dic_lwa, lwa_lower);   /* misspelled word lowercased */
+   for (i = n = 0; i < gl->ncand; ++i)
+   {
+      if (status[i] != EDX__WORDFOUND) continue;
+      if (gl->cand[i].len == L && memcmp(gl->cand[i].lower, lwa_lower, L) == 0) continue; /* only changed case. Not a guess. */
+      if (n != i) gl->cand[n] = gl->cand[i];
+      setup_dicword(dic, gl->cand[n].len, gl->cand[n].word, target_word);
+      gl->cand[n].common = search_commonwords(dic, target_word, gl->cand[n].len);
+      ++n;
+   }
+   gl->ncand = n;
+   delete[] words;
+   delete[] status;
+
+   /* 3. Best guess first */
+   if (gl->ncand > 1) qsort(gl->cand, gl->ncand, sizeof(struct guess_cand), compare_guess_rank);
+   return( (gl->ncand > 0) ? EDX__WORDFOUND : EDX__WORDNOTFOUND );
+}
+
+/*--------------------------------------------------------------------------
+    .SUBTITLE SYM_GUESS_LIST
+
+ Functional Description:
+    Makes the session's guess list for the misspelled word in DIC_LWA,DIC_LWL
+    from the suggestion index (see SYMMETRIC DELETE SUGGESTION INDEX):
+    every word up to maxdist edits away, where an edit is a character
+    inserted, deleted or replaced, or two characters side by side swapped.
+
+ Outputs:
+    Same as make_guess_list.
+
+ Outline:
+    1.  The deletes of the misspelled word are hashed, and the words
+        recorded under each hash are gathered up.
+
+    2.  They're gathered up, dropping duplicates (a word one edit away
+        shares several deletes with the misspelled word).
+
+    3.  The edit distance of each from the misspelled word is worked out,
+        and the ones within maxdist are put on the guess list. (Most of
+        them are. The rest just had a hash in common.)
+
+    4.  The user's personal Aux1 words aren't in the index, so their
+        edit distance is worked out one by one. (There aren't many.)
+
+    5.  The guesses are given the misspelled word's capitals, and sorted
+        by compare_guess_rank. Guesses one edit away are ranked by the
+        spell guessing test that would have made them (guess_test).
+---------------------------------------------------------------------------*/
+
+/* Edit distance between a,la and b,lb: the fewest characters inserted,
+   deleted or replaced, or pairs of characters side by side swapped, that
+   turn one into the other. Gives up and returns maxdist+1 as soon as it's
+   sure the distance is more than maxdist. */
+DWORD edit_distance(unsigned char *a, DWORD la, unsigned char *b, DWORD lb, DWORD maxdist)
+{
+   DWORD rows[3][MAXWORDLEN+2];
+   DWORD *prev2, *prev, *cur, *temp;
+   DWORD i, j, d, best;
+
+   if (la > lb + maxdist || lb > la + maxdist) return(maxdist+1);
+   prev2 = rows[0]; prev = rows[1]; cur = rows[2];
+   for (j = 0; j <= lb; ++j) prev[j] = j;
+   for (i = 1; i <= la; ++i)
+   {
+      cur[0] = best = i;
+      for (j = 1; j <= lb; ++j)
+      {
+         d = prev[j-1] + (a[i-1] != b[j-1]);                    /* replace (or match) */
+         if (prev[j] + 1 < d) d = prev[j] + 1;                   /* delete */
+         if (cur[j-1] + 1 < d) d = cur[j-1] + 1;                 /* insert */
+         if (   i > 1 && j > 1 && a[i-1] == b[j-2] && a[i-2] == b[j-1]
+             && prev2[j-2] + 1 < d) d = prev2[j-2] + 1;          /* swap */
+         cur[j] = d;
+         if (d < best) best = d;
+      }
+      if (best > maxdist) return(maxdist+1);   /* can't get any smaller from here */
+      temp = prev2; prev2 = prev; prev = cur; cur = temp;
+   }
+   return( (prev[lb] <= maxdist) ? prev[lb] : maxdist+1 );
+}
+
+/* Which spell guessing test (GUSREV ... GUSCON) would have made word b,lb
+   from misspelled word a,la, when they're one edit apart. So guesses from
+   the suggestion index are ranked the way spell guessing ranks them. */
+DWORD guess_test(unsigned char *a, DWORD la, unsigned char *b, DWORD lb, BOOL ext)
+{
+   DWORD i;
+
+   if (lb < la) return(GUSMIN);
+   if (lb > la) return(GUSPLS);
+   for (i = 0; i < la && a[i] == b[i]; ++i);          /* find the first difference */
+   if (i+1 < la && a[i] == b[i+1] && a[i+1] == b[i]) return(GUSREV);
+   if (ISVOWEL(a[i],ext) && ISVOWEL(b[i],ext)) return(GUSVOL);
+   return(GUSCON);
+}
+
+/* Add dictionary word (lowercase) wdbeg,wdlen, dist edits from the
+   misspelled word, to the guess list. order is its place in the dictionary. */
+void add_sym_guess(struct guess_list *gl, unsigned char *wdbeg, DWORD wdlen, DWORD dist, DWORD gmode, DWORD order, BOOL common)
+{
+   struct guess_cand *gc = &gl->cand[gl->ncand++];
+
+   memcpy(gc->word, wdbeg, wdlen);
+   gc->word[wdlen] = '\0';
+   memcpy(gc->lower, wdbeg, wdlen);
+   gc->len = wdlen;
+   gc->dist = dist;
+   gc->gmode = gmode;
+   gc->order = order;
+   gc->common = common;
+}
+
+/* Give guess word gc the capitals of the misspelled word: all capitals
+   if it's all capitals, or a capital first letter */
+void match_case(struct guess_cand *gc, unsigned char *lwa, DWORD lwl)
+{
+   DWORD i, ncaps;
+
+   for (i = ncaps = 0; i < lwl; ++i)
+      if (ANSItolower(lwa[i]) != lwa[i]) ++ncaps;
+   if (ncaps == 0) return;
+   if (ncaps == lwl && lwl > 1)
+   {
+      for (i = 0; i < gc->len; ++i) gc->word[i] = ANSItoupper(gc->word[i]);
+   }
+   else if (ANSItolower(lwa[0]) != lwa[0])
+   {
+      gc->word[0] = ANSItoupper(gc->word[0]);
+   }
+}
+
+int sym_guess_list(struct edx_session *ses, DWORD maxdist)
+{
+   struct edx_dictionary *dic = ses->dic;
+   struct guess_list *gl = &ses->guesses;
+   unsigned char word[MAXWORDLEN+1];    /* misspelled word lowercased */
+   unsigned char target_word[MAXWORDLEN+1];
+   DWORD hashes[SYM_MAX_DELETES];
+   DWORD first[SYM_MAX_DELETES];        /* postings of each delete */
+   DWORD end[SYM_MAX_DELETES];
+   DWORD *refs = NULL;
+   DWORD *seen = NULL;
+   DWORD nrefs, npostings, nseen;
+   DWORD L = ses->dic_lwl;
+   DWORD ndel, d, b, lo, hi, mid, dist, i, h, n, naux1;
+   struct aux1_view aux1;
+   unsigned char *lbptr;
+
+   free_guesses(ses);
+   if (L == 0 || L > MAXWORDLEN) return(EDX__WORDNOTFOUND);    /* too long to be a word. Don't guess. */
+   if (maxdist > dic->sym->maxdist) maxdist = dic->sym->maxdist;
+   for (i = 0; i < L; ++i) word[i] = ANSItolower(ses->dic_lwa[i]);
+
+   /* 1. Find the words recorded under each delete of the misspelled word */
+   ndel = sym_deletes(word, L, maxdist, hashes);
+   for (d = 0, npostings = 0; d < ndel; ++d)
+   {
+      first[d] = end[d] = 0;
+      b = hashes[d] >> (32 - SYM_DIR_BITS);
+      for (lo = dic->symdir[b], hi = dic->symdir[b+1]; lo < hi; )    /* binary search of this group's keys */
+      {
+         mid = (lo + hi) / 2;
+         if (dic->symkeys[mid].hash < hashes[d]) lo = mid + 1;
+         else hi = mid;
+      }
+      if (lo >= dic->symdir[b+1] || dic->symkeys[lo].hash != hashes[d]) continue;
+      first[d] = dic->symkeys[lo].first;
+      end[d] = dic->symkeys[lo+1].first;
+      if (end[d] <= first[d] || end[d] > dic->sym->npostings) { first[d] = end[d] = 0; continue; }
+      npostings += end[d] - first[d];
+   }
+
+   /* 2. Gather them up, dropping duplicates with a small hash table */
+   for (nseen = 64; nseen < 2 * npostings; nseen <<= 1);   /* keep hash table under half full */
+   refs = new DWORD[npostings + 1];
+   seen = new DWORD[nseen];
+   if (refs == NULL || seen == NULL)
+   {
+      if (refs) { delete[] refs; }
+      if (seen) { delete[] seen; }
+      return(EDX__ERROR);
+   }
+   memset(seen, 0, nseen * sizeof(DWORD));
+   for (d = 0, nrefs = 0; d < ndel; ++d)
+   {
+      for (i = first[d]; i < end[d]; ++i)
+      {
+         for (h = bloom_mix(dic->sympost[i]) & (nseen - 1); seen[h] != 0; h = (h + 1) & (nseen - 1))
+            if (seen[h] == dic->sympost[i] + 1) break;
+         if (seen[h] != 0) continue;                  /* already have it */
+         seen[h] = dic->sympost[i] + 1;
+         refs[nrefs++] = dic->sympost[i];
+      }
+   }
+   delete[] seen;
+
+   aux1_view(dic, &aux1);
+   naux1 = (aux1.base != NULL) ? count_words(aux1.base, aux1.base + aux1.len) : 0;
+   gl->maxcand = nrefs + naux1;
+   if (gl->maxcand == 0) return(EDX__WORDNOTFOUND);
+   gl->cand = new struct guess_cand[gl->maxcand];
+   if (gl->cand == NULL) { delete[] refs; gl->maxcand = 0; return(EDX__ERROR); }
+
+   /* 3. Keep the ones within maxdist. (Distance 0 is the misspelled word in other capitals. Not a guess.) */
+   for (i = 0; i < nrefs; ++i)
+   {
+      lbptr = sym_word(dic, refs[i]);
+      if (lbptr == NULL || *lbptr == 0 || *lbptr > MAXWORDLEN) continue;
+      dist = edit_distance(word, L, lbptr + 1, *lbptr, maxdist);
+      if (dist == 0 || dist > maxdist) continue;
+      add_sym_guess(gl, lbptr + 1, *lbptr, dist,
+                    (dist == 1) ? guess_test(word, L, lbptr + 1, *lbptr, dic->Extended_ANSI_Guessing) : 0,
+                    refs[i], (refs[i] & SYM_COMMON) != 0);
+   }
+   delete[] refs;
+
+   /* 4. The user's personal Aux1 words */
+   if (aux1.base != NULL)
+   {
+      for ( lbptr = aux1.base;
+            lbptr < aux1.base + aux1.len && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+            lbptr += *lbptr + 1 )
+      {
+         dist = edit_distance(word, L, lbptr + 1, *lbptr, maxdist);
+         if (dist == 0 || dist > maxdist) continue;
+         for (n = 0; n < gl->ncand; ++n)       /* already have it from the main dictionary? */
+            if (gl->cand[n].len == *lbptr && memcmp(gl->cand[n].lower, lbptr + 1, *lbptr) == 0) break;
+         if (n == gl->ncand)
+            add_sym_guess(gl, lbptr + 1, *lbptr, dist,
+                          (dist == 1) ? guess_test(word, L, lbptr + 1, *lbptr, dic->Extended_ANSI_Guessing) : 0,
+                          0xFFFFFFFF, FALSE);
+      }
+   }
+
+   /* 5. Capitals, and best guess first */
+   for (n = 0; n < gl->ncand; ++n)
+   {
+      if (!gl->cand[n].common)
+      {
+         setup_dicword(dic, gl->cand[n].len, gl->cand[n].lower, target_word);
+         gl->cand[n].common = search_commonwords(dic, target_word, gl->cand[n].len);
+      }
+      match_case(&gl->cand[n], ses->dic_lwa, L);
+   }
+   if (gl->ncand > 1) qsort(gl->cand, gl->ncand, sizeof(struct guess_cand), compare_guess_rank);
+   return( (gl->ncand > 0) ? EDX__WORDFOUND : EDX__WORDNOTFOUND );
+}
+
+/*--------------------------------------------------------------------------
+    .SUBTITLE DWG_GUESS_LIST
+
+ Functional Description:
+    Makes the session's guess list for the misspelled word in DIC_LWA,DIC_LWL
+    by walking the word graph (see WORD GRAPH). Makes exactly the guesses
+    vassar_guess_list does, ranked the same way, but only tries a guess if
+    the word graph has a word starting with the characters before the one
+    the test changes.
+
+ Outputs:
+    Same as make_guess_list.
+
+ Outline:
+    1.  Walk the graph along the misspelled word, noting the node reached
+        after each character, until no word starts that way.
+
+    2.  Each test (as spell_gusrev ... spell_guscon) goes through the places
+        in the word it can change up to there. From the node reached before
+        that place, it only tries the characters the node has edges for,
+        then walks the rest of the word. A guess is a word if the walk ends
+        on a node that ends a word.
+
+    3.  The user's personal Aux1 words aren't in the graph, so each is
+        checked against the misspelled word (dwg_aux1_guess).
+
+    4.  The guesses are sorted by compare_guess_rank. Each guess's order is
+        its place in the word and the character put there, which sorts the
+        same as the order the tests make guesses in.
+---------------------------------------------------------------------------*/
+
+/* Node of the word graph reached from node n by character c (DWG_NONE if none) */
+DWORD dwg_child(struct edx_dictionary *dic, DWORD n, DWORD c)
+{
+   DWORD e, end, label;
+
+   if (n == DWG_NONE) return(DWG_NONE);
+   for (e = dic->dwgnode[n] >> 2, end = dic->dwgnode[n+1] >> 2; e < end; ++e)
+   {
+      label = dic->dwgedge[e] & 0xFF;
+      if (label == c) return(dic->dwgedge[e] >> 8);
+      if (label > c) break;                   /* edges are in character order */
+   }
+   return(DWG_NONE);
+}
+
+/* Node of the word graph reached from node n by characters s,len. Returns
+   its DWG_WORD and DWG_COMMON flags, 0 if no word ends there. */
+DWORD dwg_walk(struct edx_dictionary *dic, DWORD n, unsigned char *s, DWORD len)
+{
+   DWORD i;
+
+   for (i = 0; i < len && n != DWG_NONE; ++i) n = dwg_child(dic, n, s[i]);
+   return( (n != DWG_NONE) ? (dic->dwgnode[n] & (DWG_WORD | DWG_COMMON)) : 0 );
+}
+
+/* Fill in okchar[] with which characters spell_gusvol, spell_guspls and spell_guscon put in a word */
+void guess_chars(struct edx_dictionary *dic, unsigned char *okchar)
+{
+   unsigned char alphabet[GUESS_ALPHABET_MAX];
+   DWORD n, i;
+
+   memset(okchar, 0, 256);
+   n = dic->Extended_ANSI_Guessing ? NUM_GUESS_VOWELS : 5;
+   for (i = 0; i < n; ++i) okchar[guess_vowels[i]] |= DWG_OK_VOWEL;
+   n = guess_alphabet(dic, TRUE, alphabet);
+   for (i = 0; i < n; ++i) okchar[alphabet[i]] |= DWG_OK_PLUS;
+   n = guess_alphabet(dic, FALSE, alphabet);
+   for (i = 0; i < n; ++i)
+      if (!ISVOWEL(alphabet[i],dic->Extended_ANSI_Guessing)) okchar[alphabet[i]] |= DWG_OK_CONSONANT;
+}
+
+/* Add guess word guess_word,len, made by test gmode, to guess list gl
+   unless it's already on it. flags are dwg_walk's for the word. */
+void add_dwg_guess(struct guess_list *gl, unsigned char *guess_word, DWORD len, DWORD gmode, DWORD order, DWORD flags)
+{
+   struct guess_cand *gc;
+   DWORD i;
+
+   if (gl->ncand >= gl->maxcand) return;       /* (should never happen) */
+   gc = &gl->cand[gl->ncand];
+   for (i = 0; i < len; ++i) gc->lower[i] = ANSItolower(guess_word[i]);
+   gc = enter_guess(gl, guess_word, len, hash_word(gc->lower, len), gmode, order);
+   if (gc != NULL) gc->common = (flags & DWG_COMMON) != 0;
+}
+
+/* Is Aux1 word w,wl one of the guesses for the misspelled word (lw is it
+   lowercased)? If so, makes the guess in guess_word, as the first test to
+   make it would, and sets its gmode and order as dwg_guess_list does. */
+BOOL dwg_aux1_guess(struct edx_session *ses, unsigned char *lw, unsigned char *okchar,
+                    unsigned char *w, DWORD wl, unsigned char *guess_word, DWORD *gmode, DWORD *order)
+{
+   unsigned char *lwa = ses->dic_lwa;
+   DWORD L = ses->dic_lwl;
+   DWORD i, j;
+
+   if (wl == L)                                /* reversal, vowel or consonant */
+   {
+      for (i = 0; i < L && lw[i] == w[i]; ++i);          /* first difference */
+      if (i == L) return(FALSE);                         /* same word */
+      for (j = L - 1; lw[j] == w[j]; --j);               /* last difference */
+      memcpy(guess_word, lwa, L);
+      if (j == i+1 && lw[i] == w[j] && lw[j] == w[i])
+      {
+         guess_word[i] = lwa[j];
+         guess_word[j] = lwa[i];
+         *gmode = GUSREV;
+         *order = i << 8;
+         return(TRUE);
+      }
+      if (j != i) return(FALSE);
+      guess_word[i] = w[i];
+      *order = (i << 8) | w[i];
+      if (ISVOWEL(lwa[i],ses->dic->Extended_ANSI_Guessing) && (okchar[w[i]] & DWG_OK_VOWEL)) { *gmode = GUSVOL; return(TRUE); }
+      if (okchar[w[i]] & DWG_OK_CONSONANT) { *gmode = GUSCON; return(TRUE); }
+      return(FALSE);
+   }
+   if (wl + 1 == L)                            /* minus */
+   {
+      for (i = 0; i < L; ++i)
+      {
+         if (memcmp(lw, w, i) != 0) return(FALSE);
+         if (memcmp(lw + i + 1, w + i, L - i - 1) != 0) continue;
+         memcpy(guess_word, lwa, i);
+         memcpy(guess_word + i, lwa + i + 1, L - i - 1);
+         *gmode = GUSMIN;
+         *order = i << 8;
+         return(TRUE);
+      }
+      return(FALSE);
+   }
+   if (wl == L + 1 && L < MAXWORDLEN)          /* plus */
+   {
+      for (i = 0; i <= L; ++i)
+      {
+         if (memcmp(lw, w, i) != 0) return(FALSE);
+         if (memcmp(lw + i, w + i + 1, L - i) != 0) continue;
+         if (!(okchar[w[i]] & DWG_OK_PLUS)) return(FALSE);
+         memcpy(guess_word, lwa, i);
+         guess_word[i] = w[i];
+         memcpy(guess_word + i + 1, lwa + i, L - i);
+         *gmode = GUSPLS;
+         *order = (i << 8) | w[i];
+         return(TRUE);
+      }
+   }
+   return(FALSE);
+}
+
+int dwg_guess_list(struct edx_session *ses)
+{
+   struct edx_dictionary *dic = ses->dic;
+   struct guess_list *gl = &ses->guesses;
+   unsigned char *lwa = ses->dic_lwa;
+   unsigned char lw[MAXWORDLEN+1];             /* misspelled word lowercased */
+   unsigned char okchar[256];
+   unsigned char guess_word[MAXWORDLEN+2];
+   unsigned char target_word[MAXWORDLEN+1];
+   DWORD node[MAXWORDLEN+1];                   /* [i] = node reached by lw[0..i) */
+   DWORD L = ses->dic_lwl;
+   BOOL ext = dic->Extended_ANSI_Guessing;
+   DWORD live, i, e, end, c, flags, naux1, gmode, order;
+   struct aux1_view aux1;
+   struct guess_cand *gc;
+   unsigned char *lbptr;
+
+   free_guesses(ses);
+   if (L > MAXWORDLEN) return(EDX__WORDNOTFOUND);    /* too long to be a word. Don't guess. */
+   aux1_view(dic, &aux1);
+   naux1 = (aux1.base != NULL) ? count_words(aux1.base, aux1.base + aux1.len) : 0;
+   if (!alloc_guesses(ses, L, naux1)) return(EDX__ERROR);
+   for (i = 0; i < L; ++i) lw[i] = ANSItolower(lwa[i]);
+   guess_chars(dic, okchar);
+
+   /* 1. Walk along the misspelled word. node[0..live] are nodes. */
+   node[0] = 0;
+   for (live = 0; live < L; ++live)
+   {
+      node[live+1] = dwg_child(dic, node[live], lw[live]);
+      if (node[live+1] == DWG_NONE) break;
+   }
+
+   /* 2. The tests, in the order spell guessing makes them. Reversals. */
+   for (i = 0; i+1 < L && i <= live; ++i)
+   {
+      if (lwa[i] == lwa[i+1] || lw[i] == lw[i+1]) continue;   /* same word */
+      flags = dwg_walk(dic, dwg_child(dic, dwg_child(dic, node[i], lw[i+1]), lw[i]), lw + i + 2, L - i - 2);
+      if (!flags) continue;
+      memcpy(guess_word, lwa, L);
+      guess_word[i] = lwa[i+1];
+      guess_word[i+1] = lwa[i];
+      add_dwg_guess(gl, guess_word, L, GUSREV, i << 8, flags);
+   }
+   /* Vowels */
+   for (i = 0; i < L && i <= live; ++i)
+   {
+      if (!ISVOWEL(lwa[i],ext)) continue;
+      for (e = dic->dwgnode[node[i]] >> 2, end = dic->dwgnode[node[i]+1] >> 2; e < end; ++e)
+      {
+         c = dic->dwgedge[e] & 0xFF;
+         if (!(okchar[c] & DWG_OK_VOWEL) || c == lw[i]) continue;
+         flags = dwg_walk(dic, dic->dwgedge[e] >> 8, lw + i + 1, L - i - 1);
+         if (!flags) continue;
+         memcpy(guess_word, lwa, L);
+         guess_word[i] = (unsigned char)c;
+         add_dwg_guess(gl, guess_word, L, GUSVOL, (i << 8) | c, flags);
+      }
+   }
+   /* Minus */
+   for (i = 0; L >= 2 && i < L && i <= live; ++i)
+   {
+      if (i > 0 && lwa[i] == lwa[i-1]) continue;    /* same as last time */
+      flags = dwg_walk(dic, node[i], lw + i + 1, L - i - 1);
+      if (!flags) continue;
+      memcpy(guess_word, lwa, i);
+      memcpy(guess_word + i, lwa + i + 1, L - i - 1);
+      add_dwg_guess(gl, guess_word, L - 1, GUSMIN, i << 8, flags);
+   }
+   /* Plus */
+   for (i = 0; L < MAXWORDLEN && i <= L && i <= live; ++i)
+   {
+      for (e = dic->dwgnode[node[i]] >> 2, end = dic->dwgnode[node[i]+1] >> 2; e < end; ++e)
+      {
+         c = dic->dwgedge[e] & 0xFF;
+         if (!(okchar[c] & DWG_OK_PLUS) || (i > 0 && c == lwa[i-1])) continue;
+         flags = dwg_walk(dic, dic->dwgedge[e] >> 8, lw + i, L - i);
+         if (!flags) continue;
+         memcpy(guess_word, lwa, i);
+         guess_word[i] = (unsigned char)c;
+         memcpy(guess_word + i + 1, lwa + i, L - i);
+         add_dwg_guess(gl, guess_word, L + 1, GUSPLS, (i << 8) | c, flags);
+      }
+   }
+   /* Consonants */
+   for (i = 0; i < L && i <= live; ++i)
+   {
+      for (e = dic->dwgnode[node[i]] >> 2, end = dic->dwgnode[node[i]+1] >> 2; e < end; ++e)
+      {
+         c = dic->dwgedge[e] & 0xFF;
+         if (!(okchar[c] & DWG_OK_CONSONANT) || c == lw[i]) continue;
+         flags = dwg_walk(dic, dic->dwgedge[e] >> 8, lw + i + 1, L - i - 1);
+         if (!flags) continue;
+         memcpy(guess_word, lwa, L);
+         guess_word[i] = (unsigned char)c;
+         add_dwg_guess(gl, guess_word, L, GUSCON, (i << 8) | c, flags);
+      }
+   }
+
+   /* 3. The user's personal Aux1 words (the ones alloc_guesses made room for) */
+   if (aux1.base != NULL)
+   {
+      for ( lbptr = aux1.base;
+            lbptr < aux1.base + aux1.len && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+            lbptr += *lbptr + 1 )
+      {
+         if (!dwg_aux1_guess(ses, lw, okchar, lbptr + 1, *lbptr, guess_word, &gmode, &order)) continue;
+         gc = &gl->cand[gl->ncand];
+         memcpy(gc->lower, lbptr + 1, *lbptr);
+         gc = enter_guess(gl, guess_word, *lbptr, hash_word(gc->lower, *lbptr), gmode, order);
+         if (gc == NULL) continue;                  /* it's in the main dictionary too */
+         setup_dicword(dic, gc->len, gc->lower, target_word);
+         gc->common = search_commonwords(dic, target_word, gc->len);
+      }
+   }
+   delete[] gl->seen;
+   gl->seen = NULL;
+
+   /* 4. Best guess first */
+   if (gl->ncand > 1) qsort(gl->cand, gl->ncand, sizeof(struct guess_cand), compare_guess_rank);
+   return( (gl->ncand > 0) ? EDX__WORDFOUND : EDX__WORDNOTFOUND );
+}
+
+/*--------------------------------------------------------------------------
+    .SUBTITLE LEV_GUESS_LIST
+
+ Functional Description:
+    Makes the session's guess list for the misspelled word in DIC_LWA,DIC_LWL
+    from every word up to maxdist edits away (as sym_guess_list counts
+    edits), without a suggestion index. Runs a Levenshtein automaton of
+    the misspelled word over the words of the main lexical database in
+    the order they're in, which is alphabetical.
+
+    The automaton's state after reading some characters is a row of edit
+    distances: entry j is the distance between those characters and the
+    first j characters of the misspelled word. A word is a guess if the
+    state after reading all of it has entry L <= maxdist. Once every entry
+    is over maxdist the state is dead: no word starting with those
+    characters can be a guess. Words next to each other share their first
+    few characters, so the states for those are kept (struct lev_state)
+    and only the rest of each word is run.
+
+    When the automaton dies, lev_next works out the first string after
+    the dead characters that it's still alive after, and the guide words
+    are searched (binsrch_maindic) for the page that string would be on.
+    The pages before it aren't read at all, and the words before it on
+    the page are skipped without running the automaton.
+
+    EDX_OPT_LEV_BUDGET_US and EDX_OPT_LEV_MAX_WORDS limit how long a
+    search can take. A search that runs out stops where it is, and the
+    guesses found so far are the guess list.
+
+ Outputs:
+    Same as make_guess_list.
+
+ Outline:
+    1.  Each word of the main lexical database not too long or short to
+        be a guess is run, up to where the automaton dies. Then we skip
+        to the first word it could be alive for (lev_next).
+
+    2.  The common words and the user's personal Aux1 words aren't in the
+        pages, so their edit distance is worked out one by one.
+
+    3.  The guesses are given the misspelled word's capitals, and sorted
+        by compare_guess_rank.
+---------------------------------------------------------------------------*/
+struct lev_state {
+   unsigned char *word;              /* misspelled word, lowercased */
+   DWORD L;                          /* its length */
+   DWORD maxdist;
+   unsigned char chars[MAXWORDLEN];  /* characters the states are for */
+   DWORD depth;                      /* states 0..depth are good */
+   DWORD dead;                       /* first state that's dead (MAXWORDLEN+1 if none is) */
+   unsigned char row[MAXWORDLEN+1][MAXWORDLEN+1];   /* [d][j] = state after chars[0..d), capped at maxdist+1 */
+};
+
+/* Make state d from states d-1 and d-2 (chars[d-1] just read). Returns its
+   smallest entry. Only entries j from d-maxdist to d+maxdist can be
+   maxdist or less, so only those are worked out. The entries either side
+   of them are set to maxdist+1 for the next state to use. */
+DWORD lev_step(struct lev_state *lv, DWORD d)
+{
+   unsigned char *prev = lv->row[d-1];
+   unsigned char *cur = lv->row[d];
+   unsigned char c = lv->chars[d-1];
+   DWORD k = lv->maxdist;
+   DWORD lo = (d > k) ? d - k : 1;
+   DWORD hi = (d + k < lv->L) ? d + k : lv->L;
+   DWORD j, v, best;
+
+   if (d > k) { cur[lo-1] = (unsigned char)(k + 1); best = k + 1; }
+   else { cur[0] = (unsigned char)d; best = d; }
+   for (j = lo; j <= hi; ++j)
+   {
+      v = prev[j-1] + (lv->word[j-1] != c);                       /* replace (or match) */
+      if (prev[j] + 1u < v) v = prev[j] + 1;                      /* delete */
+      if (cur[j-1] + 1u < v) v = cur[j-1] + 1;                    /* insert */
+      if (   d > 1 && j > 1 && c == lv->word[j-2] && lv->chars[d-2] == lv->word[j-1]
+          && lv->row[d-2][j-2] + 1u < v) v = lv->row[d-2][j-2] + 1; /* swap */
+      if (v > k) v = k + 1;
+      cur[j] = (unsigned char)v;
+      if (v < best) best = v;
+   }
+   if (hi < lv->L) cur[hi+1] = (unsigned char)(k + 1);
+   return(best);
+}
+
+/* Run the automaton on characters s,n, keeping the states for the
+   characters they have in common with the last ones run. Returns TRUE if
+   it's still alive after all of them. */
+BOOL lev_run(struct lev_state *lv, unsigned char *s, DWORD n)
+{
+   DWORD d;
+
+   for (d = 0; d < n && d < lv->depth && lv->chars[d] == s[d]; ++d);   /* characters in common */
+   lv->depth = d;
+   if (lv->dead > d) lv->dead = MAXWORDLEN + 1;
+   for ( ; d < n && lv->dead > d; ++d)
+   {
+      lv->chars[d] = s[d];
+      lv->depth = d + 1;
+      if (lev_step(lv, d + 1) > lv->maxdist) lv->dead = d + 1;
+   }
+   return(lv->dead > n);
+}
+
+/* The automaton died reading chars[0..dead). Change the characters to
+   the first string after them it's alive after, with the states for it.
+   Returns the string's length (0 if there's none, and the search is over).
+   Once state d-1 has an entry under maxdist any character keeps it alive,
+   and otherwise only characters of the misspelled word can. */
+DWORD lev_next(struct lev_state *lv)
+{
+   DWORD d = lv->dead;
+   DWORD j, hi, c, best, next;
+
+   if (d > MAXWORDLEN) return(0);                  /* (not dead) */
+   for ( ; d > 0; --d)
+   {
+      /* Smallest entry of state d-1 (just the ones lev_step worked out) */
+      j = (d - 1 > lv->maxdist) ? d - 1 - lv->maxdist : 0;
+      hi = (d - 1 + lv->maxdist < lv->L) ? d - 1 + lv->maxdist : lv->L;
+      for (best = lv->maxdist + 1; j <= hi; ++j)
+         if (lv->row[d-1][j] < best) best = lv->row[d-1][j];
+      for (c = lv->chars[d-1]; c < 255; )
+      {
+         if (best < lv->maxdist) next = c + 1;
+         else
+         {
+            for (j = 0, next = 256; j < lv->L; ++j)          /* next character of the misspelled word */
+               if (lv->word[j] > c && lv->word[j] < next) next = lv->word[j];
+            if (next > 255) break;
+         }
+         c = next;
+         lv->chars[d-1] = (unsigned char)c;
+         if (lev_step(lv, d) <= lv->maxdist)
+         {
+            lv->depth = d;
+            lv->dead = MAXWORDLEN + 1;
+            return(d);
+         }
+      }
+   }
+   return(0);
+}
+
+/* Make room for one more guess on guess list gl. Returns FALSE if there isn't memory. */
+BOOL room_for_guess(struct guess_list *gl)
+{
+   struct guess_cand *bigger;
+   DWORD newmax;
+
+   if (gl->ncand < gl->maxcand) return(TRUE);
+   newmax = 2 * gl->maxcand + 64;
+   bigger = new struct guess_cand[newmax];
+   if (bigger == NULL) return(FALSE);
+   if (gl->cand)
+   {
+      memcpy(bigger, gl->cand, gl->ncand * sizeof(struct guess_cand));
+      delete[] gl->cand;
+   }
+   gl->cand = bigger;
+   gl->maxcand = newmax;
+   return(TRUE);
+}
+
+/* Add the words from lbptr to end (a lexical database) within maxdist of
+   word,L to guess list gl, working out each one's edit distance. Words
+   already on the list are skipped. Returns FALSE if out of memory. */
+BOOL lev_add_words(struct edx_dictionary *dic, struct guess_list *gl, unsigned char *word, DWORD L,
+                   DWORD maxdist, unsigned char *lbptr, unsigned char *end, BOOL common)
+{
+   unsigned char *base = lbptr;
+   DWORD dist, n;
+
+   for ( ; lbptr < end && *lbptr != 0x00 && *lbptr <= MAXWORDLEN; lbptr += *lbptr + 1 )
+   {
+      dist = edit_distance(word, L, lbptr + 1, *lbptr, maxdist);
+      if (dist == 0 || dist > maxdist) continue;
+      for (n = 0; n < gl->ncand; ++n)       /* already have it? */
+         if (gl->cand[n].len == *lbptr && memcmp(gl->cand[n].lower, lbptr + 1, *lbptr) == 0) break;
+      if (n < gl->ncand) continue;
+      if (!room_for_guess(gl)) return(FALSE);
+      add_sym_guess(gl, lbptr + 1, *lbptr, dist,
+                    (dist == 1) ? guess_test(word, L, lbptr + 1, *lbptr, dic->Extended_ANSI_Guessing) : 0,
+                    (DWORD)(lbptr - base), common);
+   }
+   return(TRUE);
+}
+
+int lev_guess_list(struct edx_session *ses, DWORD maxdist)
+{
+   struct edx_dictionary *dic = ses->dic;
+   struct dichead_layout *dichead = dic->dichead;
+   struct guess_list *gl = &ses->guesses;
+   struct lev_state lv;
+   struct aux1_view aux1;
+   unsigned char word[MAXWORDLEN+1];    /* misspelled word lowercased */
+   unsigned char target_word[MAXWORDLEN+1];
+   unsigned char seek[MAXWORDLEN];      /* skipping words before this */
+   unsigned char *lbptr, *next;
+   unsigned char *diclexend = dic->diclexdba + dichead->lexlen;
+   DWORD L = ses->dic_lwl;
+   DWORD budget_us = dic->options[EDX_OPT_LEV_BUDGET_US];
+   DWORD max_words = dic->options[EDX_OPT_LEV_MAX_WORDS];
+   DWORD page, lastpage, low, high, seeklen, i, n, dist, nwords;
+   int cmp;
+   LARGE_INTEGER start;
+
+   free_guesses(ses);
+   if (L == 0 || L > MAXWORDLEN) return(EDX__WORDNOTFOUND);    /* too long to be a word. Don't guess. */
+   if (maxdist > LEV_MAX_DIST) maxdist = LEV_MAX_DIST;
+   for (i = 0; i < L; ++i) word[i] = ANSItolower(ses->dic_lwa[i]);
+   memset(&lv, 0, sizeof(lv));
+   lv.word = word;
+   lv.L = L;
+   lv.maxdist = maxdist;
+   lv.dead = MAXWORDLEN + 1;
+   for (i = 0; i <= L; ++i) lv.row[0][i] = (unsigned char)((i <= maxdist) ? i : maxdist + 1);
+   ++ses->lev_searches;
+   QueryPerformanceCounter(&start);
+
+   /* 1. The words of the main lexical database */
+   lastpage = DWG_NONE;
+   seeklen = 0;
+   nwords = 0;
+   for ( lbptr = dic->diclexdba;
+         lbptr < diclexend && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+         lbptr = next )
+   {
+      next = lbptr + *lbptr + 1;
+      page = (DWORD)(lbptr - dic->diclexdba) / dichead->dicpln;
+      if (page != lastpage)
+      {
+         ++ses->lev_pages;
+         lastpage = page;
+         if (   (budget_us != 0 && ses->lev_pages % LEV_CHECK_PAGES == 0 && elapsed_ms(start) * 1000.0 > budget_us)
+             || (max_words != 0 && nwords >= max_words) )
+         {
+            ++ses->lev_budget_stops;
+            break;
+         }
+      }
+      if (seeklen > 0)                         /* before the word we're skipping to? */
+      {
+         cmp = memcmp(lbptr + 1, seek, (*lbptr < seeklen) ? *lbptr : seeklen);
+         if (cmp < 0 || (cmp == 0 && *lbptr < seeklen)) continue;
+         seeklen = 0;
+      }
+      if (*lbptr > L + maxdist || *lbptr + maxdist < L) continue;   /* too long or too short */
+      ++nwords;
+      if (lev_run(&lv, lbptr + 1, *lbptr))
+      {
+         dist = lv.row[*lbptr][L];
+         if (dist == 0 || dist > maxdist) continue;   /* (0 is the misspelled word in other capitals) */
+         if (!room_for_guess(gl)) { free_guesses(ses); return(EDX__ERROR); }
+         add_sym_guess(gl, lbptr + 1, *lbptr, dist,
+                       (dist == 1) ? guess_test(word, L, lbptr + 1, *lbptr, dic->Extended_ANSI_Guessing) : 0,
+                       (DWORD)(lbptr - dic->diclexdba), FALSE);
+         continue;
+      }
+      if (lv.dead > *lbptr) continue;          /* alive, just not a guess */
+
+      /* Died. Skip to the first word it could be alive for. */
+      seeklen = lev_next(&lv);
+      if (seeklen == 0) break;                 /* no more */
+      memcpy(seek, lv.chars, seeklen);
+      setup_dicword(dic, seeklen, seek, target_word);
+      if (   page + 1 < dichead->nidxwds                  /* past the next page's guide word? */
+          && memcmp(target_word, dic->dicindptr + (page + 1)*dichead->indswd, dichead->indswd) > 0)
+      {
+         binsrch_maindic(dic, &low, &high, target_word);
+         if (low > page && low < dichead->nidxwds)
+         {
+            ses->lev_skipped += low - page - 1;
+            for (next = dic->diclexdba + low * dichead->dicpln; *next > MAXWORDLEN; ++next);  /* find a length-byte */
+         }
+      }
+   }
+
+   /* 2. The common words and the user's personal Aux1 words */
+   aux1_view(dic, &aux1);
+   if (   !lev_add_words(dic, gl, word, L, maxdist, dic->cmnwdsptr, dic->cmnwdsptr + dichead->cwdlen, TRUE)
+       || (   aux1.base != NULL
+           && !lev_add_words(dic, gl, word, L, maxdist, aux1.base, aux1.base + aux1.len, FALSE)) )
+   {
+      free_guesses(ses);
+      return(EDX__ERROR);
+   }
+
+   /* 3. Capitals, and best guess first */
+   for (n = 0; n < gl->ncand; ++n)
+   {
+      if (!gl->cand[n].common)
+      {
+         setup_dicword(dic, gl->cand[n].len, gl->cand[n].lower, target_word);
+         gl->cand[n].common = search_commonwords(dic, target_word, gl->cand[n].len);
+      }
+      match_case(&gl->cand[n], ses->dic_lwa, L);
+   }
+   if (gl->ncand > 1) qsort(gl->cand, gl->ncand, sizeof(struct guess_cand), compare_guess_rank);   /* (cand is still NULL if none were found) */
+   return( (gl->ncand > 0) ? EDX__WORDFOUND : EDX__WORDNOTFOUND );
+}
+
+/* Make the session's guess list: from the suggestion index if it's loaded,
+   else with the Levenshtein automaton if EDX_OPT_LEVENSHTEIN is set, else
+   from the word graph if it's loaded, else by spell guessing */
+int engine_guess_list(struct edx_session *ses)
+{
+   if (ses->dic->sym != NULL) { LAT_KIND(ses, LAT_GUESS_SYM); return( sym_guess_list(ses, ses->dic->options[EDX_OPT_SYMSPELL]) ); }
+   if (ses->dic->options[EDX_OPT_LEVENSHTEIN] && !ses->dic->frontcoded) { LAT_KIND(ses, LAT_GUESS_LEV); return( lev_guess_list(ses, ses->dic->options[EDX_OPT_LEVENSHTEIN]) ); }
+   if (ses->dic->dwg != NULL) { LAT_KIND(ses, LAT_GUESS_DWG); return( dwg_guess_list(ses) ); }
+   LAT_KIND(ses, LAT_GUESS_TESTS);
+   return( vassar_guess_list(ses) );
+}
+
+/* Make the session's guess list, from the guess cache if the word's in it */
+int make_guess_list(struct edx_session *ses)
+{
+   DWORD h, generation, budget_stops;
+   int result;
+
+   if (ses->dic->guesscache == NULL || ses->dic_lwl == 0) return( engine_guess_list(ses) );
+   h = hash_word(ses->dic_lwa, ses->dic_lwl);
+   if (guess_cache_find(ses, h, &generation))
+   {
+      LAT_KIND(ses, LAT_GUESS_CACHED);
+      return( (ses->guesses.ncand > 0) ? EDX__WORDFOUND : EDX__WORDNOTFOUND );
+   }
+   budget_stops = ses->lev_budget_stops;
+   result = engine_guess_list(ses);
+   if (result != EDX__ERROR && ses->lev_budget_stops == budget_stops) guess_cache_add(ses, h, generation);
+   return(result);
+}
+
+/*--------------------------------------------------------------------------
+    .SUBTITLE SPELL_GUESS
+
+ Functional Description:
+    Guesses the spelling of misspelled word stored in DIC_LWA,DIC_LWL.
+    Algorythm taken from the very popular Vassar Spelling Checker.
+    With credit to Vassar where credit is due.
+    Returns one guess per call. The first call after looking up a word makes
+    the guess list (make_guess_list), and each call after that hands out the
+    next guess on the list. edx$spell_suggest returns them all in one call.
+
+ Calling Sequence:
+    result = edx$spell_guess(char *guessword, char *errbuf, int errbuflen,);
+
+ Argument inputs:
+    char *guessword pointer to ASCIZ string. Must be at least 33 characters long! This is where we put our guessword.
+    errbuf - buffer to put any error message in to return to caller (let caller display it)
+    errbuflen - length of errbuf.
+    Held in the session (edx$spell_guess uses the default session):
+    DIC_LWA = TARGET_WORD - Address of misspelled word
+    DIC_LWL = TARGET_WORD_LEN - Length of misspelled word
+    GMODE   - guess mode    (1=make guess list, 7=hand out guesses, 6=giveup)
+    GOF     - next guess on the guess list to hand out
+     (NOTE: gmode = GUSREV, gof = 0; SET BY DIC_LOOKUP_WORD)
+
+ Outputs:
+    retcode=EDX__WORDFOUND, guessword = guessed word. Here's another word to try.
+     or
+    retcode = EDX__WORDNOTFOUND, no more guesses.
+     or
+    retcode = EDX__ERROR, memory allocation failure. Error text returned in 'errbuf'
+
+ Outline:
+    1.  Reversals   (test for transposed characters)
+    2.  vowels      (test for wrong vowel used)
+    3.  minus chars (test for extra character in word)
+    4.  plus chars  (test for character missing from word)
+    5.  consonants  (test for wrong character used)
+    6.  give up     (give up)
+
+Updated 11/03/2006
+ I defined Extended_ANSI_Guessing. If TRUE, spell guessing will use
+ those extended characters with accents in spell guessing.
+ Characters such as                                   
+
+
+---------------------------------------------------------------------------*/
+
+int hand_out_guess(struct edx_session *ses, char *guessword, char *errbuf, int errbuflen)
+{
+   switch (ses->gmode)          /* GUESS MODE */
+   {
+      case GUSREV:              /* 1 = FIRST GUESS. MAKE THE GUESS LIST */
+           ses->gof = 0;
+           if (make_guess_list(ses) == EDX__ERROR)
+           {
+              ses->gmode = GIVEUP;
+              guessword[0] = '\0';
+              _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+              errbuf[errbuflen-1] = '\0';
+              return( EDX__ERROR );
+           }
+           ses->gmode = GUSLST;
+                        /* DROP THROUGH TO NEXT MODE: GUSLST */
+      case GUSLST:              /* 7 = HAND OUT NEXT GUESS ON THE GUESS LIST */
+           if (ses->gof < ses->guesses.ncand)
+           {
+              strcpy(guessword, (char *)ses->guesses.cand[ses->gof].word);
+              ++ses->gof;       /* move to next guess for reentry */
+              return( EDX__WORDFOUND );
+           }
+           free_guesses(ses);
+           ses->gmode = GIVEUP;
+                        /* DROP THROUGH TO NEXT MODE: GIVEUP */
+      case GIVEUP:              /* 6 = GIVE UP */
+      default:
+           guessword[0] = '\0';
+           return( EDX__WORDNOTFOUND );        /* no more guesses */
+   }
+}
+
+// hand_out_guess, timed by what it did (LAT_GUESS_...)
+int session_spell_guess(struct edx_session *ses, char *guessword, char *errbuf, int errbuflen)
+{
+   DWORD gmode = ses->gmode;
+   int status;
+
+   LAT_START(ses);
+   status = hand_out_guess(ses, guessword, errbuf, errbuflen);
+   LAT_END(ses, (gmode == GUSREV) ? ses->latkind : (status == EDX__WORDFOUND) ? LAT_GUESS_NEXT : LAT_GUESS_GIVEUP, ses->dic_lwl);
+   return(status);
+}
+
+extern "C" _declspec (dllexport) int edx$spell_guess(char *guessword, char *errbuf, int errbuflen)
+{
+ int status;
+ __try
+ {
+   if (!dic_loaded) { guessword[0] = '\0'; return(EDX__WORDNOTFOUND); }   /* (nothing looked up to guess) */
+   session_enter(&default_session, FALSE);
+   status = session_spell_guess(&default_session, guessword, errbuf, errbuflen);
+   session_leave(&default_session, default_session.gmode != GIVEUP);
+   return(status);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   session_leave(&default_session, FALSE);
+   return(EDX__ERROR);
+ }
+}
+
+/*--------------------------------------------------------------------------
+    .SUBTITLE SPELL_SUGGEST
+
+ Functional Description:
+    Returns up to max_k ranked guesses for a misspelled word in one call.
+    The word becomes the session's word, so edx$spell_guess called after
+    edx$spell_suggest hands out the same guesses one at a time.
+
+ Calling Sequence:
+    result = edx$spell_suggest(char *word, int max_k, char *suggestions, int *nsuggestions,
+                               char *errbuf, int errbuflen);
+
+ Argument inputs:
+    word - ASCIZ misspelled word to guess the spelling of
+    max_k - most suggestions to return
+    suggestions - buffer of max_k * EDX_SUGGESTION_LEN characters. Suggestion n
+                  is the ASCIZ string at suggestions + n*EDX_SUGGESTION_LEN.
+    errbuf - buffer to put any error message in to return to caller (let caller display it)
+    errbuflen - length of errbuf.
+
+ Outputs:
+    nsuggestions - number of suggestions returned, best first
+    result = EDX__WORDFOUND - at least one suggestion
+           = EDX__WORDNOTFOUND - no suggestions
+           = EDX__ERROR - an error was encountered. Error text returned in 'errbuf'
+---------------------------------------------------------------------------*/
+int session_suggest(struct edx_session *ses, char *word, int max_k, char *suggestions, int *nsuggestions, char *errbuf, int errbuflen)
+{
+   int result;
+   int k;
+
+   *nsuggestions = 0;
+   ses->gmode = GIVEUP;
+   ses->gof = 0;
+   ses->dic_lwl = strlen(word);
+   if (ses->dic_lwl > MAXWORDLEN) { free_guesses(ses); return(EDX__WORDNOTFOUND); }  /* too long to be a word. Don't guess. */
+   memcpy(ses->dic_lwa, word, ses->dic_lwl);
+
+   LAT_START(ses);
+   result = make_guess_list(ses);
+   LAT_END(ses, ses->latkind, ses->dic_lwl);
+   if (result == EDX__ERROR)
+   {
+     _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+     errbuf[errbuflen-1] = '\0';
+     return(EDX__ERROR);
+   }
+   ses->gmode = GUSLST;         /* edx$spell_guess hands out the same guesses */
+   for (k = 0; k < max_k && (DWORD)k < ses->guesses.ncand; ++k)
+      strcpy(suggestions + k*EDX_SUGGESTION_LEN, (char *)ses->guesses.cand[k].word);
+   *nsuggestions = k;
+   return(result);
+}
+
+extern "C" _declspec (dllexport) int edx$spell_suggest(char *word, int max_k, char *suggestions, int *nsuggestions, char *errbuf, int errbuflen)
+{
+ int result;
+ __try
+ {
+   if (!dic_loaded)
+   {
+     *nsuggestions = 0;
+     _snprintf(errbuf, errbuflen, "No EDX dictionary loaded. Call edx$dic_lookup_word first.");
+     errbuf[errbuflen-1] = '\0';
+     return(EDX__ERROR);
+   }
+   session_enter(&default_session, TRUE);
+   result = session_suggest(&default_session, word, max_k, suggestions, nsuggestions, errbuf, errbuflen);
+   session_leave(&default_session, default_session.gmode != GIVEUP);
+   return(result);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   session_leave(&default_session, FALSE);
+   return(EDX__ERROR);
+ }
+}
+
+/*-----------------------------------------------------------------------------
+    .SBTTL  ADD WORD TO USER'S AUX1 DICTIONARY
+
+ Functional Description:
+    This routine adds a word to the user's personal aux1 dictionary.
+
+  Calling Sequence:
+    result = edx$add_persdic(char *newword, char *errbuf, int errbuflen);
+
+ Argument inputs:
+    newword - pointer to ASCIZ string containing new word to add to user's Aux1 personal dictionary
+    errbuf - buffer to put any error message in to return to caller (let caller display it)
+    errbuflen - length of errbuf.
+
+ Outline:
+ 1. Check the new word is one word of 1 to MAXWORDLEN characters (else
+    load_aux1_dic would refuse to load the file next time).
+ 2. Open for append, or create, user's personal dictionary file.
+    The user's personal dictionary file is a plain text file with one word per line.
+ 3. Append word to user's personal dictionary file, and close it.
+ 4. Add the lowercased word to the end of the Aux1 words in memory (making
+    room for it if needed), and to the Aux1 hash index and Bloom filter,
+    without stopping the sessions searching them (aux1_add_word).
+    We used to reload the whole file for every word added, which got slow
+    once a user's personal dictionary had many thousands of words in it.
+    The lookup cache forgets the word, since it may have it as not found,
+    and the guess cache is emptied, since it may be a guess for any word.
+---------------------------------------------------------------------------*/
+// Add word (lowercased) to end of user's Aux1 words in memory, and to the
+// Aux1 hash index and Bloom filter. Sessions go on searching them meanwhile
+// (aux1_view), so the word's bytes go in before its length-byte, and its
+// hash slot and Bloom filter bits are each written whole. When aux1base or
+// the hash table is full the bigger copy is made aside and swapped in with
+// aux1seq odd. The old one is kept till the dictionary is freed (aux1old),
+// since a session may still be searching it.
+BOOL aux1_add_word(struct edx_dictionary *dic, unsigned char *word, DWORD wdlen)
+{
+  struct word_hash wh = dic->aux1hash;
+  struct aux1_old *old = NULL;
+  unsigned char *base = dic->aux1base;
+  unsigned char *lbptr;     /* pointer to length-byte of new word */
+  DWORD size = dic->aux1size;
+  DWORD nslots;
+
+  if (dic->bloom != NULL && !bloom_writable(dic)) {return(FALSE);}
+  if (dic->aux1len + wdlen + 2 > size)  // room for length-byte, word, and trailing NULL byte?
+  {
+    size = 2*dic->aux1size + wdlen + 2;
+    base = new unsigned char[size];
+    if (base == NULL) {return(FALSE);}
+    memcpy(base, dic->aux1base, dic->aux1len + 1);
+  }
+  if (base != dic->aux1base || (wh.tab != NULL && 2*(wh.words + 1) > wh.mask + 1))
+  {
+    old = new struct aux1_old;
+    if (old == NULL)
+    {
+      if (base != dic->aux1base) { delete[] base; }
+      return(FALSE);
+    }
+    old->base = (base != dic->aux1base) ? dic->aux1base : NULL;
+    old->tab = NULL;
+    if (wh.tab != NULL)   /* a table for the new base, doubled if it's half full */
+    {
+      nslots = (2*(wh.words + 1) > wh.mask + 1) ? 2*(wh.mask + 1) : wh.mask + 1;
+      if (!copy_word_hash(&wh, &dic->aux1hash, base, nslots))
+        memset(&wh, 0, sizeof(struct word_hash));   // we search Aux1 the slow way
+      old->tab = dic->aux1hash.tab;
+    }
+  }
+
+  lbptr = base + dic->aux1len;
+  memcpy(lbptr + 1, word, wdlen);
+  lbptr[wdlen + 1] = '\0';         /* NULL after last word indicates end of lexical word list*/
+  MemoryBarrier();                 /* the word, then its length-byte over the old NULL */
+  *lbptr = (unsigned char)wdlen;
+  if (wh.tab != NULL)
+  {
+    hash_slot_publish(wh.tab, wh.mask, hash_word(word, wdlen), (DWORD)(lbptr - base) + 1);
+    ++wh.words;
+  }
+  if (dic->bloom != NULL) { bloom_publish(dic, word, wdlen); }
+
+  InterlockedIncrement(&dic->aux1seq);   /* odd: sessions wait for the new ones */
+  dic->aux1base = base;
+  dic->aux1size = size;
+  dic->aux1len += wdlen + 1;
+  dic->aux1hash = wh;
+  InterlockedIncrement(&dic->aux1seq);
+  if (old != NULL)
+  {
+    old->next = dic->aux1old;
+    dic->aux1old = old;
+  }
+  return(TRUE);
+}
+
+int dic_add_persdic(struct edx_dictionary *dic, char *newword, char *errbuf, int errbuflen)
+{
+  FILE *fpAux1File = NULL;  //User's Aux1 dictionary
+  unsigned char wdbuf[MAXWORDLEN+1];
+  DWORD i, wdlen;
+
+  if (!strlen(dic->Aux1File) || dic->aux1base == NULL)
+  {
+    char errmsg[ERRMSGLEN];
+    _snprintf(errmsg, ERRMSGLEN, "Error adding word to user's personal auxiliary dictionary.\nUser's personal auxiliary dictionary filename not set.\n");
+    errmsg[ERRMSGLEN-1] = '\0';
+    return(EDX__ERROR);
+  }
+
+  // 1. Check it's one word of 1 to MAXWORDLEN characters, and lowercase it.
+  wdlen = strlen(newword);
+  for (i = 0; i < wdlen && i < MAXWORDLEN && !EDXisspace((unsigned char)newword[i]); ++i)
+    wdbuf[i] = ANSItolower((unsigned char)newword[i]);
+  if (wdlen == 0 || i != wdlen)
+  {
+    _snprintf(errbuf, errbuflen, "Can't add '%s' to user's personal auxiliary dictionary.\nMust be one word of 1 to %d characters.\n", newword, MAXWORDLEN);
+    errbuf[errbuflen-1] = '\0';
+    return(EDX__ERROR);
+  }
+
+  // 2. Open for append, or create, user's personal dictionary file.
+  //    The user's personal dictionary file is a plain text file with one word per line.
+  fpAux1File = fopen(dic->Aux1File,"a");
+  if (fpAux1File == (FILE *) NULL)
+  {
+    char errmsg[ERRMSGLEN];
+    _snprintf(errmsg, ERRMSGLEN, "Error opening user's personal dictionary file %s.\n", dic->Aux1File);
+    errmsg[ERRMSGLEN-1] = '\0';
+    return(EDX__ERROR);
+  }
+
+  // 3. Append word to user's personal dictionary file, and close it.
+  fprintf(fpAux1File,"%s\n",newword);
+  fclose(fpAux1File);
+
+  // 4. Add it to the Aux1 words in memory, and have the caches forget what it changes.
+  if (!aux1_add_word(dic, wdbuf, wdlen))
+  {
+    _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+    errbuf[errbuflen-1] = '\0';
+    return(EDX__ERROR);
+  }
+  if (dic->cache != NULL) { cache_forget(dic, wdbuf, wdlen); }
+  if (dic->guesscache != NULL) { guess_cache_clear(dic); }
+
+  return(EDX__WORDFOUND);  //signal success
+}
+
+// Add newword to the handle's Aux1 dictionary (dic_add_persdic), timed
+int handle_add_persdic(struct edx_dictionary *handle, char *newword, char *errbuf, int errbuflen)
+{
+  struct edx_dictionary *dic;
+  int status;
+#ifdef EDX_STATS
+  unsigned __int64 start;
+#endif
+
+  EnterCriticalSection(&handle->addlock);     /* not while a reload is reading the Aux1 file */
+  dic = dic_lock(handle);
+#ifdef EDX_STATS
+  start = (dic->options[EDX_OPT_LATENCY] | dic->options[EDX_OPT_TRACE_US]) ? ticks_now() : 0;
+#endif
+  status = dic_add_persdic(dic, newword, errbuf, errbuflen);
+#ifdef EDX_STATS
+  if (start != 0) lat_record(handle, dic, LAT_ADD_PERSDIC, start, ticks_since(start), strlen(newword));
+#endif
+  dic_unlock(handle);
+  LeaveCriticalSection(&handle->addlock);
+  return(status);
+}
+
+extern "C" _declspec (dllexport) int edx$add_persdic(char *newword, char *errbuf, int errbuflen)
+{
+  if (!dic_loaded)
+  {
+    _snprintf(errbuf, errbuflen, "No EDX dictionary loaded. Call edx$dic_lookup_word first.");
+    errbuf[errbuflen-1] = '\0';
+    return(EDX__ERROR);
+  }
+  return(handle_add_persdic(&default_dic, newword, errbuf, errbuflen));
+}
+
+/*-----------------------------------------------------------------------------
+    .SBTTL  DICTIONARY AND SESSION INTERFACE
+
+ Functional Description:
+    Lets a program check spelling on many threads at once.
+    edx$dic_open loads an EDX dictionary (and optional user's personal Aux1
+    dictionary) once. The loaded dictionary is only read after that, so it
+    can be shared. Each thread then creates its own session on the
+    dictionary with edx$session_create. A session holds the word last looked
+    up and its guess list (DIC_LWA, DIC_LWL, GMODE, GOF, guesses),
+    which the original interface keeps in one default session.
+
+  Calling Sequence:
+    dic = edx$dic_open(Dic_File_Name, Aux1_File_Name, errbuf, errbuflen);
+    ses = edx$session_create(dic);
+    status = edx$session_lookup_word(ses, spellword, errbuf, errbuflen);
+    status = edx$session_spell_guess(ses, guessword, errbuf, errbuflen);
+    status = edx$session_suggest(ses, word, max_k, suggestions, &nsuggestions, errbuf, errbuflen);
+    result = edx$session_lookup_words(ses, words, nwords, status, errbuf, errbuflen);
+    edx$session_delete(ses);
+    status = edx$dic_reload(dic, Dic_File_Name, errbuf, errbuflen);
+    edx$dic_close(dic);
+
+ Argument inputs:
+    Same as edx$dic_lookup_word, edx$spell_guess, edx$spell_suggest,
+    edx$dic_lookup_words and edx$add_persdic.
+    edx$dic_reload: Dic_File_Name NULL or "" loads the dictionary's file
+    again. The dictionary is loaded with the options as edx$set_option
+    has them now, and with the same Aux1 file.
+
+ Outputs:
+    edx$dic_open returns NULL if the dictionary could not be loaded.
+    edx$dic_reload returns EDX__WORDFOUND, or EDX__ERROR if the dictionary
+    could not be loaded, and the sessions go on with the one they have.
+    Error text returned in 'errbuf'.
+    edx$session_create returns NULL on memory allocation failure.
+
+ NOTE: Close all sessions on a dictionary before closing the dictionary.
+       edx$dic_add_persdic adds to the user's Aux1 dictionary in memory while
+       other threads' sessions go on looking words up in it (see
+       aux1_add_word). Adds and reloads take turns.
+       edx$dic_reload loads the new dictionary while the sessions go on
+       using the old one (see DICTIONARY HANDLES), then switches them over.
+       It takes as long as edx$dic_open; call it on a thread of its own.
+---------------------------------------------------------------------------*/
+// Load a dictionary (and the layers of a stack) and make a handle of it
+struct edx_dictionary *open_dic(char *Dic_File_Name, char **Layer_File_Names, int nlayers, char *Aux1_File_Name, char *errbuf, int errbuflen)
+{
+  struct edx_dictionary *dic, *handle;
+
+  dic = load_dic(Dic_File_Name, Layer_File_Names, nlayers, Aux1_File_Name, errbuf, errbuflen);
+  if (dic == NULL) {return(NULL);}
+  handle = new struct edx_dictionary;
+  if (handle == NULL)
+  {
+    _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+    errbuf[errbuflen-1] = '\0';
+    unload_dic(dic);
+    delete dic;
+    return(NULL);
+  }
+  memset(handle, 0, sizeof(struct edx_dictionary));
+  InitializeCriticalSection(&handle->reloadlock);
+  InitializeCriticalSection(&handle->addlock);
+#ifdef EDX_STATS
+  InitializeCriticalSection(&handle->latencylock);
+#endif
+  init_handle(handle, dic, Dic_File_Name, Aux1_File_Name);
+  return(handle);
+}
+
+extern "C" _declspec (dllexport) struct edx_dictionary * edx$dic_open(char *Dic_File_Name, char *Aux1_File_Name, char *errbuf, int errbuflen)
+{
+  return( open_dic(Dic_File_Name, NULL, 0, Aux1_File_Name, errbuf, errbuflen) );
+}
+
+extern "C" _declspec (dllexport) void edx$dic_close(struct edx_dictionary *dic)
+{
+  if (dic == NULL) {return;}
+  close_handle(dic);
+  DeleteCriticalSection(&dic->reloadlock);
+  DeleteCriticalSection(&dic->addlock);
+#ifdef EDX_STATS
+  DeleteCriticalSection(&dic->latencylock);
+#endif
+  delete dic;
+}
+
+extern "C" _declspec (dllexport) int edx$dic_add_persdic(struct edx_dictionary *dic, char *newword, char *errbuf, int errbuflen)
+{
+  return(handle_add_persdic(dic, newword, errbuf, errbuflen));
+}
+
+extern "C" _declspec (dllexport) struct edx_session * edx$session_create(struct edx_dictionary *dic)
+{
+  struct edx_session *ses = new struct edx_session;
+  if (ses == NULL) {return(NULL);}
+  memset(ses, 0, sizeof(struct edx_session));
+  ses->handle = dic;
+  ses->dic = dic->live;
+  ses->gmode = GIVEUP;       /* nothing to guess until a word is looked up */
+  EnterCriticalSection(&dic->reloadlock);
+  ses->nextses = dic->sessions;
+  dic->sessions = ses;
+  LeaveCriticalSection(&dic->reloadlock);
+  return(ses);
+}
+
+extern "C" _declspec (dllexport) void edx$session_delete(struct edx_session *ses)
+{
+  struct edx_dictionary *handle;
+  struct edx_session **prev;
+
+  if (ses == NULL) {return;}
+  handle = ses->handle;
+  EnterCriticalSection(&handle->reloadlock);
+  for (prev = &handle->sessions; *prev != NULL && *prev != ses; prev = &(*prev)->nextses) ;
+  if (*prev != NULL) { *prev = ses->nextses; }
+#ifdef EDX_STATS
+  add_stats(&handle->stats, &ses->stats);   /* so edx$stats still counts what it did */
+  if (ses->latency != NULL)                 /* and edx$latency times it */
+  {
+    EnterCriticalSection(&handle->latencylock);
+    if (handle->latency == NULL) handle->latency = new_latency();
+    if (handle->latency != NULL) add_latency(handle->latency, ses->latency);
+    LeaveCriticalSection(&handle->latencylock);
+    delete[] ses->latency;
+  }
+#endif
+  free_retired(handle, FALSE);      /* it may have had the last pin on one */
+  LeaveCriticalSection(&handle->reloadlock);
+  free_guesses(ses);
+  delete ses;
+}
+
+extern "C" _declspec (dllexport) int edx$session_lookup_word(struct edx_session *ses, char *spellword, char *errbuf, int errbuflen)
+{
+ int status;
+ __try
+ {
+   session_enter(ses, TRUE);
+   status = session_lookup_word(ses, spellword);
+   session_leave(ses, status == EDX__WORDNOTFOUND && ses->gmode != GIVEUP);
+   return(status);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   session_leave(ses, FALSE);
+   return(EDX__ERROR);
+ }
+}
+
+extern "C" _declspec (dllexport) int edx$session_lookup_words(struct edx_session *ses, struct edx_wordref *words, int nwords, int *status, char *errbuf, int errbuflen)
+{
+ int result;
+ BOOL guessing = ses->guessing;   /* (a guess iteration the batch mustn't end) */
+ __try
+ {
+   session_enter(ses, FALSE);
+   result = session_lookup_words(ses, words, nwords, status, errbuf, errbuflen);
+   session_leave(ses, guessing);
+   return(result);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   session_leave(ses, guessing);
+   return(EDX__ERROR);
+ }
+}
+
+extern "C" _declspec (dllexport) int edx$session_spell_guess(struct edx_session *ses, char *guessword, char *errbuf, int errbuflen)
+{
+ int status;
+ __try
+ {
+   session_enter(ses, FALSE);
+   status = session_spell_guess(ses, guessword, errbuf, errbuflen);
+   session_leave(ses, ses->gmode != GIVEUP);
+   return(status);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   session_leave(ses, FALSE);
+   return(EDX__ERROR);
+ }
+}
+
+extern "C" _declspec (dllexport) int edx$session_suggest(struct edx_session *ses, char *word, int max_k, char *suggestions, int *nsuggestions, char *errbuf, int errbuflen)
+{
+ int result;
+ __try
+ {
+   session_enter(ses, TRUE);
+   result = session_suggest(ses, word, max_k, suggestions, nsuggestions, errbuf, errbuflen);
+   session_leave(ses, ses->gmode != GIVEUP);
+   return(result);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   session_leave(ses, FALSE);
+   return(EDX__ERROR);
+ }
+}
+
+extern "C" _declspec (dllexport) int edx$dic_reload(struct edx_dictionary *dic, char *Dic_File_Name, char *errbuf, int errbuflen)
+{
+  return( reload_dic(dic, Dic_File_Name, errbuf, errbuflen) );
+}
+
+extern "C" _declspec (dllexport) int edx$reload_dic(char *Dic_File_Name, char *errbuf, int errbuflen)
+{
+  if (!dic_loaded)
   {
-    //NOT EDX DICTIONARY. ERROR IN HEADER.
-    _snprintf(errbuf, errbuflen, "File %s is not an EDX dictionary file. Header does not begin with 'EDXdict'", Dic_File_Name );
+    _snprintf(errbuf, errbuflen, "No EDX dictionary loaded. Call edx$dic_lookup_word first.");
     errbuf[errbuflen-1] = '\0';
-    return(FALSE);
+    return(EDX__ERROR);
   }
-  if (dichead->id[0] == 5)    //Dictionary version 5 contains 'flags'
+  return( reload_dic(&default_dic, Dic_File_Name, errbuf, errbuflen) );
+}
+
+
+/*-----------------------------------------------------------------------------
+    .SBTTL  DICTIONARY STACK INTERFACE
+
+ Functional Description:
+    Opens a stack of dictionaries: a main EDX dictionary, then up to
+    EDX_MAX_LAYERS more EDX dictionaries or word lists (a medical or legal
+    dictionary, a team's word list), then the user's Aux1 dictionary, and
+    looks words up in all of them at once (see DICTIONARY STACKS). A word
+    looked up costs about what it does with just the main dictionary and
+    an Aux1 dictionary, however many layers there are, and
+    edx$session_lookup_layer says which layer it was found in.
+    The handle edx$dic_open_stack returns is used like edx$dic_open's, and
+    edx$dic_reload reloads the layers too.
+
+ Calling Sequence:
+    dic = edx$dic_open_stack(File_Names, nfiles, Aux1_File_Name, errbuf, errbuflen);
+    status = edx$session_lookup_layer(ses, spellword, &layer, errbuf, errbuflen);
+    status = edx$dic_layer_name(dic, layer, buf, buflen);
+
+ Argument inputs:
+    File_Names - nfiles file names: File_Names[0] is the main EDX
+                 dictionary, the rest are the layers, in the order they're
+                 looked in. A layer is an EDX dictionary (any version) or a
+                 word list with one word per line, like an Aux1 file.
+    layer - 0 for the main dictionary, 1 to nfiles-1 for the layers,
+            nfiles for the user's Aux1 dictionary.
+
+ Outputs:
+    edx$dic_open_stack returns NULL if a dictionary could not be loaded.
+    edx$session_lookup_layer returns what edx$session_lookup_word does, and
+    the layer the word was found in (the first if it's in more than one),
+    or -1 if it wasn't found.
+    edx$dic_layer_name returns the layer's file name in buf, and
+    EDX__WORDFOUND, or EDX__ERROR if there's no such layer.
+---------------------------------------------------------------------------*/
+extern "C" _declspec (dllexport) struct edx_dictionary * edx$dic_open_stack(char **File_Names, int nfiles, char *Aux1_File_Name, char *errbuf, int errbuflen)
+{
+  if (nfiles < 1)
   {
-    Extended_ANSI_Guessing = (dichead->flags & 0x00000001);
+    _snprintf(errbuf, errbuflen, "Error opening EDX dictionary stack.\nNo main dictionary named.\n");
+    errbuf[errbuflen-1] = '\0';
+    return(NULL);
   }
-  else
-  {
-    if (dichead->id[0] != 4)    //Dictionary version 4
-    {
-      //WRONG DICTIONARY VERSION
-      _snprintf(errbuf, errbuflen, "EDX dictionary file %s is not version 4 or 5. Version is %d", Dic_File_Name, dichead->id[0] );
-      errbuf[errbuflen-1] = '\0';
+  return( open_dic(File_Names[0], File_Names + 1, nfiles - 1, Aux1_File_Name, errbuf, errbuflen) );
+}
+
+extern "C" _declspec (dllexport) int edx$session_lookup_layer(struct edx_session *ses, char *spellword, int *layer, char *errbuf, int errbuflen)
+{
+ int status;
+ __try
+ {
+   session_enter(ses, TRUE);
+   status = session_lookup_word(ses, spellword);
+   *layer = (status == EDX__WORDFOUND) ? (int)ses->layer : -1;
+   session_leave(ses, status == EDX__WORDNOTFOUND && ses->gmode != GIVEUP);
+   return(status);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   session_leave(ses, FALSE);
+   return(EDX__ERROR);
+ }
+}
+
+extern "C" _declspec (dllexport) int edx$dic_layer_name(struct edx_dictionary *dic, int layer, char *buf, int buflen)
+{
+  char *name = NULL;
+
+  if (buflen < 1) {return(EDX__ERROR);}
+  dic_lock(dic);
+  if (layer == 0) { name = dic->DicFile; }
+  else if (layer > 0 && (DWORD)layer <= dic->nlayers) { name = dic->layers[layer-1].Name; }
+  else if ((DWORD)layer == dic->nlayers + 1 && dic->Aux1File[0] != '\0') { name = dic->Aux1File; }
+  _snprintf(buf, buflen, "%s", (name != NULL) ? name : "");
+  buf[buflen-1] = '\0';
+  dic_unlock(dic);
+  return((name != NULL) ? EDX__WORDFOUND : EDX__ERROR);
+}
+
+
+/*-----------------------------------------------------------------------------
+    .SBTTL  CHECK DOCUMENT
+
+ Functional Description:
+    Checks the spelling of every word of a document, and hands back where
+    the misspelled words are. The document is a text buffer (edx$check_text)
+    or a file (edx$check_file), of any size. A word is a run of characters
+    above 32 (see EDXisspace), the same rule the dictionary is built with.
+
+    Each word is looked up where it lies in the text or the file's memory
+    map (dic_lookup_word lowercases it into a target word on the stack), so
+    it isn't copied to the session's DIC_LWA or strlen'd first the way
+    edx$session_lookup_word does. The session's word to guess is left alone.
+
+    The document is checked CHECK_VIEW_SIZE bytes at a time. A file is
+    mapped one view of that size at a time, so even a file of many
+    gigabytes is checked in the same few megabytes of memory. A word
+    running off the end of a view is checked in the next view, which starts
+    at the word. A word too long to be a word (more than MAXWORDLEN
+    characters) is misspelled, as dic_lookup_word says, and only its length
+    is counted past the end of a view.
+
+ Calling Sequence:
+    chk = edx$check_text(ses, text, textlen, errbuf, errbuflen);
+    chk = edx$check_file(ses, File_Name, errbuf, errbuflen);
+    result = edx$check_next(chk, words, maxwords, &nwords, errbuf, errbuflen);
+    count = edx$check_words(chk);
+    edx$check_close(chk);
+
+ Argument inputs:
+    ses - session to look the words up with. A session checks one document at a time.
+    text, textlen - text buffer to check. It must stay there until edx$check_close.
+    File_Name - file to check
+    words - array of maxwords to put misspelled words in
+
+ Outputs:
+    edx$check_text and edx$check_file return NULL if the file can't be
+    opened or on memory allocation failure. Error text returned in 'errbuf'.
+    nwords - number of misspelled words put in words[], in the order found.
+             Each is the offset of the word from the start of the document
+             and its length.
+    result = EDX__WORDFOUND - words[] is full. Call again for more.
+           = EDX__WORDNOTFOUND - the whole document has been checked
+           = EDX__ERROR - a view of the file could not be mapped. Error text returned in 'errbuf'
+    count - number of words checked so far, misspelled or not
+---------------------------------------------------------------------------*/
+/* A document being checked */
+struct edx_check {
+   struct edx_session *ses;
+   unsigned char *text;              /* edx$check_text: the text (NULL for a file) */
+   HANDLE hFile;                     /* edx$check_file: the file and its mapping */
+   HANDLE hFileMap;
+   DWORD  granularity;               /*   views start on a multiple of this */
+   unsigned __int64 len;             /* length of the document */
+   unsigned __int64 pos;             /* offset of the next character to check */
+   unsigned char *view;              /* the part of the document being checked now (NULL = none) */
+   unsigned __int64 viewofst;        /*   its offset in the document */
+   DWORD  viewlen;                   /*   its length (up to CHECK_VIEW_SIZE) */
+   unsigned __int64 longofst;        /* a word too long to be a word that ran off the end of the last view */
+   DWORD  longlen;                   /*   its length so far (0 = none) */
+   unsigned __int64 words;           /* words checked so far */
+};
+
+/* Put the misspelled word at ofst,len in words[*nwords] */
+void add_misspelling(struct edx_misspelling *words, int *nwords, unsigned __int64 ofst, unsigned __int64 len)
+{
+   words[*nwords].offset = ofst;
+   words[*nwords].length = (len > 0xFFFFFFFF) ? 0xFFFFFFFF : (DWORD)len;
+   ++*nwords;
+}
+
+/* Set chk->view to the part of the document starting at (or for a file,
+   just before) chk->pos. FALSE if a view of the file couldn't be mapped. */
+BOOL check_view_at_pos(struct edx_check *chk, char *errbuf, int errbuflen)
+{
+   if (chk->text != NULL)
+   {
+      chk->viewofst = chk->pos;
+      chk->view = chk->text + chk->pos;
+   }
+   else
+   {
+      chk->viewofst = chk->pos - chk->pos % chk->granularity;
+      chk->view = NULL;
+   }
+   chk->viewlen = (chk->len - chk->viewofst < CHECK_VIEW_SIZE) ? (DWORD)(chk->len - chk->viewofst) : CHECK_VIEW_SIZE;
+   if (chk->text != NULL) {return(TRUE);}
+
+   chk->view = (unsigned char *)MapViewOfFile(chk->hFileMap, FILE_MAP_READ,
+                                              (DWORD)(chk->viewofst >> 32), (DWORD)chk->viewofst, chk->viewlen);
+   if (chk->view == NULL)
+   {
+      FetchErrorText(GetLastError(), "Call to 'MapViewOfFile' failed for the file being checked.", errbuf, errbuflen);
       return(FALSE);
-    }
-    Extended_ANSI_Guessing = FALSE;
-  }
-  return(TRUE);
+   }
+   return(TRUE);
 }
 
-/*****************************************************************************/
-BOOL load_aux1_dic(char *Aux1_File_Name, char *errbuf, int errbuflen)
+/* Check the words of chk->view from chk->pos, putting the misspelled ones
+   in words[*nwords] on. Returns TRUE when done with the view, FALSE when
+   words[] is full. */
+BOOL check_view(struct edx_check *chk, struct edx_misspelling *words, int maxwords, int *nwords)
 {
-  FILE *fpAux1File = NULL;  //User's Aux1 dictionary
-  HANDLE hAux1File;         //Handle to user's Aux1 dictionary
-  DWORD dwAux1FileSize;     //Length of user's Aux1 dictionary. Used to determine how much memory to allocate.
+   unsigned char *p = chk->view + (DWORD)(chk->pos - chk->viewofst);
+   unsigned char *end = chk->view + chk->viewlen;
+   unsigned char *wdbeg;
+   BOOL lastview = (chk->viewofst + chk->viewlen == chk->len);
+   DWORD wdlen;
+
+   /* 1. The rest of a word too long to be a word, begun in the last view */
+   if (chk->longlen > 0)
+   {
+      for (wdbeg = p; p < end && !EDXisspace(*p); ++p);
+      chk->longlen += (DWORD)(p - wdbeg);
+      if (p == end && !lastview) { chk->pos = chk->viewofst + chk->viewlen; return(TRUE); }
+      add_misspelling(words, nwords, chk->longofst, chk->longlen);
+      chk->longlen = 0;
+      ++chk->words;
+   }
 
-  //User's personal Aux1 dictionary is optional.
-  if (Aux1_File_Name == "") {return(TRUE);}
+   /* 2. Each word of the view */
+   for (;;)
+   {
+      while (p < end && EDXisspace(*p)) ++p;
+      chk->pos = chk->viewofst + (p - chk->view);
+      if (p == end) return(TRUE);
+      if (*nwords == maxwords) return(FALSE);
+      for (wdbeg = p; p < end && !EDXisspace(*p); ++p);
+      wdlen = (DWORD)(p - wdbeg);
+      if (p == end && !lastview)            /* runs off the end of the view */
+      {
+         if (wdlen <= MAXWORDLEN) return(TRUE);   /* check it in the next view */
+         chk->longofst = chk->pos;
+         chk->longlen = wdlen;
+         chk->pos = chk->viewofst + chk->viewlen;
+         return(TRUE);
+      }
+      ++chk->words;
+      if (dic_lookup_word(chk->ses, (wdlen > MAXWORDLEN) ? MAXWORDLEN+1 : wdlen, wdbeg) != EDX__WORDFOUND)
+         add_misspelling(words, nwords, chk->pos, wdlen);
+   }
+}
 
-  //Save Aux1 filename
-  strncpy(Aux1File,Aux1_File_Name,FNAMESIZE);
-  Aux1File[FNAMESIZE-1] = '\0';
+int check_next(struct edx_check *chk, struct edx_misspelling *words, int maxwords, int *nwords, char *errbuf, int errbuflen)
+{
+   *nwords = 0;
+   while (chk->pos < chk->len && *nwords < maxwords)
+   {
+      if (chk->view == NULL && !check_view_at_pos(chk, errbuf, errbuflen)) return(EDX__ERROR);
+      if (check_view(chk, words, maxwords, nwords))
+      {
+         if (chk->text == NULL) UnmapViewOfFile(chk->view);
+         chk->view = NULL;
+      }
+   }
+   return( (chk->pos < chk->len) ? EDX__WORDFOUND : EDX__WORDNOTFOUND );
+}
 
-  //OPEN USER'S PERSONAL DICTIONARY (AUX1) and get the size
-  hAux1File = CreateFile (Aux1_File_Name,
-                          GENERIC_READ,
-                          FILE_SHARE_READ,
-                          NULL,
-                          OPEN_ALWAYS,
-                          0,
-                          NULL);
-  if (hAux1File == INVALID_HANDLE_VALUE)
+extern "C" _declspec (dllexport) struct edx_check * edx$check_text(struct edx_session *ses, char *text, unsigned __int64 textlen, char *errbuf, int errbuflen)
+{
+  struct edx_check *chk = new struct edx_check;
+  if (chk == NULL)
   {
-    DWORD dwErrCode = GetLastError();
-    char errmsg[ERRMSGLEN];
-    _snprintf(errmsg, ERRMSGLEN, "Error opening %s", Aux1_File_Name );
-    errmsg[ERRMSGLEN-1] = '\0';
-    FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
-    return(FALSE);
+    _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+    errbuf[errbuflen-1] = '\0';
+    return(NULL);
   }
+  memset(chk, 0, sizeof(struct edx_check));
+  chk->ses = ses;
+  chk->text = (unsigned char *)text;
+  chk->len = textlen;
+  return(chk);
+}
 
-  //GET SIZE OF AUX1 FILE
-  dwAux1FileSize = GetFileSize(hAux1File, NULL);
-  if (dwAux1FileSize == 0xFFFFFFFF)
+extern "C" _declspec (dllexport) struct edx_check * edx$check_file(struct edx_session *ses, char *File_Name, char *errbuf, int errbuflen)
+{
+  struct edx_check *chk;
+  SYSTEM_INFO si;
+  DWORD sizelow, sizehigh;
+
+  chk = new struct edx_check;
+  if (chk == NULL)
   {
-    DWORD dwErrCode = GetLastError();
-    if (dwErrCode != NO_ERROR)
-    {
-       char errmsg[ERRMSGLEN];
-       _snprintf(errmsg, ERRMSGLEN, "Call to 'GetFileSize' failed for file %s", Aux1_File_Name );
-       errmsg[ERRMSGLEN-1] = '\0';
-       FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
-       return(FALSE);
-    }
+    _snprintf(errbuf, errbuflen, "Memory allocation failure.");
+    errbuf[errbuflen-1] = '\0';
+    return(NULL);
   }
-  CloseHandle(hAux1File);
+  memset(chk, 0, sizeof(struct edx_check));
+  chk->ses = ses;
+  GetSystemInfo(&si);
+  chk->granularity = si.dwAllocationGranularity;
 
-  fpAux1File = fopen(Aux1_File_Name,"r");
-  if (fpAux1File == (FILE *) NULL)
+  chk->hFile = CreateFile(File_Name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+  if (chk->hFile == INVALID_HANDLE_VALUE)
   {
+    DWORD dwErrCode = GetLastError();
     char errmsg[ERRMSGLEN];
-    _snprintf(errmsg, ERRMSGLEN, "Error reopening user's personal dictionary file %s.\n", Aux1_File_Name);
+    _snprintf(errmsg, ERRMSGLEN, "Error opening %s", File_Name );
     errmsg[ERRMSGLEN-1] = '\0';
-    return(FALSE);
+    FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
+    delete chk;
+    return(NULL);
   }
+  sizelow = GetFileSize(chk->hFile, &sizehigh);
+  chk->len = ((unsigned __int64)sizehigh << 32) | sizelow;
+  if (chk->len == 0) {return(chk);}        /* nothing to map, nothing to check */
 
-  aux1base = new unsigned char[dwAux1FileSize+2];  //+1 for leading length byte of first word, +1 for trailing NULL byte of last word
-  if (aux1base == 0)
+  chk->hFileMap = CreateFileMapping(chk->hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (chk->hFileMap == NULL || chk->hFileMap == INVALID_HANDLE_VALUE)
   {
     DWORD dwErrCode = GetLastError();
     char errmsg[ERRMSGLEN];
-    _snprintf(errmsg, ERRMSGLEN, "Memory allocation failure.");
+    _snprintf(errmsg, ERRMSGLEN, "Error calling CreateFileMapping for file %s", File_Name );
     errmsg[ERRMSGLEN-1] = '\0';
     FetchErrorText(dwErrCode, errmsg, errbuf, errbuflen );
-    return(FALSE);
+    CloseHandle(chk->hFile);
+    delete chk;
+    return(NULL);
   }
-  aux1ptr = aux1base;  /* Current address into user's AUX1 personal lexical database */
+  return(chk);
+}
 
-//------------------------------------------------------------------------------
-  /* MAIN LOOP. READ FROM USER'S PERSONAL AUX1 DICTIONARY, ADD TO MEMORY DATABASE */
-   int i,j,
-       ln_len,  /* line length */
-       wd_len,  /* word length */
-       wdbeg;
-   int linenum = 0;  /* line number */
+extern "C" _declspec (dllexport) int edx$check_next(struct edx_check *chk, struct edx_misspelling *words, int maxwords, int *nwords, char *errbuf, int errbuflen)
+{
+ int status;
+ BOOL guessing = chk->ses->guessing;
+ __try
+ {
+   session_enter(chk->ses, FALSE);
+   status = check_next(chk, words, maxwords, nwords, errbuf, errbuflen);
+   session_leave(chk->ses, guessing);
+   return(status);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   session_leave(chk->ses, guessing);
+   return(EDX__ERROR);
+ }
+}
 
-   #define WDBUF_SIZE    80    /* Inword buffer */
-   unsigned char  wdbuf[WDBUF_SIZE];
-   char signedwdbuf[WDBUF_SIZE];
+extern "C" _declspec (dllexport) unsigned __int64 edx$check_words(struct edx_check *chk)
+{
+  return(chk->words);
+}
 
-   while ( fgets(signedwdbuf,WDBUF_SIZE,fpAux1File) != 0)
-   {
-      ++linenum;                /* line # of file we're reading */
-      ln_len = strlen(signedwdbuf);   /* Save length of line */
-      if (ln_len == WDBUF_SIZE)
-      {
-         char errmsg[ERRMSGLEN];
-         _snprintf(errmsg, ERRMSGLEN, "Input line too long in user's personal dictionary file.\nLine %d, file %s.\n", linenum, Aux1_File_Name);
-         errmsg[ERRMSGLEN-1] = '\0';
-         return(FALSE);
-      }
+extern "C" _declspec (dllexport) void edx$check_close(struct edx_check *chk)
+{
+  if (chk == NULL) {return;}
+  if (chk->text == NULL && chk->view) { UnmapViewOfFile(chk->view); }
+  if (chk->hFileMap && chk->hFileMap != INVALID_HANDLE_VALUE) { CloseHandle(chk->hFileMap); }
+  if (chk->hFile && chk->hFile != INVALID_HANDLE_VALUE) { CloseHandle(chk->hFile); }
+  delete chk;
+}
 
-      /* Lowercase the string */
-      for ( i = 0; i < ln_len; ++i )
-         wdbuf[i] = ANSItolower( (unsigned char)signedwdbuf[i] );
 
-      /* skip over leading spaces and tabs until we find beginning of word or end of line */
-      for ( wdbeg = 0;
-             EDXisspace(wdbuf[wdbeg])
-            &&
-             wdbeg < ln_len;
-           ++wdbeg );
+/*-----------------------------------------------------------------------------
+    .SBTTL  OPTIONS AND DICTIONARY INFO
 
-      if (wdbeg < ln_len)   /* Is begining of word (else was a blank line)*/
-      {
-         /* Get length of word */
-         for (  j = wdbeg, wd_len=0 ;
-                j < ln_len
-             && !EDXisspace(wdbuf[j]);
-                ++j, ++wd_len );
+ Functional Description:
+    edx$set_option sets one of the EDX_OPT_ options in edxspell.h.
+    Options are copied into a dictionary when it is loaded, so they
+    affect dictionaries loaded after the call (including the default
+    dictionary, which is loaded on the first call to edx$dic_lookup_word).
 
-         if ( wd_len > 31 )
-         {
-            wdbuf[wdbeg+wd_len] = 0;                    /* make ASCIZ string */
-            char errmsg[ERRMSGLEN];
-            _snprintf(errmsg, ERRMSGLEN, "Word too long in user's personal dictionary file.\nMax length is 31 characters.\nLine %d, file %s, word '%s'\n", linenum, Aux1_File_Name, &wdbuf[wdbeg]);
-            errmsg[ERRMSGLEN-1] = '\0';
-            return(FALSE);
-         }
+    edx$dic_info describes the indexes built for an open dictionary:
+    how many words are in them, how much memory they use, and how
+    long they took to build.
 
-/* Move word to output */
-         *aux1ptr++ = (unsigned char) wd_len;         /* Length-byte preceeding each word */
-         for (  i = 0, j = wdbeg;
-                i < wd_len;
-                ++i, ++j )
-         {
-            *aux1ptr++ = wdbuf[j];
-         }
-      }/*endif we have a word*/
-   }/* END MAIN LOOP */
+    edx$session_info reports a session's counters: how many lookups
+    were checked against the Bloom filter, and how many of those the
+    Bloom filter answered without searching the dictionary.
+
+ Calling Sequence:
+    status = edx$set_option(EDX_OPT_HASH_INDEX, 0);
+    edx$dic_info(dic, buf, buflen);
+    edx$session_info(ses, buf, buflen);
+
+ Outputs:
+    edx$set_option returns EDX__ERROR if 'option' is not a valid option.
+---------------------------------------------------------------------------*/
+void format_dic_info(struct edx_dictionary *dic, char *buf, int buflen)
+{
+    char names[128];
+    int len;
+    DWORD i, used, hits, misses, evictions, layerwords;
+
+    if (buflen < 1) {return;}
+    _snprintf(buf, buflen, "Dictionary: version %d, %lu bytes%s%s.\n", dic->dichead->id[0], dic->dwDicFileSize,
+              (dic->dichead6 != NULL) ? ", sections on pages" : "",
+              dic->frontcoded ? ", front coded pages" : (dic->plainbase != NULL) ? ", front coded pages decoded into memory" : "");
+    buf[buflen-1] = '\0';
+    len = strlen(buf);
+    buf += len; buflen -= len;
+    if (buflen < 1) {return;}
+    if (dic->plainbase != NULL)          /* what it cost, and why */
+    {
+      static const char *fc_names[4] = { "hash index", "suggestion index", "word graph", "Levenshtein guessing" };
+      BOOL wanted[4];
+
+      wanted[0] = hash_index_wanted(dic);
+      wanted[1] = (dic->options[EDX_OPT_SYMSPELL] != 0);
+      wanted[2] = (dic->options[EDX_OPT_DAWG] != 0);
+      wanted[3] = (dic->options[EDX_OPT_LEVENSHTEIN] != 0);
+      names[0] = '\0';
+      for (i = 0; i < 4; ++i)
+        if (wanted[i])
+        {
+          if (names[0] != '\0') strcat(names, ", ");
+          strcat(names, fc_names[i]);
+        }
+      _snprintf(buf, buflen, "Front coded pages decoded into %lu KB of memory for the %s.\n", dic->v6head.lexlen / 1024, names);
+      buf[buflen-1] = '\0';
+      len = strlen(buf);
+      buf += len; buflen -= len;
+      if (buflen < 1) {return;}
+    }
+    for (i = 0, layerwords = 0; i < dic->nlayers; ++i)
+    {
+      _snprintf(buf, buflen, "Layer %lu: %lu words, %s.\n", i + 1, dic->layers[i].words, dic->layers[i].Name);
+      buf[buflen-1] = '\0';
+      len = strlen(buf);
+      buf += len; buflen -= len;
+      if (buflen < 1) {return;}
+      layerwords += dic->layers[i].words;
+    }
+    _snprintf(buf, buflen, "Common words: %lu words, hash index %lu bytes.\nAux1 words: %lu words, hash index %lu bytes%s.\nScan kernel: %s.\n",
+              dic->cmnhash.words, dic->cmnhash.bytes, dic->aux1hash.words - layerwords, dic->aux1hash.bytes,
+              (dic->nlayers != 0) ? " (with the layers' words)" : "",
+              (dic->scan == scan_words_scalar) ? "scalar" : "SSE2");
+    buf[buflen-1] = '\0';
+    len = strlen(buf);
+    buf += len; buflen -= len;
+    if (buflen < 1) {return;}
+    if (dic->mainhash.mapped)
+    {
+      _snprintf(buf, buflen, "Hash index: %lu words, %lu bytes, mapped from the dictionary.\n",
+                dic->mainhash.words, dic->mainhash.bytes);
+    }
+    else if (dic->mainhash.tab != NULL)
+    {
+      _snprintf(buf, buflen, "Hash index: %lu words, %lu bytes, built in %.1f ms.\n",
+                dic->mainhash.words, dic->mainhash.bytes, dic->hashbuildms);
+    }
+    else
+    {
+      _snprintf(buf, buflen, "Hash index: not built.\n");
+    }
+    buf[buflen-1] = '\0';
+    len = strlen(buf);
+    buf += len; buflen -= len;
+    if (buflen < 1) {return;}
+    if (dic->bloom != NULL && dic->bloombase == NULL)
+    {
+      _snprintf(buf, buflen, "Bloom filter: %lu words, %lu bytes, %lu bits set per word, mapped from the dictionary.\n",
+                dic->bloomwords, dic->bloomblocks * BLOOM_BLOCK_DWORDS * sizeof(DWORD), dic->bloomk);
+    }
+    else if (dic->bloom != NULL)
+    {
+      _snprintf(buf, buflen, "Bloom filter: %lu words, %lu bytes, %lu bits per word, %lu bits set per word.\n",
+                dic->bloomwords, dic->bloomblocks * BLOOM_BLOCK_DWORDS * sizeof(DWORD),
+                dic->options[EDX_OPT_BLOOM_BITS], dic->bloomk);
+    }
+    else
+    {
+      _snprintf(buf, buflen, "Bloom filter: not built.\n");
+    }
+    buf[buflen-1] = '\0';
+    len = strlen(buf);
+    buf += len; buflen -= len;
+    if (buflen < 1) {return;}
+    if (dic->sym == NULL)
+    {
+      _snprintf(buf, buflen, "Suggestion index: not loaded.\n");
+    }
+    else if (dic->symfile.buildms > 0.0)
+    {
+      _snprintf(buf, buflen, "Suggestion index: %lu deletes, %lu postings, %lu bytes, built in %.1f ms on %lu threads%s%s.\n",
+                dic->sym->nkeys, dic->sym->npostings, dic->sym->filelen, dic->symfile.buildms, dic->symthreads,
+                dic->symfile.Name[0] ? ", saved to " : " (not saved)", dic->symfile.Name);
+    }
+    else
+    {
+      _snprintf(buf, buflen, "Suggestion index: %lu deletes, %lu postings, %lu bytes, mapped from %s.\n",
+                dic->sym->nkeys, dic->sym->npostings, dic->sym->filelen, dic->symfile.Name);
+    }
+    buf[buflen-1] = '\0';
+    len = strlen(buf);
+    buf += len; buflen -= len;
+    if (buflen < 1) {return;}
+    if (dic->dwg == NULL)
+    {
+      _snprintf(buf, buflen, "Word graph: not loaded.\n");
+    }
+    else if (dic->dwgfile.buildms > 0.0)
+    {
+      _snprintf(buf, buflen, "Word graph: %lu words, %lu nodes (%lu before merging), %lu edges, %lu bytes, built in %.1f ms%s%s.\n",
+                dic->dwg->nwords, dic->dwg->nnodes, dic->dwg->treenodes, dic->dwg->nedges, dic->dwg->filelen,
+                dic->dwgfile.buildms, dic->dwgfile.Name[0] ? ", saved to " : " (not saved)", dic->dwgfile.Name);
+    }
+    else
+    {
+      _snprintf(buf, buflen, "Word graph: %lu words, %lu nodes, %lu edges, %lu bytes, mapped from %s.\n",
+                dic->dwg->nwords, dic->dwg->nnodes, dic->dwg->nedges, dic->dwg->filelen, dic->dwgfile.Name);
+    }
+    buf[buflen-1] = '\0';
+    len = strlen(buf);
+    buf += len; buflen -= len;
+    if (buflen < 1) {return;}
+    if (dic->cache == NULL)
+    {
+      _snprintf(buf, buflen, "Lookup cache: not built.\n");
+    }
+    else
+    {
+      for (i = 0, used = 0, hits = 0, misses = 0, evictions = 0; i < CACHE_SHARDS; ++i)
+      {
+        EnterCriticalSection(&dic->cache[i].lock);
+        used += dic->cache[i].used;
+        hits += dic->cache[i].hits;
+        misses += dic->cache[i].misses;
+        evictions += dic->cache[i].evictions;
+        LeaveCriticalSection(&dic->cache[i].lock);
+      }
+      _snprintf(buf, buflen, "Lookup cache: %lu of %lu words, %lu hits, %lu misses, %lu evictions.\n",
+                used, dic->cache[0].size * CACHE_SHARDS, hits, misses, evictions);
+    }
+    buf[buflen-1] = '\0';
+    len = strlen(buf);
+    buf += len; buflen -= len;
+    if (buflen < 1) {return;}
+    if (dic->guesscache == NULL)
+    {
+      _snprintf(buf, buflen, "Guess cache: not built.\n");
+    }
+    else
+    {
+      EnterCriticalSection(&dic->guesscache->lock);
+      _snprintf(buf, buflen, "Guess cache: %lu of %lu words, %lu hits, %lu misses, %lu evictions, file %s.\n",
+                dic->guesscache->used, dic->guesscache->size, dic->guesscache->hits, dic->guesscache->misses,
+                dic->guesscache->evictions, (dic->GuessCacheFile[0] != '\0') ? dic->GuessCacheFile : "none");
+      LeaveCriticalSection(&dic->guesscache->lock);
+    }
+    buf[buflen-1] = '\0';
+    len = strlen(buf);
+    buf += len; buflen -= len;
+    if (buflen < 1) {return;}
+    residency_names(dic->resident, names, sizeof(names));
+    _snprintf(buf, buflen, "Residency: %s", names);
+    buf[buflen-1] = '\0';
+    len = strlen(buf);
+    buf += len; buflen -= len;
+    if (buflen < 1) {return;}
+    if (dic->resident & ~EDX_RES_RANDOM)
+    {
+      _snprintf(buf, buflen, ", in %.1f ms%s", dic->residentms, (dic->hotbase != NULL) ? ", hot sections in large pages" : "");
+      buf[buflen-1] = '\0';
+      len = strlen(buf);
+      buf += len; buflen -= len;
+      if (buflen < 1) {return;}
+    }
+    if (dic->options[EDX_OPT_RESIDENCY] & ~dic->resident)
+    {
+      residency_names(dic->options[EDX_OPT_RESIDENCY] & ~dic->resident, names, sizeof(names));
+      _snprintf(buf, buflen, " (couldn't: %s)", names);
+      buf[buflen-1] = '\0';
+      len = strlen(buf);
+      buf += len; buflen -= len;
+      if (buflen < 1) {return;}
+    }
+    _snprintf(buf, buflen, ".\n");
+    buf[buflen-1] = '\0';
+}
 
-/* Assume we exit loop because fgets reached End Of File. (No fancy error checking) */
-  *aux1ptr++ = '\0';      /* NULL after last word indicates end of lexical word list*/
-  fclose(fpAux1File);
-  return(TRUE);
+void format_session_info(struct edx_session *ses, char *buf, int buflen)
+{
+    if (buflen < 1) {return;}
+    _snprintf(buf, buflen, "Bloom filter: %lu lookups, %lu rejected without searching.\n"
+                           "Levenshtein automaton: %lu searches, %lu pages searched, %lu pages skipped, %lu stopped by budget.\n",
+              ses->bloom_lookups, ses->bloom_rejects,
+              ses->lev_searches, ses->lev_pages, ses->lev_skipped, ses->lev_budget_stops);
+    buf[buflen-1] = '\0';
 }
-/******************************************************************************/
-// Dic_File_Name is name of main EDX spelling dictionary (the EDX lexical database file)
-// Aux1_File_Name is the name of the user's personal auxiliary spelling dictionary (Aux1)
-BOOL spell_init(char *Dic_File_Name, char *Aux1_File_Name, char *errbuf, int errbuflen)
+
+extern "C" _declspec (dllexport) int edx$set_option(int option, unsigned long value)
 {
-  if (dic_loaded) { return(TRUE); }
+    if (option < 0 || option >= EDX_NUM_OPTIONS) {return(EDX__ERROR);}
+    dic_options[option] = value;
+    return(EDX__WORDFOUND);
+}
 
-  if ( !load_main_dic(Dic_File_Name, errbuf, errbuflen) ) return(FALSE);
+extern "C" _declspec (dllexport) void edx$dic_info(struct edx_dictionary *dic, char *buf, int buflen)
+{
+    struct edx_dictionary *retired;
+    DWORD nretired = 0;
+    int len;
 
-  if ( !load_aux1_dic(Aux1_File_Name, errbuf, errbuflen) ) return(FALSE);
+    if (buflen < 1) {return;}
+    if (dic == NULL) {buf[0] = '\0'; return;}
+    format_dic_info(dic_lock(dic), buf, buflen);
+    for (retired = dic->retired; retired != NULL; retired = retired->nextretired) ++nretired;
+    len = strlen(buf);
+    if (buflen - len > 1)
+    {
+      _snprintf(buf + len, buflen - len, "Reloads: %lu, %lu replaced dictionaries still in use.\n", dic->live->generation, nretired);
+      buf[buflen-1] = '\0';
+    }
+    dic_unlock(dic);
+}
 
-  dic_loaded = TRUE;  //dic_loaded now means both main dictionary and optinal aux1 dictionary
-  return(TRUE);
+extern "C" _declspec (dllexport) void edx$session_info(struct edx_session *ses, char *buf, int buflen)
+{
+    if (buflen < 1) {return;}
+    if (ses == NULL) {buf[0] = '\0'; return;}
+    format_session_info(ses, buf, buflen);
 }
 
-/*---------------------------------------------------------------------------
-    .SUBTITLE BINSRCH_MAINDIC
+/*-----------------------------------------------------------------------------
+    .SBTTL  EDX$STATS
 
  Functional Description:
-    The index to the dictionary main lexical database is searched
-    to determine the page range within which target_word must lie
-    if it exists.
+    Reports the hot path counters (see HOT PATH COUNTERS) of all the
+    sessions on a dictionary since it was opened, as text, or as one
+    line of JSON for a program to read.
 
  Calling Sequence:
-    binsrch_maindic( &low, &high, &target_word, &errbuf, errbuflen );
+    status = edx$stats(dic, EDX_STATS_TEXT, buf, buflen);
 
  Argument inputs:
-    target_word - character array of word to match, blank padded to
-                      dichead->indswd (by reference)
+    dic - dictionary from edx$dic_open, or NULL for the default dictionary
+          of the original edx$dic_lookup_word interface
+    format - EDX_STATS_TEXT or EDX_STATS_JSON
 
  Outputs:
-    low - dictionary page number below which word would not reside (by reference)
-    high - dictionary page number above which word would not reside (by reference)
-    (NOTE: The first dictionary page number is 0.)
-
+    status = EDX__WORDFOUND - the report is in buf
+           = EDX__ERROR - it didn't fit in buf, or the DLL was compiled
+                          without the counters (buf says so)
 ---------------------------------------------------------------------------*/
-void binsrch_maindic( DWORD *low,
-                      DWORD *high,
-                      unsigned char *target_word )
+extern "C" _declspec (dllexport) int edx$stats(struct edx_dictionary *dic, int format, char *buf, int buflen)
 {
-   unsigned char *dicindptr = (unsigned char *)dichead + dichead->indofst;  /* Starting address of index */
-   int cmp;     /* Result of memory compare memcmp */
-   DWORD newdpn;  /* new dictionary page number to try */
-
-/* PREPARE FOR BINARY SEARCH */
-   *high = dichead->nidxwds - 1;   /* Highest dictionary page number [minus one because we start count at zero](number of index guide words. One guide word for each page.) */
-   *low = 0;  /* Start at low dictionary page number = 0 (first page)*/
-
-/* BINARY SEARCH THE INDEX */
-   for (;;)
-   {
-      newdpn = (*low + *high)/2;
-      if (newdpn == *low) break;           /* exitloop when guess=lowb */
-      cmp = memcmp(target_word, dicindptr + newdpn*dichead->indswd, dichead->indswd);
-      if (cmp == 0) break;          /* switch to linear search */
-      if (cmp > 0) *low = newdpn;          /* word is in higher half */
-      else *high = newdpn;             /* else word is in lower half */
-   }/*endloop */
-
-/* NOW DO LINEAR SEARCH UP AND DOWN TO FIND TRUE PAGE BOUNDARIES */
-/* FIRST LOOK TOWARD Z'S FOR newdpn > TARGET_INDEX OR END OF DICTIONARY */
-/* Set upper bound page #.  NOTE: Search is to INCLUDE this page up to
-first length-byte.  Word we are looking for may be at the end of prev
-page spilling over into this page.  ALSO NOTE: if word is in very last
-page of dictionary past last guide word then we must increment high by
-one to include the last page.  */
-   *high = dichead->nidxwds -1;   /* number of last page in dictionary [minus one because we start count at zero](number of index guide words) */
-   while( (cmp = memcmp(target_word,
-                       dicindptr + newdpn*dichead->indswd,
-                       dichead->indswd))
-          >= 0  &&  newdpn != *high ) ++newdpn;
-   *high = newdpn;             /* Set upper bound page # */
-   if (cmp >= 0) ++*high;       /* include very last page of dictionary if need be */
-
+#ifdef EDX_STATS
+    struct edx_stats total;
+    DWORD nsessions;
+    BOOL fits;
 
-/* SEARCH FOR newdpn < TARGET_INDEX OR BEGINNING OF DICTIONARY */
-   while( memcmp(target_word,
-                 dicindptr + newdpn*dichead->indswd,
-                 dichead->indswd)
-          <= 0  &&  newdpn != 0 ) --newdpn;
-   *low = newdpn;  /* set lower bound page # */
+    if (buflen < 1) {return(EDX__ERROR);}
+    if (dic == NULL)
+    {
+      if (!dic_loaded) {memset(&total, 0, sizeof(total)); return( format_stats(&total, 0, format, buf, buflen) ? EDX__WORDFOUND : EDX__ERROR );}
+      dic = &default_dic;
+    }
+    EnterCriticalSection(&dic->reloadlock);
+    nsessions = sum_stats(dic, &total);
+    LeaveCriticalSection(&dic->reloadlock);
+    fits = format_stats(&total, nsessions, format, buf, buflen);
+    return(fits ? EDX__WORDFOUND : EDX__ERROR);
+#else
+    if (buflen < 1) {return(EDX__ERROR);}
+    _snprintf(buf, buflen, (format == EDX_STATS_JSON) ? "{\"enabled\":false}\n" : "Hot path counters: not compiled in.\n");
+    buf[buflen-1] = '\0';
+    return(EDX__ERROR);
+#endif
 }
 
-/*=============================================================================
-    .SUBTITLE DIC_LOOKUP_WORD
+/*-----------------------------------------------------------------------------
+    .SBTTL  EDX$LATENCY, EDX$TRACE_SAVE
 
  Functional Description:
-    Searches the EDX dictionary for a given word
+    edx$latency reports the latency histograms (see LATENCY HISTOGRAMS AND
+    TRACING) of a dictionary since it was opened: for each kind of call
+    timed, the number of calls, the 50th, 90th, 99th and 99.9th percentile
+    time and the slowest, as text, or as one line of JSON with the
+    histogram buckets too, for a program to read.
+    edx$trace_save writes the trace of the slow calls to a file that
+    chrome://tracing, Perfetto (ui.perfetto.dev) and speedscope load.
+
+    Set option EDX_OPT_LATENCY to time calls, and EDX_OPT_TRACE_US to a
+    number of microseconds to trace the calls slower than that, before
+    opening the dictionary.
 
  Calling Sequence:
-    status = dic_lookup_word(wdlen, wdbeg, errbuf, errbuflen, Dic_File_Name, Aux1_File_Name)
+    status = edx$latency(dic, EDX_STATS_TEXT, buf, buflen);
+    status = edx$trace_save(dic, File_Name, errbuf, errbuflen);
 
  Argument inputs:
-    wdlen - length of word
-    wdbeg - pointer to start of word
-    errbuf - buffer to put any error message in to return to caller (let caller display it)
-    errbuflen - length of errbuf.
-    Dic_File_Name - name of dictionary file to pass to Spell_Init
-    Aux1_File_Name - name of user's personal dictionary file to pass to Spell_Init.
-                     May be NULL "" if user does not have a personal dictionary file.
-                     A user's personal dictionary file is a plain text file with
-                     one word per line. This file is checked when spell checking
-                     and when spell guessing.
+    dic - dictionary from edx$dic_open, or NULL for the default dictionary
+          of the original edx$dic_lookup_word interface
+    format - EDX_STATS_TEXT or EDX_STATS_JSON
+    File_Name - trace file to write (Chrome trace event JSON)
 
  Outputs:
-    status = EDX__WORDFOUND - word was found
-           = EDX__WORDNOTFOUND - word was not found
-           = EDX__ERROR - an error was encountered. Error text returned in 'errbuf'
-
- Outline:
-    1.  The input word is copied to target_word buffer and lowercased.
-
-    2.  The dictionary common word list is searched for the word.
-
-    3.  The main lexical database is searched for the word.
-
+    status = EDX__WORDFOUND - the report is in buf, or the trace written
+           = EDX__ERROR - it didn't fit in buf, the file couldn't be
+                          written (errbuf says why), or the DLL was
+                          compiled without them (EDX_NO_STATS)
 ---------------------------------------------------------------------------*/
-
-int dic_lookup_word(int wdlen, unsigned char *wdbeg, char *errbuf, int errbuflen, char *Dic_File_Name, char *Aux1_File_Name)
+extern "C" _declspec (dllexport) int edx$latency(struct edx_dictionary *dic, int format, char *buf, int buflen)
 {
-   DWORD i;
-   DWORD low;       /* lower bound page # */
-   DWORD high;      /* upper bound page # */
-   unsigned char *wdend;     /* word pointer */
-   unsigned char *wdptr;     /* word pointer */
-   unsigned char *dptr;      /* pointer into dictionary into word */
-   unsigned char *lbptr;     /* pointer to length-byte of current word */
-   unsigned char *tptr;      /* pointer into target_word */
-   unsigned char *endrange;
-   DWORD target_word_len;            /* length of target word */
-   unsigned char target_word[MAXWORDLEN+1];   /* word spelling checker is currently checking */
-
-   if (!spell_init(Dic_File_Name,Aux1_File_Name,errbuf,errbuflen)) { return(EDX__ERROR); }
-
-   unsigned char *cmnwdsptr = (unsigned char *)dichead + dichead->cwdofst;  /* Starting address of common words */
-   unsigned char *diclexdba = (unsigned char *)dichead + dichead->lexofst;  /* Starting address of main lexical database */
-   //char *dicindptr = (char *)dichead + dichead->indofst;  /* Starting address of index */
-/* NOTE: pages referred to are edx_dictionary pages of size DICPLN */
-
-   /* SETUP_DICWORD */
-   /* Move misspelled word to storage place, lowercase, and blank pad
-      to INDSWD in length (so we can compare it with guide words) */
-
-   if (wdlen == 0) return(EDX__WORDFOUND);     /* accept zero length word as OK */
-   if (wdlen > MAXWORDLEN) return(EDX__WORDNOTFOUND); /* Word too long.  Can't possibly be a word.  User probably doesn't want us to stop on it anyway. */
-   wdend = wdbeg + wdlen;               /* wdend -> char after last char of word */
-   for ( wdptr = wdbeg, i = 0;
-         wdptr < wdend;
-         ++wdptr, ++i )
-      target_word[i] = ANSItolower(*wdptr);
-   target_word_len = wdlen;
-
-   for ( ; i < dichead->indswd; ++i )          /* BLANK PAD TO INDSWD LENGTH */
-      target_word[i] = SPACE;
+#ifdef EDX_STATS
+    struct lat_hist *total;
+    struct edx_session *ses;
+    BOOL fits;
+
+    if (buflen < 1) {return(EDX__ERROR);}
+    total = new_latency();
+    if (total == NULL)
+    {
+      _snprintf(buf, buflen, "Memory allocation failure.");
+      buf[buflen-1] = '\0';
+      return(EDX__ERROR);
+    }
+    if (dic == NULL && dic_loaded) dic = &default_dic;
+    if (dic != NULL)
+    {
+      EnterCriticalSection(&dic->reloadlock);
+      for (ses = dic->sessions; ses != NULL; ses = ses->nextses)
+        if (ses->latency != NULL) add_latency(total, ses->latency);
+      EnterCriticalSection(&dic->latencylock);
+      if (dic->latency != NULL) add_latency(total, dic->latency);
+      LeaveCriticalSection(&dic->latencylock);
+      LeaveCriticalSection(&dic->reloadlock);
+    }
+    fits = format_latency(total, format, buf, buflen);
+    delete[] total;
+    return(fits ? EDX__WORDFOUND : EDX__ERROR);
+#else
+    if (buflen < 1) {return(EDX__ERROR);}
+    _snprintf(buf, buflen, (format == EDX_STATS_JSON) ? "{\"enabled\":false}\n" : "Latency histograms: not compiled in.\n");
+    buf[buflen-1] = '\0';
+    return(EDX__ERROR);
+#endif
+}
 
-/* SEARCH COMMON WORD LIST FOR MATCH */
-   if (target_word_len <= dichead->cwdmln)     /* skip if target_word is too long to be in commonword list */
-   {
-      endrange = cmnwdsptr + dichead->cwdlen;  /* end of commonwords */
-      lbptr = cmnwdsptr;                       /* start at beginning of common words */
-      while (lbptr < endrange)                 /* still in range of dictionary we're searching */
+extern "C" _declspec (dllexport) int edx$trace_save(struct edx_dictionary *dic, char *File_Name, char *errbuf, int errbuflen)
+{
+#ifdef EDX_STATS
+    if (dic == NULL)
+    {
+      if (!dic_loaded)
       {
-         if (*lbptr == 0x00) break;            /* End of Lexical Database */
-         if ((DWORD)*lbptr == target_word_len)         /* check if word lengths match first */
-         {
-            for ( tptr = target_word + target_word_len -1,  /* start tptr at last char of target_word */
-                  dptr = lbptr + target_word_len;           /* start dptr at last char of word in dictionary */
-                  tptr >= target_word && *tptr == *dptr;    /* while chars match up to beginning of word */
-                  --tptr, --dptr);                          /* move back a char */
-            if (tptr < target_word) return(EDX__WORDFOUND); /* word found */
-         }
-         lbptr += *lbptr + 1;                   /* move to next word */
+        _snprintf(errbuf, errbuflen, "No EDX dictionary loaded. Call edx$dic_lookup_word first.");
+        errbuf[errbuflen-1] = '\0';
+        return(EDX__ERROR);
       }
-   }
+      dic = &default_dic;
+    }
+    return( save_trace(dic, File_Name, errbuf, errbuflen) );
+#else
+    _snprintf(errbuf, errbuflen, "Tracing: not compiled in.");
+    errbuf[errbuflen-1] = '\0';
+    return(EDX__ERROR);
+#endif
+}
 
-/* SEARCH MAIN DICTIONARY FOR MATCH */
-   binsrch_maindic( &low, &high, (unsigned char *)&target_word );
 
-/* Linear search dictionary pages for match to target word.  Compare
-   found word with target word starting with last character and moving
-   to front of word.  We do this because we already expect the first
-   few characters of the word to match if we're looking in the right
-   area of the dictionary.
-*/
-   endrange = diclexdba + (high * dichead->dicpln);
+/*-----------------------------------------------------------------------------
+    .SBTTL  SAVE AND VERIFY DICTIONARY
 
-/*//DEBUG
-   char *lbptra = diclexdba + (low * dichead->dicpln);
-   char *diclexend = diclexdba + dichead->lexlen;
-   sprintf(errbuf,"low=%u high=%u dichead=%x diclexdba=%x diclexend=%x lbptra=%x lbptr=%x endrange=%x *lbptra=%c *lbptr=%c",low,high,dichead,diclexdba,diclexend,lbptra,lbptr,endrange,*lbptra,*lbptr);
-   return(31);
-*/
+ Functional Description:
+    edx$dic_save writes an open dictionary as a version 6 dictionary
+    (see VERSION 6 DICTIONARIES), with the hash index, Bloom filter,
+    suggestion index and word graph it has loaded saved in it, so a
+    program loading the new dictionary with the same options maps them
+    instead of building or reading them. Set the options for the indexes
+    wanted before opening the dictionary to save. (A Bloom filter saved
+    from a dictionary opened with an Aux1 file has the Aux1 words in it
+    too, which does no harm but wastes a little of it, and one saved from
+    a dictionary stack has its layers' words in it.) If option
+    EDX_OPT_FRONT_CODE was set when the dictionary was opened, the main
+    lexical database is saved as front coded pages (see FRONT CODED
+    PAGES), with the Bloom filter but not the other indexes, which point
+    at words in whole word pages.
+
+    edx$dic_verify checks each section of a version 6 dictionary against
+    its checksum, which reads the whole file. (load_main_dic only checks
+    the header's.) Version 4 and 5 dictionaries have no checksums.
 
-   for ( lbptr = diclexdba + (low * dichead->dicpln); *lbptr > 31; ++lbptr);  /* find a length-byte */
-   while (lbptr < endrange)
-   {
-      if (*lbptr == 0x00) break;                            /* End of Lexical Database */
-      if ((DWORD)*lbptr == target_word_len)                 /* check if word lengths match first */
-      {
-         for ( tptr = target_word + target_word_len -1,     /* start tptr at last char of target_word */
-               dptr = lbptr + target_word_len;              /* start dptr at last char of word in dictionary */
-               tptr >= target_word && *tptr == *dptr;       /* while chars match up to beginning of word */
-               --tptr, --dptr);                             /* move back a char */
-         if (tptr < target_word) return(EDX__WORDFOUND);    /* word found */
-      }
-      lbptr += *lbptr + 1;                  /* move to next word */
-   }
+ Calling Sequence:
+    status = edx$dic_save(dic, File_Name, errbuf, errbuflen);
+    status = edx$dic_verify(dic, errbuf, errbuflen);
 
-/* SEARCH USER'S PERSONAL AUX1 DICTIONARY FOR MATCH */
-   if (aux1base != NULL)  //If there is a user's personal Aux1 dictionary
-   {
-      lbptr = aux1base;                        /* start at beginning of words */
-      while (TRUE)
-      {
-         if (*lbptr == 0x00) break;            /* End of Lexical Database */
-         if ((DWORD)*lbptr == target_word_len)         /* check if word lengths match first */
-         {
-            for ( tptr = target_word + target_word_len -1,  /* start tptr at last char of target_word */
-                  dptr = lbptr + target_word_len;           /* start dptr at last char of word in dictionary */
-                  tptr >= target_word && *tptr == *dptr;    /* while chars match up to beginning of word */
-                  --tptr, --dptr);                          /* move back a char */
-            if (tptr < target_word) return(EDX__WORDFOUND); /* word found */
-         }
-         lbptr += *lbptr + 1;                   /* move to next word */
-      }
-   }
+ Outputs:
+    EDX__WORDFOUND if all went well, else EDX__ERROR with error text
+    returned in 'errbuf'.
+---------------------------------------------------------------------------*/
+extern "C" _declspec (dllexport) int edx$dic_save(struct edx_dictionary *dic, char *File_Name, char *errbuf, int errbuflen)
+{
+ int status;
+ __try
+ {
+   status = dic_save(dic_lock(dic), File_Name, errbuf, errbuflen);
+   dic_unlock(dic);
+   return(status);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   dic_unlock(dic);
+   return(EDX__ERROR);
+ }
+}
 
-/* DROP OUT BOTTOM IF WORD NOT FOUND IN MAIN DICTIONARY */
-   return(EDX__WORDNOTFOUND);      /* WORD NOT FOUND ANYWHERE.  SORRY */
+extern "C" _declspec (dllexport) int edx$dic_verify(struct edx_dictionary *dic, char *errbuf, int errbuflen)
+{
+ int status;
+ __try
+ {
+   status = dic_verify(dic_lock(dic), errbuf, errbuflen);
+   dic_unlock(dic);
+   return(status);
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   dic_unlock(dic);
+   return(EDX__ERROR);
+ }
 }
 
-/*===============================================================================
- * Main entry point. Fills in globals dic_lwa with word, dic_lwl with word length,
- * Resets GMODE, GOF, and GSUBMODE for possible call to edx$spell_guess
+
+/*-----------------------------------------------------------------------------
+    .SBTTL  SCAN BENCHMARK
+
  Functional Description:
-    Searches the EDX dictionary for a given word
+    Times the scan kernels (see SCAN KERNELS) on a dictionary's main
+    lexical database, and checks they agree.
+    For each kernel, searches the whole main lexical database for words
+    of length 2 to 12 which aren't there, over and over for about a
+    quarter second, and reports millions of bytes scanned per second.
+    Then looks up every 97th word of the main lexical database, and the
+    same word with its last letter changed, with each kernel, and reports
+    how many times the kernels disagreed (should be 0).
 
  Calling Sequence:
-    status = edx$dic_lookup_word(char *spellword, char *errbuf, int errbuflen, char *Dic_File_Name, char *Aux1_File_Name);
-
- Argument inputs:
-    spellword - word to check spelling of
-    errbuf - buffer to put any error message in to return to caller (let caller display it)
-    errbuflen - length of errbuf.
-    Dic_File_Name - name of EDX dictionary file to pass to Spell_Init
-    Aux1_File_Name - name of user's personal dictionary file to pass to Spell_Init.
-                     May be NULL "" if user does not have a personal dictionary file.
-                     A user's personal dictionary file is a plain text file with
-                     one word per line. This file is checked when spell checking
-                     and when spell guessing.
+    edx$scan_benchmark(dic, buf, buflen);
 
  Outputs:
-    status = EDX__WORDFOUND - word was found
-           = EDX__WORDNOTFOUND - word was not found
-           = EDX__ERROR - an error was encountered. Error text returned in 'errbuf'
- *===============================================================================*/
-extern "C" _declspec (dllexport) int edx$dic_lookup_word(char *spellword, char *errbuf, int errbuflen, char *Dic_File_Name, char *Aux1_File_Name)
+    Report returned in 'buf' (buflen 500 is plenty).
+---------------------------------------------------------------------------*/
+void scan_benchmark(struct edx_dictionary *dic, char *buf, int buflen)
 {
-   gof = gsubmode = 0;                 /* reset GMODE, GOF, and GSUBMODE, incase we start spell guessing */
-   gmode = GUSREV;
-   strncpy( (char *)dic_lwa,spellword,MAXWORDLEN);
-   dic_lwl = strlen(spellword);
+#define NUM_KERNELS 2
+   scan_kernel kernels[NUM_KERNELS];
+   char *kernel_names[NUM_KERNELS] = { "scalar", "SSE2" };
+   unsigned char target_word[MAXWORDLEN+1];
+   unsigned char *diclexdba, *diclexend, *lbptr;
+   LARGE_INTEGER start;
+   double ms;
+   DWORD k, len, passes, wordno, mismatches;
+   BOOL found[NUM_KERNELS];
+   int n;
+   char *errbuf = buf;       /* for LOAD_EIPE_ERROR_MESSAGE */
+   int errbuflen = buflen;
+
+   if (buflen < 1) {return;}
+   if (dic == NULL) {buf[0] = '\0'; return;}
+   buf[0] = '\0';
+   if (dic->frontcoded)
+   {
+      _snprintf(buf, buflen, "Not available: the dictionary's pages are front coded, and aren't scanned.\n");
+      buf[buflen-1] = '\0';
+      return;
+   }
+   kernels[0] = scan_words_scalar;
+   kernels[1] = select_scan_kernel(TRUE);
+   if (kernels[1] == scan_words_scalar) kernels[1] = NULL;  /* no SSE2 */
+   diclexdba = dic->diclexdba;
+   diclexend = diclexdba + dic->dichead->lexlen;
+
  __try
  {
-   return( dic_lookup_word(dic_lwl, dic_lwa, errbuf, errbuflen, Dic_File_Name, Aux1_File_Name) );
+   for (k = 0; k < NUM_KERNELS; ++k)
+   {
+      n = strlen(buf);
+      if (kernels[k] == NULL)
+      {
+        _snprintf(buf + n, buflen - n, "%s: not available.\n", kernel_names[k]);
+        buf[buflen-1] = '\0';
+        continue;
+      }
+      QueryPerformanceCounter(&start);
+      passes = 0;
+      do
+      {
+         for (len = 2; len <= 12; ++len, ++passes)
+         {
+            memset(target_word, SPACE, sizeof(target_word));
+            memset(target_word, 'q', len);          /* not a word */
+            kernels[k](diclexdba, diclexend, dic->maplimit, target_word, len);
+         }
+         ms = elapsed_ms(start);
+      } while (ms < 250.0);
+      _snprintf(buf + n, buflen - n, "%s: %.0f million bytes scanned per second.\n",
+                kernel_names[k], (double)passes * dic->dichead->lexlen / (ms * 1000.0));
+      buf[buflen-1] = '\0';
+   }
+
+   mismatches = 0;
+   for ( lbptr = diclexdba, wordno = 0;
+         lbptr < diclexend && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+         lbptr += *lbptr + 1, ++wordno )
+   {
+      if (wordno % 97 != 0) continue;
+      len = *lbptr;
+      memset(target_word, SPACE, sizeof(target_word));
+      memcpy(target_word, lbptr + 1, len);
+      for (n = 0; n < 2; ++n)
+      {
+         if (n == 1) target_word[len-1] = (target_word[len-1] == 'q') ? 'x' : 'q';
+         for (k = 0; k < NUM_KERNELS; ++k)
+            found[k] = kernels[k] ? kernels[k](diclexdba, diclexend, dic->maplimit, target_word, len) : found[0];
+         if (found[1] != found[0] || (n == 0 && !found[0])) ++mismatches;
+      }
+   }
+   n = strlen(buf);
+   _snprintf(buf + n, buflen - n, "Kernels disagreed %lu times.\n", mismatches);
+   buf[buflen-1] = '\0';
  }
  __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
             EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
  {
    // Failed to read from the view.
    LOAD_EIPE_ERROR_MESSAGE
-   return(EDX__ERROR);
  }
 }
-/*--------------------------------------------------------------------------
-    .SUBTITLE SPELL_GUESS
 
- Functional Description:
-    Guesses the spelling of misspelled word stored in DIC_LWA,DIC_LWL.
-    Algorythm taken from the very popular Vassar Spelling Checker.
-    With credit to Vassar where credit is due.
+extern "C" _declspec (dllexport) void edx$scan_benchmark(struct edx_dictionary *dic, char *buf, int buflen)
+{
+   scan_benchmark(dic_lock(dic), buf, buflen);
+   dic_unlock(dic);
+}
 
- Outline:
-    1.  spell_gusrev   Reversals   (test for transposed characters)
-    2.  spell_gusvol   vowels      (test for wrong vowel used)
-    3.  spell_gusmin   minus chars (test for extra character in word)
-    4.  spell_guspls   plus chars  (test for character missing from word)
-    5.  spell_guscon   consonants  (test for wrong character used)
-    6.  give up     (give up)
 
-Updated 11/03/2006
- I defined Extended_ANSI_Guessing. If TRUE, spell guessing will use
- those extended characters with accents in spell guessing.
- Characters such as                                   
+/*-----------------------------------------------------------------------------
+    .SBTTL  INDEX BENCHMARK
 
+ Functional Description:
+    Times the search of the guide word index (see BINSRCH_MAINDIC) with
+    and without the guide word index acceleration, and checks they agree.
+    Searches for every word of the main lexical database and the same word
+    with its last letter changed, over and over for about a quarter second
+    each way, and reports nanoseconds per search and how many times the
+    two disagreed on the page range (should be 0).
+
+ Calling Sequence:
+    edx$index_benchmark(dic, buf, buflen);
 
+ Outputs:
+    Report returned in 'buf' (buflen 500 is plenty).
 ---------------------------------------------------------------------------*/
-BOOL spell_gusrev(unsigned char *guess_word)
+void index_benchmark(struct edx_dictionary *dic, char *buf, int buflen)
 {
-   int status;
-   unsigned char temp;
+   unsigned char *targets;   /* every word, and every word with its last letter changed, blank padded to indswd */
+   unsigned char *diclexdba, *diclexend, *lbptr, *tptr;
+   DWORD indswd, ntargets, t, searches, mismatches, low, high, low2, high2;
+   LARGE_INTEGER start;
+   double ms, ns[2];
+   int pass;
+   char *errbuf = buf;       /* for LOAD_EIPE_ERROR_MESSAGE */
+   int errbuflen = buflen;
+
+   if (buflen < 1) {return;}
+   buf[0] = '\0';
+   if (dic == NULL) {return;}
+   if (dic->guidekeys == NULL)
+   {
+      _snprintf(buf, buflen, "Guide word index acceleration not built.\n");
+      buf[buflen-1] = '\0';
+      return;
+   }
+   diclexdba = main_words(dic, &diclexend);      /* (front coded pages decoded) */
+   if (diclexdba == NULL) {return;}
+   indswd = dic->dichead->indswd;
 
-   /* Guess reversals.
-      Copy word and transpose x with x+1 */
-   while(gof < dic_lwl-1)                      /* test for beyond end of word */
+ __try
+ {
+   ntargets = 2 * count_words(diclexdba, diclexend);
+   targets = new unsigned char[ntargets * (MAXWORDLEN+1)];
+   if (targets == NULL)
+   {
+      _snprintf(buf, buflen, "Memory allocation failure.");
+      buf[buflen-1] = '\0';
+      free_main_words(dic, diclexdba);
+      return;
+   }
+   for ( lbptr = diclexdba, tptr = targets;
+         lbptr < diclexend && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+         lbptr += *lbptr + 1, tptr += 2*(MAXWORDLEN+1) )
+   {
+      setup_dicword(dic, *lbptr, lbptr + 1, tptr);
+      setup_dicword(dic, *lbptr, lbptr + 1, tptr + MAXWORDLEN+1);
+      tptr[MAXWORDLEN+1 + *lbptr - 1] = (tptr[*lbptr - 1] == 'q') ? 'x' : 'q';
+   }
+
+   mismatches = 0;
+   for (t = 0, tptr = targets; t < ntargets; ++t, tptr += MAXWORDLEN+1)
+   {
+      binsrch_guidewords(dic, &low, &high, tptr);
+      binsrch_maindic(dic, &low2, &high2, tptr);
+      if (low != low2 || high != high2) ++mismatches;
+   }
+
+   for (pass = 0; pass < 2; ++pass)
    {
-      if (dic_lwa[gof] != dic_lwa[gof+1])      /* don't swap if characters are identical */
+      QueryPerformanceCounter(&start);
+      searches = 0;
+      do
       {
-         memcpy(guess_word,dic_lwa,dic_lwl);   /* copy over word */
-         guess_word[dic_lwl] = '\0';
-         temp = guess_word[gof];               /* swap chars */
-         guess_word[gof] = guess_word[gof+1];
-         guess_word[gof+1] = temp;
-         status = dic_lookup_word( dic_lwl, guess_word, "", 0, "", "" );   /* see if word exists */
-         //status = EDX__WORDFOUND; //for debugging
-         if (status == EDX__WORDFOUND)
+         for (t = 0, tptr = targets; t < ntargets; ++t, tptr += MAXWORDLEN+1)
          {
-            ++gof;                             /* move to next character for reentry */
-            return(TRUE);                      /* return with guessword containing a correctly spelled word, status */
+            if (pass == 0) binsrch_guidewords(dic, &low, &high, tptr);
+            else           binsrch_maindic(dic, &low, &high, tptr);
          }
-      }
-      ++gof;                        /* move to next character */
+         searches += ntargets;
+         ms = elapsed_ms(start);
+      } while (ms < 250.0);
+      ns[pass] = ms * 1000000.0 / searches;
    }
-   return(FALSE);         /* no more guess words found */
+   delete[] targets;
+   free_main_words(dic, diclexdba);
+
+   _snprintf(buf, buflen, "%lu guide words of %lu characters.\n"
+                          "Binary search and walk: %.1f ns per search.\n"
+                          "Prefix jump table and packed keys: %.1f ns per search.\n"
+                          "Disagreed %lu times.\n",
+             dic->dichead->nidxwds, indswd, ns[0], ns[1], mismatches);
+   buf[buflen-1] = '\0';
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   free_main_words(dic, diclexdba);
+ }
 }
-/*-------------------------------------------------------------------------------*/
-BOOL spell_gusvol(unsigned char *guess_word)
+
+extern "C" _declspec (dllexport) void edx$index_benchmark(struct edx_dictionary *dic, char *buf, int buflen)
 {
-   int status;
-   unsigned int topcase;
+   index_benchmark(dic_lock(dic), buf, buflen);
+   dic_unlock(dic);
+}
 
-   /* Guess vowel replacements.
-      For each {a,e,i,o,u} replace with {a,e,i,o,u}
-      GSUBMODE goes from 0-4 as letter replacement goes a,e,i,o,u
 
-      11/03/2006
-      Added Extended_ANSI_Guessing. If defined, then we include all those other
-      extended vowels with accents, and we do
-      For each {a,e,i,o,u} replace with {a,e,i,o,u}
-      GSUBMODE goes from 0-28 as letter replacement goes a,e,i,o,u...
+/*-----------------------------------------------------------------------------
+    .SBTTL  SUGGESTION BENCHMARK
 
-   */
-   while(gof < dic_lwl)                 /* test for beyond end of word */
-   {
-      memcpy(guess_word,dic_lwa,dic_lwl);   /* copy over word */
-      guess_word[dic_lwl] = '\0';
+ Functional Description:
+    Compares spell guessing (vassar_guess_list, what edx$spell_guess does
+    without a suggestion index or word graph) with the suggestion index
+    (sym_guess_list) and the word graph (dwg_guess_list), whichever the
+    dictionary has loaded, and the Levenshtein automaton (lev_guess_list,
+    as many edits away as the word was misspelled). Takes about 1000 words
+    of the main lexical database, misspells each one once (a letter in the
+    middle replaced) and twice (and the last letter dropped too), and times
+    each way of making the guess list for the misspellings. Reports
+    microseconds per word, on average and for the 50th, 90th and 99th
+    percentile word, and how many times the word we started with was among
+    the guesses. For the word graph, also how many times its guesses were
+    exactly those of spell guessing.
 
-      if ( ISVOWEL(guess_word[gof]) )
-      {
-         if (Extended_ANSI_Guessing){
-            topcase = 28;
-         }else{
-            topcase = 4;
-         }
-         while(gsubmode <= topcase)
-         {
-            switch (gsubmode)
-            {
-               case  0: guess_word[gof] = 'a'; break;    /* 1 = replace with an "a" */
-               case  1: guess_word[gof] = 'e'; break;    /* 2 = replace with an "e" */
-               case  2: guess_word[gof] = 'i'; break;    /* 3 = replace with an "i" */
-               case  3: guess_word[gof] = 'o'; break;    /* 4 = replace with an "o" */
-               case  4: guess_word[gof] = 'u'; break;    /* 5 = replace with an "u" */
-               case  5: guess_word[gof] = A_WITH_GRAVE; break;        // 224
-               case  6: guess_word[gof] = A_WITH_ACUTE; break;        // 225
-               case  7: guess_word[gof] = A_WITH_CIRCUMFLEX; break;   // 226
-               case  8: guess_word[gof] = A_WITH_TILDE; break;        // 227
-               case  9: guess_word[gof] = A_WITH_DIAERESIS; break;    // 228
-               case 10: guess_word[gof] = A_WITH_RING_ABOVE; break;   // 229
-//       || guess_word[gof] == AE; break;                // 230
-//       || guess_word[gof] == C_WITH_CEDILLA; break;    // 231
-               case 11: guess_word[gof] = E_WITH_GRAVE; break;        // 232
-               case 12: guess_word[gof] = E_WITH_ACUTE; break;        // 233
-               case 13: guess_word[gof] = E_WITH_CIRCUMFLEX; break;   // 234
-               case 14: guess_word[gof] = E_WITH_DIAERESIS; break;    // 235
-               case 15: guess_word[gof] = I_WITH_GRAVE; break;        // 236
-               case 16: guess_word[gof] = I_WITH_ACUTE; break;        // 237
-               case 17: guess_word[gof] = I_WITH_CIRCUMFLEX; break;   // 238
-               case 18: guess_word[gof] = I_WITH_DIAERESIS; break;    // 239
-//       || guess_word[gof] == ETH; break;               // 240
-//       || guess_word[gof] == N_WITH_TILDE; break;      // 241
-               case 19: guess_word[gof] = O_WITH_GRAVE; break;        // 242
-               case 20: guess_word[gof] = O_WITH_ACUTE; break;        // 243
-               case 21: guess_word[gof] = O_WITH_CIRCUMFLEX; break;   // 244
-               case 22: guess_word[gof] = O_WITH_TILDE; break;        // 245
-               case 23: guess_word[gof] = O_WITH_DIAERESIS; break;    // 246
-//#define (this is the division sign)              // 247
-               case 24: guess_word[gof] = O_WITH_STROKE; break;       // 248
-               case 25: guess_word[gof] = U_WITH_GRAVE; break;        // 249
-               case 26: guess_word[gof] = U_WITH_ACUTE; break;        // 250
-               case 27: guess_word[gof] = U_WITH_CIRCUMFLEX; break;   // 251
-               case 28: guess_word[gof] = U_WITH_DIAERESIS; break;    // 252
-//       || guess_word[gof] == Y_WITH_ACUTE      // 253
-//       || guess_word[gof] == THORN             // 254
-//       || guess_word[gof] == Y_WITH_DIAERESIS  // 255
-               default:  return(FALSE);   /* Should never get here. return but don't signal */
-            }
-            if (guess_word[gof] != dic_lwa[gof])    /* if we didn't replace vowel with same vowel */
-            {
-               status = dic_lookup_word( dic_lwl, guess_word, "", 0, "", "" );   /* see if word exists */
-               //status = EDX__WORDFOUND; //for debugging
-               if (status == EDX__WORDFOUND)
-               {
-                  ++gsubmode;           /* set to guess next vowel for next time */
-                  return(TRUE);         /* return with guess_word containing a correctly spelled word, status */
-               }/*endif(status);*/
-            }/*endif(guess_word[gof]!=dic_lwa[gof]);*/
-            ++gsubmode;                 /* move to next vowel */
-         }/*endwhile(gsubmode < 5 or 29)*/
-         gsubmode=0;                    /* reset gsubmode */
-      }/*endif(guessword=aeiou*/
-      ++gof;                        /* move to next character */
-   }/*endwhile(gof<dic_lwl-1)*/
-   return(FALSE);             /* no more guesses */
-}
-/*-------------------------------------------------------------------------------*/
-BOOL spell_gusmin(unsigned char *guess_word)
+ Calling Sequence:
+    edx$suggest_benchmark(dic, buf, buflen);
+
+ Outputs:
+    Report returned in 'buf' (buflen 1000 is plenty).
+---------------------------------------------------------------------------*/
+/* qsort comparison routine for doubles */
+int compare_double(const void *a, const void *b)
 {
-   int status;
+   double x = *(const double *)a, y = *(const double *)b;
 
-   /* Guess minus.  Test for extra character.
-      Try eliding one character at a time */
-   if (dic_lwl < 2) {return(FALSE);}         /* skip this test if eliding a character would leave us with an empty string */
-   while(gof < dic_lwl)                     /* test for beyond end of word */
-   {
-      if (gof == 0 || dic_lwa[gof] != dic_lwa[gof-1])       /* skip if prev char = current char. The result would be the same */
-      {                                                     /*  as last time.  (Also check gof==0 first) */
-         memcpy(&guess_word[0],&dic_lwa[0],gof);            /* copy over word */
-         memcpy(&guess_word[gof],&dic_lwa[gof+1],dic_lwl-(gof+1));/* shift GOF'th+1 to end of word left one */
-         guess_word[dic_lwl-1] = '\0';
-         status = dic_lookup_word( dic_lwl-1, guess_word, "", 0, "", "" );   /* see if word exists */
-         //status = EDX__WORDFOUND; //for debugging
-         if (status == EDX__WORDFOUND)
-         {
-            ++gof;              /* move to next char for reentry */
-            return(TRUE);       /* return with guess_word containing a correctly spelled word, status */
-         }/*endif(status);*/
-      }/*endif(not double char)*/
-      ++gof;                    /* move to next char */
-   }/*endwhile(gof<dic_lwl)*/
-   return(FALSE);             /* no more guesses */
+   return( (x < y) ? -1 : (x > y) );
 }
 
-/*-------------------------------------------------------------------------------*/
-BOOL spell_guspls(unsigned char *guess_word)
+/* Misspell dictionary word lbptr once or twice into the session's DIC_LWA,DIC_LWL */
+void misspell_word(struct edx_session *ses, unsigned char *lbptr, DWORD edits)
 {
-   int status;
-   unsigned char guess_char;
-
-   /* Guess plus.  Test if a letter is missing from word.  Add one letter anywhere in word.
-      GSUBMODE goes from 0-25 as letter replacement goes from a-z
-      11/03/2006
-      If 'Extended_ANSI_Guessing' is TRUE, then we include all those other
-      extended characters with accents, and we do
-      GSUBMODE goes from 0-25 as letter replacement goes from a-z
-      then
-      GSUBMODE jumps to 223 and goes from 223-255, skipping 247 (division sign)
-         (see file "EDX_lowercasing_entended_letters.htm")   */
-   while(gof <= dic_lwl)                    /* test for beyond end of word */
-   {
-      memcpy(&guess_word[0],&dic_lwa[0],gof);           /* copy over word */
-      memcpy(&guess_word[gof+1],&dic_lwa[gof],dic_lwl-gof); /* shift GOF'th+1 to end of word left one */
-      guess_word[dic_lwl+1] = '\0';
-
-      while(gsubmode <= 255)                  /* test for GSUBMODE<=255 (all extended letters of alphabet) */
-      {
-         if (gsubmode ==  26)
-         {
-            if (Extended_ANSI_Guessing) {gsubmode = 154;}  /* skip up to extended chars */
-            else {break;}                        /* Jump out of while loop. We are done.  */
-         }
-         if (gsubmode == 155) {++gsubmode;}      /* skip SINGLE RIGHT-POINTING ANGLE QUOTATION MARK */
-         if (gsubmode == 157) {++gsubmode;}      /* skip (not used) */
-         if (gsubmode == 159) {gsubmode = 223;}  /* jump to LATIN SMALL LETTER SHARP S */
-         if (gsubmode == 247) {++gsubmode;}      /* skip DIVISION SIGN */
-         if (gsubmode < 26){guess_char = (unsigned char)gsubmode + (unsigned char)'a';}  /* convert GSUBMODE={0-25} to ASCII {A-Z} (which is {65-90} */
-         else {guess_char = (unsigned char)gsubmode;}        /* convert GSUBMODE={223-255} to ANSI (see file "EDX_lowercasing_entended_letters.htm") */
-
-         if (gof == 0 || guess_char != dic_lwa[gof-1])      /* if extra char being inserted = char it's infront of */
-         {                                                  /*  then don't do it to avoid duplicates */
-            guess_word[gof] = guess_char;                   /* insert missing letter */
-            status = dic_lookup_word( dic_lwl+1, guess_word, "", 0, "", "" );   /* see if word exists */
-            //status = EDX__WORDFOUND; //for debugging
-            if (status == EDX__WORDFOUND)
-            {
-               ++gsubmode;          /* set to try next char on reentry */
-               return(TRUE);        /* return with string containing a correctly spelled word, status */
-            }/*endif(status);*/
-         }/*endif(not double char)*/
-         ++gsubmode;                /* try next char */
-      }/*endwhile(gsubmode<=255)*/
+   DWORD len = *lbptr;
 
-      gsubmode=0;               /* reset gsubmode */
-      ++gof;                    /* move to next char */
-   }/*endwhile(gof<dic_lwl)*/
-   return(FALSE);             /* no more guesses */
+   memcpy(ses->dic_lwa, lbptr + 1, len);
+   ses->dic_lwa[len/2] = (ses->dic_lwa[len/2] == 'q') ? 'x' : 'q';   /* misspell it */
+   if (edits == 2) --len;
+   ses->dic_lwl = len;
 }
 
-/*-------------------------------------------------------------------------------*/
-BOOL spell_guscon(unsigned char *guess_word)
+void suggest_benchmark(struct edx_dictionary *dic, char *buf, int buflen)
 {
-   int status;
-   int isvowel;
-   unsigned char guess_char;
+   static const char *engine_name[4] = { "spell guessing", "suggestion index", "word graph", "automaton" };
+   struct edx_session ses;
+   struct guess_cand *vassar = NULL;
+   unsigned char *diclexdba, *diclexend, *lbptr;
+   DWORD nwords, every, w, edits, engine, n, i, k, nvassar, found[2][4], same[2];
+   LARGE_INTEGER start, wstart;
+   double us[2][4], pct[2][4][3];
+   double *wordus = NULL;    /* microseconds for each word */
+   char *errbuf = buf;       /* for LOAD_EIPE_ERROR_MESSAGE */
+   int errbuflen = buflen;
+
+   if (buflen < 1) {return;}
+   buf[0] = '\0';
+   if (dic == NULL) {return;}
+   memset(&ses, 0, sizeof(ses));
+   ses.dic = dic;
+   diclexdba = main_words(dic, &diclexend);      /* (front coded pages decoded) */
+   if (diclexdba == NULL) {return;}
 
-   /* Guess consonants.  Test for any one character wrong.
-      Replace each character with every other character of the alphabet
-      GSUBMODE goes from 0-25 as letter replacement goes from a-z
-      If 'Extended_ANSI_Guessing' is TRUE, then we include all those other
-      extended characters with accents, and we do
-      GSUBMODE goes from 0-25 as letter replacement goes from a-z
-      then
-      GSUBMODE jumps to 223 and goes from 223-255, skipping 247 (division sign)
-         (see file "EDX_lowercasing_entended_letters.htm")
-      We've already tried replacing vowel characters with other vowel characters,
-      so if we're on a vowel, then skip if our replacement character is also a vowel.
-      Also skip if our guess character is the same as the original character.
-   */
-   while(gof < dic_lwl)                 /* test for beyond end of word */
+ __try
+ {
+   nwords = count_words(diclexdba, diclexend);
+   every = (nwords > 1000) ? nwords / 1000 : 1;
+   for (w = 0, lbptr = diclexdba, n = 0;
+        lbptr < diclexend && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+        lbptr += *lbptr + 1, ++w)
+      if (w % every == 0 && *lbptr >= 4) ++n;                         /* words tried */
+   if (n == 0) n = 1;
+   wordus = new double[n];
+   if (wordus == NULL) { free_main_words(dic, diclexdba); return; }
+
+   for (edits = 1; edits <= 2; ++edits)
    {
-      if ( ISVOWEL(dic_lwa[gof]) )
-         isvowel = TRUE;
-      else
-         isvowel = FALSE;
-
-      while(gsubmode <= 255)                  /* test for GSUBMODE<=255 (all extended letters of alphabet) */
+      for (engine = 0; engine < 4; ++engine)
       {
-         if (gsubmode ==  26)
+         found[edits-1][engine] = 0;
+         us[edits-1][engine] = 0.0;
+         if (engine == 1 && dic->sym == NULL) continue;
+         if (engine == 2 && dic->dwg == NULL) continue;
+         if (engine == 3 && dic->frontcoded) continue;   /* (needs whole word pages) */
+         QueryPerformanceCounter(&start);
+         for ( lbptr = diclexdba, w = 0, i = 0;
+               lbptr < diclexend && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+               lbptr += *lbptr + 1, ++w )
          {
-            if (Extended_ANSI_Guessing) {gsubmode = 223;}  /* skip up to extended chars */
-            else {break;}                        /* Jump out of while loop. We are done.  */
+            if (w % every != 0 || *lbptr < 4) continue;
+            misspell_word(&ses, lbptr, edits);
+            QueryPerformanceCounter(&wstart);
+            if (engine == 0) vassar_guess_list(&ses);
+            else if (engine == 1) sym_guess_list(&ses, 2);
+            else if (engine == 2) dwg_guess_list(&ses);
+            else lev_guess_list(&ses, edits);
+            if (i < n) wordus[i++] = elapsed_ms(wstart) * 1000.0;
+            for (k = 0; k < ses.guesses.ncand; ++k)
+               if (ses.guesses.cand[k].len == *lbptr && memcmp(ses.guesses.cand[k].lower, lbptr + 1, *lbptr) == 0)
+               {
+                  ++found[edits-1][engine];
+                  break;
+               }
          }
-         if (gsubmode == 247) {gsubmode = 248;}  /* skip division sign */
-
-         if (gsubmode < 26){guess_char = (unsigned char)gsubmode + (unsigned char)'a';}  /* convert GSUBMODE={0-25} to ASCII {A-Z} (which is {65-90} */
-         else {guess_char = (unsigned char)gsubmode;}        /* convert GSUBMODE={223-255} to ANSI (see file "EDX_lowercasing_entended_letters.htm") */
+         us[edits-1][engine] = elapsed_ms(start) * 1000.0;
+         qsort(wordus, i, sizeof(double), compare_double);
+         for (k = 0; k < 3; ++k)
+            pct[edits-1][engine][k] = (i == 0) ? 0.0 : wordus[(i - 1) * ((k == 0) ? 50 : (k == 1) ? 90 : 99) / 100];
+      }
 
-         if (   (guess_char != dic_lwa[gof])            /* if overstrike char != original char */
-             && ( !ISVOWEL(guess_char) )               /* and char being replaced isn't a vowel */
-            )
-         {                          /*  or then don't do it to avoid duplicates */
-            memcpy(guess_word,dic_lwa,dic_lwl);         /* copy over word */
-            guess_word[dic_lwl] = '\0';
-            guess_word[gof] = guess_char;               /* overstrike with another letter */
-            status = dic_lookup_word( dic_lwl, guess_word, "", 0, "", "" );   /* see if word exists */
-            //status = EDX__WORDFOUND; //for debugging
-            if (status == EDX__WORDFOUND)
-            {
-               ++gsubmode;          /* set to try next char on reentry */
-               return(TRUE);        /* return with string containing a correctly spelled word, status */
-            }/*endif(status);*/
-         }/*endif(not double char)*/
-         ++gsubmode;                /* try next char */
-      }/*endwhile(gsubmode<=255)*/
+      /* Does the word graph make exactly the same guesses? */
+      same[edits-1] = 0;
+      for ( lbptr = diclexdba, w = 0;
+            dic->dwg != NULL && lbptr < diclexend && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+            lbptr += *lbptr + 1, ++w )
+      {
+         if (w % every != 0 || *lbptr < 4) continue;
+         misspell_word(&ses, lbptr, edits);
+         vassar_guess_list(&ses);
+         vassar = ses.guesses.cand;           /* keep them */
+         nvassar = ses.guesses.ncand;
+         ses.guesses.cand = NULL;
+         dwg_guess_list(&ses);
+         for (k = 0; k < nvassar && k < ses.guesses.ncand; ++k)
+            if (strcmp((char *)vassar[k].word, (char *)ses.guesses.cand[k].word) != 0) break;
+         if (k == nvassar && k == ses.guesses.ncand) ++same[edits-1];
+         if (vassar) { delete[] vassar; }
+         vassar = NULL;
+      }
+   }
+   free_guesses(&ses);
+   delete[] wordus;
+   wordus = NULL;
+   free_main_words(dic, diclexdba);
+
+   if (dic->sym != NULL)
+     report_printf(buf, buflen, "Suggestion index: %lu bytes, %s.\n", dic->sym->filelen,
+                   (dic->symfile.buildms > 0.0) ? "built now" : "mapped");
+   if (dic->dwg != NULL)
+     report_printf(buf, buflen, "Word graph: %lu bytes, %s.\n", dic->dwg->filelen,
+                   (dic->dwgfile.buildms > 0.0) ? "built now" : "mapped");
+   for (edits = 1; edits <= 2; ++edits)
+   {
+      report_printf(buf, buflen, "%lu words misspelled %s:\n", n, (edits == 1) ? "once" : "twice");
+      for (engine = 0; engine < 4; ++engine)
+      {
+         if (engine == 1 && dic->sym == NULL) continue;
+         if (engine == 2 && dic->dwg == NULL) continue;
+         if (engine == 3 && dic->frontcoded) continue;
+         report_printf(buf, buflen, "   %-17s %7.1f us per word (50%% %.1f, 90%% %.1f, 99%% %.1f), found %lu",
+                       engine_name[engine], us[edits-1][engine] / n, pct[edits-1][engine][0],
+                       pct[edits-1][engine][1], pct[edits-1][engine][2], found[edits-1][engine]);
+         if (engine == 2) report_printf(buf, buflen, ", same guesses as spell guessing for %lu", same[edits-1]);
+         report_printf(buf, buflen, ".\n");
+      }
+   }
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   if (vassar) { delete[] vassar; }
+   if (wordus) { delete[] wordus; }
+   free_guesses(&ses);
+   free_main_words(dic, diclexdba);
+ }
+}
 
-      gsubmode=0;               /* reset gsubmode */
-      ++gof;                    /* move to next char */
-   }/*endwhile(gof<dic_lwl)*/
-   return(FALSE);             /* no more guesses */
+extern "C" _declspec (dllexport) void edx$suggest_benchmark(struct edx_dictionary *dic, char *buf, int buflen)
+{
+   suggest_benchmark(dic_lock(dic), buf, buflen);
+   dic_unlock(dic);
 }
 
-/*--------------------------------------------------------------------------
-    .SUBTITLE SPELL_GUESS
+
+/*-----------------------------------------------------------------------------
+    .SBTTL  LOOKUP BENCHMARK
 
  Functional Description:
-    Guesses the spelling of misspelled word stored in DIC_LWA,DIC_LWL.
-    Algorythm taken from the very popular Vassar Spelling Checker.
-    With credit to Vassar where credit is due.
+    Times looking words up the way edx$session_lookup_word does
+    (dic_lookup_word, with whatever hash index, Bloom filter and lookup
+    cache the dictionary has), and guessing spellings the way
+    edx$spell_guess does the first time it sees a misspelling.
+
+    Four kinds of lookups:
+       Hit lookups  - about 4000 words of the main lexical database
+       Miss lookups - the same words with a letter in the middle changed,
+                      those which then aren't words
+       Common words - the dictionary's common words
+       Aux1 hits    - the words of the user's Aux1 dictionary, if any
+    Each kind is looked up over and over in a shuffled order for about a
+    quarter second to get lookups per second, then another quarter second
+    timing them for the 50th, 90th and 99th percentile time of one lookup.
+    A lookup takes about as long as reading the timer, so lookups are timed
+    BENCH_GROUP at a time and the percentiles are of those times divided
+    by BENCH_GROUP.
+
+    Then for misspellings of 2-4, 5-7, 8-11 and 12 or more letters
+    (dictionary words with a letter in the middle changed), the time to
+    look the word up, make the whole guess list and hand out every guess
+    on it, as edx$spell_guess would. The guess cache is bypassed, as the
+    point is what making the list costs. Reported as words per second and
+    percentiles of the time for one word, and the average number of
+    guesses.
+
+    Each result is one line,
+       name: rate per second, 50% time, 90% time, 99% time
+    so edxbench can compare one run with another.
 
  Calling Sequence:
-    result = edx$spell_guess(char *guessword, char *errbuf, int errbuflen,);
-
- Argument inputs:
-    char *guessword pointer to ASCIZ string. Must be at least 33 characters long! This is where we put our guessword.
-    errbuf - buffer to put any error message in to return to caller (let caller display it)
-    errbuflen - length of errbuf.
-    DIC_LWA = TARGET_WORD - Address of misspelled word
-    DIC_LWL = TARGET_WORD_LEN - Length of misspelled word
-    GMODE   - guess mode    (1=reversals,2=vowels,3=minus,4=plus,5=consonants,6=giveup)
-    GOF - guess column offset (character # in word working on)
-    GSUBMODE- (char) guess submode (letter we're currently replacing with)
-     (NOTE: gmode = GUSREV, gof = gsubmode = 0; SET BY DIC_LOOKUP_WORD)
+    edx$lookup_benchmark(dic, buf, buflen);
 
  Outputs:
-    retcode=EDX__WORDFOUND, guessword = guessed word. Here's another word to try.
-     or
-    retcode = EDX__WORDNOTFOUND, no more guesses.
+    Report returned in 'buf' (buflen 1000 is plenty).
+---------------------------------------------------------------------------*/
+/* A word to look up or guess */
+struct bench_word {
+   DWORD len;
+   unsigned char word[MAXWORDLEN+1];   /* ASCIZ */
+};
+
+/* Put about max of the words of length minlen to maxlen in lexical database
+   lbptr..end in ws[*n], taken evenly from all through it. If 'misspell',
+   misspell them, and keep only those which then aren't words. */
+void bench_words(struct edx_session *ses, unsigned char *base, unsigned char *end,
+                 DWORD minlen, DWORD maxlen, BOOL misspell, struct bench_word *ws, DWORD *n, DWORD max)
+{
+   unsigned char *lbptr;
+   DWORD w, len, every;
+
+   for ( lbptr = base, w = 0;
+         lbptr < end && *lbptr != 0x00 && *lbptr <= MAXWORDLEN;
+         lbptr += *lbptr + 1 )
+      if (*lbptr >= minlen && *lbptr <= maxlen) ++w;
+   every = (w > max) ? w / max : 1;
+
+   for ( lbptr = base, w = 0;
+         lbptr < end && *lbptr != 0x00 && *lbptr <= MAXWORDLEN && *n < max;
+         lbptr += *lbptr + 1 )
+   {
+      len = *lbptr;
+      if (len < minlen || len > maxlen) continue;
+      if (w++ % every != 0) continue;
+      ws[*n].len = len;
+      memcpy(ws[*n].word, lbptr + 1, len);
+      ws[*n].word[len] = '\0';
+      if (misspell)
+      {
+         ws[*n].word[len/2] = (ws[*n].word[len/2] == 'q') ? 'x' : 'q';
+         if (dic_lookup_word(ses, len, ws[*n].word) == EDX__WORDFOUND) continue;
+      }
+      ++*n;
+   }
+}
 
- Outline:
-    1.  Reversals   (test for transposed characters)
-    2.  vowels      (test for wrong vowel used)
-    3.  minus chars (test for extra character in word)
-    4.  plus chars  (test for character missing from word)
-    5.  consonants  (test for wrong character used)
-    6.  give up     (give up)
+/* Shuffle ws[n], the same way every time */
+void bench_shuffle(struct bench_word *ws, DWORD n)
+{
+   struct bench_word t;
+   DWORD i, j, seed = 12345;
 
-Updated 11/03/2006
- I defined Extended_ANSI_Guessing. If TRUE, spell guessing will use
- those extended characters with accents in spell guessing.
- Characters such as                                   
+   for (i = n; i > 1; --i)
+   {
+      seed = seed * 1103515245 + 12345;
+      j = (seed >> 8) % i;
+      t = ws[i-1]; ws[i-1] = ws[j]; ws[j] = t;
+   }
+}
 
+/* Look up the words ws[n] over and over. Returns lookups per second, and
+   the 50th, 90th and 99th percentile nanoseconds per lookup in pct[] */
+double bench_lookups(struct edx_session *ses, struct bench_word *ws, DWORD n, double *samples, double *pct)
+{
+   LARGE_INTEGER start, gstart;
+   DWORD i, g, lookups, nsamples;
+   double ms, rate;
+
+   /* Lookups per second */
+   QueryPerformanceCounter(&start);
+   lookups = 0;
+   i = 0;
+   do
+   {
+      for (g = 0; g < 1024; ++g)
+      {
+         dic_lookup_word(ses, ws[i].len, ws[i].word);
+         if (++i == n) i = 0;
+      }
+      lookups += 1024;
+      ms = elapsed_ms(start);
+   } while (ms < 250.0);
+   rate = lookups * 1000.0 / ms;
+
+   /* Percentiles */
+   QueryPerformanceCounter(&start);
+   nsamples = 0;
+   do
+   {
+      QueryPerformanceCounter(&gstart);
+      for (g = 0; g < BENCH_GROUP; ++g)
+      {
+         dic_lookup_word(ses, ws[i].len, ws[i].word);
+         if (++i == n) i = 0;
+      }
+      samples[nsamples % BENCH_SAMPLES] = elapsed_ms(gstart) * 1000000.0 / BENCH_GROUP;
+      ++nsamples;
+   } while (elapsed_ms(start) < 250.0);
+   if (nsamples > BENCH_SAMPLES) nsamples = BENCH_SAMPLES;
+   qsort(samples, nsamples, sizeof(double), compare_double);
+   pct[0] = samples[(nsamples - 1) * 50 / 100];
+   pct[1] = samples[(nsamples - 1) * 90 / 100];
+   pct[2] = samples[(nsamples - 1) * 99 / 100];
+   return(rate);
+}
 
----------------------------------------------------------------------------*/
+/* Guess the spelling of each of the misspellings ws[n], over and over.
+   Returns words per second, the 50th, 90th and 99th percentile
+   microseconds per word in pct[], and the average number of guesses. */
+double bench_guesses(struct edx_session *ses, struct bench_word *ws, DWORD n, double *samples, double *pct, double *nguesses)
+{
+   char guessword[MAXWORDLEN+2];
+   LARGE_INTEGER start, wstart;
+   DWORD i, k, words, guesses, nsamples;
+   double ms;
+
+   QueryPerformanceCounter(&start);
+   words = guesses = nsamples = 0;
+   i = 0;
+   do
+   {
+      QueryPerformanceCounter(&wstart);
+      if (session_lookup_word(ses, (char *)ws[i].word) == EDX__WORDNOTFOUND && engine_guess_list(ses) == EDX__WORDFOUND)
+      {
+         for (k = 0; k < ses->guesses.ncand; ++k)
+            strcpy(guessword, (char *)ses->guesses.cand[k].word);   /* hand it out */
+         guesses += ses->guesses.ncand;
+      }
+      samples[nsamples % BENCH_SAMPLES] = elapsed_ms(wstart) * 1000.0;
+      ++nsamples;
+      ++words;
+      if (++i == n) i = 0;
+      ms = elapsed_ms(start);
+   } while (ms < 250.0 || words < n);
+   free_guesses(ses);
+   if (nsamples > BENCH_SAMPLES) nsamples = BENCH_SAMPLES;
+   qsort(samples, nsamples, sizeof(double), compare_double);
+   pct[0] = samples[(nsamples - 1) * 50 / 100];
+   pct[1] = samples[(nsamples - 1) * 90 / 100];
+   pct[2] = samples[(nsamples - 1) * 99 / 100];
+   *nguesses = (double)guesses / words;
+   return(words * 1000.0 / ms);
+}
 
-extern "C" _declspec (dllexport) int edx$spell_guess(char *guessword, char *errbuf, int errbuflen)
+void lookup_benchmark(struct edx_dictionary *dic, char *buf, int buflen)
 {
+   static const char *lookup_name[4] = { "Hit lookups", "Miss lookups", "Common words", "Aux1 hits" };
+   static const DWORD band_min[4] = { 2, 5, 8, 12 };
+   static const DWORD band_max[4] = { 4, 7, 11, MAXWORDLEN };
+   struct edx_session ses;
+   struct bench_word *ws = NULL;
+   double *samples = NULL;
+   unsigned char *diclexdba, *diclexend, *cmnwdend;
+   DWORD nmain, ncommon, naux1, n, kind, band;
+   double rate, pct[3], nguesses;
+   char *errbuf = buf;       /* for LOAD_EIPE_ERROR_MESSAGE */
+   int errbuflen = buflen;
+
+   if (buflen < 1) {return;}
+   buf[0] = '\0';
+   if (dic == NULL) {return;}
+   memset(&ses, 0, sizeof(ses));
+   ses.dic = dic;
+   ses.gmode = GIVEUP;
+   diclexdba = main_words(dic, &diclexend);      /* (front coded pages decoded) */
+   if (diclexdba == NULL) {return;}
+   cmnwdend = dic->cmnwdsptr + dic->dichead->cwdlen;
+
  __try
  {
-   switch (gmode)               /* GUESS MODE */
-   {
-      case GUSREV:              /* 1 = GUESS REVERSALS */
-           if (spell_gusrev( (unsigned char *)guessword) ) return(EDX__WORDFOUND);      /* EDX__WORDFOUND if guess word found. outstr set.  gcol, gmode, gsubmode hold our place for reentry */
-           ++gmode;             /* go to next guess mode */
-           gof = gsubmode = 0;          /* reset GOF and GSUBMODE */
-                        /* DROP THROUGH TO NEXT GUESS MODE */
-      case GUSVOL:              /* 2 = GUESS VOWELS */
-           if (spell_gusvol( (unsigned char *)guessword) ) return(EDX__WORDFOUND);      /* EDX__WORDFOUND if guess word found. outstr set.  gcol, gmode, gsubmode hold our place for reentry */
-           ++gmode;             /* go to next guess mode */
-           gof = gsubmode = 0;          /* reset GOF and GSUBMODE */
-                        /* DROP THROUGH TO NEXT MODE: GUSMIN */
-      case GUSMIN:              /* 3 = GUESS MINUS */
-           if (spell_gusmin( (unsigned char *)guessword) ) return(EDX__WORDFOUND);      /* EDX__WORDFOUND if guess word found. outstr set.  gcol, gmode, gsubmode hold our place for reentry */
-           ++gmode;             /* go to next guess mode */
-           gof = gsubmode = 0;          /* reset GOF and GSUBMODE */
-                        /* DROP THROUGH TO NEXT MODE: GUSPLS */
-      case GUSPLS:              /* 4 = GUESS PLUS */
-           if (spell_guspls( (unsigned char *)guessword) ) return(EDX__WORDFOUND);      /* EDX__WORDFOUND if guess word found. outstr set.  gcol, gmode, gsubmode hold our place for reentry */
-           ++gmode;             /* go to next guess mode */
-           gsubmode = 0;            /* reset GSUBMODE */
-           gof = 0;             /* reset GOF */
-                        /* DROP THROUGH TO NEXT MODE: GUSCON */
-      case GUSCON:              /* 5 = GUESS CONSONANTS */
-           if (spell_guscon( (unsigned char *)guessword) ) return(EDX__WORDFOUND);      /* EDX__WORDFOUND if guess word found. outstr set.  gcol, gmode, gsubmode hold our place for reentry */
-                        /* DROP THROUGH TO NEXT MODE: GIVEUP */
-      case GIVEUP:              /* 6 = GIVE UP */
-           guessword[0] = '\0';
-           return( EDX__WORDNOTFOUND );        /* no more guesses */
+   nmain = count_words(diclexdba, diclexend);
+   ncommon = count_words(dic->cmnwdsptr, cmnwdend);
+   naux1 = (dic->aux1base != NULL) ? count_words(dic->aux1base, dic->aux1base + dic->aux1len) : 0;
+   report_printf(buf, buflen, "%lu words, %lu common words, %lu Aux1 words. Extended ANSI guessing %s.\n"
+                              "Hash index %s, Bloom filter %s, lookup cache %s%s.\n",
+                 nmain, ncommon, naux1, dic->Extended_ANSI_Guessing ? "on" : "off",
+                 (dic->mainhash.tab != NULL) ? "on" : "off", (dic->bloom != NULL) ? "on" : "off",
+                 (dic->cache != NULL) ? "on" : "off", dic->frontcoded ? ", front coded pages" : "");
+
+   ws = new struct bench_word[BENCH_WORDS];
+   samples = new double[BENCH_SAMPLES];
+   if (ws == NULL || samples == NULL)
+   {
+      report_printf(buf, buflen, "Memory allocation failure.\n");
+      if (ws) { delete[] ws; }
+      if (samples) { delete[] samples; }
+      free_main_words(dic, diclexdba);
+      return;
+   }
+   for (kind = 0; kind < 4; ++kind)
+   {
+      n = 0;
+      if (kind <= 1) bench_words(&ses, diclexdba, diclexend, 1, MAXWORDLEN, (kind == 1), ws, &n, BENCH_WORDS);
+      else if (kind == 2) bench_words(&ses, dic->cmnwdsptr, cmnwdend, 1, MAXWORDLEN, FALSE, ws, &n, BENCH_WORDS);
+      else if (dic->aux1base != NULL) bench_words(&ses, dic->aux1base, dic->aux1base + dic->aux1len, 1, MAXWORDLEN, FALSE, ws, &n, BENCH_WORDS);
+      if (n == 0) continue;
+      bench_shuffle(ws, n);
+      rate = bench_lookups(&ses, ws, n, samples, pct);
+      report_printf(buf, buflen, "%s: %.0f per second, 50%% %.1f ns, 90%% %.1f ns, 99%% %.1f ns.\n",
+                    lookup_name[kind], rate, pct[0], pct[1], pct[2]);
    }
-   return( EDX__WORDNOTFOUND );        /* (should never end up here) */
+
+   for (band = 0; band < 4; ++band)
+   {
+      n = 0;
+      bench_words(&ses, diclexdba, diclexend, band_min[band], band_max[band], TRUE, ws, &n, BENCH_GUESS_WORDS);
+      if (n == 0) continue;
+      bench_shuffle(ws, n);
+      rate = bench_guesses(&ses, ws, n, samples, pct, &nguesses);
+      report_printf(buf, buflen, "Guessing %lu-%lu letters: %.0f per second, 50%% %.1f us, 90%% %.1f us, 99%% %.1f us, %.1f guesses.\n",
+                    band_min[band], band_max[band], rate, pct[0], pct[1], pct[2], nguesses);
+   }
+   delete[] ws;
+   delete[] samples;
+   free_main_words(dic, diclexdba);
  }
  __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
             EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
  {
    // Failed to read from the view.
    LOAD_EIPE_ERROR_MESSAGE
-   return(EDX__ERROR);
+   if (ws) { delete[] ws; }
+   if (samples) { delete[] samples; }
+   free_guesses(&ses);
+   free_main_words(dic, diclexdba);
  }
 }
 
+extern "C" _declspec (dllexport) void edx$lookup_benchmark(struct edx_dictionary *dic, char *buf, int buflen)
+{
+   lookup_benchmark(dic_lock(dic), buf, buflen);
+   dic_unlock(dic);
+}
+
+
 /*-----------------------------------------------------------------------------
-    .SBTTL  ADD WORD TO USER'S AUX1 DICTIONARY
+    .SBTTL  STARTUP BENCHMARK
 
  Functional Description:
-    This routine adds a word to the user's personal aux1 dictionary.
-
-  Calling Sequence:
-    result = edx$add_persdic(char *newword, char *errbuf, int errbuflen);
+    Times how soon a dictionary can be used after it's opened, with each
+    of the EDX_OPT_RESIDENCY settings (see DICTIONARY RESIDENCY): none,
+    random access, will need, prefault, large pages and locked, the other
+    options as edx$set_option left them. For each, the dictionary is
+    opened, STARTUP_LOOKUPS words of it are looked up one at a time in a
+    shuffled order, each timed, and it's closed. Reported as lookups per
+    second and the 50th, 90th and 99th percentile time of those first
+    lookups, the time edx$dic_open took and the time of the first lookup,
+    so edxbench can compare one run with another:
+       Startup prefault: rate per second, 50% time, 90% time, 99% time, open time, first lookup time.
+
+    The dictionary is opened once first to pick the words, so the figures
+    are for a dictionary the system has in its file cache (as when a
+    second program starts): the page faults of a new mapping, not disk
+    reads. To time reading it from disk, run it just after the computer
+    starts, with the dictionary's file not yet read. The settings
+    take turns as EDX_OPT_RESIDENCY, so don't open dictionaries on other
+    threads while it runs.
 
- Argument inputs:
-    newword - pointer to ASCIZ string containing new word to add to user's Aux1 personal dictionary
-    errbuf - buffer to put any error message in to return to caller (let caller display it)
-    errbuflen - length of errbuf.
+ Calling Sequence:
+    edx$startup_benchmark(Dic_File_Name, buf, buflen);
 
- Outline:
- 1. Open for append, or create, user's personal dictionary file.
-    The user's personal dictionary file is a plain text file with one word per line.
- 2. delete previously allocated memory that we loaded user's personal dictionary in
- 3. Append word to user's personal dictionary file.
- 4. Close user's personal dictionary file.
- 5. Call load_aux1_dic to reload it, now with new word included.
+ Outputs:
+    Report returned in 'buf' (buflen 1000 is plenty).
 ---------------------------------------------------------------------------*/
-extern "C" _declspec (dllexport) int edx$add_persdic(char *newword, char *errbuf, int errbuflen)
-{
-  // 1. Open for append, or create, user's personal dictionary file.
-  //    The user's personal dictionary file is a plain text file with one word per line.
-  FILE *fpAux1File = NULL;  //User's Aux1 dictionary
-
-  if (!strlen(Aux1File))
-  {
-    char errmsg[ERRMSGLEN];
-    _snprintf(errmsg, ERRMSGLEN, "Error adding word to user's personal auxiliary dictionary.\nUser's personal auxiliary dictionary filename not set.\n");
-    errmsg[ERRMSGLEN-1] = '\0';
-    return(EDX__ERROR);
-  }
+#define STARTUP_LOOKUPS 10000   /* first lookups timed after opening the dictionary */
 
-  fpAux1File = fopen(Aux1File,"a");
-  if (fpAux1File == (FILE *) NULL)
-  {
-    char errmsg[ERRMSGLEN];
-    _snprintf(errmsg, ERRMSGLEN, "Error opening user's personal dictionary file %s.\n", Aux1File);
-    errmsg[ERRMSGLEN-1] = '\0';
-    return(EDX__ERROR);
-  }
-
-  // 2. delete previously allocated memory that we loaded user's personal dictionary in
-  if (aux1base) { delete[] aux1base; }  // User's personal Aux1 dictionary in memory
-
-  // 3. Append word to user's personal dictionary file.
-  fprintf(fpAux1File,"%s\n",newword);
-
-  // 4. Close user's personal dictionary file.
-  fclose(fpAux1File);
+extern "C" _declspec (dllexport) void edx$startup_benchmark(char *Dic_File_Name, char *buf, int buflen)
+{
+   static const DWORD residency[6] = { 0, EDX_RES_RANDOM, EDX_RES_WILLNEED, EDX_RES_PREFAULT, EDX_RES_LARGE_PAGES, EDX_RES_LOCK };
+   static const char *residency_name[6] = { "none", "random access", "will need", "prefault", "large pages", "locked" };
+   struct edx_dictionary *dic = NULL;
+   struct edx_session ses;
+   struct bench_word *ws = NULL;
+   double *samples = NULL;
+   unsigned char *words, *end;
+   LARGE_INTEGER start, lstart;
+   DWORD saved = dic_options[EDX_OPT_RESIDENCY];
+   DWORD n, i, r;
+   double openms, firstus, ms;
+   char *errbuf = buf;       /* for LOAD_EIPE_ERROR_MESSAGE */
+   int errbuflen = buflen;
+
+   if (buflen < 1) {return;}
+   buf[0] = '\0';
+   memset(&ses, 0, sizeof(ses));
+   ws = new struct bench_word[STARTUP_LOOKUPS];
+   samples = new double[STARTUP_LOOKUPS];
+   if (ws == NULL || samples == NULL)
+   {
+      report_printf(buf, buflen, "Memory allocation failure.\n");
+      if (ws) { delete[] ws; }
+      if (samples) { delete[] samples; }
+      return;
+   }
 
-  // 5. Call load_aux1_dic to reload it, now with new word included.
-  if ( !load_aux1_dic(Aux1File, errbuf, errbuflen) ) return(EDX__ERROR);
+ __try
+ {
+   /* The words */
+   dic = edx$dic_open(Dic_File_Name, "", buf, buflen);
+   if (dic == NULL) { delete[] ws; delete[] samples; return; }
+   ses.dic = dic->live;
+   n = 0;
+   words = main_words(dic->live, &end);
+   if (words != NULL) bench_words(&ses, words, end, 1, MAXWORDLEN, FALSE, ws, &n, STARTUP_LOOKUPS);
+   free_main_words(dic->live, words);
+   edx$dic_close(dic);
+   dic = NULL;
+   bench_shuffle(ws, n);
+   if (n == 0)
+   {
+      report_printf(buf, buflen, "No words to look up.\n");
+      delete[] ws;
+      delete[] samples;
+      return;
+   }
 
-  return(EDX__WORDFOUND);  //signal success
+   for (r = 0; r < 6; ++r)
+   {
+      dic_options[EDX_OPT_RESIDENCY] = residency[r];
+      QueryPerformanceCounter(&start);
+      dic = edx$dic_open(Dic_File_Name, "", buf + strlen(buf), buflen - strlen(buf));
+      openms = elapsed_ms(start);
+      if (dic == NULL) break;
+      memset(&ses, 0, sizeof(ses));
+      ses.dic = dic->live;
+      for (i = 0; i < n; ++i)
+      {
+         QueryPerformanceCounter(&lstart);
+         dic_lookup_word(&ses, ws[i].len, ws[i].word);
+         samples[i] = elapsed_ms(lstart) * 1000000.0;
+      }
+      ms = elapsed_ms(start) - openms;
+      firstus = samples[0] / 1000.0;
+      qsort(samples, n, sizeof(double), compare_double);
+      report_printf(buf, buflen, "Startup %s: %.0f per second, 50%% %.1f ns, 90%% %.1f ns, 99%% %.1f ns, open %.1f ms, first lookup %.1f us%s.\n",
+                    residency_name[r], n * 1000.0 / ms, samples[(n - 1) * 50 / 100], samples[(n - 1) * 90 / 100],
+                    samples[(n - 1) * 99 / 100], openms, firstus, (dic->live->resident == residency[r]) ? "" : " (couldn't)");
+      edx$dic_close(dic);
+      dic = NULL;
+   }
+   dic_options[EDX_OPT_RESIDENCY] = saved;
+   delete[] ws;
+   delete[] samples;
+ }
+ __except(GetExceptionCode()==EXCEPTION_IN_PAGE_ERROR ?
+            EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+ {
+   // Failed to read from the view.
+   LOAD_EIPE_ERROR_MESSAGE
+   dic_options[EDX_OPT_RESIDENCY] = saved;
+   if (dic) { edx$dic_close(dic); }
+   if (ws) { delete[] ws; }
+   if (samples) { delete[] samples; }
+ }
 }
 
 
@@ -1246,8 +8665,11 @@ extern "C" _declspec (dllexport) void edx$dll_version(char *buf, int buflen)
 #define AUX1LOADED    "\nUser's personal auxiliary dictionary file is: "
 #define VERSNO4       "\nEDX dictionary file is version 4"
 #define VERSNO5       "\nEDX dictionary file is version 5 (Extended ANSI character compatible)"
+#define VERSNO6       "\nEDX dictionary file is version 6 (Extended ANSI character compatible, sections on pages)"
 #define EXANSISET     "\nExtended ANSI characters exist in the dictionary.\nExtended ANSI Guessing is: ON."
 #define EXANSICLEAR   "\nThere are no extended ANSI characters in the dictionary.\nExtended ANSI Guessing is: OFF."
+    struct edx_dictionary *dic;
+    int len;
 
     if (buflen < 1) {return;}
 
@@ -1257,24 +8679,28 @@ extern "C" _declspec (dllexport) void edx$dll_version(char *buf, int buflen)
     }
     else
     {
-      if (dichead->id[0] == 4)
+      dic = dic_lock(&default_dic);
+      if (dic->dichead->id[0] == 4)
       {
-        _snprintf(buf, buflen, "%s%s%s%s\n", EDX$X_VERSION, VERSNO4, AUX1LOADED, Aux1File);
+        _snprintf(buf, buflen, "%s%s%s%s\n", EDX$X_VERSION, VERSNO4, AUX1LOADED, dic->Aux1File);
       }
       else
       {
-        if (dichead->id[0] == 5)
+        if (dic->Extended_ANSI_Guessing)
+        {
+          _snprintf(buf, buflen, "%s%s%s%s%s\n", EDX$X_VERSION, (dic->dichead->id[0] == 5) ? VERSNO5 : VERSNO6, EXANSISET, AUX1LOADED, dic->Aux1File);
+        }
+        else
         {
-          if (Extended_ANSI_Guessing)
-          {
-            _snprintf(buf, buflen, "%s%s%s%s%s\n", EDX$X_VERSION, VERSNO5, EXANSISET, AUX1LOADED, Aux1File);
-          }
-          else
-          {
-            _snprintf(buf, buflen, "%s%s%s%s%s\n", EDX$X_VERSION, VERSNO5, EXANSICLEAR, AUX1LOADED, Aux1File);
-          }
+          _snprintf(buf, buflen, "%s%s%s%s%s\n", EDX$X_VERSION, (dic->dichead->id[0] == 5) ? VERSNO5 : VERSNO6, EXANSICLEAR, AUX1LOADED, dic->Aux1File);
         }
       }
+      buf[buflen-1] = '\0';
+      len = strlen(buf);
+      format_dic_info(dic, buf + len, buflen - len);
+      len = strlen(buf);
+      format_session_info(&default_session, buf + len, buflen - len);
+      dic_unlock(&default_dic);
     }
     buf[buflen-1] = '\0';
 }
@@ -0,0 +1,166 @@
+/*
+edxspell.h - Interface to the EDX Spelling Checker DLL (edxspell.dll)
+Written by David Deley
+
+Include this file to call edxspell.dll from C or C++. Callers which load the
+DLL with LoadLibrary/GetProcAddress (such as Multi-Edit macros) do not need it.
+
+Two ways to use the spelling checker:
+
+1. The original single-user interface. edx$dic_lookup_word loads the EDX
+   dictionary on the first call, and edx$spell_guess then guesses spellings
+   for the last word looked up, one per call. (edx$spell_suggest returns the
+   best guesses for a word in one call.) These calls all share one default
+   session and must not be called from more than one thread at a time.
+
+2. The dictionary/session interface. Open an EDX dictionary once with
+   edx$dic_open, then create one session per thread with edx$session_create.
+   The dictionary is read-only once opened and may be shared by any number of
+   sessions. A session remembers the last word looked up and where it is in
+   guessing that word, so each thread needs its own session.
+   edx$dic_add_persdic adds a word to the user's Aux1 dictionary. Call it
+   from any thread; sessions go on looking words up and guessing while it
+   adds, and see the word once it returns.
+   edx$check_text and edx$check_file check every word of a text buffer or
+   file on a session, and edx$check_next hands back where the misspelled
+   words are. The file is checked a few megabytes at a time, however big.
+   edx$dic_reload loads the dictionary file again (or another one) and
+   switches the sessions over to it without stopping them: each call goes
+   on with the dictionary it started with, and a guess iteration with the
+   dictionary its word was looked up in. Call it from any thread; lookups
+   aren't held up while it loads.
+   edx$dic_open_stack opens a main dictionary with more dictionaries or
+   word lists stacked on it (a domain dictionary, a team's list), looked
+   in all at once, and edx$session_lookup_layer says which one a word
+   was found in.
+   edx$stats reports what the lookups and guesses on a dictionary have
+   cost, counted by all its sessions: common word hits, guide words
+   compared, bytes of pages and Aux1 words scanned, guesses made.
+   edx$latency reports how long lookups, spell guesses (by what they did),
+   edx$add_persdic and loading took, as percentiles from histograms, with
+   EDX_OPT_LATENCY set. edx$trace_save writes the calls slower than
+   EDX_OPT_TRACE_US to a file chrome://tracing or Perfetto loads.
+*/
+#if !defined(EDXSPELL_H__INCLUDED_)
+#define EDXSPELL_H__INCLUDED_
+
+#ifdef EDXSPELL_EXPORTS
+#define EDXSPELL_API extern "C" _declspec (dllexport)
+#else
+#define EDXSPELL_API extern "C" _declspec (dllimport)
+#endif
+
+/* Status values returned by the spelling checker */
+#define EDX__WORDFOUND 1
+#define EDX__WORDNOTFOUND 2
+#define EDX__ERROR 4
+
+#define MAXWORDLEN 31             /* maximum word length dictionary can store is 31 characters */
+#define EDX_SUGGESTION_LEN (MAXWORDLEN+2) /* size of each suggestion edx$spell_suggest returns (ASCIZ) */
+#define EDX_MAX_LAYERS 8          /* most dictionaries edx$dic_open_stack stacks on the main dictionary */
+
+/* Options for edx$set_option. They take effect for dictionaries loaded after the call. */
+#define EDX_OPT_HASH_INDEX 0      /* EDX_HASH_...: build a hash index of the main lexical database at load
+                                     (default EDX_HASH_UNLESS_FRONT_CODED) */
+#define EDX_HASH_NONE        0    /* no hash index */
+#define EDX_HASH_ALWAYS      1    /* a hash index, decoding a front coded dictionary's pages into memory for it */
+#define EDX_HASH_UNLESS_FRONT_CODED 2 /* a hash index unless the dictionary is front coded, which keeps its saving */
+#define EDX_OPT_BLOOM_BITS 1      /* Bloom filter bits per word, 0 for none (default 10, about 1% false positives) */
+#define EDX_OPT_SIMD       2      /* nonzero: scan dictionary pages with SSE2 if the processor has it (default 1) */
+#define EDX_OPT_GUIDE_INDEX 3     /* nonzero: speed up the guide word index search with a prefix jump table (default 1) */
+#define EDX_OPT_SYMSPELL   4      /* 1 or 2: guess spellings up to this many edits away from a suggestion index,
+                                     built once and saved next to the dictionary as a .sym file (default 0, don't) */
+#define EDX_OPT_DAWG       5      /* nonzero: guess spellings by walking a word graph of the dictionary instead of
+                                     looking each guess up. Built once and saved as a .dwg file (default 0, don't) */
+#define EDX_OPT_LEVENSHTEIN 6     /* 1 to 3: guess spellings up to this many edits away with a Levenshtein automaton
+                                     run over the dictionary pages. Needs no index (default 0, don't) */
+#define EDX_OPT_LEV_BUDGET_US 7   /* most microseconds one EDX_OPT_LEVENSHTEIN search may take, 0 for no limit (default 0) */
+#define EDX_OPT_LEV_MAX_WORDS 8   /* most dictionary words one EDX_OPT_LEVENSHTEIN search may compare, 0 for no limit (default 0) */
+#define EDX_OPT_LOOKUP_CACHE 9    /* words whose lookup result is cached, shared by all sessions on the dictionary.
+                                     Only worth it with EDX_OPT_HASH_INDEX 0 (default 0, no cache) */
+#define EDX_OPT_GUESS_CACHE 10    /* misspelled words whose guesses are kept for the next time they're guessed,
+                                     shared by all sessions on the dictionary, 0 for no cache (default 256) */
+#define EDX_OPT_GUESS_CACHE_FILE 11 /* nonzero: keep the guess cache in a .gsc file next to the user's Aux1
+                                     dictionary (or the dictionary), so it's kept across restarts (default 0) */
+#define EDX_OPT_FRONT_CODE       12 /* nonzero: edx$dic_save writes the main lexical database as front coded pages,
+                                     which are smaller but are decoded into memory for EDX_HASH_ALWAYS, the
+                                     suggestion index, the word graph and Levenshtein guessing (default 0) */
+#define EDX_OPT_RESIDENCY        13 /* EDX_RES_... bits: read the dictionary into memory when it's opened, instead
+                                     of a page at a time by the first lookups (default 0) */
+#define EDX_RES_RANDOM       0x01   /* open it for random access, no read ahead */
+#define EDX_RES_WILLNEED     0x02   /* read in the guide words, common words, hash index and Bloom filter */
+#define EDX_RES_PREFAULT     0x04   /* read in the whole file */
+#define EDX_RES_LARGE_PAGES  0x08   /* copy the guide words, hash index and Bloom filter into large pages
+                                       (needs the "Lock pages in memory" user right) */
+#define EDX_RES_LOCK         0x10   /* lock the whole file in memory */
+#define EDX_OPT_LATENCY          14 /* nonzero: time lookups, guesses, edx$add_persdic and loading into the
+                                     histograms edx$latency reports (default 0) */
+#define EDX_OPT_TRACE_US         15 /* calls slower than this many microseconds go in the trace edx$trace_save
+                                     writes, 0 none (default 0) */
+
+/* Formats of edx$stats and edx$latency report */
+#define EDX_STATS_TEXT 0          /* lines of text */
+#define EDX_STATS_JSON 1          /* one JSON object */
+
+struct edx_dictionary;            /* An open EDX dictionary (main lexical database + user's Aux1) */
+struct edx_session;               /* One caller's lookup/guessing state on an open dictionary */
+struct edx_check;                 /* A document being checked with edx$check_text/edx$check_file */
+
+/* One word of a batch passed to edx$dic_lookup_words/edx$session_lookup_words.
+   The word need not be lowercased or null terminated. */
+struct edx_wordref {
+   char *wdbeg;                   /* pointer to start of word */
+   int   wdlen;                   /* length of word */
+};
+
+/* One misspelled word of a document, returned by edx$check_next */
+struct edx_misspelling {
+   unsigned __int64 offset;       /* offset of the word from the start of the text or file */
+   unsigned long    length;       /* length of word */
+};
+
+/* Original single-user interface */
+EDXSPELL_API int  edx$dic_lookup_word(char *spellword, char *errbuf, int errbuflen, char *Dic_File_Name, char *Aux1_File_Name);
+EDXSPELL_API int  edx$spell_guess(char *guessword, char *errbuf, int errbuflen);
+EDXSPELL_API int  edx$add_persdic(char *newword, char *errbuf, int errbuflen);
+EDXSPELL_API void edx$dll_version(char *buf, int buflen);
+EDXSPELL_API int  edx$dic_lookup_words(struct edx_wordref *words, int nwords, int *status, char *errbuf, int errbuflen, char *Dic_File_Name, char *Aux1_File_Name);
+EDXSPELL_API int  edx$spell_suggest(char *word, int max_k, char *suggestions, int *nsuggestions, char *errbuf, int errbuflen);
+EDXSPELL_API int  edx$reload_dic(char *Dic_File_Name, char *errbuf, int errbuflen);
+
+/* Dictionary/session interface */
+EDXSPELL_API struct edx_dictionary * edx$dic_open(char *Dic_File_Name, char *Aux1_File_Name, char *errbuf, int errbuflen);
+EDXSPELL_API void edx$dic_close(struct edx_dictionary *dic);
+EDXSPELL_API int  edx$dic_add_persdic(struct edx_dictionary *dic, char *newword, char *errbuf, int errbuflen);
+EDXSPELL_API int  edx$dic_reload(struct edx_dictionary *dic, char *Dic_File_Name, char *errbuf, int errbuflen);
+EDXSPELL_API struct edx_dictionary * edx$dic_open_stack(char **File_Names, int nfiles, char *Aux1_File_Name, char *errbuf, int errbuflen);
+EDXSPELL_API int  edx$session_lookup_layer(struct edx_session *ses, char *spellword, int *layer, char *errbuf, int errbuflen);
+EDXSPELL_API int  edx$dic_layer_name(struct edx_dictionary *dic, int layer, char *buf, int buflen);
+EDXSPELL_API struct edx_session * edx$session_create(struct edx_dictionary *dic);
+EDXSPELL_API void edx$session_delete(struct edx_session *ses);
+EDXSPELL_API int  edx$session_lookup_word(struct edx_session *ses, char *spellword, char *errbuf, int errbuflen);
+EDXSPELL_API int  edx$session_spell_guess(struct edx_session *ses, char *guessword, char *errbuf, int errbuflen);
+EDXSPELL_API int  edx$session_lookup_words(struct edx_session *ses, struct edx_wordref *words, int nwords, int *status, char *errbuf, int errbuflen);
+EDXSPELL_API int  edx$session_suggest(struct edx_session *ses, char *word, int max_k, char *suggestions, int *nsuggestions, char *errbuf, int errbuflen);
+EDXSPELL_API int  edx$set_option(int option, unsigned long value);
+EDXSPELL_API void edx$dic_info(struct edx_dictionary *dic, char *buf, int buflen);
+EDXSPELL_API int  edx$dic_save(struct edx_dictionary *dic, char *File_Name, char *errbuf, int errbuflen);
+EDXSPELL_API int  edx$dic_verify(struct edx_dictionary *dic, char *errbuf, int errbuflen);
+EDXSPELL_API void edx$session_info(struct edx_session *ses, char *buf, int buflen);
+EDXSPELL_API int  edx$stats(struct edx_dictionary *dic, int format, char *buf, int buflen);
+EDXSPELL_API int  edx$latency(struct edx_dictionary *dic, int format, char *buf, int buflen);
+EDXSPELL_API int  edx$trace_save(struct edx_dictionary *dic, char *File_Name, char *errbuf, int errbuflen);
+
+/* Checking a whole document (text buffer or file) on a session */
+EDXSPELL_API struct edx_check * edx$check_text(struct edx_session *ses, char *text, unsigned __int64 textlen, char *errbuf, int errbuflen);
+EDXSPELL_API struct edx_check * edx$check_file(struct edx_session *ses, char *File_Name, char *errbuf, int errbuflen);
+EDXSPELL_API int  edx$check_next(struct edx_check *chk, struct edx_misspelling *words, int maxwords, int *nwords, char *errbuf, int errbuflen);
+EDXSPELL_API unsigned __int64 edx$check_words(struct edx_check *chk);
+EDXSPELL_API void edx$check_close(struct edx_check *chk);
+EDXSPELL_API void edx$scan_benchmark(struct edx_dictionary *dic, char *buf, int buflen);
+EDXSPELL_API void edx$index_benchmark(struct edx_dictionary *dic, char *buf, int buflen);
+EDXSPELL_API void edx$suggest_benchmark(struct edx_dictionary *dic, char *buf, int buflen);
+EDXSPELL_API void edx$lookup_benchmark(struct edx_dictionary *dic, char *buf, int buflen);
+EDXSPELL_API void edx$startup_benchmark(char *Dic_File_Name, char *buf, int buflen);
+
+#endif // !defined(EDXSPELL_H__INCLUDED_)